@@ -70,8 +70,16 @@ void Job::uncommit() {
 }
 
 void Job::pushRevision(const std::shared_ptr<std::vector<uint8_t>>& data) {
-
     _description.deserialize(data);
+    onRevisionPushed();
+}
+
+void Job::pushRevision(const std::shared_ptr<HostDescriptionSegment>& segment) {
+    _description.deserialize(segment);
+    onRevisionPushed();
+}
+
+void Job::onRevisionPushed() {
     _priority = _description.getPriority();
     if (_description.getMaxDemand() > 0) {
         // Set max. demand to more restrictive number
@@ -195,6 +195,8 @@ public:
     void uncommit();
     // Add the job description of the next (or the first/only) revision.
     void pushRevision(const std::shared_ptr<std::vector<uint8_t>>& data);
+    // Add the next revision, which resides in a host-wide shared memory segment.
+    void pushRevision(const std::shared_ptr<HostDescriptionSegment>& segment);
     // Starts the execution of a new job.
     void start();
     // Suspend the execution of all internal solvers. They can be resumed at any time.
@@ -227,7 +229,7 @@ public:
     bool isIncremental() const {return JobDescription::isApplicationIncremental(_appl);}
     bool hasDescription() const {return _has_description;};
     const JobDescription& getDescription() const {assert(hasDescription()); return _description;};
-    const std::shared_ptr<std::vector<uint8_t>>& getSerializedDescription(int revision) {return _description.getSerialization(revision);};
+    std::shared_ptr<std::vector<uint8_t>> getSerializedDescription(int revision) {return _description.getSerialization(revision);};
     bool hasCommitment() const {return _commitment.has_value();}
     const JobRequest& getCommitment() const {assert(hasCommitment()); return _commitment.value();}
     int getId() const {return _id;};
@@ -322,6 +324,9 @@ public:
         return _name.c_str();
     };
     const char* jobStateToStr() const {return JOB_STATE_STRINGS[(int)_state];};
+
+private:
+    void onRevisionPushed();
 };
 
 #endif
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "util/assert.hpp"
 #include "util/hashing.hpp"
 #include "app/sat/data/clause_metadata_def.hpp"
+#include "app/sat/data/clause_kernels.hpp"
 
 namespace Mallob {
     
@@ -55,18 +56,8 @@ namespace Mallob {
     };
 
     inline size_t commutativeHash(const int* begin, int size, int which = 3) {
-        static unsigned const int primes [] = 
-            {2038072819, 2038073287, 2038073761, 2038074317,
-            2038072823,	2038073321,	2038073767, 2038074319,
-            2038072847,	2038073341,	2038073789,	2038074329,
-            2038074751,	2038075231,	2038075751,	2038076267};
-        
-        size_t res = 1;
-        for (auto it = begin + MALLOB_CLAUSE_METADATA_SIZE; it != begin+size; it++) {
-            int lit = *it;
-            res ^= lit * primes[abs((lit^which) & 15)];
-        }
-        return res;
+        return clause_kernels::commutativeHash(begin + MALLOB_CLAUSE_METADATA_SIZE,
+            size - MALLOB_CLAUSE_METADATA_SIZE, which);
     }
 
     /*
@@ -0,0 +1,222 @@
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+Low-level kernels for the per-clause work of clause sharing: sorting the
+literals of a clause and computing its commutative hash. Each kernel has a
+portable scalar implementation and, if compiled with AVX2 support
+(-DMALLOB_USE_AVX2=1), a vectorized implementation. Both implementations
+produce bit-identical results.
+*/
+namespace clause_kernels {
+
+    // Without vectorization, clauses up to this many literals are sorted
+    // with a scalar sorting network. For longer clauses, the network's
+    // number of comparators outweighs the branch mispredictions of std::sort.
+    constexpr int MAX_SCALAR_NETWORK_SIZE = 12;
+
+    inline void compareExchange(int* lits, int i, int j) {
+        int a = lits[i], b = lits[j];
+        lits[i] = std::min(a, b);
+        lits[j] = std::max(a, b);
+    }
+
+    // Comparators of Batcher's merge exchange sort (Knuth, TAOCP Vol. 3,
+    // Algorithm 5.2.2M) for N elements, computed at compile time.
+    struct Comparator {
+        int i;
+        int j;
+    };
+    template <int N>
+    struct MergeExchangeNetwork {
+        static constexpr int numComparators() {
+            return forEachComparator([](int, int) {});
+        }
+        static constexpr auto comparators() {
+            std::array<Comparator, numComparators()> out {};
+            int k = 0;
+            forEachComparator([&](int i, int j) {
+                out[k].i = i;
+                out[k].j = j;
+                k++;
+            });
+            return out;
+        }
+    private:
+        template <typename F>
+        static constexpr int forEachComparator(F f) {
+            if (N <= 1) return 0;
+            int t = 0;
+            while ((1 << t) < N) t++;
+            int count = 0;
+            for (int p = 1 << (t-1); p > 0; p >>= 1) {
+                int q = 1 << (t-1), r = 0, d = p;
+                while (d > 0) {
+                    for (int i = 0; i + d < N; i++) {
+                        if ((i & p) == r) {
+                            f(i, i+d);
+                            count++;
+                        }
+                    }
+                    d = q - p;
+                    q >>= 1;
+                    r = p;
+                }
+            }
+            return count;
+        }
+    };
+
+    template <int N, std::size_t... Cs>
+    inline void applyNetwork(int* lits, std::index_sequence<Cs...>) {
+        // Nothing to do for N <= 1 (no comparators)
+        if constexpr (sizeof...(Cs) > 0) {
+            static constexpr auto comparators = MergeExchangeNetwork<N>::comparators();
+            // Work on a local copy which the compiler can keep in registers
+            int buf[N];
+            std::copy(lits, lits+N, buf);
+            (compareExchange(buf, comparators[Cs].i, comparators[Cs].j), ...);
+            std::copy(buf, buf+N, lits);
+        }
+    }
+
+    // Sorts exactly N literals with a fully unrolled, branch-free sorting network.
+    template <int N>
+    inline void sortNetwork(int* lits) {
+        applyNetwork<N>(lits, std::make_index_sequence<MergeExchangeNetwork<N>::numComparators()>());
+    }
+
+    template <std::size_t... Ns>
+    constexpr auto makeSortNetworkTable(std::index_sequence<Ns...>) {
+        return std::array<void(*)(int*), sizeof...(Ns)> {&sortNetwork<Ns>...};
+    }
+
+#ifdef __AVX2__
+    // Bitonic sort of 8*R integers held in R AVX2 registers.
+    // Compare-exchanges between lanes of the same register are done via a
+    // lane permutation followed by min/max and a blend which selects the
+    // maximum for the upper lane of each pair (the lower lane for descending pairs).
+    template <int R, int K, int J>
+    inline void bitonicStage(__m256i* v) {
+        if constexpr (J >= 8) {
+            // Partners reside in different registers, at the same lane
+            constexpr int jr = J/8;
+            for (int r = 0; r < R; r++) {
+                if (r & jr) continue;
+                bool ascending = ((8*r) & K) == 0;
+                __m256i mn = _mm256_min_epi32(v[r], v[r+jr]);
+                __m256i mx = _mm256_max_epi32(v[r], v[r+jr]);
+                v[r] = ascending ? mn : mx;
+                v[r+jr] = ascending ? mx : mn;
+            }
+        } else {
+            const __m256i perm = _mm256_setr_epi32(0^J, 1^J, 2^J, 3^J, 4^J, 5^J, 6^J, 7^J);
+            for (int r = 0; r < R; r++) {
+                auto takesMax = [&](int lane) {
+                    int i = 8*r + lane;
+                    return (((i & J) != 0) != ((i & K) != 0)) ? -1 : 0;
+                };
+                const __m256i maxMask = _mm256_setr_epi32(takesMax(0), takesMax(1), takesMax(2),
+                    takesMax(3), takesMax(4), takesMax(5), takesMax(6), takesMax(7));
+                __m256i partner = _mm256_permutevar8x32_epi32(v[r], perm);
+                __m256i mn = _mm256_min_epi32(v[r], partner);
+                __m256i mx = _mm256_max_epi32(v[r], partner);
+                v[r] = _mm256_blendv_epi8(mn, mx, maxMask);
+            }
+        }
+        if constexpr (J > 1) bitonicStage<R, K, J/2>(v);
+    }
+    template <int R, int K = 2>
+    inline void bitonicSort(__m256i* v) {
+        bitonicStage<R, K, K/2>(v);
+        if constexpr (K < 8*R) bitonicSort<R, 2*K>(v);
+    }
+
+    // Sorts up to 8*R literals, padding the registers with INT_MAX.
+    template <int R>
+    inline void sortVectorized(int* lits, int size) {
+        alignas(32) int buf[8*R];
+        std::copy(lits, lits+size, buf);
+        std::fill(buf+size, buf+8*R, INT_MAX);
+        __m256i v[R];
+        for (int r = 0; r < R; r++) v[r] = _mm256_load_si256((const __m256i*) (buf + 8*r));
+        bitonicSort<R>(v);
+        for (int r = 0; r < R; r++) _mm256_store_si256((__m256i*) (buf + 8*r), v[r]);
+        std::copy(buf, buf+size, lits);
+    }
+#endif
+
+    // Sorts the literals in ascending order (same result as std::sort).
+    inline void sortLiterals(int* lits, int size) {
+#ifdef __AVX2__
+        if (size <= 8) return sortVectorized<1>(lits, size);
+        if (size <= 16) return sortVectorized<2>(lits, size);
+        if (size <= 32) return sortVectorized<4>(lits, size);
+#else
+        static constexpr auto networks = makeSortNetworkTable(
+            std::make_index_sequence<MAX_SCALAR_NETWORK_SIZE+1>());
+        if (size <= MAX_SCALAR_NETWORK_SIZE) return networks[size](lits);
+#endif
+        std::sort(lits, lits+size);
+    }
+
+    static constexpr uint32_t HASH_PRIMES[] =
+        {2038072819, 2038073287, 2038073761, 2038074317,
+        2038072823, 2038073321, 2038073767, 2038074319,
+        2038072847, 2038073341, 2038073789, 2038074329,
+        2038074751, 2038075231, 2038075751, 2038076267};
+
+    // Commutative hash of a set of literals: the XOR over all literals,
+    // each multiplied (in 32 bits) with a prime selected by its lowest bits.
+    inline size_t commutativeHash(const int* lits, int size, int which) {
+        uint32_t res = 0;
+        int i = 0;
+#ifdef __AVX2__
+        const __m256i primesLo = _mm256_loadu_si256((const __m256i*) HASH_PRIMES);
+        const __m256i primesHi = _mm256_loadu_si256((const __m256i*) (HASH_PRIMES+8));
+        const __m256i whichVec = _mm256_set1_epi32(which);
+        const __m256i fifteen = _mm256_set1_epi32(15);
+        const __m256i eight = _mm256_set1_epi32(8);
+        __m256i acc = _mm256_setzero_si256();
+        for (; i+8 <= size; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) (lits+i));
+            __m256i idx = _mm256_and_si256(_mm256_xor_si256(v, whichVec), fifteen);
+            // permutevar only regards the lowest three bits of each index
+            __m256i useHi = _mm256_cmpeq_epi32(_mm256_and_si256(idx, eight), eight);
+            __m256i primes = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(primesLo, idx),
+                _mm256_permutevar8x32_epi32(primesHi, idx), useHi);
+            acc = _mm256_xor_si256(acc, _mm256_mullo_epi32(v, primes));
+        }
+        __m128i acc4 = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        acc4 = _mm_xor_si128(acc4, _mm_shuffle_epi32(acc4, 0b01001110));
+        acc4 = _mm_xor_si128(acc4, _mm_shuffle_epi32(acc4, 0b10110001));
+        res = (uint32_t) _mm_cvtsi128_si32(acc4);
+#else
+        // Four independent accumulators to break the dependency chain
+        uint32_t acc[4] = {0, 0, 0, 0};
+        for (; i+4 <= size; i += 4) {
+            for (int j = 0; j < 4; j++) {
+                int lit = lits[i+j];
+                acc[j] ^= lit * HASH_PRIMES[(lit^which) & 15];
+            }
+        }
+        res = acc[0] ^ acc[1] ^ acc[2] ^ acc[3];
+#endif
+        for (; i < size; i++) {
+            int lit = lits[i];
+            res ^= lit * HASH_PRIMES[(lit^which) & 15];
+        }
+        return 1 ^ (size_t) res;
+    }
+}
@@ -1,12 +1,20 @@
 
 #pragma once
 
+#include <string>
+#include <cstdio>
+
 struct SharingStatistics {
 
 	unsigned long exportedClauses = 0;
 	unsigned long clausesDroppedAtExport = 0;
 	unsigned long clausesProcessFilteredAtExport = 0;
 	unsigned long clausesSolverFilteredAtExport = 0;
+	unsigned long filterLockAcquisitions = 0;
+	unsigned long filterLockContentions = 0;
+	unsigned long filterMemoryBytes = 0;
+	unsigned long filterEvictions = 0;
+	double filterFalsePositiveProbability = 0;
 	ClauseHistogram* histProduced;
 	ClauseHistogram* histFailedFilter;
 	ClauseHistogram* histAdmittedToDb;
@@ -18,11 +26,19 @@ struct SharingStatistics {
 		unsigned long failedExported = clausesProcessFilteredAtExport + clausesSolverFilteredAtExport + clausesDroppedAtExport;
 		unsigned long exportedWithFailed = exportedClauses + failedExported;
 		float droppedRatio = failedExported == 0 ? 0 : (float)clausesDroppedAtExport / failedExported;
+		char fpr[16];
+		snprintf(fpr, sizeof(fpr), "%.2e", filterFalsePositiveProbability);
+		float contendedRatio = filterLockAcquisitions == 0 ? 0 : (float)filterLockContentions / filterLockAcquisitions;
 
 		return "exp:" + std::to_string(exportedClauses) + "/" + std::to_string(exportedWithFailed)
 			+ " drp:" + std::to_string(clausesDroppedAtExport) 
 					+ "(" + std::to_string((float) (0.01 * (int)(droppedRatio*100))) + ")"
 			+ " pflt:" + std::to_string(clausesProcessFilteredAtExport)
-			+ " sflt:" + std::to_string(clausesSolverFilteredAtExport);
+			+ " sflt:" + std::to_string(clausesSolverFilteredAtExport)
+			+ " flck:" + std::to_string(filterLockContentions) + "/" + std::to_string(filterLockAcquisitions)
+					+ "(" + std::to_string((float) (0.01 * (int)(contendedRatio*100))) + ")"
+			+ " fmem:" + std::to_string(filterMemoryBytes / (1ul << 20)) + "MB"
+			+ " fevc:" + std::to_string(filterEvictions)
+			+ " ffpr:" + fpr;
 	}
 };
@@ -122,8 +122,7 @@ SatEngine::SatEngine(const Parameters& params, const SatProcessConfig& config, L
 		cyclePos = (cyclePos+1) % solverChoices.size();
 	}
 
-	_sharing_manager.reset(new SharingManager(_solver_interfaces, _params, _logger, 
-		/*max. deferred literals per solver=*/5*config.maxBroadcastedLitsPerCycle, config.apprank));
+	_sharing_manager.reset(new SharingManager(_solver_interfaces, _params, _logger, config.apprank));
 	LOGGER(_logger, V5_DEBG, "initialized\n");
 }
 
@@ -277,6 +276,11 @@ int SatEngine::solveLoop() {
     return -1; // no result yet
 }
 
+void SatEngine::collectProducedClauses() {
+	if (isCleanedUp()) return;
+	_sharing_manager->collectProducedClauses();
+}
+
 int SatEngine::prepareSharing(int* begin, int maxSize) {
 	if (isCleanedUp()) return sizeof(size_t) / sizeof(int); // checksum, nothing else
 	LOGGER(_logger, V5_DEBG, "collecting clauses on this node\n");
@@ -58,6 +58,7 @@ public:
     int solveLoop();
 	JobResult& getResult() {return _result;}
 
+	void collectProducedClauses();
     int prepareSharing(int* begin, int maxSize);
 	int filterSharing(int* begin, int size, int* filterOut);
 	void digestSharingWithFilter(int* begin, int size, const int* filter);
@@ -17,6 +17,7 @@
 #include "util/sys/proc.hpp"
 #include "data/checksum.hpp"
 #include "util/sys/terminator.hpp"
+#include "data/host_description_store.hpp"
 
 #include "engine.hpp"
 #include "../job/sat_shared_memory.hpp"
@@ -40,6 +41,9 @@ private:
     int _desired_revision;
     Checksum* _checksum;
 
+    // Mappings of revisions residing in host-wide shared memory
+    std::vector<std::shared_ptr<HostDescriptionSegment>> _host_segments;
+
 public:
     SatProcess(const Parameters& params, const SatProcessConfig& config, Logger& log) 
         : _params(params), _config(config), _log(log), _engine(_params, _config, _log) {
@@ -74,8 +78,8 @@ public:
         // Import first revision
         _desired_revision = _config.firstrev;
         {
-            int* fPtr = (int*) accessMemory(_shmem_id + ".formulae.0", sizeof(int) * _hsm->fSize);
-            int* aPtr = (int*) accessMemory(_shmem_id + ".assumptions.0", sizeof(int) * _hsm->aSize);
+            const int* fPtr; const int* aPtr;
+            accessRevisionPayload(0, _hsm->fSize, _hsm->aSize, fPtr, aPtr);
             _engine.appendRevision(0, _hsm->fSize, fPtr, _hsm->aSize, aPtr, 
                 /*finalRevisionForNow=*/_desired_revision == 0);
             updateChecksum(fPtr, _hsm->fSize);
@@ -139,6 +143,9 @@ public:
             }
             if (!_hsm->doDumpStats) _hsm->didDumpStats = false;
 
+            // Move clauses produced by the solvers into the clause database
+            _engine.collectProducedClauses();
+
             // Check if clauses should be exported
             if (_hsm->doExport && !_hsm->didExport) {
                 LOGGER(_log, V5_DEBG, "DO export clauses\n");
@@ -247,7 +254,27 @@ private:
         return ptr;
     }
 
-    void updateChecksum(int* ptr, size_t size) {
+    void accessRevisionPayload(int revision, size_t fSize, size_t aSize, const int*& fPtr, const int*& aPtr) {
+        auto revStr = std::to_string(revision);
+        auto refId = _shmem_id + ".hostdesc." + revStr;
+        if (SharedMemory::canAccess(refId)) {
+            // Map the payload (read-only) from where the parent's description resides
+            auto ref = (HostSegmentReference*) accessMemory(refId, sizeof(HostSegmentReference));
+            auto segment = HostDescriptionStore::map(ref->segmentId);
+            if (!segment) {
+                LOGGER(_log, V0_CRIT, "[ERROR] Could not map host-wide shmem %s\n", ref->segmentId);
+                Process::doExit(0);
+            }
+            fPtr = (const int*) (segment->data() + ref->formulaOffset);
+            aPtr = (const int*) (segment->data() + ref->assumptionsOffset);
+            _host_segments.push_back(std::move(segment));
+            return;
+        }
+        fPtr = (const int*) accessMemory(_shmem_id + ".formulae." + revStr, sizeof(int) * fSize);
+        aPtr = (const int*) accessMemory(_shmem_id + ".assumptions." + revStr, sizeof(int) * aSize);
+    }
+
+    void updateChecksum(const int* ptr, size_t size) {
         if (_checksum == nullptr) return;
         for (size_t i = 0; i < size; i++) _checksum->combine(ptr[i]);
     }
@@ -272,8 +299,8 @@ private:
         size_t* fSizePtr = (size_t*) accessMemory(_shmem_id + ".fsize." + std::to_string(revision), sizeof(size_t));
         size_t* aSizePtr = (size_t*) accessMemory(_shmem_id + ".asize." + std::to_string(revision), sizeof(size_t));
         LOGGER(_log, V4_VVER, "Read rev. %i/%i : %i lits, %i assumptions\n", revision, _desired_revision, *fSizePtr, *aSizePtr);
-        int* fPtr = (int*) accessMemory(_shmem_id + ".formulae." + std::to_string(revision), sizeof(int) * (*fSizePtr));
-        int* aPtr = (int*) accessMemory(_shmem_id + ".assumptions." + std::to_string(revision), sizeof(int) * (*aSizePtr));
+        const int* fPtr; const int* aPtr;
+        accessRevisionPayload(revision, *fSizePtr, *aSizePtr, fPtr, aPtr);
         
         if (checksum != nullptr) {
             // Append accessed data to local checksum
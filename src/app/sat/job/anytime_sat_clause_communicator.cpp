@@ -47,11 +47,8 @@ void AnytimeSatClauseCommunicator::communicate() {
     // no communication at all?
     if (_params.appCommPeriod() <= 0) return;
 
-    // update role in distributed filter
-    //_filter.update(_job->getJobTree().getIndex(), _job->getVolume());
-
     // clean up old sessions
-    while (_sessions.size() > 1) {
+    while (_sessions.size() > getMaxNumActiveSessions()) {
         auto& session = _sessions.front();
         if (!session.isDestructible()) break;
         // can be deleted
@@ -62,7 +59,7 @@ void AnytimeSatClauseCommunicator::communicate() {
     if (_job->getJobTree().isRoot()) {
         auto time = Timer::elapsedSeconds();
         bool nextEpochDue = time - _time_of_last_epoch_initiation >= _params.appCommPeriod();
-        bool lastEpochDone = _time_of_last_epoch_conclusion > 0;
+        bool lastEpochDone = isReadyForNextEpoch();
         if (nextEpochDue && !lastEpochDone) {
             LOG(V1_WARN, "[WARN] %s : Next epoch over-due!\n", _job->toStr());
         }
@@ -86,9 +83,19 @@ void AnytimeSatClauseCommunicator::communicate() {
         }
     }
 
-    if (_sessions.empty()) return;
-    auto& session = currentSession();
-    if (!session.isValid()) return;
+    // Advance the active sessions from the oldest to the newest. The local 
+    // solvers filter and digest one sharing at a time, so a session may only
+    // begin filtering after all preceding sessions are done filtering.
+    bool predecessorsFiltered = true;
+    for (auto it = getFirstActiveSession(); it != _sessions.end(); ++it) {
+        auto& session = *it;
+        if (!session.isValid()) continue;
+        advanceSession(session, predecessorsFiltered);
+        if (session.isValid()) predecessorsFiltered = false;
+    }
+}
+
+void AnytimeSatClauseCommunicator::advanceSession(Session& session, bool predecessorsFiltered) {
 
     // Done preparing sharing?
     if (!session._allreduce_clauses.hasProducer() && _job->hasPreparedSharing()) {
@@ -98,9 +105,17 @@ void AnytimeSatClauseCommunicator::communicate() {
         session._allreduce_clauses.produce([&]() {
             Checksum checksum;
             auto clauses = _job->getPreparedClauses(checksum);
+            if (_params.compactClauseBuffers()) {
+                // Encode as many clauses as the byte limit admits, return the rest
+                std::vector<int> excess;
+                clauses = _cdb.encodeCompactBuffer(clauses.data(), clauses.size(), 
+                    sizeof(int) * _job->getBufferLimit(1, MyMpi::SELF), &excess);
+                if (excess.size() > sizeof(size_t)/sizeof(int)+1) _job->returnClauses(excess);
+            }
             clauses.push_back(1); // # aggregated workers
             return clauses;
         });
+        session._time_produced_clauses = Timer::elapsedSeconds();
     
         // Calculate new sharing compensation factor from last sharing statistics
         auto [nbAdmitted, nbBroadcast] = _job->getLastAdmittedClauseShare();
@@ -118,7 +133,7 @@ void AnytimeSatClauseCommunicator::communicate() {
     
     } else if (!session._allreduce_clauses.hasProducer()) {
         // No sharing prepared yet: Retry
-        _job->prepareSharing(_job->getBufferLimit(1, MyMpi::SELF));
+        _job->prepareSharing(getLocalSharingLimit());
     }
     
     // Advance all-reduction of clauses
@@ -127,7 +142,8 @@ void AnytimeSatClauseCommunicator::communicate() {
     // All-reduction of clauses finished?
     if (session._allreduce_clauses.hasResult()) {
 
-        LOG(V4_VVER, "%s CS filter\n", _job->toStr());
+        LOG(V4_VVER, "%s CS received cls\n", _job->toStr());
+        session._time_received_clauses = Timer::elapsedSeconds();
 
         // Some clauses may have been left behind during merge
         if (session._excess_clauses_from_merge.size() > sizeof(size_t)/sizeof(int)) {
@@ -138,16 +154,40 @@ void AnytimeSatClauseCommunicator::communicate() {
 
         // Fetch initial clause buffer (result of all-reduction of clauses)
         session._broadcast_clause_buffer = session._allreduce_clauses.extractResult();
+        if (_params.compactClauseBuffers()) {
+            auto& buf = session._broadcast_clause_buffer;
+            buf = _cdb.decodeCompactBuffer(buf.data(), buf.size());
+        }
+        if (_params.distributedDuplicateDetection()) session.computeBroadcastKeys();
+
+        session._has_broadcast_clauses = true;
+    }
 
-        // Initiate production of local filter element for 2nd all-reduction 
+    // Initiate production of local filter element for 2nd all-reduction
+    if (session._has_broadcast_clauses && !session.isFiltering() && predecessorsFiltered) {
+        LOG(V4_VVER, "%s CS filter\n", _job->toStr());
         _job->filterSharing(session._broadcast_clause_buffer);
+        session.setFiltering();
     }
 
     // Supply calculated local filter to the 2nd all-reduction
-    if (!session._allreduce_filter.hasProducer() && _job->hasFilteredSharing()) {
+    if (session.isFiltering() && !session._allreduce_filter.hasProducer() && _job->hasFilteredSharing()) {
         LOG(V4_VVER, "%s CS produce filter\n", _job->toStr());
-        session._allreduce_filter.produce([&]() {return _job->getLocalFilter();});
-    } 
+        session._allreduce_filter.produce([&]() {
+            auto localFilter = _job->getLocalFilter();
+            if (!_params.distributedDuplicateDetection()) return localFilter;
+            // Replace the filter of the local solvers: only report duplicates
+            // among the clauses of this node's fingerprint range
+            session._filter_volume = _job->getVolume();
+            _filter.update(_job->getJobTree().getIndex(), session._filter_volume);
+            auto filter = _filter.getLocalFilter(session._broadcast_keys, session._epoch);
+            LOG(V5_DEBG, "%s CS ddd rank=%i/%i filter=%i/%i mem=%lu evictions=%lu\n", _job->toStr(), 
+                _filter.getRank(), session._filter_volume, _filter.getNumFiltered(), _filter.getNumChecked(), 
+                _filter.getMemoryBytes(), _filter.getNumEvictions());
+            return filter;
+        });
+        session._time_produced_filter = Timer::elapsedSeconds();
+    }
 
     // Advance all-reduction of filter
     session._allreduce_filter.advance();
@@ -159,17 +199,79 @@ void AnytimeSatClauseCommunicator::communicate() {
 
         // Extract and digest result
         auto filter = session._allreduce_filter.extractResult();
+        if (_params.distributedDuplicateDetection()) 
+            filter = DistributedClauseFilter::toPlainFilter(filter, session._broadcast_keys);
         _job->applyFilter(filter);
         if (_use_cls_history) {
             auto filteredClauses = session.applyGlobalFilter(filter, session._broadcast_clause_buffer);
             addToClauseHistory(filteredClauses, session._epoch);
         }
 
-        // Conclude this sharing epoch
-        _time_of_last_epoch_conclusion = Timer::elapsedSeconds();
+        concludeSession(session);
+    }
+}
+
+void AnytimeSatClauseCommunicator::concludeSession(Session& session) {
+
+    // Conclude this sharing epoch
+    _time_of_last_epoch_conclusion = Timer::elapsedSeconds();
+
+    // Report latencies of the individual stages
+    float exportClauses = session._time_produced_clauses - session._time_initiated;
+    float allReduceClauses = session._time_received_clauses - session._time_produced_clauses;
+    float filterClauses = session._time_produced_filter - session._time_received_clauses;
+    float allReduceFilter = _time_of_last_epoch_conclusion - session._time_produced_filter;
+    float total = _time_of_last_epoch_conclusion - session._time_initiated;
+    auto& lat = _latencies;
+    lat.nbSessions++;
+    lat.exportClauses += exportClauses;
+    lat.allReduceClauses += allReduceClauses;
+    lat.filterClauses += filterClauses;
+    lat.allReduceFilter += allReduceFilter;
+    lat.total += total;
+    LOG(V4_VVER, 
+        "%s CS e=%i latency export=%.4f allredcls=%.4f filter=%.4f allredfilter=%.4f total=%.4f "
+        "(avg. %.4f %.4f %.4f %.4f %.4f)\n", _job->toStr(), session._epoch, 
+        exportClauses, allReduceClauses, filterClauses, allReduceFilter, total,
+        lat.exportClauses / lat.nbSessions, lat.allReduceClauses / lat.nbSessions, 
+        lat.filterClauses / lat.nbSessions, lat.allReduceFilter / lat.nbSessions, 
+        lat.total / lat.nbSessions);
+}
+
+int AnytimeSatClauseCommunicator::getMaxNumActiveSessions() const {
+    // Pipelining: At most two epochs are in flight at the same time
+    return _params.pipelineSharingEpochs() ? 2 : 1;
+}
+
+std::list<AnytimeSatClauseCommunicator::Session>::iterator AnytimeSatClauseCommunicator::getFirstActiveSession() {
+    // Only the newest session(s) are advanced; older sessions are abandoned
+    auto it = _sessions.end();
+    for (int i = 0; i < getMaxNumActiveSessions() && it != _sessions.begin(); i++) --it;
+    return it;
+}
+
+AnytimeSatClauseCommunicator::Session* AnytimeSatClauseCommunicator::getActiveSession(int epoch) {
+    for (auto it = getFirstActiveSession(); it != _sessions.end(); ++it) {
+        if (it->_epoch == epoch) return &(*it);
     }
+    return nullptr;
 }
 
+bool AnytimeSatClauseCommunicator::isReadyForNextEpoch() {
+    if (!_params.pipelineSharingEpochs()) return _time_of_last_epoch_conclusion > 0;
+    // The next epoch may begin as soon as the all-reduction of clauses of
+    // the current epoch is done and the epoch before has concluded.
+    int nbInFlight = 0;
+    bool newestReducedClauses = true;
+    for (auto it = getFirstActiveSession(); it != _sessions.end(); ++it) {
+        if (!it->isValid()) continue;
+        nbInFlight++;
+        newestReducedClauses = it->_has_broadcast_clauses;
+    }
+    return nbInFlight == 0 || (nbInFlight == 1 && newestReducedClauses);
+}
+
+
 void AnytimeSatClauseCommunicator::handle(int source, int mpiTag, JobMessage& msg) {
 
     if (msg.jobId != _job->getId()) {
@@ -221,21 +323,21 @@ void AnytimeSatClauseCommunicator::handle(int source, int mpiTag, JobMessage& ms
             _job->getJobTree().getNumChildren());
         _sessions.emplace_back(_params, _job, _cdb, _current_epoch);
         if (!_job->hasPreparedSharing()) {
-            int limit = _job->getBufferLimit(1, MyMpi::SELF);
-            _job->prepareSharing(limit);
+            _job->prepareSharing(getLocalSharingLimit());
         }
         advanceCollective(_job, msg, MSG_INITIATE_CLAUSE_SHARING);
     }
 
     // Advance all-reductions
     bool success = false;
-    if (!_sessions.empty() && msg.tag == MSG_ALLREDUCE_CLAUSES && currentSession()._allreduce_clauses.isValid()) {
-        success = currentSession()._allreduce_clauses.receive(source, mpiTag, msg);
-        currentSession()._allreduce_clauses.advance();
+    Session* session = getActiveSession(msg.epoch);
+    if (session != nullptr && msg.tag == MSG_ALLREDUCE_CLAUSES && session->_allreduce_clauses.isValid()) {
+        success = session->_allreduce_clauses.receive(source, mpiTag, msg);
+        session->_allreduce_clauses.advance();
     }
-    if (!_sessions.empty() && msg.tag == MSG_ALLREDUCE_FILTER && currentSession()._allreduce_filter.isValid()) {
-        success = currentSession()._allreduce_filter.receive(source, mpiTag, msg);
-        currentSession()._allreduce_filter.advance();
+    if (session != nullptr && msg.tag == MSG_ALLREDUCE_FILTER && session->_allreduce_filter.isValid()) {
+        success = session->_allreduce_filter.receive(source, mpiTag, msg);
+        session->_allreduce_filter.advance();
     }
     if (!success) {
         // Special case where clauses are broadcast but message was not processed:
@@ -248,10 +350,28 @@ void AnytimeSatClauseCommunicator::handle(int source, int mpiTag, JobMessage& ms
     }
 }
 
+int AnytimeSatClauseCommunicator::getLocalSharingLimit() {
+    int limit = _job->getBufferLimit(1, MyMpi::SELF);
+    // A compact contribution of the same byte size fits more clauses, 
+    // so more clauses are requested from the local solvers
+    if (_params.compactClauseBuffers()) limit *= COMPACT_BUFFER_OVERSUPPLY;
+    return limit;
+}
+
 void AnytimeSatClauseCommunicator::feedHistoryIntoSolver() {
     if (_use_cls_history) _cls_history.feedHistoryIntoSolver();
 }
 
+void AnytimeSatClauseCommunicator::Session::computeBroadcastKeys() {
+    _broadcast_keys.clear();
+    auto reader = _cdb.getBufferReader(_broadcast_clause_buffer.data(), _broadcast_clause_buffer.size());
+    auto clause = reader.getNextIncomingClause();
+    while (clause.begin != nullptr) {
+        _broadcast_keys.emplace_back(clause);
+        clause = reader.getNextIncomingClause();
+    }
+}
+
 std::vector<int> AnytimeSatClauseCommunicator::Session::applyGlobalFilter(const std::vector<int>& filter, std::vector<int>& clauses) {
 
     size_t clsIdx = 0;
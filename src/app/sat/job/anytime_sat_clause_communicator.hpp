@@ -10,8 +10,9 @@
 #include "app/job.hpp"
 #include "base_sat_job.hpp"
 #include "clause_history.hpp"
-//#include "distributed_clause_filter.hpp"
+#include "distributed_clause_filter.hpp"
 #include "comm/job_tree_all_reduction.hpp"
+#include "util/sys/timer.hpp"
 
 class AnytimeSatClauseCommunicator {
 
@@ -25,6 +26,10 @@ public:
     };
 
 private:
+    // Factor by which the local contribution is over-supplied with clauses
+    // if clause buffers are exchanged in the compact format
+    static constexpr int COMPACT_BUFFER_OVERSUPPLY = 2;
+
     const Parameters& _params;
     BaseSatJob* _job = NULL;
     bool _suspended = false;
@@ -35,7 +40,7 @@ private:
 
     AdaptiveClauseDatabase _cdb;
     ClauseHistory _cls_history;
-    //DistributedClauseFilter _filter;
+    DistributedClauseFilter _filter;
     float _compensation_factor = 1.0f;
     float _compensation_decay = 0.6;
 
@@ -50,13 +55,24 @@ private:
         std::vector<int> _broadcast_clause_buffer;
         int _num_broadcast_clauses;
         int _num_admitted_clauses;
+        // Fingerprints of the broadcast clauses and volume of the job tree
+        // for distributed duplicate detection
+        std::vector<DistributedClauseFilter::Key> _broadcast_keys;
+        int _filter_volume = 0;
 
         JobTreeAllReduction _allreduce_clauses;
         JobTreeAllReduction _allreduce_filter;
+        bool _has_broadcast_clauses = false;
         bool _filtering = false;
 
+        // Points in time when the session reached each stage
+        float _time_initiated;
+        float _time_produced_clauses = -1;
+        float _time_received_clauses = -1;
+        float _time_produced_filter = -1;
+
         Session(const Parameters& params, BaseSatJob* job, AdaptiveClauseDatabase& cdb, int epoch) : 
-            _params(params), _job(job), _cdb(cdb), _epoch(epoch),
+            _params(params), _job(job), _cdb(cdb), _epoch(epoch), _time_initiated(Timer::elapsedSeconds()),
             _allreduce_clauses(
                 job->getJobTree(),
                 // Base message 
@@ -70,11 +86,24 @@ private:
                         numAggregated += elem.back();
                         elem.pop_back();
                     }
-                    auto merger = _cdb.getBufferMerger(_job->getBufferLimit(numAggregated, MyMpi::ALL));
-                    for (auto& elem : elems) {
-                        merger.add(_cdb.getBufferReader(elem.data(), elem.size()));
+                    int limit = _job->getBufferLimit(numAggregated, MyMpi::ALL);
+                    std::vector<int> merged;
+                    if (_params.compactClauseBuffers()) {
+                        // Same bandwidth as for the according number of plain literals
+                        auto merger = _cdb.getCompactBufferMerger(sizeof(int) * limit);
+                        for (auto& elem : elems) {
+                            merger.add(_cdb.getCompactBufferReader(elem.data(), elem.size()));
+                        }
+                        std::vector<int> excess;
+                        merged = merger.merge(&excess);
+                        _excess_clauses_from_merge = _cdb.decodeCompactBuffer(excess.data(), excess.size());
+                    } else {
+                        auto merger = _cdb.getBufferMerger(limit);
+                        for (auto& elem : elems) {
+                            merger.add(_cdb.getBufferReader(elem.data(), elem.size()));
+                        }
+                        merged = merger.merge(&_excess_clauses_from_merge);
                     }
-                    std::vector<int> merged = merger.merge(&_excess_clauses_from_merge);
                     LOG(V4_VVER, "%s : merged %i contribs ~> len=%i\n", 
                         _job->toStr(), numAggregated, merged.size());
                     merged.push_back(numAggregated);
@@ -89,6 +118,9 @@ private:
                 std::vector<int>(),
                 // Aggregator for local + incoming elements
                 [&](std::list<std::vector<int>>& elems) {
+                    if (_params.distributedDuplicateDetection()) {
+                        return DistributedClauseFilter::merge(elems, _broadcast_keys, _filter_volume);
+                    }
                     std::vector<int> filter = std::move(elems.front());
                     elems.pop_front();
                     for (auto& elem : elems) {
@@ -108,6 +140,7 @@ private:
 
         void setFiltering() {_filtering = true;}
         bool isFiltering() const {return _filtering;}
+        void computeBroadcastKeys();
         std::vector<int> applyGlobalFilter(const std::vector<int>& filter, std::vector<int>& clauses);
 
         bool isValid() const {
@@ -125,6 +158,16 @@ private:
     float _time_of_last_epoch_initiation = 0;
     float _time_of_last_epoch_conclusion = 0.000001f;
 
+    // Accumulated latencies of the stages of all concluded sessions
+    struct StageLatencies {
+        int nbSessions = 0;
+        double exportClauses = 0; // initiation until local contribution of clauses
+        double allReduceClauses = 0; // local contribution until broadcast clauses arrived
+        double filterClauses = 0; // broadcast clauses arrived until local filter computed
+        double allReduceFilter = 0; // local filter computed until broadcast filter arrived
+        double total = 0;
+    } _latencies;
+
 public:
     AnytimeSatClauseCommunicator(const Parameters& params, BaseSatJob* job) : _params(params), _job(job), 
         _clause_buf_base_size(_params.clauseBufferBaseSize()), 
@@ -138,7 +181,9 @@ public:
             setup.numLiterals = 0;
             return setup;
         }()),
-        _cls_history(_params, _job->getBufferLimit(_job->getJobTree().getCommSize(), MyMpi::ALL), *job, _cdb) {
+        _cls_history(_params, _job->getBufferLimit(_job->getJobTree().getCommSize(), MyMpi::ALL), *job, _cdb),
+        _filter(_params.clauseFilterClearInterval(), _params.reshareImprovedLbd(), 
+            1024UL * 1024UL * _params.duplicateDetectionBudget()) {
 
         _time_of_last_epoch_initiation = Timer::elapsedSeconds();
         _time_of_last_epoch_conclusion = Timer::elapsedSeconds();
@@ -157,6 +202,12 @@ public:
     }
 
 private:
-    inline Session& currentSession() {return _sessions.back();}
+    int getMaxNumActiveSessions() const;
+    std::list<Session>::iterator getFirstActiveSession();
+    Session* getActiveSession(int epoch);
+    bool isReadyForNextEpoch();
+    void advanceSession(Session& session, bool predecessorsFiltered);
+    void concludeSession(Session& session);
+    int getLocalSharingLimit();
     void addToClauseHistory(std::vector<int>& clauses, int epoch);
 };
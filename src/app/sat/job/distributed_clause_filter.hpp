@@ -2,161 +2,205 @@
 #pragma once
 
 #include <stdint.h>
+#include <climits>
+#include <list>
+#include <vector>
 
 #include "../data/clause.hpp"
-#include "../sharing/filter/clause_filter.hpp"
-#include "app/job_tree.hpp"
-
+#include "../sharing/filter/clause_fingerprint_table.hpp"
+#include "../sharing/filter/produced_clause_filter.hpp"
+
+/*
+Distributed duplicate detection for the all-reduction of clause filters.
+The space of 64-bit clause fingerprints is partitioned into as many equally
+sized ranges as there are nodes in the job tree. The ranges are assigned to
+the nodes in the in-order of the tree, so the nodes of each subtree are
+responsible for a single contiguous range of fingerprints. Each node remembers
+the recently shared clauses of its own range in a memory-bounded fingerprint
+table and reports which of the broadcast clauses in its range are duplicates.
+
+A (partial) filter consists of the volume of the job tree and the first and
+last in-order rank of the covered nodes, followed by one bit per broadcast
+clause in the covered range (in the order of the broadcast buffer). As such,
+the filter sent upwards by a subtree only has one bit per clause the subtree
+is responsible for. An empty filter covers no clauses at all.
+*/
 class DistributedClauseFilter {
 
+public:
+    // Volume, first covered rank, last covered rank
+    static constexpr int NUM_HEADER_INTS = 3;
+
+    struct Key {
+        uint64_t fingerprint;
+        int lbd;
+        Key(const Mallob::Clause& c) :
+            fingerprint(ProducedClauseFilter::getFingerprint(c.begin + MALLOB_CLAUSE_METADATA_SIZE,
+                c.size - MALLOB_CLAUSE_METADATA_SIZE)),
+            lbd(c.lbd) {}
+    };
+
 private:
-    robin_hood::unordered_flat_map<Mallob::Clause, int, NonCommutativeClauseHasher, SortedClauseExactEquals> _filter;
+    struct SharingInfo {
+        uint16_t lastSharedEpoch;
+        uint8_t minSharedLbd;
+    };
+    ClauseFingerprintTable<SharingInfo> _table;
 
-    int _last_index = -1;
-    int _last_volume = -1;
+    const int _epoch_horizon;
+    const bool _reshare_improved_lbd;
 
-    int _max_slot_index;
-    int _my_slot_index;
-    int _left_slot_index;
-    int _right_slot_index;
+    int _volume = 0;
+    int _my_rank = -1;
 
-    int _num_remembered_epochs;
+    unsigned long _nb_checked = 0;
+    unsigned long _nb_filtered = 0;
 
 public:
-    DistributedClauseFilter(int numRememberedEpochs) : 
-        _num_remembered_epochs(numRememberedEpochs >= 0 ? numRememberedEpochs : INT32_MAX) {}
+    // A negative epoch horizon remembers shared clauses as long as the memory budget permits.
+    DistributedClauseFilter(int epochHorizon, bool reshareImprovedLbd, size_t memoryBudget) :
+            _epoch_horizon(epochHorizon < 0 || epochHorizon >= UINT16_MAX ? -1 : epochHorizon),
+            _reshare_improved_lbd(reshareImprovedLbd) {
+        _table.init(memoryBudget);
+    }
 
+    // Sets the role of this node given its index in a job tree of the given volume.
     void update(int index, int volume) {
-        if (index == _last_index && volume == _last_volume) return;
-        _last_index = index;
-        _last_volume = volume;
-
-        _my_slot_index = getSlotIndex(index, volume);
-
-        // If this node has a (left|right) child, this is its direct in-order neighbor
-        _left_slot_index = 2*index+1 < volume ? _my_slot_index-1 : -1;
-        _right_slot_index = 2*index+2 < volume ? _my_slot_index+1 : -1;
-
-        _left_slot_index = -1;
-        _right_slot_index = -1;
-
-        // Go down to (right|left)most child in the (left|right) subtree
-        for (int childVal = 1; childVal <= 2; childVal++) {
-            int& neighborIndex = childVal == 1 ? _left_slot_index : _right_slot_index;
-            int childIndex = 2*index+childVal;
-            while (childIndex < volume) {
-                neighborIndex = childIndex;    
-                childIndex = 2*childIndex+(3-childVal);
-            }
-            // Conversion from tree index to slot index
-            if (neighborIndex != -1) neighborIndex = getSlotIndex(neighborIndex, volume);
-        }
+        _volume = volume;
+        _my_rank = index < volume ? getInorderRank(index, volume) : -1;
+    }
 
-        // Only node? -> no parents.
-        if (index == 0) return;
-
-        // Go upwards until finding a (smaller|larger) slot index than your own one
-        int parentIndex = index;
-        while (_left_slot_index == -1 || _right_slot_index == -1) {
-            parentIndex = (parentIndex-1) / 2;
-            int parentSlot = getSlotIndex(parentIndex, volume);
-            if (_left_slot_index == -1 && parentSlot < _my_slot_index)
-                _left_slot_index = parentSlot;
-            if (_right_slot_index == -1 && parentSlot > _my_slot_index)
-                _right_slot_index = parentSlot;
-            if (parentIndex == 0) break;
+    // Checks which of the given broadcast clauses in this node's range were shared
+    // recently and registers the others as shared in the given epoch.
+    std::vector<int> getLocalFilter(const std::vector<Key>& keys, int epoch) {
+        if (_my_rank < 0) return std::vector<int>(); // not part of the job tree
+        std::vector<int> filter {_volume, _my_rank, _my_rank};
+        size_t bitIdx = 0;
+        for (const auto& key : keys) {
+            if (getResponsibleRank(key.fingerprint, _volume) != _my_rank) continue;
+            bool filtered = !admitSharing(key, epoch);
+            setBit(filter, bitIdx++, filtered);
+            _nb_checked++;
+            if (filtered) _nb_filtered++;
         }
+        return filter;
     }
 
-    bool passClause(Mallob::Clause& clause, int epoch) {
-
-        size_t hash = ClauseHasher::hash(clause, /*which=*/3);
-
-        auto it = _filter.find(clause);
-        bool contained = it != _filter.end();
-
-        if (contained && epoch - it->second > _num_remembered_epochs) {
-            // Obsolete epoch! Remove entry and pretend it was never there
-            contained = false;
-            free(it->first.begin);
-            _filter.erase(it);
+    // Aggregates partial filters of adjacent ranges into a filter of the range
+    // which covers all of them. If the filters were computed for different volumes
+    // (because the job tree changed in the meantime), the aggregated filter covers
+    // all clauses w.r.t. the provided volume.
+    static std::vector<int> merge(const std::list<std::vector<int>>& elems, const std::vector<Key>& keys, int volume) {
+
+        struct Cursor {
+            const std::vector<int>* elem;
+            size_t bitIdx;
+        };
+        std::vector<Cursor> cursors;
+        bool sameVolume = true;
+        int first = INT_MAX, last = -1;
+        for (auto& elem : elems) {
+            if (elem.size() < NUM_HEADER_INTS || elem[0] <= 0) continue;
+            cursors.push_back(Cursor{&elem, 0});
+            if (elem[0] != volume) sameVolume = false;
+            first = std::min(first, elem[1]);
+            last = std::max(last, elem[2]);
         }
-
-        // Already contained: clause does not pass.
-        if (contained) return false;
-
-        // Am I responsible for this clause?
-        if (isResponsibleFor(hash) && !contained) {
-            Clause copy = clause;
-            copy.begin = (int*) malloc(sizeof(int)*clause.size);
-            memcpy(copy.begin, clause.begin, sizeof(int)*clause.size);
-            _filter[copy] = epoch; // register
+        if (cursors.empty() || volume <= 0) return std::vector<int>();
+        if (!sameVolume) {
+            first = 0;
+            last = volume-1;
         }
 
-        return true; // no duplicate was found: success
+        std::vector<int> merged {volume, first, last};
+        size_t bitIdx = 0;
+        for (const auto& key : keys) {
+            bool filtered = false;
+            for (auto& cursor : cursors) {
+                if (covers(*cursor.elem, key))
+                    filtered |= getBit(*cursor.elem, cursor.bitIdx++);
+            }
+            if (covers(merged, key)) setBit(merged, bitIdx++, filtered);
+        }
+        return merged;
     }
 
-    ~DistributedClauseFilter() {
-        for (auto& [c, val] : _filter) free(c.begin);
+    // Converts a (partial) filter into a plain filter with one bit for each of the given clauses.
+    static std::vector<int> toPlainFilter(const std::vector<int>& filter, const std::vector<Key>& keys) {
+        constexpr auto bitsPerElem = 8*sizeof(int);
+        std::vector<int> plain((keys.size() + bitsPerElem-1) / bitsPerElem, 0);
+        if (filter.size() < NUM_HEADER_INTS || filter[0] <= 0) return plain;
+        size_t bitIdx = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!covers(filter, keys[i])) continue;
+            if (getBit(filter, bitIdx++)) plain[i / bitsPerElem] |= (int) (1u << (i % bitsPerElem));
+        }
+        return plain;
     }
 
-    bool isResponsibleFor(size_t hash) {
-        double hashPivot = (((double) hash) / SIZE_MAX) * (_max_slot_index);
-        double myPivot = _my_slot_index - 0.5;
-        //LOG(V2_INFO, "%.5f %.5f\n", hashPivot, myPivot);
-        if (_left_slot_index == -1 && hashPivot <= myPivot) return true;
-        if (_right_slot_index == -1 && hashPivot >= myPivot) return true;
-        double leftPivot = _left_slot_index - 0.5;
-        double rightPivot = _right_slot_index - 0.5;
-        return std::abs(hashPivot-myPivot) <= std::abs(hashPivot-leftPivot)
-            && std::abs(hashPivot-myPivot) <= std::abs(hashPivot-rightPivot);
+    // Maps a fingerprint to the in-order rank of the responsible node.
+    static inline int getResponsibleRank(uint64_t fingerprint, int volume) {
+        return (int) (((fingerprint >> 32) * (uint64_t) volume) >> 32);
     }
 
-    std::vector<int> getSlotIndices() const {
-        std::vector<int> indices;
-        indices.push_back(_left_slot_index);
-        indices.push_back(_my_slot_index);
-        indices.push_back(_right_slot_index);
-        return indices;
+    // Number of nodes in the subtree rooted at the given index.
+    static int getSubtreeSize(int index, int volume) {
+        int size = 0;
+        for (long lo = index, hi = index; lo < volume; lo = 2*lo+1, hi = 2*hi+2) {
+            size += std::min(hi, (long) volume-1) - lo + 1;
+        }
+        return size;
     }
 
-    size_t size() const {
-        return _filter.size();
+    // Position of the given node in the in-order traversal of the job tree.
+    static int getInorderRank(int index, int volume) {
+        int rank = getSubtreeSize(2*index+1, volume);
+        for (int child = index; child > 0; child = (child-1) / 2) {
+            int parent = (child-1) / 2;
+            if (child == 2*parent+2) rank += getSubtreeSize(2*parent+1, volume) + 1;
+        }
+        return rank;
     }
 
+    int getRank() const {return _my_rank;}
+    unsigned long getNumChecked() const {return _nb_checked;}
+    unsigned long getNumFiltered() const {return _nb_filtered;}
+    size_t size() const {return _table.size();}
+    unsigned long getNumEvictions() const {return _table.getNumEvictions();}
+    size_t getMemoryBytes() const {return _table.getMemoryBytes();}
+
 private:
-    int getSlotIndex(int treeIndex, int volume) {
-
-        int powerOfTwoVolume = 1;
-        while (powerOfTwoVolume <= volume) powerOfTwoVolume <<= 1;
-        _max_slot_index = powerOfTwoVolume-1;
-
-        int i = treeIndex+1;
-        int slotIndex = powerOfTwoVolume/2;
-        if (i > 1) {
-            // Get largest power of two which is smaller than the MSB of i
-            int iPower = 1; while (4*iPower <= i) iPower *= 2;
-            //LOG(V2_INFO, "%i : %i\n", i, iPower);
-            int offset = slotIndex;
-            while (iPower > 0) {
-                offset /= 2;
-                if ((i & iPower) == 0) {
-                    // Go to left child
-                    //LOG(V2_INFO, "%i LEFT\n", i&iPower);
-                    slotIndex -= offset;
-                } else {
-                    // Go to right child
-                    //LOG(V2_INFO, "%i RIGHT\n", i&iPower);
-                    slotIndex += offset;
-                }
-                iPower /= 2;
-            }
+    bool admitSharing(const Key& key, int epoch) {
+        SharingInfo* info = _table.find(key.fingerprint, epoch);
+        if (info == nullptr) {
+            _table.insert(key.fingerprint, SharingInfo{(uint16_t) epoch, (uint8_t) key.lbd}, epoch);
+            return true;
         }
-        
-        //LOG(V2_INFO, "%i : slot index %i\n", treeIndex, slotIndex);
-        assert(slotIndex >= 0);
-        assert(slotIndex <= _max_slot_index);
-        return slotIndex;
+        // Same semantics as for the clauses exported by the local solvers
+        bool recent = _epoch_horizon < 0
+            || (uint16_t) ((uint16_t) epoch - info->lastSharedEpoch) <= _epoch_horizon;
+        if (recent && (!_reshare_improved_lbd || info->minSharedLbd <= key.lbd))
+            return false;
+        info->lastSharedEpoch = epoch;
+        info->minSharedLbd = key.lbd;
+        return true;
+    }
+
+    static inline bool covers(const std::vector<int>& filter, const Key& key) {
+        int rank = getResponsibleRank(key.fingerprint, filter[0]);
+        return rank >= filter[1] && rank <= filter[2];
     }
 
+    static inline bool getBit(const std::vector<int>& filter, size_t bitIdx) {
+        constexpr auto bitsPerElem = 8*sizeof(int);
+        size_t pos = NUM_HEADER_INTS + bitIdx / bitsPerElem;
+        if (pos >= filter.size()) return false;
+        return (filter[pos] & (int) (1u << (bitIdx % bitsPerElem))) != 0;
+    }
+
+    static inline void setBit(std::vector<int>& filter, size_t bitIdx, bool bit) {
+        constexpr auto bitsPerElem = 8*sizeof(int);
+        if (bitIdx % bitsPerElem == 0) filter.push_back(0);
+        if (bit) filter.back() |= (int) (1u << (bitIdx % bitsPerElem));
+    }
 };
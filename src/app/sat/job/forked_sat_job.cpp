@@ -44,6 +44,7 @@ void ForkedSatJob::doStartSolver() {
         desc.getFormulaPayload(0), 
         dummyJob ? std::min(1ul, desc.getAssumptionsSize(0)) : desc.getAssumptionsSize(0),
         desc.getAssumptionsPayload(0),
+        desc.getHostSegment(0),
         (AnytimeSatClauseCommunicator*)_clause_comm
     ));
     loadIncrements();
@@ -74,7 +75,8 @@ void ForkedSatJob::loadIncrements() {
             numLits, 
             desc.getFormulaPayload(_last_imported_revision),
             numAssumptions,
-            desc.getAssumptionsPayload(_last_imported_revision)
+            desc.getAssumptionsPayload(_last_imported_revision),
+            desc.getHostSegment(_last_imported_revision)
         });
     }
     if (!revisions.empty()) {
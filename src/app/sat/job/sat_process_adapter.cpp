@@ -24,9 +24,10 @@
 #endif
 
 SatProcessAdapter::SatProcessAdapter(Parameters&& params, SatProcessConfig&& config, ForkedSatJob* job,
-    size_t fSize, const int* fLits, size_t aSize, const int* aLits, AnytimeSatClauseCommunicator* comm) :    
+    size_t fSize, const int* fLits, size_t aSize, const int* aLits, 
+    const std::shared_ptr<HostDescriptionSegment>& segment, AnytimeSatClauseCommunicator* comm) :    
         _params(std::move(params)), _config(std::move(config)), _job(job), _clause_comm(comm),
-        _f_size(fSize), _f_lits(fLits), _a_size(aSize), _a_lits(aLits) {
+        _f_size(fSize), _f_lits(fLits), _a_size(aSize), _a_lits(aLits), _segment(segment) {
 
     _desired_revision = _config.firstrev;
     _shmem_id = _config.getSharedMemId(Proc::getPid());
@@ -48,8 +49,7 @@ void SatProcessAdapter::doWriteRevisions() {
             auto revStr = std::to_string(revData.revision);
             createSharedMemoryBlock("fsize."       + revStr, sizeof(size_t),              (void*)&revData.fSize);
             createSharedMemoryBlock("asize."       + revStr, sizeof(size_t),              (void*)&revData.aSize);
-            createSharedMemoryBlock("formulae."    + revStr, sizeof(int) * revData.fSize, (void*)revData.fLits);
-            createSharedMemoryBlock("assumptions." + revStr, sizeof(int) * revData.aSize, (void*)revData.aLits);
+            writeRevisionPayload(revData);
             createSharedMemoryBlock("checksum."    + revStr, sizeof(Checksum),            (void*)&(revData.checksum));
             _written_revision = revData.revision;
             LOG(V4_VVER, "DBG Done writing next revision %i\n", revData.revision);
@@ -128,8 +128,7 @@ void SatProcessAdapter::doInitialize() {
             sizeof(int)*_hsm->importBufferMaxSize, nullptr);
 
     // Allocate shared memory for formula, assumptions of initial revision
-    createSharedMemoryBlock("formulae.0", sizeof(int) * _f_size, (void*)_f_lits);
-    createSharedMemoryBlock("assumptions.0", sizeof(int) * _a_size, (void*)_a_lits);
+    writeRevisionPayload(RevisionData {0, Checksum(), _f_size, _f_lits, _a_size, _a_lits, _segment});
 
     if (_terminate) return;
 
@@ -421,6 +420,23 @@ void SatProcessAdapter::waitUntilChildExited() {
     }
 }
 
+void SatProcessAdapter::writeRevisionPayload(const RevisionData& revData) {
+    auto revStr = std::to_string(revData.revision);
+    if (revData.segment && revData.segment->getId().size() < sizeof(HostSegmentReference::segmentId)) {
+        // Payload already resides in host-wide shared memory: only refer to it
+        HostSegmentReference ref;
+        memset(&ref, 0, sizeof(HostSegmentReference));
+        strcpy(ref.segmentId, revData.segment->getId().c_str());
+        ref.formulaOffset = ((const uint8_t*) revData.fLits) - revData.segment->data();
+        ref.assumptionsOffset = ((const uint8_t*) revData.aLits) - revData.segment->data();
+        _host_segments.push_back(revData.segment);
+        createSharedMemoryBlock("hostdesc." + revStr, sizeof(HostSegmentReference), (void*)&ref);
+        return;
+    }
+    createSharedMemoryBlock("formulae."    + revStr, sizeof(int) * revData.fSize, (void*)revData.fLits);
+    createSharedMemoryBlock("assumptions." + revStr, sizeof(int) * revData.aSize, (void*)revData.aLits);
+}
+
 void* SatProcessAdapter::createSharedMemoryBlock(std::string shmemSubId, size_t size, void* data) {
     std::string id = _shmem_id + "." + shmemSubId;
     void* shmem = SharedMemory::create(id, size);
@@ -473,4 +489,6 @@ void SatProcessAdapter::freeSharedMemory() {
         SharedMemory::free(shmemObj.id, (char*)shmemObj.data, shmemObj.size);
     }
     _shmem.clear();
+    _host_segments.clear();
+    _segment.reset();
 }
@@ -12,6 +12,7 @@
 #include "data/checksum.hpp"
 #include "util/sys/background_worker.hpp"
 #include "data/job_result.hpp"
+#include "data/host_description_store.hpp"
 
 class ForkedSatJob; // fwd
 class AnytimeSatClauseCommunicator;
@@ -26,6 +27,8 @@ public:
         const int* fLits;
         size_t aSize;
         const int* aLits;
+        // If present, the sub-process maps the payload from here
+        std::shared_ptr<HostDescriptionSegment> segment;
     };
 
 private:
@@ -40,6 +43,9 @@ private:
     const int* _f_lits;
     size_t _a_size;
     const int* _a_lits;
+    std::shared_ptr<HostDescriptionSegment> _segment;
+    // Host-wide segments referenced by the sub-process
+    std::list<std::shared_ptr<HostDescriptionSegment>> _host_segments;
     
     struct ShmemObject {
         std::string id; 
@@ -98,6 +104,7 @@ private:
 public:
     SatProcessAdapter(Parameters&& params, SatProcessConfig&& config, ForkedSatJob* job, 
         size_t fSize, const int* fLits, size_t aSize, const int* aLits,
+        const std::shared_ptr<HostDescriptionSegment>& segment = std::shared_ptr<HostDescriptionSegment>(),
         AnytimeSatClauseCommunicator* comm = nullptr);
     ~SatProcessAdapter();
 
@@ -138,6 +145,7 @@ public:
 private:
     void doInitialize();
     void doWriteRevisions();
+    void writeRevisionPayload(const RevisionData& revData);
     void doPrepareSolution();
 
     bool process(const std::vector<int>& clauses, BufferTask task);
@@ -7,6 +7,13 @@
 #include "data/checksum.hpp"
 #include "sat_process_config.hpp"
 
+// Reference to a revision whose description resides in host-wide shared memory
+struct HostSegmentReference {
+    char segmentId[256];
+    size_t formulaOffset; // in bytes
+    size_t assumptionsOffset; // in bytes
+};
+
 struct SatSharedMemory {
 
     SatProcessConfig config;
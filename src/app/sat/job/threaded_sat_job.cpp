@@ -140,6 +140,9 @@ bool ThreadedSatJob::appl_isDestructible() {
 
 void ThreadedSatJob::appl_communicate() {
     if (!_initialized) return;
+    // Move clauses produced by the solvers into the clause database
+    // (otherwise the solvers' export rings run full until the next sharing)
+    _solver->collectProducedClauses();
     ((AnytimeSatClauseCommunicator*) _clause_comm)->communicate();
 }
 
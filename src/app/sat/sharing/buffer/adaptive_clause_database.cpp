@@ -1,6 +1,8 @@
 
 #include "adaptive_clause_database.hpp"
 
+#include <cstring>
+
 AdaptiveClauseDatabase::AdaptiveClauseDatabase(Setup setup):
     _total_literal_limit(setup.numLiterals),
     _max_lbd_partitioned_size(setup.maxLbdPartitionedSize),
@@ -54,8 +56,16 @@ AdaptiveClauseDatabase::AdaptiveClauseDatabase(Setup setup):
                 } else {
                     slotIdx = _large_slots.size();
                     _large_slots.emplace_back();
-                    _large_slots.back().implicitLbdOrZero = (opMode == SAME_SIZE_AND_LBD ? lbd : 0);
-                    _large_slots.back().mtx.reset(new Mutex());
+                    auto& slot = _large_slots.back();
+                    slot.implicitLbdOrZero = (opMode == SAME_SIZE_AND_LBD ? lbd : 0);
+                    int recordSize = clauseLength + (opMode == SAME_SIZE_AND_LBD ? 0 : 1);
+                    if (opMode == SAME_SUM_OF_SIZE_AND_LBD) {
+                        // Records must fit the longest clause of this slot (with LBD 2)
+                        slot.sumOfLengthAndLbdOrZero = sumOfLengthAndLbd;
+                        recordSize = 1 + sumOfLengthAndLbd-2;
+                    }
+                    slot.arena = ClauseArena(recordSize);
+                    slot.mtx.reset(new Mutex());
                 }
                 _size_lbd_to_slot_idx_mode[representantKey] = std::pair<int, ClauseSlotMode>(slotIdx, opMode);
             }
@@ -113,16 +123,15 @@ bool AdaptiveClauseDatabase::addClause(int* cBegin, int cSize, int cLbd, bool so
         _binary_slot.mtx->unlock();
     } else {
         // Sort clause if necessary
-        if (sortLargeClause) std::sort(cBegin+MALLOB_CLAUSE_METADATA_SIZE, cBegin+cSize);
+        if (sortLargeClause) clause_kernels::sortLiterals(cBegin+MALLOB_CLAUSE_METADATA_SIZE,
+            cSize-MALLOB_CLAUSE_METADATA_SIZE);
         // Insert clause
         auto& slot = _large_slots.at(slotIdx);
         bool explicitLbd = slot.implicitLbdOrZero == 0;
-        std::vector<int> vec(len + (explicitLbd ? 1 : 0));
-        size_t i = 0;
-        if (explicitLbd) vec[i++] = cLbd;
-        for (size_t j = 0; j < len; j++) vec[i++] = cBegin[j];
         slot.mtx->lock();
-        slot.list.push_front(std::move(vec));
+        int* record = slot.arena.emplaceBack(_chunk_pool);
+        if (explicitLbd) *(record++) = cLbd;
+        memcpy(record, cBegin, len*sizeof(int));
         atomics::addRelaxed(slot.nbLiterals, cSize);
         assert_heavy(checkNbLiterals(slot));
         slot.mtx->unlock();
@@ -191,6 +200,32 @@ bool AdaptiveClauseDatabase::popMallobClause(Slot<T>& slot, bool giveUpOnLock, M
     return true;
 }
 
+bool AdaptiveClauseDatabase::popMallobClause(LargeSlot& slot, bool giveUpOnLock, Mallob::Clause& out) {
+    if (slot.nbLiterals.load(std::memory_order_relaxed) == 0) return false;
+    if (giveUpOnLock) {
+        if (!slot.mtx->tryLock()) return false;
+    } else {
+        slot.mtx->lock();
+    }
+    if (slot.nbLiterals.load(std::memory_order_relaxed) == 0) {
+        slot.mtx->unlock();
+        return false;
+    }
+    assert(!slot.arena.empty());
+    int nbLiteralsBefore = slot.nbLiterals.load(std::memory_order_relaxed);
+    // Copy the clause before its record may be recycled
+    out = getMallobClause(slot, slot.arena.back()).copy();
+    slot.arena.popBack(_chunk_pool);
+
+    storeGlobalBudget(out.size);
+    _nb_used_literals.fetch_sub(out.size, std::memory_order_relaxed);
+    atomics::subRelaxed(slot.nbLiterals, out.size);
+
+    assert_heavy(checkNbLiterals(slot, "popMallobClause(): " + out.toStr() + "; " + std::to_string(nbLiteralsBefore) + " lits before"));
+    slot.mtx->unlock();
+    return true;
+}
+
 template <typename T>
 Mallob::Clause AdaptiveClauseDatabase::getMallobClause(T& elem, int implicitLbdOrZero) {
     if constexpr (std::is_same<int, T>::value) {
@@ -199,13 +234,6 @@ Mallob::Clause AdaptiveClauseDatabase::getMallobClause(T& elem, int implicitLbdO
     if constexpr (std::is_same<std::pair<int, int>, T>::value) {
         return Mallob::Clause(&elem.first, 2, 2);
     }
-    if constexpr (std::is_same<std::vector<int>, T>::value) {
-        bool lbdInVector = implicitLbdOrZero == 0;
-        int len = elem.size() - (lbdInVector ? 1 : 0);
-        assert(len <= _max_clause_length);
-        return Mallob::Clause(elem.data() + (lbdInVector ? 1 : 0), len, 
-            lbdInVector ? elem[0] : implicitLbdOrZero);
-    }
     abort();
 }
 
@@ -290,6 +318,85 @@ void AdaptiveClauseDatabase::flushClauses(Slot<T>& slot, bool sortClauses, Buffe
     }
 }
 
+void AdaptiveClauseDatabase::flushClauses(LargeSlot& slot, bool sortClauses, BufferBuilder& builder) {
+
+    if (slot.nbLiterals.load(std::memory_order_relaxed) == 0
+        && slot.freeLocalBudget.load(std::memory_order_relaxed) == 0) 
+        return;
+
+    // Swap current clause records in the slot to another arena
+    ClauseArena swappedArena(slot.arena.getRecordSize());
+    int nbSwappedLits;
+    int litsToStore = 0;
+    {
+        auto lock = slot.mtx->getLock();
+
+        // Transfer local free budget to global budget, if necessary
+        int freeBudget = slot.freeLocalBudget;
+        if (freeBudget > 0) {
+            slot.freeLocalBudget.store(0, std::memory_order_relaxed);
+            litsToStore += freeBudget;
+        }
+
+        // Nothing to extract?
+        if (slot.nbLiterals.load(std::memory_order_relaxed) == 0) {
+            if (litsToStore > 0) storeGlobalBudget(litsToStore);
+            return;
+        }
+
+        // Extract clauses
+        swappedArena.swap(slot.arena);
+        nbSwappedLits = slot.nbLiterals.load(std::memory_order_relaxed);
+        slot.nbLiterals.store(0, std::memory_order_relaxed);
+    }
+
+    // Scan the records linearly, beginning with the newest clause
+    std::vector<Mallob::Clause> flushedClauses;
+    flushedClauses.reserve(swappedArena.size());
+    int remainingLits = builder.getMaxRemainingLits();
+    int collectedLits = 0;
+    swappedArena.forEachFromBack([&](const int* record) {
+        Mallob::Clause clause = getMallobClause(slot, record);
+        if (clause.size > remainingLits) return false;
+        remainingLits -= clause.size;
+        collectedLits += clause.size;
+        flushedClauses.push_back(clause);
+        return true;
+    });
+
+    // Return budget of extracted literals
+    litsToStore += collectedLits;
+    storeGlobalBudget(litsToStore);
+    _nb_used_literals.fetch_sub(collectedLits, std::memory_order_relaxed);
+
+    bool differentLbdValues = slot.implicitLbdOrZero == 0;
+    if (differentLbdValues || sortClauses) {
+        // Sort
+        std::sort(flushedClauses.begin(), flushedClauses.end());
+    }
+
+    // Append clause to buffer builder
+    for (auto& c : flushedClauses) {
+        bool success = builder.append(c);
+        assert(success);
+    }
+
+    // Release the records of the exported clauses
+    swappedArena.truncateBack(flushedClauses.size(), _chunk_pool);
+
+    if (!swappedArena.empty()) {
+        // Re-insert swapped clauses which remained unused (as the oldest clauses)
+        auto lock = slot.mtx->getLock();
+        slot.arena.prepend(swappedArena);
+        atomics::addRelaxed(slot.nbLiterals, nbSwappedLits - collectedLits);
+        assert_heavy(checkNbLiterals(slot));
+    } else {
+        assert(nbSwappedLits == collectedLits || 
+            log_return_false("[ERROR] slot advertised %i lits, collected %i lits\n", 
+            nbSwappedLits, collectedLits));
+    }
+}
+
 std::vector<int> AdaptiveClauseDatabase::exportBuffer(int totalLiteralLimit, int& numExportedClauses, 
         ExportMode mode, bool sortClauses) {
 
@@ -391,11 +498,6 @@ int AdaptiveClauseDatabase::stealBudgetFromSlot(Slot<T>& slot, int desiredLitera
                 nbCollectedLits += 2;
                 _hist_deleted_in_slots.increment(2);
             }
-            if constexpr (std::is_same<std::vector<int>, T>::value) {
-                int clslen = it->size() - (slot.implicitLbdOrZero==0 ? 1 : 0);
-                nbCollectedLits += clslen;
-                _hist_deleted_in_slots.increment(clslen);
-            }
             nbCollectedClauses++;
             ++it;
         }
@@ -422,6 +524,51 @@ int AdaptiveClauseDatabase::stealBudgetFromSlot(Slot<T>& slot, int desiredLitera
     return freeBudget + nbCollectedLits;
 }
 
+int AdaptiveClauseDatabase::stealBudgetFromSlot(LargeSlot& slot, int desiredLiterals, bool dropClauses) {
+
+    if (slot.nbLiterals.load(std::memory_order_relaxed) == 0
+        && slot.freeLocalBudget.load(std::memory_order_relaxed) == 0) 
+        return 0;
+
+    auto lock = slot.mtx->getLock();
+    assert_heavy(checkNbLiterals(slot, "before dropClauses()"));
+    int nbLiteralsBefore = slot.nbLiterals.load(std::memory_order_relaxed);
+
+    int freeBudget = std::min(slot.freeLocalBudget.load(std::memory_order_relaxed), desiredLiterals);
+    int nbCollectedLits = 0;
+    int nbCollectedClauses = 0;
+
+    if (dropClauses) {
+        slot.arena.forEachFromBack([&](const int* record) {
+            if (freeBudget + nbCollectedLits >= desiredLiterals) return false;
+            int clslen = getMallobClause(slot, record).size;
+            nbCollectedLits += clslen;
+            _hist_deleted_in_slots.increment(clslen);
+            nbCollectedClauses++;
+            return true;
+        });
+    }
+
+    if (freeBudget+nbCollectedLits == 0) {
+        return 0;
+    }
+
+    // Drop the newest records; emptied chunks are moved to the pool
+    // from where the stealing slot (or any other slot) can pick them up
+    slot.arena.truncateBack(nbCollectedClauses, _chunk_pool);
+
+    atomics::subRelaxed(slot.nbLiterals, nbCollectedLits);
+    atomics::subRelaxed(slot.freeLocalBudget, freeBudget);
+    atomics::subRelaxed(_nb_used_literals, nbCollectedLits);
+
+    assert_heavy(checkNbLiterals(slot, "dropClauses(): collected " 
+        + std::to_string(nbCollectedLits) + " literals from " 
+        + std::to_string(nbCollectedClauses) + " clauses; " 
+        + std::to_string(nbLiteralsBefore) + " lits before"));
+
+    return freeBudget + nbCollectedLits;
+}
+
 BufferReader AdaptiveClauseDatabase::getBufferReader(int* begin, size_t size, bool useChecksums) {
     return BufferReader(begin, size, _max_clause_length, _slots_for_sum_of_length_and_lbd, useChecksums);
 }
@@ -434,6 +581,53 @@ BufferBuilder AdaptiveClauseDatabase::getBufferBuilder(std::vector<int>* out) {
     return BufferBuilder(-1, _max_clause_length, _slots_for_sum_of_length_and_lbd, out);
 }
 
+BufferReader AdaptiveClauseDatabase::getCompactBufferReader(int* begin, size_t size) {
+    return BufferReader(begin, size, _max_clause_length, _slots_for_sum_of_length_and_lbd, 
+        /*useChecksum=*/false, /*compact=*/true);
+}
+
+BufferMerger AdaptiveClauseDatabase::getCompactBufferMerger(int byteLimit) {
+    return BufferMerger(byteLimit, _max_clause_length, _slots_for_sum_of_length_and_lbd, _use_checksum, 
+        /*compact=*/true);
+}
+
+BufferBuilder AdaptiveClauseDatabase::getCompactBufferBuilder(int byteLimit, std::vector<int>* out) {
+    return BufferBuilder(byteLimit, _max_clause_length, _slots_for_sum_of_length_and_lbd, out, 
+        /*compact=*/true);
+}
+
+std::vector<int> AdaptiveClauseDatabase::encodeCompactBuffer(int* begin, size_t size, int byteLimit, 
+        std::vector<int>* excessClauses) {
+    auto reader = getBufferReader(begin, size);
+    auto builder = getCompactBufferBuilder(byteLimit);
+    std::unique_ptr<BufferBuilder> excessBuilder;
+    if (excessClauses != nullptr) {
+        excessClauses->clear();
+        excessBuilder.reset(new BufferBuilder(-1, _max_clause_length, 
+            _slots_for_sum_of_length_and_lbd, excessClauses));
+    }
+    const Clause& c = reader.getNextIncomingClause();
+    while (c.begin != nullptr) {
+        if (!builder.append(c)) {
+            if (!excessBuilder) break;
+            excessBuilder->append(c);
+        }
+        reader.getNextIncomingClause();
+    }
+    return builder.extractBuffer();
+}
+
+std::vector<int> AdaptiveClauseDatabase::decodeCompactBuffer(int* begin, size_t size) {
+    auto reader = getCompactBufferReader(begin, size);
+    auto builder = getBufferBuilder();
+    const Clause& c = reader.getNextIncomingClause();
+    while (c.begin != nullptr) {
+        builder.append(c);
+        reader.getNextIncomingClause();
+    }
+    return builder.extractBuffer();
+}
+
 ClauseHistogram& AdaptiveClauseDatabase::getDeletedClausesHistogram() {
     return _hist_deleted_in_slots;
 }
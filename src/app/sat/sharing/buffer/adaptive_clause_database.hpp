@@ -10,6 +10,7 @@
 #include "bucket_label.hpp"
 #include "buffer_reader.hpp"
 #include "buffer_merger.hpp"
+#include "clause_arena.hpp"
 #include "util/periodic_event.hpp"
 #include "../../data/solver_statistics.hpp"
 
@@ -18,6 +19,8 @@ Buffering structure for clauses which sorts and prioritizes clauses
 by length (primary) and LBD score (secondary). The structure is adaptive
 because memory chunks of fixed size are allocated on demand and
 can be moved freely from one length-LBD slot to another as necessary.
+Large clauses (length > 2) are stored as fixed-size records in a chunk arena
+per slot; chunks emptied in one slot are handed to other slots via a pool.
 */
 class AdaptiveClauseDatabase {
 
@@ -75,9 +78,32 @@ private:
             list(other.list) {}
     };
 
+    // Slot for clauses of length > 2. Each clause is stored as a record of 
+    // recordSize integers: the LBD (if not implicit), the literals, and
+    // padding (if the slot holds clauses of different lengths).
+    struct LargeSlot {
+        int implicitLbdOrZero;
+        // Sum of length and LBD of each clause if the slot holds clauses
+        // of different lengths, zero otherwise
+        int sumOfLengthAndLbdOrZero {0};
+        std::atomic_int nbLiterals {0};
+        std::atomic_int freeLocalBudget {0};
+        std::shared_ptr<Mutex> mtx;
+        ClauseArena arena;
+        LargeSlot() = default;
+        LargeSlot(LargeSlot&& other) :
+            implicitLbdOrZero(other.implicitLbdOrZero),
+            sumOfLengthAndLbdOrZero(other.sumOfLengthAndLbdOrZero),
+            nbLiterals(other.nbLiterals.load(std::memory_order_relaxed)), 
+            freeLocalBudget(other.freeLocalBudget.load(std::memory_order_relaxed)), 
+            mtx(std::move(other.mtx)),
+            arena(std::move(other.arena)) {}
+    };
+
     Slot<int> _unit_slot;
     Slot<std::pair<int, int>> _binary_slot;
-    std::vector<Slot<std::vector<int>>> _large_slots;
+    std::vector<LargeSlot> _large_slots;
+    ClauseChunkPool _chunk_pool;
     
     enum ClauseSlotMode {SAME_SUM_OF_SIZE_AND_LBD, SAME_SIZE, SAME_SIZE_AND_LBD};
     robin_hood::unordered_flat_map<std::pair<int, int>, std::pair<int, ClauseSlotMode>, IntPairHasher> _size_lbd_to_slot_idx_mode;
@@ -153,7 +179,6 @@ public:
 
         atomics::addRelaxed(_nb_used_literals, nbLiterals);
         float timeInsert = Timer::elapsedSeconds();
-        T& clause = clauses.front();
 
         if constexpr (std::is_same<T, int>::value) {
             auto lock = _unit_slot.mtx->getLock();
@@ -165,20 +190,8 @@ public:
             _binary_slot.list.splice_after(_binary_slot.list.before_begin(), clauses);
             atomics::addRelaxed(_binary_slot.nbLiterals, nbLiterals);
             assert_heavy(checkNbLiterals(_binary_slot));
-        } else if constexpr (std::is_same<T, std::vector<int>>::value) {
-            auto& slot = _large_slots[slotIdx];
-            if (slot.implicitLbdOrZero == 0) {
-                // Explicit LBD
-                assert(clause.size() == cSize+1);
-                assert(clause[0] == cLbd);
-            } else {
-                // Implicit LBD
-                assert(clause.size() == cSize);
-            }
-            auto lock = slot.mtx->getLock();
-            slot.list.splice_after(slot.list.before_begin(), clauses);
-            atomics::addRelaxed(slot.nbLiterals, nbLiterals);
-            assert_heavy(checkNbLiterals(slot));
+        } else {
+            static_assert(sizeof(T) == 0, "Only unit and binary clauses can be added as uniform clauses");
         }
         timeInsert = Timer::elapsedSeconds() - timeInsert;
 
@@ -215,6 +228,21 @@ public:
     BufferMerger getBufferMerger(int sizeLimit);
     BufferBuilder getBufferBuilder(std::vector<int>* out = nullptr);
 
+    /*
+    Same as above for buffers in the compact format (see CompactBufferCodec).
+    Size limits of compact buffers are given in encoded bytes.
+    */
+    BufferReader getCompactBufferReader(int* begin, size_t size);
+    BufferMerger getCompactBufferMerger(int byteLimit);
+    BufferBuilder getCompactBufferBuilder(int byteLimit, std::vector<int>* out = nullptr);
+    // Re-encodes a normal buffer in the compact format. Clauses beyond the byte
+    // limit are written into excessClauses (in the normal format) if provided.
+    std::vector<int> encodeCompactBuffer(int* begin, size_t size, int byteLimit, 
+        std::vector<int>* excessClauses = nullptr);
+    // Decodes a compact buffer into a normal buffer.
+    std::vector<int> decodeCompactBuffer(int* begin, size_t size);
+
+    int getMaxNumLiterals() const {return _total_literal_limit;}
     int getCurrentlyUsedLiterals() const {
         return _nb_used_literals.load(std::memory_order_relaxed);
     }
@@ -264,27 +292,47 @@ private:
             if constexpr (std::is_same<std::pair<int, int>, T>::value) {
                 nbActual += 2;
             }
-            if constexpr (std::is_same<std::vector<int>, T>::value) {
-                nbActual += elem.size() - (slot.implicitLbdOrZero==0 ? 1:0);
-            }
         }
         if (nbAdvertised != nbActual) 
             LOG(V0_CRIT, "[ERROR] Slot advertised %i literals - found %i literals (%s)\n", 
                 nbAdvertised, nbActual, additionalInfo.c_str());
         return nbAdvertised == nbActual;
     }
+    bool checkNbLiterals(LargeSlot& slot, std::string additionalInfo = "") {
+
+        int nbAdvertised = slot.nbLiterals.load(std::memory_order_relaxed);
+        int nbActual = 0;
+        slot.arena.forEachFromBack([&](const int* record) {
+            nbActual += getMallobClause(slot, record).size;
+            return true;
+        });
+        if (nbAdvertised != nbActual) 
+            LOG(V0_CRIT, "[ERROR] Slot advertised %i literals - found %i literals (%s)\n", 
+                nbAdvertised, nbActual, additionalInfo.c_str());
+        return nbAdvertised == nbActual;
+    }
 
     template <typename T>
     bool popMallobClause(Slot<T>& slot, bool giveUpOnLock, Mallob::Clause& out);
+    bool popMallobClause(LargeSlot& slot, bool giveUpOnLock, Mallob::Clause& out);
 
     template <typename T>
     Mallob::Clause getMallobClause(T& elem, int implicitLbdOrZero);
+    inline Mallob::Clause getMallobClause(const LargeSlot& slot, const int* record) const {
+        if (slot.implicitLbdOrZero != 0) 
+            return Mallob::Clause((int*) record, slot.arena.getRecordSize(), slot.implicitLbdOrZero);
+        int len = slot.sumOfLengthAndLbdOrZero != 0 ? 
+            slot.sumOfLengthAndLbdOrZero - record[0] : slot.arena.getRecordSize()-1;
+        return Mallob::Clause((int*) record+1, len, record[0]);
+    }
 
     template <typename T>
     int stealBudgetFromSlot(Slot<T>& slot, int desiredLiterals, bool dropClauses);
+    int stealBudgetFromSlot(LargeSlot& slot, int desiredLiterals, bool dropClauses);
 
     template <typename T>
     void flushClauses(Slot<T>& slot, bool sortClauses, BufferBuilder& builder);
+    void flushClauses(LargeSlot& slot, bool sortClauses, BufferBuilder& builder);
     
     std::pair<int, ClauseSlotMode> getSlotIdxAndMode(int clauseSize, int lbd);
     BucketLabel getBucketIterator();
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "buffer_iterator.hpp"
+#include "compact_buffer_codec.hpp"
 #include "../../data/clause.hpp"
 #include "util/logger.hpp"
 
@@ -19,9 +20,21 @@ private:
     int _num_added_clauses = 0;
     int _num_added_lits = 0;
 
+    // Compact format (see CompactBufferCodec): 
+    // The literal limit is a limit on the number of encoded bytes instead.
+    bool _compact;
+    std::vector<uint8_t> _bytes; // finished buckets
+    std::vector<uint8_t> _bucket_bytes; // clauses of the current bucket
+    std::vector<uint8_t> _clause_bytes; // encoding of the clause to append
+    int _bucket_count = 0;
+    int _prev_first_lit = 0;
+    bool _extracted = false;
+
 public:
-    BufferBuilder(int totalLiteralLimit, int maxClauseLength, bool slotsForSumOfLengthAndLbd, std::vector<int>* out = nullptr) :
-        _out(out), _total_literal_limit(totalLiteralLimit), _it(maxClauseLength, slotsForSumOfLengthAndLbd) {
+    BufferBuilder(int totalLiteralLimit, int maxClauseLength, bool slotsForSumOfLengthAndLbd, 
+            std::vector<int>* out = nullptr, bool compact = false) :
+        _out(out), _total_literal_limit(totalLiteralLimit), _it(maxClauseLength, slotsForSumOfLengthAndLbd),
+        _compact(compact) {
 
         if (_total_literal_limit < 0) _total_literal_limit = INT32_MAX;
 
@@ -32,6 +45,7 @@ public:
 
         for (int i = 0; i < sizeof(size_t)/sizeof(int); i++) _out->push_back(0);
         *((size_t*) _out->data()) = 1;
+        if (_compact) return;
         _counter_position = _out->size();
         _out->push_back(0); // counter for the first group
         if (totalLiteralLimit > 0) _out->reserve(totalLiteralLimit);
@@ -42,6 +56,8 @@ public:
 
     bool append(const Mallob::Clause& c) {
 
+        if (_compact) return appendCompact(c);
+
         if (_total_literal_limit >= 0 && _num_added_lits + c.size > _total_literal_limit) 
             return false;
 
@@ -73,10 +89,84 @@ public:
     }
 
     inline int getMaxRemainingLits() const {
-        return _total_literal_limit - _num_added_lits;
+        return _total_literal_limit - (_compact ? getNumEncodedBytes() : _num_added_lits);
+    }
+
+    // Size of the compact encoding so far (including the current bucket's counter)
+    int getNumEncodedBytes() const {
+        return _bytes.size() + Varint::getSize(_bucket_count) + _bucket_bytes.size();
     }
 
     std::vector<int>&& extractBuffer() {
+        if (_compact && !_extracted) {
+            flushBucket();
+            _out->push_back(_bytes.size());
+            size_t offset = _out->size();
+            _out->resize(offset + (_bytes.size() + sizeof(int)-1) / sizeof(int), 0);
+            memcpy(_out->data()+offset, _bytes.data(), _bytes.size());
+            _extracted = true;
+        }
         return std::move(*_out);
     }
+
+private:
+    bool appendCompact(const Mallob::Clause& c) {
+
+        // Counters of the buckets to skip and of the clause's bucket
+        int numBucketSwitches = 0;
+        BufferIterator it(_it);
+        while (c.size != it.clauseLength || c.lbd != it.lbd) {
+            numBucketSwitches++;
+            it.nextLengthLbdGroup();
+            assert(it.clauseLength <= 255);
+        }
+
+        // Encode the clause
+        _clause_bytes.resize(CompactBufferCodec::MAX_VARINT_BYTES * c.size);
+        uint8_t* encoded = _clause_bytes.data();
+        int encodedSize = 0;
+        int prevLit = numBucketSwitches == 0 ? _prev_first_lit : 0;
+        for (int i = 0; i < c.size; i++) {
+            if (i < MALLOB_CLAUSE_METADATA_SIZE) {
+                encodedSize += Varint::write(Varint::zigzag(c.begin[i]), encoded+encodedSize);
+                continue;
+            }
+            encodedSize += Varint::write(Varint::zigzag((int64_t) c.begin[i] - prevLit), encoded+encodedSize);
+            prevLit = c.begin[i];
+        }
+
+        // Check size limit
+        int newSize;
+        if (numBucketSwitches == 0) {
+            newSize = _bytes.size() + Varint::getSize(_bucket_count+1)
+                + _bucket_bytes.size() + encodedSize;
+        } else {
+            // all skipped buckets are empty, i.e., have a single byte as a counter
+            newSize = getNumEncodedBytes() + (numBucketSwitches-1) + 1 + encodedSize;
+        }
+        if (newSize > _total_literal_limit) return false;
+
+        // Switch buckets
+        for (int i = 0; i < numBucketSwitches; i++) {
+            flushBucket();
+            _it.nextLengthLbdGroup();
+        }
+        if (c.size > MALLOB_CLAUSE_METADATA_SIZE) _prev_first_lit = c.begin[MALLOB_CLAUSE_METADATA_SIZE];
+        _bucket_bytes.insert(_bucket_bytes.end(), encoded, encoded+encodedSize);
+        _bucket_count++;
+        _num_added_lits += c.size;
+        _num_added_clauses++;
+        assert(getNumEncodedBytes() == newSize);
+        return true;
+    }
+
+    void flushBucket() {
+        uint8_t counter[CompactBufferCodec::MAX_VARINT_BYTES];
+        int counterSize = Varint::write(_bucket_count, counter);
+        _bytes.insert(_bytes.end(), counter, counter+counterSize);
+        _bytes.insert(_bytes.end(), _bucket_bytes.begin(), _bucket_bytes.end());
+        _bucket_bytes.clear();
+        _bucket_count = 0;
+        _prev_first_lit = 0;
+    }
 };
@@ -1,21 +1,48 @@
 
 #include <algorithm>
+#include <memory>
 
 #include "buffer_merger.hpp"
 
-BufferMerger::BufferMerger(int sizeLimit, int maxClauseLength, bool slotsForSumOfLengthAndLbd, bool useChecksum) : 
+BufferMerger::BufferMerger(int sizeLimit, int maxClauseLength, bool slotsForSumOfLengthAndLbd, bool useChecksum,
+        bool compact) : 
     _size_limit(sizeLimit), _max_clause_length(maxClauseLength), 
-    _slots_for_sum_of_length_and_lbd(slotsForSumOfLengthAndLbd), _use_checksum(useChecksum) {}
+    _slots_for_sum_of_length_and_lbd(slotsForSumOfLengthAndLbd), _use_checksum(useChecksum), _compact(compact) {}
 
 void BufferMerger::add(BufferReader&& reader) {_readers.push_back(std::move(reader));}
 
 std::vector<int> BufferMerger::merge(std::vector<int>* excessClauses) {
-    
-    AbstractClauseThreewayComparator* threewayCompare = _slots_for_sum_of_length_and_lbd ?
-        (AbstractClauseThreewayComparator*) new LengthLbdSumClauseThreewayComparator(_max_clause_length+2) :
-        (AbstractClauseThreewayComparator*) new LexicographicClauseThreewayComparator();
-    ClauseComparator compare(threewayCompare);
-    InputClauseComparator inputCompare(threewayCompare);
+    if (_slots_for_sum_of_length_and_lbd) 
+        return mergeWithHeap(LengthLbdSumClauseThreewayComparator(_max_clause_length+2), excessClauses);
+    return mergeWithHeap(LexicographicClauseThreewayComparator(), excessClauses);
+}
+
+template <typename ThreewayComparator>
+std::vector<int> BufferMerger::mergeWithHeap(const ThreewayComparator& compare, std::vector<int>* excessClauses) {
+
+    // Order of input clauses: by clause, then by descending reader index
+    auto isBefore = [&](const InputClause& left, const InputClause& right) {
+        int res = compare.compare(*left.first, *right.first);
+        if (res != 0) return res < 0;
+        return left.second > right.second;
+    };
+
+    // Min-heap of the current clause of each non-exhausted reader
+    std::vector<InputClause> heap;
+    heap.reserve(_readers.size());
+    auto siftDown = [&](size_t i) {
+        InputClause elem = heap[i];
+        const size_t n = heap.size();
+        while (true) {
+            size_t child = 2*i+1;
+            if (child >= n) break;
+            if (child+1 < n && isBefore(heap[child+1], heap[child])) child++;
+            if (!isBefore(heap[child], elem)) break;
+            heap[i] = heap[child];
+            i = child;
+        }
+        heap[i] = elem;
+    };
 
     // Setup readers
     for (size_t i = 0; i < _readers.size(); i++) {
@@ -24,85 +51,68 @@ std::vector<int> BufferMerger::merge(std::vector<int>* excessClauses) {
         Clause* c = _readers[i].getCurrentClausePointer();
         _readers[i].getNextIncomingClause();
         if (c->begin == nullptr) continue;
-        InputClause inputClause(c, i);
-
-        // Insert clause into merger
-        if (_merger.empty()) _merger.insert_after(_merger.before_begin(), inputClause);
-        else {
-            auto it = _merger.before_begin(); 
-            auto nextIt = it; ++nextIt;
-            while (nextIt != _merger.end() && inputCompare(inputClause, *nextIt)) {
-                ++it;
-                ++nextIt;
-            }
-            _merger.insert_after(it, inputClause);
-        }
+        heap.emplace_back(c, i);
     }
+    for (int i = ((int) heap.size())/2 - 1; i >= 0; i--) siftDown(i);
 
     // Setup builders for main buffer and excess clauses buffer
-    BufferBuilder mainBuilder(_size_limit, _max_clause_length, _slots_for_sum_of_length_and_lbd);
-    BufferBuilder* excessBuilder;
+    BufferBuilder mainBuilder(_size_limit, _max_clause_length, _slots_for_sum_of_length_and_lbd, nullptr, _compact);
+    std::unique_ptr<BufferBuilder> excessBuilder;
     if (excessClauses != nullptr) {
-        excessBuilder = new BufferBuilder(_size_limit, _max_clause_length, _slots_for_sum_of_length_and_lbd);
+        excessBuilder.reset(new BufferBuilder(_size_limit, _max_clause_length, _slots_for_sum_of_length_and_lbd, 
+            nullptr, _compact));
     }
     BufferBuilder* currentBuilder = &mainBuilder;
 
-    // For checking duplicates
+    // For checking duplicates. Readers of compact buffers overwrite their
+    // current clause when advancing, so the last seen clause is copied.
     Clause lastSeenClause;
+    std::vector<int> lastSeenLits;
 
     // Merge rounds
-    while (!_merger.empty()) {
+    while (!heap.empty()) {
 
         // Fetch next best clause
-        auto& [clause, readerId] = _merger.front();
+        auto [clause, readerId] = heap.front();
         
         // Duplicate?
-        if (lastSeenClause.begin == nullptr || compare(lastSeenClause, *clause)) {
+        if (lastSeenClause.begin == nullptr || compare.compare(lastSeenClause, *clause) < 0) {
             // -- not a duplicate
             lastSeenClause = *clause;
+            if (_compact) {
+                lastSeenLits.assign(clause->begin, clause->begin+clause->size);
+                lastSeenClause.begin = lastSeenLits.data();
+            }
 
             // Try to append to current builder
             bool success = currentBuilder->append(lastSeenClause);
             if (!success && currentBuilder == &mainBuilder) {
                 // Switch from normal output to excess clauses output
-                currentBuilder = excessBuilder;
+                if (!excessBuilder) break; // no excess clauses desired: done
+                currentBuilder = excessBuilder.get();
                 success = currentBuilder->append(lastSeenClause);
             }
         } else {
             // Duplicate!
-            assert(!compare(*clause, lastSeenClause) || 
+            assert(compare.compare(*clause, lastSeenClause) >= 0 || 
                 log_return_false("ERROR: Clauses unordered - %s <-> %s\n", 
                 clause->toStr().c_str(), lastSeenClause.toStr().c_str()));
         }
 
-        // Refill merger
+        // Refill merger: the reader's next clause replaces the top of the heap
         _readers[readerId].getNextIncomingClause();
         if (clause->begin == nullptr) {
             // No clauses left for this reader
-            _merger.erase_after(_merger.before_begin());
-        } else {
-            // Insert clause at the correct position in the merger
-            auto it = _merger.begin(); 
-            auto nextIt = it; ++nextIt;
-            while (nextIt != _merger.end() && inputCompare(_merger.front(), *nextIt)) {
-                ++it;
-                ++nextIt;
-            }
-            if (it != _merger.begin()) {
-                // Move element
-                auto elem = _merger.front();
-                _merger.erase_after(_merger.before_begin());
-                _merger.insert_after(it, elem);
-            } // Else: element is already at the right place
+            heap.front() = heap.back();
+            heap.pop_back();
         }
+        if (!heap.empty()) siftDown(0);
     }
 
     // Fill provided excess clauses buffer with result from according builder
     if (excessClauses != nullptr) {
         *excessClauses = excessBuilder->extractBuffer();
-        delete excessBuilder;
     }
 
-    delete threewayCompare;
     return mainBuilder.extractBuffer();
 }
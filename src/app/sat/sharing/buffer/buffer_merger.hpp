@@ -2,8 +2,6 @@
 #pragma once
 
 #include <vector>
-#include <set>
-#include <forward_list>
 
 #include "buffer_builder.hpp"
 #include "buffer_reader.hpp"
@@ -17,29 +15,28 @@ private:
     int _slots_for_sum_of_length_and_lbd;
 
     bool _use_checksum;
+    bool _compact;
     std::vector<BufferReader> _readers;
 
     std::vector<Clause> _next_clauses;
     std::vector<bool> _selected;
 
+    // Current clause of an input reader and the reader's index
     typedef std::pair<Clause*, int> InputClause;
-    struct InputClauseComparator {
-        AbstractClauseThreewayComparator* compare;
-        InputClauseComparator(AbstractClauseThreewayComparator* compare) : compare(compare) {}
-        bool operator()(const InputClause& left, const InputClause& right) const {
-            int res = compare->compare(*left.first, *right.first);
-            if (res != 0) return res > 0;
-            if (left.second != right.second) return left.second < right.second;
-            return false;
-        }
-    };
-    std::forward_list<InputClause> _merger;
 
 public:
-    BufferMerger(int sizeLimit, int maxClauseLength, bool slotsForSumOfLengthAndLbd, bool useChecksum = false);
+    // If compact is set, all added readers must read compact buffers, the output
+    // is written in the compact format as well, and sizeLimit is the maximum
+    // number of encoded bytes of each output buffer.
+    BufferMerger(int sizeLimit, int maxClauseLength, bool slotsForSumOfLengthAndLbd, bool useChecksum = false,
+        bool compact = false);
     void add(BufferReader&& reader);
     std::vector<int> merge(std::vector<int>* excessClauses = nullptr);
     
 private:
-    std::vector<int> fastMerge(int sizeLimit, std::vector<int>* excessClauses = nullptr);
+    // k-way merge of the input buffers over a binary min-heap of the readers' 
+    // current clauses. The (concrete) comparator is a template parameter
+    // so that the comparisons can be inlined.
+    template <typename ThreewayComparator>
+    std::vector<int> mergeWithHeap(const ThreewayComparator& compare, std::vector<int>* excessClauses);
 };
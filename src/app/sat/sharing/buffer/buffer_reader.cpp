@@ -2,8 +2,10 @@
 #include "buffer_reader.hpp"
 #include "util/logger.hpp"
 
-BufferReader::BufferReader(int* buffer, int size, int maxClauseLength, bool slotsForSumOfLengthAndLbd, bool useChecksum) : 
-        _buffer(buffer), _size(size), _it(maxClauseLength, slotsForSumOfLengthAndLbd), _use_checksum(useChecksum) {
+BufferReader::BufferReader(int* buffer, int size, int maxClauseLength, bool slotsForSumOfLengthAndLbd, 
+        bool useChecksum, bool compact) : 
+        _buffer(buffer), _size(size), _it(maxClauseLength, slotsForSumOfLengthAndLbd), _use_checksum(useChecksum),
+        _compact(compact) {
     
     int numInts = sizeof(size_t)/sizeof(int);
     if (_use_checksum && _size > 0) {
@@ -12,12 +14,76 @@ BufferReader::BufferReader(int* buffer, int size, int maxClauseLength, bool slot
         memcpy(&_true_hash, _buffer, sizeof(size_t));
     }
 
-    _remaining_cls_of_bucket = _size <= numInts ? 0 : _buffer[numInts];
-    assert(_remaining_cls_of_bucket >= 0);
-    _current_pos = numInts+1;
     _hash = 1;
     _current_clause.size = _it.clauseLength;
     _current_clause.lbd = _it.lbd;
+
+    if (_compact) {
+        _current_pos = CompactBufferCodec::NUM_HEADER_INTS;
+        _remaining_cls_of_bucket = 0;
+        if (_size < _current_pos) return;
+        size_t numBytes = _buffer[numInts];
+        assert(numBytes <= (_size - _current_pos) * sizeof(int));
+        _bytes_pos = (const uint8_t*) (_buffer + _current_pos);
+        _bytes_end = _bytes_pos + numBytes;
+        uint64_t count;
+        if (Varint::read(_bytes_pos, _bytes_end, count, CompactBufferCodec::MAX_VARINT_BYTES)) 
+            _remaining_cls_of_bucket = count;
+        _decoded.resize(maxClauseLength + 1 + MALLOB_CLAUSE_METADATA_SIZE);
+        return;
+    }
+
+    _remaining_cls_of_bucket = _size <= numInts ? 0 : _buffer[numInts];
+    assert(_remaining_cls_of_bucket >= 0);
+    _current_pos = numInts+1;
+}
+
+const Mallob::Clause& BufferReader::getNextCompactClause() {
+
+    // Find first bucket with some clauses left
+    if (_remaining_cls_of_bucket == 0) {
+        do {
+            // Nothing left to read?
+            if (_bytes_pos >= _bytes_end) return endReading();
+
+            // Go to next bucket
+            _it.nextLengthLbdGroup();
+            uint64_t count;
+            if (!Varint::read(_bytes_pos, _bytes_end, count, CompactBufferCodec::MAX_VARINT_BYTES)) return endReading();
+            _remaining_cls_of_bucket = count;
+
+        } while (_remaining_cls_of_bucket == 0);
+
+        // Update clause data
+        _current_clause.size = _it.clauseLength;
+        _current_clause.lbd = _it.lbd;
+        _prev_first_lit = 0;
+        if (_current_clause.size > _decoded.size()) _decoded.resize(_current_clause.size);
+    }
+
+    // Decode the clause
+    int* out = _decoded.data();
+    int64_t prevLit = _prev_first_lit;
+    for (int i = 0; i < _current_clause.size; i++) {
+        uint64_t val;
+        if (!Varint::read(_bytes_pos, _bytes_end, val, CompactBufferCodec::MAX_VARINT_BYTES)) return endReading();
+        if (i < MALLOB_CLAUSE_METADATA_SIZE) {
+            out[i] = (int) Varint::unzigzag(val);
+            continue;
+        }
+        prevLit += Varint::unzigzag(val);
+        out[i] = (int) prevLit;
+        if (i == MALLOB_CLAUSE_METADATA_SIZE) _prev_first_lit = out[i];
+    }
+
+    if (_use_checksum) {
+        hash_combine(_hash, Mallob::ClauseHasher::hash(out, _current_clause.size, 3));
+    }
+
+    _current_clause.begin = out;
+    _current_pos = _bytes_pos - (const uint8_t*) _buffer;
+    _remaining_cls_of_bucket--;
+    return _current_clause;
 }
 
 const Mallob::Clause& BufferReader::endReading() {
@@ -5,6 +5,7 @@
 
 #include "util/assert.hpp"
 #include "buffer_iterator.hpp"
+#include "compact_buffer_codec.hpp"
 #include "../../data/clause.hpp"
 #include "util/hashing.hpp"
 #include "util/logger.hpp"
@@ -23,9 +24,18 @@ private:
     size_t _hash;
     size_t _true_hash = 1;
 
+    // Compact format (see CompactBufferCodec): Each clause is decoded
+    // into a local array which the current clause points to.
+    bool _compact = false;
+    const uint8_t* _bytes_pos = nullptr;
+    const uint8_t* _bytes_end = nullptr;
+    std::vector<int> _decoded;
+    int _prev_first_lit = 0;
+
 public:
     BufferReader() = default;
-    BufferReader(int* buffer, int size, int maxClauseLength, bool slotsForSumOfLengthAndLbd, bool useChecksum = false);
+    BufferReader(int* buffer, int size, int maxClauseLength, bool slotsForSumOfLengthAndLbd, 
+        bool useChecksum = false, bool compact = false);
 
     void releaseBuffer() {_buffer = nullptr;}
     
@@ -39,6 +49,8 @@ public:
         // No buffer?
         if (_buffer == nullptr) return _current_clause;
 
+        if (_compact) return getNextCompactClause();
+
         // Find first bucket with some clauses left
         if (_remaining_cls_of_bucket == 0) {
             do {    
@@ -88,5 +100,6 @@ public:
     }
 
 private:
+    const Mallob::Clause& getNextCompactClause();
     const Mallob::Clause& endReading();
 };
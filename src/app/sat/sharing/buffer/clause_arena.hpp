@@ -0,0 +1,186 @@
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "util/sys/threading.hpp"
+#include "util/assert.hpp"
+
+/*
+A chunk of contiguous memory for clause records.
+*/
+struct ClauseChunk {
+    std::unique_ptr<int[]> data;
+    int capacity {0}; // in integers
+};
+
+/*
+Pool of free memory chunks of a fixed size which is shared among all
+clause arenas of a clause database. When a slot frees clauses (e.g.,
+because another slot steals its budget), emptied chunks are moved here
+and can be picked up by any other slot without re-allocating them.
+*/
+class ClauseChunkPool {
+
+public:
+    static constexpr int CHUNK_SIZE = 1024; // in integers
+
+private:
+    Mutex _mtx;
+    std::vector<ClauseChunk> _chunks;
+
+public:
+    ClauseChunk acquire(int minCapacity) {
+        if (minCapacity <= CHUNK_SIZE) {
+            auto lock = _mtx.getLock();
+            if (!_chunks.empty()) {
+                ClauseChunk chunk = std::move(_chunks.back());
+                _chunks.pop_back();
+                return chunk;
+            }
+        }
+        ClauseChunk chunk;
+        chunk.capacity = std::max(minCapacity, CHUNK_SIZE);
+        chunk.data.reset(new int[chunk.capacity]);
+        return chunk;
+    }
+    void release(ClauseChunk&& chunk) {
+        if (chunk.capacity != CHUNK_SIZE) return; // oversized chunk: just deallocate
+        auto lock = _mtx.getLock();
+        _chunks.push_back(std::move(chunk));
+    }
+    size_t getNumPooledChunks() {
+        auto lock = _mtx.getLock();
+        return _chunks.size();
+    }
+};
+
+/*
+Stack of clause records of a uniform size (in integers) which are stored
+back to back in a sequence of chunks. Records are appended at the back and
+removed from the back (i.e., the newest record first). Chunks may be only
+partially filled, which allows to move all chunks of one arena into another
+arena in constant time per chunk.
+The arena does not synchronize any accesses.
+*/
+class ClauseArena {
+
+private:
+    struct Segment {
+        ClauseChunk chunk;
+        int nbRecords {0};
+    };
+    int _record_size {0};
+    std::vector<Segment> _segments; // from oldest to newest records
+    int _nb_records {0};
+
+public:
+    ClauseArena() {}
+    ClauseArena(int recordSize) : _record_size(recordSize) {}
+    ClauseArena(ClauseArena&& other) : _record_size(other._record_size),
+        _segments(std::move(other._segments)), _nb_records(other._nb_records) {
+        other._nb_records = 0;
+    }
+    ClauseArena& operator=(ClauseArena&& other) {
+        _record_size = other._record_size;
+        _segments = std::move(other._segments);
+        _nb_records = other._nb_records;
+        other._segments.clear();
+        other._nb_records = 0;
+        return *this;
+    }
+
+    int getRecordSize() const {return _record_size;}
+    int size() const {return _nb_records;}
+    bool empty() const {return _nb_records == 0;}
+
+    // Returns uninitialized memory for a new (newest) record.
+    int* emplaceBack(ClauseChunkPool& pool) {
+        if (_segments.empty() || !hasSpace(_segments.back())) {
+            _segments.push_back(Segment{pool.acquire(_record_size), 0});
+        }
+        auto& seg = _segments.back();
+        int* record = seg.chunk.data.get() + seg.nbRecords * _record_size;
+        seg.nbRecords++;
+        _nb_records++;
+        return record;
+    }
+
+    // Newest record. The arena must not be empty.
+    int* back() {
+        assert(!empty());
+        auto& seg = _segments.back();
+        return seg.chunk.data.get() + (seg.nbRecords-1) * _record_size;
+    }
+
+    // Removes the newest record and returns an emptied chunk to the pool.
+    void popBack(ClauseChunkPool& pool) {
+        assert(!empty());
+        auto& seg = _segments.back();
+        seg.nbRecords--;
+        _nb_records--;
+        if (seg.nbRecords == 0) {
+            pool.release(std::move(seg.chunk));
+            _segments.pop_back();
+        }
+    }
+
+    // Calls f on each record from the newest to the oldest record
+    // until f returns false.
+    template <typename F>
+    void forEachFromBack(F f) const {
+        for (auto segIt = _segments.rbegin(); segIt != _segments.rend(); ++segIt) {
+            const int* begin = segIt->chunk.data.get();
+            for (int i = segIt->nbRecords-1; i >= 0; i--) {
+                if (!f(begin + i * _record_size)) return;
+            }
+        }
+    }
+
+    // Removes the n newest records, returning emptied chunks to the pool.
+    void truncateBack(int n, ClauseChunkPool& pool) {
+        assert(n <= _nb_records);
+        _nb_records -= n;
+        while (n > 0) {
+            auto& seg = _segments.back();
+            int nbRemoved = std::min(n, seg.nbRecords);
+            seg.nbRecords -= nbRemoved;
+            n -= nbRemoved;
+            if (seg.nbRecords == 0) {
+                pool.release(std::move(seg.chunk));
+                _segments.pop_back();
+            }
+        }
+    }
+
+    // Moves all records of the provided arena (of the same record size)
+    // in front of the records of this arena, i.e., as older records.
+    void prepend(ClauseArena& older) {
+        assert(older._record_size == _record_size);
+        _segments.insert(_segments.begin(), std::make_move_iterator(older._segments.begin()),
+            std::make_move_iterator(older._segments.end()));
+        _nb_records += older._nb_records;
+        older._segments.clear();
+        older._nb_records = 0;
+    }
+
+    void swap(ClauseArena& other) {
+        std::swap(_record_size, other._record_size);
+        _segments.swap(other._segments);
+        std::swap(_nb_records, other._nb_records);
+    }
+
+    // Returns all chunks to the pool.
+    void clear(ClauseChunkPool& pool) {
+        for (auto& seg : _segments) pool.release(std::move(seg.chunk));
+        _segments.clear();
+        _nb_records = 0;
+    }
+
+private:
+    bool hasSpace(const Segment& seg) const {
+        return (seg.nbRecords+1) * _record_size <= seg.chunk.capacity;
+    }
+};
@@ -0,0 +1,30 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "util/varint.hpp"
+
+/*
+Primitives of the compact clause buffer format, which BufferBuilder and
+BufferReader use instead of raw 32-bit integers if constructed accordingly.
+A compact buffer is a vector of integers which begins with the same checksum
+slot as a normal buffer, followed by a single integer holding the number of
+encoded bytes, followed by the encoded bytes (padded to full integers).
+The encoded bytes contain, for each bucket in the usual order, the number of
+clauses as a varint followed by the clauses. Metadata integers of a clause are
+written as zigzag varints (see Varint). The first literal of a clause is written
+as the zigzag varint of its difference to the first literal of the preceding
+clause in the same bucket, and each further literal as the zigzag varint of its
+difference to the preceding literal. Since clauses are sorted within a bucket
+and literals are sorted within a clause, most differences fit into one byte.
+*/
+struct CompactBufferCodec {
+
+    // Integers preceding the encoded bytes: checksum slot and number of bytes
+    static constexpr int NUM_HEADER_INTS = sizeof(size_t)/sizeof(int) + 1;
+    // Maximum number of bytes of a single varint-encoded value. Differences
+    // of two 32-bit literals need up to 33 bits after zigzag encoding.
+    static constexpr int MAX_VARINT_BYTES = 5;
+};
@@ -0,0 +1,51 @@
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "buffer_reader.hpp"
+
+/*
+Flat clause buffer in the format parsed by BufferReader which is imported
+by several local solvers at once. The buffer is never modified after its
+creation, so each solver can read it concurrently via its own BufferReader.
+Which of the clauses a particular solver actually imports is specified by
+a separate bitmask (see SkipMask).
+*/
+struct SharedClauseBuffer {
+
+    std::vector<int> data;
+    int maxClauseLength;
+    bool slotsForSumOfLengthAndLbd;
+
+    SharedClauseBuffer(const int* begin, int size, int maxClauseLength, bool slotsForSumOfLengthAndLbd) :
+        data(begin, begin+size), maxClauseLength(maxClauseLength),
+        slotsForSumOfLengthAndLbd(slotsForSumOfLengthAndLbd) {}
+
+    BufferReader getReader() const {
+        // The reader only hands out pointers to the data, never modifying it
+        return BufferReader(const_cast<int*>(data.data()), data.size(),
+            maxClauseLength, slotsForSumOfLengthAndLbd);
+    }
+};
+
+/*
+Bitmask over the clauses of a buffer in their order of appearance.
+A set bit indicates that the respective clause is to be skipped.
+*/
+class SkipMask {
+
+private:
+    std::vector<uint64_t> _words;
+
+public:
+    // Appends the flag for the next clause.
+    void append(size_t clauseIdx, bool skip) {
+        if (clauseIdx % 64 == 0) _words.push_back(0);
+        if (skip) _words.back() |= (1ul << (clauseIdx % 64));
+    }
+    bool skips(size_t clauseIdx) const {
+        return (_words[clauseIdx / 64] >> (clauseIdx % 64)) & 1;
+    }
+};
@@ -1,71 +1,74 @@
 
 #pragma once
 
-#include <list>
+#include <memory>
 
-#include "util/sys/threading.hpp"
+#include "util/ringbuffer.hpp"
 #include "filter/produced_clause_filter.hpp"
 #include "buffer/adaptive_clause_database.hpp"
 #include "../data/solver_statistics.hpp"
 
+// Receives the clauses produced by the solver threads and feeds them into the
+// ProducedClauseFilter and the AdaptiveClauseDatabase. Each solver thread writes
+// its clauses into a ring buffer of its own, which is wait-free and does not
+// allocate any memory. The ring buffers are drained by a single consumer thread
+// via collect().
 class ExportBuffer {
 
 private:
-    Mutex _backlog_mutex;
-    std::list<ProducedClauseCandidate> _export_backlog;
-
     ProducedClauseFilter& _filter;
     AdaptiveClauseDatabase& _cdb;
     std::vector<SolverStatistics*>& _solver_stats;
 
+    // Element: header byte (clause size), LBD, epoch, literals
+    std::vector<std::unique_ptr<RingBufferV2>> _rings;
+    std::vector<int> _collected_element;
+
     ClauseHistogram _hist_failed_filter;
 	ClauseHistogram _hist_admitted_to_db;
 	ClauseHistogram _hist_dropped_before_db;
 
 public:
     ExportBuffer(ProducedClauseFilter& filter, AdaptiveClauseDatabase& cdb, 
-            std::vector<SolverStatistics*>& solverStats, int maxClauseLength) : 
+            std::vector<SolverStatistics*>& solverStats, int numSolvers, 
+            size_t ringCapacityPerSolver, int maxClauseLength) : 
         _filter(filter), _cdb(cdb), _solver_stats(solverStats),
         _hist_failed_filter(maxClauseLength), 
         _hist_admitted_to_db(maxClauseLength), 
-        _hist_dropped_before_db(maxClauseLength) {}
+        _hist_dropped_before_db(maxClauseLength) {
+        
+        for (int i = 0; i < numSolvers; i++) {
+            _rings.emplace_back(new RingBufferV2(ringCapacityPerSolver));
+        }
+    }
 
+    // Called by the solver thread of the given producer ID only.
     void produce(int* begin, int size, int lbd, int producerId, int epoch) {
+        if (size+2 > 255) {
+            // Clause too large for a ring buffer element: insert directly
+            insert(begin, size, lbd, producerId, epoch);
+            return;
+        }
+        const int prefix[2] = {lbd, epoch};
+        if (!_rings[producerId]->produceWithPrefix(prefix, 2, begin, /*producerId=*/0, size+2, size)) {
+            // Ring buffer full: drop clause
+            handleResult(producerId, ProducedClauseFilter::DROPPED, size);
+        }
+    }
 
-        if (_filter.tryAcquireLock()) {
-
-            // Insert clause directly
-            auto result = _filter.tryRegisterAndInsert(
-                ProducedClauseCandidate(begin, size, lbd, producerId, epoch), 
-                _cdb
-            );
-            handleResult(producerId, result, size);
-
-            // Also decrease backlog size by some amount
-            std::list<ProducedClauseCandidate> backlogSplice;
-            {
-                auto lock = _backlog_mutex.getLock();
-                if (!_export_backlog.empty()) {
-                    backlogSplice.splice(backlogSplice.begin(), _export_backlog, 
-                        _export_backlog.begin(),
-                        std::next(_export_backlog.begin(), std::min(16ul, _export_backlog.size()))
-                    );
-                }
-            }
-            for (auto& pcc : backlogSplice) {
-                int clauseLength = pcc.size;
-                int producerId = pcc.producerId;
-                result = _filter.tryRegisterAndInsert(std::move(pcc), _cdb);
-                handleResult(producerId, result, clauseLength);
+    // Drains all clauses produced so far into the filter and the clause database.
+    // Must be called by a single thread at a time.
+    void collect() {
+        for (size_t producerId = 0; producerId < _rings.size(); producerId++) {
+            auto& ring = *_rings[producerId];
+            uint8_t size;
+            while (ring.getNextHeaderByte(size)) {
+                _collected_element.clear();
+                bool success = ring.consume(size+2, _collected_element);
+                assert(success);
+                insert(_collected_element.data()+3, size, _collected_element[1], 
+                    producerId, _collected_element[2]);
             }
-
-            _filter.releaseLock();
-
-        } else {
-
-            // Filter busy: Append clause to backlog
-            auto lock = _backlog_mutex.getLock();
-            _export_backlog.emplace_back(begin, size, lbd, producerId, epoch);        
         }
     }
 
@@ -74,6 +77,14 @@ public:
 	ClauseHistogram& getDroppedHistogram() {return _hist_dropped_before_db;}
 
 private:
+    void insert(int* begin, int size, int lbd, int producerId, int epoch) {
+        auto result = _filter.tryRegisterAndInsert(
+            ProducedClauseCandidate(begin, size, lbd, producerId, epoch), 
+            _cdb
+        );
+        handleResult(producerId, result, size);
+    }
+
     void handleResult(int producerId, ProducedClauseFilter::ExportResult result, int clauseLength) {
         auto solverStats = _solver_stats.at(producerId);
         if (result == ProducedClauseFilter::ADMITTED) {
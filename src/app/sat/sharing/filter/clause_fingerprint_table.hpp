@@ -0,0 +1,130 @@
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/*
+Flat, memory-bounded table which maps 64-bit clause fingerprints to some
+meta data. Each fingerprint can reside in the NUM_WAYS entries of two
+alternative buckets, given by its lowest bits and by a range of its middle
+bits. The entries of a bucket are filled from the front. If both buckets
+of a fingerprint are full, the table doubles its size until it reaches its
+maximum size. From then on, inserting into two full buckets evicts the
+entry among them which has not been used for the most epochs.
+A fingerprint of zero denotes an empty entry and must not be inserted.
+The table does not synchronize any accesses.
+*/
+template <typename Info>
+class ClauseFingerprintTable {
+
+public:
+    static constexpr int NUM_WAYS = 4;
+    static constexpr size_t INITIAL_NUM_BUCKETS = 64;
+
+private:
+    struct Entry {
+        uint64_t fingerprint {0};
+        Info info;
+        uint16_t lastUsedEpoch {0};
+    };
+    std::vector<Entry> _entries;
+    size_t _num_buckets {0};
+    size_t _max_num_buckets {0};
+    size_t _num_occupied {0};
+    unsigned long _num_evictions {0};
+
+public:
+    // Sets the maximum size of the table in bytes.
+    void init(size_t maxBytes) {
+        size_t maxNumEntries = maxBytes / sizeof(Entry);
+        _max_num_buckets = 1;
+        while (2*_max_num_buckets*NUM_WAYS <= maxNumEntries) _max_num_buckets *= 2;
+    }
+
+    // Returns the meta data of the given fingerprint or nullptr if it is not present.
+    Info* find(uint64_t fingerprint, int epoch) {
+        if (_num_buckets == 0) return nullptr;
+        for (Entry* bucket : {getBucket(fingerprint), getAlternativeBucket(fingerprint)}) {
+            for (int i = 0; i < NUM_WAYS && bucket[i].fingerprint != 0; i++) {
+                if (bucket[i].fingerprint == fingerprint) {
+                    bucket[i].lastUsedEpoch = epoch;
+                    return &bucket[i].info;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    // Inserts the given fingerprint, which must not be present yet.
+    void insert(uint64_t fingerprint, const Info& info, int epoch) {
+        if (_num_buckets == 0) grow();
+        Entry* victim = findFreeEntry(fingerprint);
+        // Buckets full? Grow the table as long as the budget allows
+        while (victim == nullptr && _num_buckets < _max_num_buckets) {
+            grow();
+            victim = findFreeEntry(fingerprint);
+        }
+        if (victim == nullptr) {
+            // Evict least recently used entry
+            uint16_t maxAge = 0;
+            for (Entry* bucket : {getBucket(fingerprint), getAlternativeBucket(fingerprint)}) {
+                for (int i = 0; i < NUM_WAYS; i++) {
+                    uint16_t age = (uint16_t) epoch - bucket[i].lastUsedEpoch;
+                    if (victim == nullptr || age > maxAge) {
+                        victim = bucket+i;
+                        maxAge = age;
+                    }
+                }
+            }
+            _num_evictions++;
+        } else _num_occupied++;
+        victim->fingerprint = fingerprint;
+        victim->info = info;
+        victim->lastUsedEpoch = epoch;
+    }
+
+    size_t size() const {return _num_occupied;}
+    unsigned long getNumEvictions() const {return _num_evictions;}
+    size_t getMemoryBytes() const {return _entries.capacity() * sizeof(Entry);}
+
+private:
+    Entry* getBucket(uint64_t fingerprint) {
+        return _entries.data() + (fingerprint & (_num_buckets-1)) * NUM_WAYS;
+    }
+    Entry* getAlternativeBucket(uint64_t fingerprint) {
+        return _entries.data() + ((fingerprint >> 29) & (_num_buckets-1)) * NUM_WAYS;
+    }
+    // Returns the first empty entry of the (less occupied) bucket of the fingerprint
+    Entry* findFreeEntry(uint64_t fingerprint) {
+        Entry* bucket = getBucket(fingerprint);
+        Entry* altBucket = getAlternativeBucket(fingerprint);
+        for (int i = 0; i < NUM_WAYS; i++) {
+            if (bucket[i].fingerprint == 0) return bucket+i;
+            if (altBucket[i].fingerprint == 0) return altBucket+i;
+        }
+        return nullptr;
+    }
+
+    void grow() {
+        std::vector<Entry> oldEntries(std::move(_entries));
+        size_t oldNumBuckets = _num_buckets;
+        _num_buckets = _num_buckets == 0 ? std::min(INITIAL_NUM_BUCKETS, _max_num_buckets) : 2*_num_buckets;
+        _entries = std::vector<Entry>(_num_buckets * NUM_WAYS);
+        // Each entry stays in its primary or alternative bucket, respectively.
+        // Each new bucket receives entries of a single old bucket only,
+        // so all entries fit into their new bucket.
+        for (size_t b = 0; b < oldNumBuckets; b++) {
+            for (int i = 0; i < NUM_WAYS; i++) {
+                const auto& entry = oldEntries[b*NUM_WAYS + i];
+                if (entry.fingerprint == 0) continue;
+                bool primary = (entry.fingerprint & (oldNumBuckets-1)) == b;
+                Entry* bucket = primary ? getBucket(entry.fingerprint) : getAlternativeBucket(entry.fingerprint);
+                int pos = 0;
+                while (bucket[pos].fingerprint != 0) pos++;
+                bucket[pos] = entry;
+            }
+        }
+    }
+};
@@ -2,10 +2,15 @@
 #pragma once
 
 #include <array>
+#include <mutex>
+#include <type_traits>
+#include <cmath>
 
 #include "util/tsl/robin_map.h"
 #include "../../data/produced_clause.hpp"
 #include "../../data/produced_clause_candidate.hpp"
+#include "../buffer/adaptive_clause_database.hpp"
+#include "clause_fingerprint_table.hpp"
 #include "util/sys/threading.hpp"
 
 // Packed struct to get in all meta data within a 32 bit integer.
@@ -34,132 +39,284 @@ struct ClauseInfo {
     }
 };
 
-// Exact data structure which remembers clauses which were successfully exported by a solver.
+// Data structure which remembers clauses which were successfully exported by a solver.
 // For each incoming clause, the structure can then be used to decide (a) if the clause should 
 // be discarded ("filtered") because it was shared before (or too recently) and (b) which
 // subset of solvers should receive the clauses (because they did not export it themselves).
-// The structure takes space linear in the number of clauses successfully added to the
-// AdaptiveClauseDatabase instance which is used for tryRegisterAndInsert. 
+// In exact mode, the structure takes space linear in the number of clauses successfully added
+// to the AdaptiveClauseDatabase instance which is used for tryRegisterAndInsert. 
+// In fingerprint mode, the structure only remembers a 64-bit fingerprint of each clause in
+// a table of bounded size which evicts the least recently used clauses if necessary.
+// Fingerprint collisions may lead to falsely filtered clauses with negligible probability.
+// The clauses are partitioned into a number of shards by their hash value. Each shard
+// is protected by its own lock, so solver threads can register clauses concurrently
+// and only block each other if they happen to access the same shard at the same time.
 class ProducedClauseFilter {
 
 template <typename T>
 using ProducedMap = tsl::robin_map<T, ClauseInfo, ProducedClauseHasher<T>, ProducedClauseEqualsCommutative<T>>;
 
+public:
+    static constexpr int NUM_SHARDS = 64;
+
 private:
-    ProducedMap<ProducedUnitClause> _map_units;
-    ProducedMap<ProducedBinaryClause> _map_binaries;
-    ProducedMap<ProducedLargeClause> _map_large_clauses;
+    struct alignas(64) Shard {
+        Mutex mtx;
+        ProducedMap<ProducedUnitClause> mapUnits;
+        ProducedMap<ProducedBinaryClause> mapBinaries;
+        ProducedMap<ProducedLargeClause> mapLargeClauses;
+        size_t largeClauseBytes {0};
+        ClauseFingerprintTable<ClauseInfo> fingerprints;
+        // Lock statistics, only modified while holding the lock
+        unsigned long nbLockAcquisitions {0};
+        unsigned long nbContendedLockAcquisitions {0};
 
-    Mutex _map_mutex;
+        template <typename T> ProducedMap<T>& getMap() {
+            if constexpr (std::is_same<T, ProducedUnitClause>::value) return mapUnits;
+            if constexpr (std::is_same<T, ProducedBinaryClause>::value) return mapBinaries;
+            if constexpr (std::is_same<T, ProducedLargeClause>::value) return mapLargeClauses;
+        }
+    };
+    std::array<Shard, NUM_SHARDS> _shards;
 
     const int _epoch_horizon;
     const bool _reshare_improved_lbd;
+    const bool _use_fingerprints;
 
     ClauseInfo _empty_clause_info;
 
 public:
-    ProducedClauseFilter(int epochHorizon, bool reshareImprovedLbd) : 
-        _epoch_horizon(epochHorizon), _reshare_improved_lbd(reshareImprovedLbd) {}
+    // A positive fingerprintBudget (in bytes) enables fingerprint mode.
+    ProducedClauseFilter(int epochHorizon, bool reshareImprovedLbd, size_t fingerprintBudget = 0) : 
+            _epoch_horizon(epochHorizon), _reshare_improved_lbd(reshareImprovedLbd),
+            _use_fingerprints(fingerprintBudget > 0 && MALLOB_CLAUSE_METADATA_SIZE == 0) {
+        if (_use_fingerprints) for (auto& shard : _shards) {
+            shard.fingerprints.init(fingerprintBudget / NUM_SHARDS);
+        }
+    }
 
     enum ExportResult {ADMITTED, FILTERED, DROPPED};
+    // Thread-safe.
     ExportResult tryRegisterAndInsert(ProducedClauseCandidate&& c, AdaptiveClauseDatabase& cdb) {
+
+        if (_use_fingerprints) {
+            const uint64_t fingerprint = getFingerprint(c.begin, c.size);
+            Shard& shard = getShardOfFingerprint(fingerprint);
+            auto lock = lockShard(shard);
+            ClauseInfo* info = shard.fingerprints.find(fingerprint, c.epoch);
+            auto result = tryRegisterAndInsert(info, c, c.begin, cdb);
+            if (result == ADMITTED && info == nullptr)
+                shard.fingerprints.insert(fingerprint, ClauseInfo(c), c.epoch);
+            return result;
+        }
         
         if (c.size == 1) {
             ProducedUnitClause pc;
             pc.literal = *c.begin;
-            return tryRegisterAndInsert(pc, c, _map_units, cdb);
+            return tryRegisterAndInsert(pc, c, cdb);
 
         } else if (c.size == 2) {
             ProducedBinaryClause pc;
             pc.literals[0] = std::min(c.begin[0], c.begin[1]);
             pc.literals[1] = std::max(c.begin[0], c.begin[1]);
-            return tryRegisterAndInsert(pc, c, _map_binaries, cdb);
+            return tryRegisterAndInsert(pc, c, cdb);
 
         } else {
             ProducedLargeClause pc;
             pc.size = c.size;
             pc.data = c.releaseData();
-            return tryRegisterAndInsert(pc, c, _map_large_clauses, cdb);
+            return tryRegisterAndInsert(pc, c, cdb);
         }
     }
 
-    template<typename T>
-    ExportResult tryRegisterAndInsert(T& pc, ProducedClauseCandidate& c, ProducedMap<T>& map, AdaptiveClauseDatabase& cdb) {
-        
-        // Try to find clause
-        auto it = map.find(pc);
-                
-        // If clause is contained:
-        bool contained = it != map.end();
-        if (contained) {
-            int oldLbd = it.value().minProducedLbd;
-            // No improvement in LBD value? Filter clause.
-            if (oldLbd > 0 && c.lbd >= oldLbd) {
-                updateClauseInfo(c, it.value(), /*updateLbd=*/false);
-                return FILTERED;
-            }
-            // Clause can be accepted (again) due to improved LBD score
-        }
+    // Thread-safe.
+    uint8_t getProducers(Mallob::Clause& c, int epoch) {
 
-        // Try to insert to sharing database
-        if (!cdb.addClause(prod_cls::data(pc), c.size, c.lbd, /*sortLargeClause=*/true)) {
-            // No space left in database: update meta data, drop clause
-            // (Do not update LBD value because the clause was not exported)
-            if (contained) updateClauseInfo(c, it.value(), /*updateLbd=*/false);
-            return DROPPED;
+        if (_use_fingerprints) {
+            const uint64_t fingerprint = getFingerprint(c.begin, c.size);
+            Shard& shard = getShardOfFingerprint(fingerprint);
+            auto lock = lockShard(shard);
+            ClauseInfo* info = shard.fingerprints.find(fingerprint, epoch);
+            return info == nullptr ? 0 : info->producers;
         }
 
-        // Inserted: do register and set epoch to current epoch
-        if (contained) updateClauseInfo(c, it.value(), /*updateLbd=*/true);
-        else map.insert({std::move(pc), ClauseInfo(c)});
-        return ADMITTED;
-    }
-
-    uint8_t getProducers(Mallob::Clause& c, int epoch) {
-
         if (c.size == 1) {
             ProducedUnitClause pc(c);
-            return getProducers(pc, _map_units, epoch);
+            return getProducers(pc, epoch);
 
         } else if (c.size == 2) {
             ProducedBinaryClause pc(c);
-            return getProducers(pc, _map_binaries, epoch);
+            return getProducers(pc, epoch);
 
         } else {
             ProducedLargeClause pc;
             pc.size = c.size;
             pc.data = c.begin;
-            auto info = getProducers(pc, _map_large_clauses, epoch);
+            auto info = getProducers(pc, epoch);
             pc.data = nullptr;
             return info;
         }
     }
 
+    // Thread-safe.
     bool admitSharing(Mallob::Clause& c, int epoch) {
 
+        if (_use_fingerprints) {
+            const uint64_t fingerprint = getFingerprint(c.begin, c.size);
+            Shard& shard = getShardOfFingerprint(fingerprint);
+            auto lock = lockShard(shard);
+            return admitSharing(shard.fingerprints.find(fingerprint, epoch), c.lbd, epoch);
+        }
+
         if (c.size == 1) {
             ProducedUnitClause pc(c);
-            return admitSharing(pc, _map_units, c.lbd, epoch);
+            return admitSharing(pc, c.lbd, epoch);
 
         } else if (c.size == 2) {
             ProducedBinaryClause pc(c);
-            return admitSharing(pc, _map_binaries, c.lbd, epoch);
+            return admitSharing(pc, c.lbd, epoch);
 
         } else {
             ProducedLargeClause pc;
             pc.data = c.begin;
             pc.size = c.size;
-            bool admitted = admitSharing(pc, _map_large_clauses, c.lbd, epoch);
+            bool admitted = admitSharing(pc, c.lbd, epoch);
             pc.data = nullptr; // avoid freeing of clause data reference
             return admitted;
         }
     }
 
-    inline bool tryAcquireLock() {return _map_mutex.tryLock();}
-    inline void acquireLock() {_map_mutex.lock();}
-    inline void releaseLock() {_map_mutex.unlock();}
+    bool usesFingerprints() const {return _use_fingerprints;}
+
+    // Total number of times a shard lock was acquired
+    unsigned long getNumLockAcquisitions() {
+        return sumOverShards([](Shard& shard) {return shard.nbLockAcquisitions;});
+    }
+    // Number of times a shard lock was acquired only after waiting for another thread
+    unsigned long getNumContendedLockAcquisitions() {
+        return sumOverShards([](Shard& shard) {return shard.nbContendedLockAcquisitions;});
+    }
+    // Number of clauses which were forgotten due to the fingerprint table's memory budget
+    unsigned long getNumEvictions() {
+        return sumOverShards([](Shard& shard) {return shard.fingerprints.getNumEvictions();});
+    }
+    // Approximate number of bytes occupied by the remembered clauses
+    size_t getMemoryBytes() {
+        return sumOverShards([](Shard& shard) {
+            return shard.fingerprints.getMemoryBytes()
+                + shard.mapUnits.bucket_count() * sizeof(std::pair<ProducedUnitClause, ClauseInfo>)
+                + shard.mapBinaries.bucket_count() * sizeof(std::pair<ProducedBinaryClause, ClauseInfo>)
+                + shard.mapLargeClauses.bucket_count() * sizeof(std::pair<ProducedLargeClause, ClauseInfo>)
+                + shard.largeClauseBytes;
+        });
+    }
+    // Probability for an unknown clause to be mistaken for a remembered clause
+    double getFalsePositiveProbability() {
+        if (!_use_fingerprints) return 0;
+        // A false positive requires a collision of all 64 bits of the fingerprint
+        // (shard and bucket bits included) with one of the present fingerprints.
+        return std::ldexp((double) sumOverShards([](Shard& shard) {return shard.fingerprints.size();}), -64);
+    }
+
+    // Order-independent 64-bit fingerprint of a clause's literals.
+    // Also used to identify clauses across processes (see DistributedClauseFilter).
+    static uint64_t getFingerprint(const int* begin, int size) {
+        uint64_t sum = 0;
+        for (int i = 0; i < size; i++) sum += mix((uint64_t) (uint32_t) begin[i]);
+        uint64_t fingerprint = mix(sum ^ (uint64_t) size);
+        return fingerprint == 0 ? 1 : fingerprint; // zero denotes an empty table entry
+    }
+    static inline uint64_t mix(uint64_t x) {
+        // Finalizer of SplitMix64
+        x += 0x9E3779B97F4A7C15ul;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ul;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBul;
+        return x ^ (x >> 31);
+    }
 
 private:
+    inline Shard& getShard(size_t hash) {
+        // The maps index their buckets by the lowest bits of the hash value,
+        // so the shard is selected by the highest bits of a scrambled hash value.
+        return _shards[(hash * 0x9E3779B97F4A7C15ul) >> (64 - 6)];
+    }
+    inline Shard& getShardOfFingerprint(uint64_t fingerprint) {
+        // The fingerprint table uses the lowest bits
+        return _shards[fingerprint >> (64 - 6)];
+    }
+    static_assert(NUM_SHARDS == 1 << 6);
+
+    inline std::unique_lock<Mutex> lockShard(Shard& shard) {
+        if (!shard.mtx.tryLock()) {
+            shard.mtx.lock();
+            shard.nbContendedLockAcquisitions++;
+        }
+        shard.nbLockAcquisitions++;
+        return std::unique_lock<Mutex>(shard.mtx, std::adopt_lock);
+    }
+
+    template <typename F>
+    unsigned long sumOverShards(F f) {
+        unsigned long sum = 0;
+        for (auto& shard : _shards) {
+            auto lock = shard.mtx.getLock();
+            sum += f(shard);
+        }
+        return sum;
+    }
+
+    template<typename T>
+    ExportResult tryRegisterAndInsert(T& pc, ProducedClauseCandidate& c, AdaptiveClauseDatabase& cdb) {
+        
+        const size_t hash = ProducedClauseHasher<T>()(pc);
+        Shard& shard = getShard(hash);
+        auto& map = shard.template getMap<T>();
+        auto lock = lockShard(shard);
+
+        // Try to find clause
+        auto it = map.find(pc, hash);
+        ClauseInfo* info = it == map.end() ? nullptr : &it.value();
+        auto result = tryRegisterAndInsert(info, c, prod_cls::data(pc), cdb);
+
+        // Newly inserted: do register
+        if (result == ADMITTED && info == nullptr) {
+            if constexpr (std::is_same<T, ProducedLargeClause>::value) {
+                shard.largeClauseBytes += c.size * sizeof(int);
+            }
+            map.insert({std::move(pc), ClauseInfo(c)});
+        }
+        return result;
+    }
+
+    // Decides upon a produced clause given its meta data (or nullptr if the clause
+    // is not known yet) and, if admitted, inserts it into the database.
+    ExportResult tryRegisterAndInsert(ClauseInfo* info, const ProducedClauseCandidate& c, 
+            int* data, AdaptiveClauseDatabase& cdb) {
+
+        // If clause is contained:
+        if (info != nullptr) {
+            int oldLbd = info->minProducedLbd;
+            // No improvement in LBD value? Filter clause.
+            if (oldLbd > 0 && c.lbd >= oldLbd) {
+                updateClauseInfo(c, *info, /*updateLbd=*/false);
+                return FILTERED;
+            }
+            // Clause can be accepted (again) due to improved LBD score
+        }
+
+        // Try to insert to sharing database
+        if (!cdb.addClause(data, c.size, c.lbd, /*sortLargeClause=*/true)) {
+            // No space left in database: update meta data, drop clause
+            // (Do not update LBD value because the clause was not exported)
+            if (info != nullptr) updateClauseInfo(c, *info, /*updateLbd=*/false);
+            return DROPPED;
+        }
+
+        // Inserted: set epoch to current epoch
+        if (info != nullptr) updateClauseInfo(c, *info, /*updateLbd=*/true);
+        return ADMITTED;
+    }
+
     void updateClauseInfo(const ProducedClauseCandidate& c, ClauseInfo& info, bool updateLbd) {
         assert(c.lbd > 0);
         if (updateLbd) {
@@ -173,22 +330,31 @@ private:
     }
 
     template <typename T>
-    inline bool admitSharing(const T& pc, ProducedMap<T>& map, int lbd, int epoch) {
+    inline bool admitSharing(const T& pc, int lbd, int epoch) {
         
-        auto it = map.find(pc);
-        if (it == map.end()) return true; // No entry? -> Admit trivially
+        const size_t hash = ProducedClauseHasher<T>()(pc);
+        Shard& shard = getShard(hash);
+        auto& map = shard.template getMap<T>();
+        auto lock = lockShard(shard);
+
+        auto it = map.find(pc, hash);
+        return admitSharing(it == map.end() ? nullptr : &it.value(), lbd, epoch);
+    }
+
+    inline bool admitSharing(ClauseInfo* info, int lbd, int epoch) {
+
+        if (info == nullptr) return true; // No entry? -> Admit trivially
         
         // There is a present entry for this clause
-        ClauseInfo& info = it.value();
-        if (info.minSharedLbd > 0) {
+        if (info->minSharedLbd > 0) {
             // Clause was shared before
-            if (epoch - info.lastSharedEpoch <= _epoch_horizon) {
+            if (epoch - info->lastSharedEpoch <= _epoch_horizon) {
                 // Clause was shared at some recent point in time
                 if (!_reshare_improved_lbd) {
                     // Never reshare recent clauses, even with improved LBD
                     return false;
                 }
-                if (info.minSharedLbd <= lbd) {
+                if (info->minSharedLbd <= lbd) {
                     // Clause was shared with this LBD or better: filter
                     return false; 
                 }
@@ -196,16 +362,19 @@ private:
         }
 
         // Admit for sharing, update meta data to reflect sharing
-        info.minSharedLbd = lbd;
-        info.lastSharedEpoch = epoch;
+        info->minSharedLbd = lbd;
+        info->lastSharedEpoch = epoch;
         return true;
     }
 
     template <typename T>
-    inline uint8_t getProducers(const T& pc, ProducedMap<T>& map, int epoch) {
-        auto it = map.find(pc);
+    inline uint8_t getProducers(const T& pc, int epoch) {
+        const size_t hash = ProducedClauseHasher<T>()(pc);
+        Shard& shard = getShard(hash);
+        auto& map = shard.template getMap<T>();
+        auto lock = lockShard(shard);
+        auto it = map.find(pc, hash);
         if (it == map.end()) return 0;
-        ClauseInfo& info = it.value();
-        return info.producers;
+        return it.value().producers;
     }
 };
@@ -3,19 +3,44 @@
 
 #include <vector>
 #include <list>
+#include <memory>
+#include <atomic>
 
 #include "buffer/adaptive_clause_database.hpp"
+#include "buffer/shared_clause_buffer.hpp"
+#include "util/sys/threading.hpp"
 #include "../execution/solver_setup.hpp"
 
+// Clauses to be imported by a single solver. Clauses can be added either to an
+// internal clause database (add) or in bulk as a view on a flat
+// buffer which is shared among all local solvers (addSharedBuffer). The latter
+// clauses are read directly from the shared buffer without copying them.
+// Clauses are added by the sharing thread and fetched by the solver thread.
 class ImportBuffer {
 
 private:
     SolverStatistics& _stats;
     AdaptiveClauseDatabase _cdb;
     int _max_clause_length;
+    int _max_nb_literals;
+
+    struct PendingBuffer {
+        std::shared_ptr<const SharedClauseBuffer> buffer;
+        SkipMask skipMask;
+        BufferReader reader;
+        size_t clauseIdx {0};
+        PendingBuffer(std::shared_ptr<const SharedClauseBuffer>&& buffer, SkipMask&& skipMask) :
+            buffer(std::move(buffer)), skipMask(std::move(skipMask)), reader(this->buffer->getReader()) {}
+    };
+    Mutex _incoming_buffers_mutex;
+    std::list<PendingBuffer> _incoming_buffers; // added, but not seen by the solver thread yet
+    std::list<PendingBuffer> _pending_buffers; // accessed by the solver thread only
+    std::atomic_int _nb_pending_literals {0};
+    std::vector<int> _pending_units;
 
     std::vector<int> _plain_units_out;
     Mallob::Clause _clause_out;
+    bool _clause_out_owned {false};
 
 public:
     ImportBuffer(const SolverSetup& setup, SolverStatistics& stats) : _stats(stats), 
@@ -33,16 +58,22 @@ public:
             cdbSetup.slotsForSumOfLengthAndLbd = false;
             cdbSetup.useChecksums = false;
             return cdbSetup;
-        }()), _max_clause_length(setup.strictClauseLengthLimit) {}
+        }()), _max_clause_length(setup.strictClauseLengthLimit), 
+        _max_nb_literals(_cdb.getMaxNumLiterals()) {}
 
-    int getLiteralBudget(int clauseLength, int lbd) {
-        return _cdb.reserveLiteralBudget(clauseLength, lbd);
+    // Number of further literals which can be added via addSharedBuffer.
+    int getFreeLiteralBudget() const {
+        return std::max(0, _max_nb_literals - _cdb.getCurrentlyUsedLiterals() 
+            - _nb_pending_literals.load(std::memory_order_relaxed));
     }
 
-    template <typename T>
-    void performImport(int clauseLength, int lbd, std::forward_list<T>& clauses, int nbLiterals) {
-        if (clauses.empty()) return;
-        _cdb.addReservedUniformClauses(clauseLength, lbd, clauses, nbLiterals);
+    // Enqueues all clauses of the shared buffer except for those in the skip mask,
+    // which in sum must have nbLiterals literals.
+    void addSharedBuffer(std::shared_ptr<const SharedClauseBuffer> buffer, SkipMask&& skipMask, int nbLiterals) {
+        if (nbLiterals == 0) return;
+        _nb_pending_literals.fetch_add(nbLiterals, std::memory_order_relaxed);
+        auto lock = _incoming_buffers_mutex.getLock();
+        _incoming_buffers.emplace_back(std::move(buffer), std::move(skipMask));
     }
 
     void add(const Mallob::Clause& c) {
@@ -64,33 +95,72 @@ public:
 
     const std::vector<int>& getUnitsBuffer() {
 
-        if (_cdb.getNumLiterals(1, 1) == 0) {
-            _plain_units_out.clear();
-            return _plain_units_out;
+        _plain_units_out.clear();
+
+        // Units from shared buffers
+        fetchIncomingBuffers();
+        _plain_units_out.swap(_pending_units);
+        for (auto& pending : _pending_buffers) {
+            auto& reader = pending.reader;
+            // Units are stored in the first bucket of a buffer
+            while (reader.getCurrentBufferIterator().clauseLength == 1 
+                    && reader.getNumRemainingClausesInBucket() > 0) {
+                auto& c = reader.getNextIncomingClause();
+                if (c.begin == nullptr) break;
+                if (!pending.skipMask.skips(pending.clauseIdx++)) {
+                    _plain_units_out.push_back(c.begin[0]);
+                    _nb_pending_literals.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        size_t numUnitsFromBuffers = _plain_units_out.size();
+
+        // Units from the internal clause database
+        if (_cdb.getNumLiterals(1, 1) > 0) {
+            int numUnits = 0;
+            std::vector<int> buf;
+            buf = _cdb.exportBuffer(-1, numUnits, AdaptiveClauseDatabase::UNITS, /*sortClauses=*/false);
+            _plain_units_out.insert(_plain_units_out.end(), buf.data()+(buf.size()-numUnits), buf.data()+buf.size());
+            assert(_plain_units_out.size() == numUnitsFromBuffers + numUnits);
         }
 
-        int numUnits = 0;
-        std::vector<int> buf;
-        buf = _cdb.exportBuffer(-1, numUnits, AdaptiveClauseDatabase::UNITS, /*sortClauses=*/false);
-
-        _plain_units_out = std::vector<int>(buf.data()+(buf.size()-numUnits), buf.data()+buf.size());
-        assert(_plain_units_out.size() == numUnits);
         for (int i = 0; i < _plain_units_out.size(); i++) assert(_plain_units_out[i] != 0);
-        _stats.receivedClausesDigested += numUnits;
-        _stats.histDigested->increase(1, numUnits);
+        _stats.receivedClausesDigested += _plain_units_out.size();
+        _stats.histDigested->increase(1, _plain_units_out.size());
         return _plain_units_out;
     }
 
     Mallob::Clause& get(AdaptiveClauseDatabase::ExportMode mode) {
 
-        if (_clause_out.begin != nullptr) {
-            free(_clause_out.begin);
-            _clause_out.begin = nullptr;
+        if (_clause_out_owned && _clause_out.begin != nullptr) free(_clause_out.begin);
+        _clause_out.begin = nullptr;
+        _clause_out_owned = false;
+
+        if (_cdb.getCurrentlyUsedLiterals() > 0 && _cdb.popFrontWeak(mode, _clause_out)) {
+            _clause_out_owned = true;
+        } else if (mode != AdaptiveClauseDatabase::UNITS) {
+            // Read next clause from the shared buffers (without copying it)
+            fetchIncomingBuffers();
+            while (!_pending_buffers.empty() && _clause_out.begin == nullptr) {
+                auto& pending = _pending_buffers.front();
+                auto& c = pending.reader.getNextIncomingClause();
+                if (c.begin == nullptr) {
+                    // Buffer done. (No clause handed out before refers to it any more.)
+                    _pending_buffers.pop_front();
+                    continue;
+                }
+                if (pending.skipMask.skips(pending.clauseIdx++)) continue;
+                _nb_pending_literals.fetch_sub(c.size, std::memory_order_relaxed);
+                if (c.size == 1 && mode == AdaptiveClauseDatabase::NONUNITS) {
+                    // Keep for the next call of getUnitsBuffer
+                    _pending_units.push_back(c.begin[0]);
+                    continue;
+                }
+                _clause_out = c;
+            }
         }
 
-        if (_cdb.getCurrentlyUsedLiterals() == 0) return _clause_out;
-
-        if (_cdb.popFrontWeak(mode, _clause_out)) {
+        if (_clause_out.begin != nullptr) {
             _stats.receivedClausesDigested++;
             _stats.histDigested->increment(_clause_out.size);
             assert(_clause_out.size > 0);
@@ -105,10 +175,18 @@ public:
         int litsInUse = _cdb.getCurrentlyUsedLiterals();
         assert(litsInUse >= 0);
         if (litsInUse > 0) return false;
-        return true;
+        if (_nb_pending_literals.load(std::memory_order_relaxed) > 0) return false;
+        return _pending_units.empty();
     }
 
     ~ImportBuffer() {
-        if (_clause_out.begin != nullptr) free(_clause_out.begin);
+        if (_clause_out_owned && _clause_out.begin != nullptr) free(_clause_out.begin);
+    }
+
+private:
+    void fetchIncomingBuffers() {
+        if (!_incoming_buffers_mutex.tryLock()) return;
+        _pending_buffers.splice(_pending_buffers.end(), _incoming_buffers);
+        _incoming_buffers_mutex.unlock();
     }
 };
@@ -16,11 +16,11 @@
 
 SharingManager::SharingManager(
 		std::vector<std::shared_ptr<PortfolioSolverInterface>>& solvers, 
-		const Parameters& params, const Logger& logger, size_t maxDeferredLitsPerSolver, int jobIndex)
+		const Parameters& params, const Logger& logger, int jobIndex)
 	: _solvers(solvers),
-	_max_deferred_lits_per_solver(maxDeferredLitsPerSolver), 
 	_params(params), _logger(logger), _job_index(jobIndex),
-	_filter(params.clauseFilterClearInterval(), params.reshareImprovedLbd()),
+	_filter(params.clauseFilterClearInterval(), params.reshareImprovedLbd(),
+		params.certifiedUnsat() ? 0 : (1ul << 20) * params.producedClauseFilterBudget()),
 	_cdb([&]() {
 		AdaptiveClauseDatabase::Setup setup;
 		setup.maxClauseLength = _params.strictClauseLengthLimit();
@@ -29,7 +29,8 @@ SharingManager::SharingManager(
 		setup.slotsForSumOfLengthAndLbd = _params.groupClausesByLengthLbdSum();
 		return setup;
 	}()), 
-	_export_buffer(_filter, _cdb, _solver_stats, params.strictClauseLengthLimit()),
+	_export_buffer(_filter, _cdb, _solver_stats, solvers.size(), 
+		_params.clauseBufferBaseSize()*_params.numChunksForExport(), params.strictClauseLengthLimit()),
 	_hist_produced(params.strictClauseLengthLimit()), 
 	_hist_returned_to_db(params.strictClauseLengthLimit()) {
 
@@ -136,8 +137,15 @@ void SharingManager::onProduceClause(int solverId, int solverRevision, const Cla
 	if (tldClauseVec) delete tldClauseVec;
 }
 
+void SharingManager::collectProducedClauses() {
+	_export_buffer.collect();
+}
+
 int SharingManager::prepareSharing(int* begin, int totalLiteralLimit) {
 
+	// Make sure that all clauses produced so far are considered
+	collectProducedClauses();
+
 	int numExportedClauses = 0;
 	auto buffer = _cdb.exportBuffer(totalLiteralLimit, numExportedClauses);
 	//assert(buffer.size() <= maxSize);
@@ -163,6 +171,7 @@ void SharingManager::returnClauses(int* begin, int buflen) {
 
 int SharingManager::filterSharing(int* begin, int buflen, int* filterOut) {
 
+	_sharing_epoch++;
 	auto reader = _cdb.getBufferReader(begin, buflen);
 	
 	constexpr auto bitsPerElem = 8*sizeof(int);
@@ -172,7 +181,6 @@ int SharingManager::filterSharing(int* begin, int buflen, int* filterOut) {
 	int nbFiltered = 0;
 	int nbTotal = 0;
 
-	_filter.acquireLock();
 	while (clause.begin != nullptr) {
 		++nbTotal;
 
@@ -182,7 +190,7 @@ int SharingManager::filterSharing(int* begin, int buflen, int* filterOut) {
 			shift = 0;
 		}
 		
-		if (!_filter.admitSharing(clause, _internal_epoch)) {
+		if (!_filter.admitSharing(clause, _sharing_epoch)) {
 			// filtered!
 			auto bitFiltered = 1 << shift;
 			filterOut[filterPos] |= bitFiltered;
@@ -192,7 +200,6 @@ int SharingManager::filterSharing(int* begin, int buflen, int* filterOut) {
 		++shift;
 		clause = reader.getNextIncomingClause();
 	}
-	_filter.releaseLock();
 
 	_logger.log(V4_VVER, "filtered %i/%i\n", nbFiltered, nbTotal);
 	return filterPos+1;
@@ -238,114 +245,57 @@ void SharingManager::digestSharingWithFilter(int* begin, int buflen, const int*
 		});
 	}
 
-	// Prepare to traverse clauses not filtered yet
-	std::vector<std::forward_list<int>> unitLists(importingSolvers.size());
-	std::vector<std::forward_list<std::pair<int, int>>> binaryLists(importingSolvers.size());
-	std::vector<std::forward_list<std::vector<int>>> largeLists(importingSolvers.size());
-	std::vector<int> currentCapacities(importingSolvers.size(), -1);
-	std::vector<int> currentAddedLiterals(importingSolvers.size(), 0);
-
-	auto reader = _cdb.getBufferReader(begin, buflen);
-	BufferIterator it(_params.strictClauseLengthLimit(), /*slotsForSumOfLengthAndLbd=*/false);
-	auto clause = reader.getNextIncomingClause();
-	bool explicitLbds = false;
-
-	// Method to publish completed clause lists
-	auto doPublishClauseLists = [&]() {
-		if (it.clauseLength == 1) {
-			// Publish unit lists
-			for (size_t i = 0; i < importingSolvers.size(); i++) {
-				if (!unitLists[i].empty()) {
-					importingSolvers[i]->addLearnedClauses(it.clauseLength, it.lbd, unitLists[i], currentAddedLiterals[i]);
-				}
-			}
-		} else if (it.clauseLength == 2) {
-			// Publish binary lists
-			for (size_t i = 0; i < importingSolvers.size(); i++) {
-				if (!binaryLists[i].empty()) {
-					importingSolvers[i]->addLearnedClauses(it.clauseLength, it.lbd, binaryLists[i], currentAddedLiterals[i]);
-				}
-			}
-		} else {
-			// Publish large lists
-			for (size_t i = 0; i < importingSolvers.size(); i++) {
-				if (!largeLists[i].empty()) {
-					importingSolvers[i]->addLearnedClauses(it.clauseLength, it.lbd, largeLists[i], currentAddedLiterals[i]);
-				}
-			}
-		}
-	};
-
-	_logger.log(verb+2, "DG prepare import\n");
-
-	// Traverse clauses
-	bool initialized = false;
-	_filter.acquireLock();
+	// All importing solvers read the remaining clauses from a single shared copy
+	// of the buffer, each skipping the clauses specified in its own bitmask.
+	auto sharedBuffer = std::make_shared<SharedClauseBuffer>(begin, buflen, 
+		_params.strictClauseLengthLimit(), _params.groupClausesByLengthLbdSum());
+	std::vector<SkipMask> skipMasks(importingSolvers.size());
+	std::vector<int> budgets(importingSolvers.size());
+	std::vector<int> addedLiterals(importingSolvers.size(), 0);
+	for (size_t i = 0; i < importingSolvers.size(); i++) {
+		budgets[i] = importingSolvers[i]->getClauseImportBudget();
+	}
 
 	_logger.log(verb+2, "DG import\n");
 
+	// Traverse clauses
+	auto reader = sharedBuffer->getReader();
+	auto clause = reader.getNextIncomingClause();
+	size_t clauseIdx = 0;
 	while (clause.begin != nullptr) {
-		
-		if (!initialized || clause.size != it.clauseLength || clause.lbd != it.lbd) {
-			initialized = true;
-			float publishTime = Timer::elapsedSeconds();
-			_filter.releaseLock();
-
-			doPublishClauseLists();
-
-			while (clause.size != it.clauseLength || clause.lbd != it.lbd) {
-				it.nextLengthLbdGroup();
-				explicitLbds = it.storeWithExplicitLbd(/*maxLbdPartitioningSize=*/2);
-			}
-
-			for (size_t i = 0; i < importingSolvers.size(); i++) {
-				currentCapacities[i] = importingSolvers[i]->getClauseImportBudget(clause.size, clause.lbd);
-				currentAddedLiterals[i] = 0;
-			}
-
-			_filter.acquireLock();
-			publishTime = Timer::elapsedSeconds() - publishTime;
-			_logger.log(verb+2, "DG published clause lists (%.4f s)\n", publishTime);
-		}
 
 		hist.increment(clause.size);
-		uint8_t producers = _filter.getProducers(clause, _internal_epoch);
+		uint8_t producers = _filter.getProducers(clause, _sharing_epoch);
 
 		for (size_t i = 0; i < importingSolvers.size(); i++) {
 			auto& solver = *importingSolvers[i];
 			int sid = solver.getLocalId();
 			auto& solverStats = _solver_stats[sid];
 			solverStats->receivedClauses++;
-			if (currentCapacities[i] < clause.size) {
-				// No import budget left
-				solverStats->receivedClausesDropped++;
-				continue;
-			}
-			uint8_t producerFlag = 1 << sid;
+			bool skip = true;
 			if ((producers & (1 << sid)) != 0) {
 				// filtered by solver filter
 				solverStats->receivedClausesFiltered++;
-				continue;
+			} else if (budgets[i] < clause.size) {
+				// No import budget left
+				solverStats->receivedClausesDropped++;
 			} else {
 				// admitted by solver filter
-				if (clause.size == 1) unitLists[i].push_front(clause.begin[0]);
-				else if (clause.size == 2) binaryLists[i].emplace_front(clause.begin[0], clause.begin[1]);
-				else {
-					std::vector<int> clauseVec((explicitLbds ? 1 : 0) + clause.size);
-					size_t idx = 0;
-					if (explicitLbds) clauseVec[idx++] = clause.lbd;
-					for (size_t k = 0; k < clause.size; k++) clauseVec[idx++] = clause.begin[k];
-					largeLists[i].emplace_front(std::move(clauseVec));
-				}
-				currentCapacities[i] -= clause.size;
-				currentAddedLiterals[i] += clause.size;
+				skip = false;
+				budgets[i] -= clause.size;
+				addedLiterals[i] += clause.size;
 			}
+			skipMasks[i].append(clauseIdx, skip);
 		}
 
+		clauseIdx++;
 		clause = reader.getNextIncomingClause();
 	}
-	_filter.releaseLock();
-	doPublishClauseLists();
+
+	// Publish the clauses to the solvers
+	for (size_t i = 0; i < importingSolvers.size(); i++) {
+		importingSolvers[i]->addLearnedClauses(sharedBuffer, std::move(skipMasks[i]), addedLiterals[i]);
+	}
 	
 	// Process-wide stats
 	time = Timer::elapsedSeconds() - time;
@@ -366,6 +316,11 @@ SharingStatistics SharingManager::getStatistics() {
 		_observed_nonunit_lbd_of_length_minus_one, 
 		_observed_nonunit_lbd_of_length);
 	*/
+	_stats.filterLockAcquisitions = _filter.getNumLockAcquisitions();
+	_stats.filterLockContentions = _filter.getNumContendedLockAcquisitions();
+	_stats.filterMemoryBytes = _filter.getMemoryBytes();
+	_stats.filterEvictions = _filter.getNumEvictions();
+	_stats.filterFalsePositiveProbability = _filter.getFalsePositiveProbability();
 	return _stats;
 }
 
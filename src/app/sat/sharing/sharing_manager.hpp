@@ -24,18 +24,6 @@ protected:
 
 	SolverStatistics _returned_clauses_stats;
 
-	// clause importing / digestion
-	struct DeferredClauseList {
-		int revision;
-		size_t numLits = 0;
-		std::vector<bool> involvedSolvers;
-		std::vector<int> buffer;
-		std::vector<Mallob::Clause> clauses;
-		std::vector<uint32_t> producersPerClause;
-	};
-	std::list<DeferredClauseList> _future_clauses;
-	size_t _max_deferred_lits_per_solver;
-	
 	// global parameters
 	const Parameters& _params;
 	const Logger& _logger;
@@ -62,14 +50,20 @@ protected:
 	bool _observed_nonunit_lbd_of_length = false;
 	bool _observed_nonunit_lbd_of_length_minus_one = false;
 
+	// Number of exports so far (stamped on produced clauses)
 	int _internal_epoch = 0;
+	// Number of filtered sharings so far (used for the sharing epochs of
+	// the clause filter). Counted separately from the exports such that
+	// the export of the next sharing may precede the filtering of the last one.
+	int _sharing_epoch = 0;
 
 public:
 	SharingManager(std::vector<std::shared_ptr<PortfolioSolverInterface>>& solvers,
-			const Parameters& params, const Logger& logger, size_t maxDeferredLitsPerSolver,
-			int jobIndex);
+			const Parameters& params, const Logger& logger, int jobIndex);
 	~SharingManager();
 
+	// To be called periodically: moves freshly produced clauses into the clause database.
+	void collectProducedClauses();
     int prepareSharing(int* begin, int totalLiteralLimit);
 	int filterSharing(int* begin, int buflen, int* filterOut);
 	void digestSharingWithFilter(int* begin, int buflen, const int* filter);
@@ -95,9 +89,4 @@ private:
 		};
 	};
 
-	void tryReinsertDeferredClauses(int solverId, std::list<Clause>& clauses, SolverStatistics* stats);
-	void digestDeferredFutureClauses();
-
-	void importClausesToSolver(int solverId, const std::vector<Clause>& clauses, const std::vector<uint32_t>& producersPerClause);
-
 };
@@ -82,9 +82,15 @@ void PortfolioSolverInterface::addLearnedClause(const Mallob::Clause& c) {
 	_import_buffer.add(c);
 }
 
-int PortfolioSolverInterface::getClauseImportBudget(int clauseLength, int lbd) {
+int PortfolioSolverInterface::getClauseImportBudget() {
 	if (_clause_sharing_disabled) return 0;
-	return _import_buffer.getLiteralBudget(clauseLength, lbd);
+	return _import_buffer.getFreeLiteralBudget();
+}
+
+void PortfolioSolverInterface::addLearnedClauses(std::shared_ptr<const SharedClauseBuffer> buffer, 
+		SkipMask&& skipMask, int numLiterals) {
+	if (_clause_sharing_disabled) return;
+	_import_buffer.addSharedBuffer(std::move(buffer), std::move(skipMask), numLiterals);
 }
 
 bool PortfolioSolverInterface::fetchLearnedClause(Mallob::Clause& clauseOut, AdaptiveClauseDatabase::ExportMode mode) {
@@ -157,11 +157,10 @@ public:
 	// Add a learned clause to the formula
 	// The learned clauses might be added later or possibly never
 	void addLearnedClause(const Mallob::Clause& c);
-	int getClauseImportBudget(int clauseLength, int lbd);
-	template <typename T>
-	void addLearnedClauses(int clauseLength, int lbd, std::forward_list<T>& list, int numLiterals) {
-		_import_buffer.performImport<T>(clauseLength, lbd, list, numLiterals);
-	}
+	// Number of literals which can be added via addLearnedClauses at this point
+	int getClauseImportBudget();
+	// Add all clauses of the shared buffer except for the skipped ones (with numLiterals in total)
+	void addLearnedClauses(std::shared_ptr<const SharedClauseBuffer> buffer, SkipMask&& skipMask, int numLiterals);
 
 	// Within the solver, fetch a clause that was previously added as a learned clause.
 	bool fetchLearnedClause(Mallob::Clause& clauseOut, AdaptiveClauseDatabase::ExportMode mode = AdaptiveClauseDatabase::ANY);
@@ -20,6 +20,7 @@
 #include "data/job_reader.hpp"
 #include "util/sys/thread_pool.hpp"
 #include "util/sys/atomics.hpp"
+#include "util/sys/fileutils.hpp"
 
 #include "interface/socket/socket_connector.hpp"
 #include "interface/filesystem/filesystem_connector.hpp"
@@ -34,22 +35,36 @@ void Client::readIncomingJobs() {
 
     std::vector<std::future<void>> taskFutures;
 
+    const int maxParsingJobs = _params.numReaderThreads() > 0 ? _params.numReaderThreads() : INT32_MAX;
+    const size_t memoryBudget = ((size_t) _params.loadedJobMemoryBudget()) * 1024 * 1024;
+    // State in which the best job last exceeded the memory budget
+    // (the reader sleeps until the loaded bytes or the incoming jobs change)
+    bool budgetExceeded = false;
+    size_t budgetExceededLoadedBytes = 0;
+    int budgetExceededNumIncoming = 0;
+
     while (true) {
         // Wait for a nonempty incoming job queue
         _incoming_job_cond_var.wait(_incoming_job_lock, [&]() {
             return !_instance_reader.continueRunning() 
-                || (_num_incoming_jobs > 0 && _num_loaded_jobs < _params.loadedJobsPerClient());
+                || (_num_incoming_jobs > 0 && _num_loaded_jobs < _params.loadedJobsPerClient()
+                    && _num_parsing_jobs < maxParsingJobs
+                    && (!budgetExceeded || _loaded_job_bytes != budgetExceededLoadedBytes
+                        || _num_incoming_jobs != budgetExceededNumIncoming));
         });
         if (!_instance_reader.continueRunning()) break;
         if (_num_loaded_jobs >= _params.loadedJobsPerClient()) continue;
+        if (_num_parsing_jobs >= maxParsingJobs) continue;
 
         // Obtain lock, measure time
         auto lock = _incoming_job_lock.getLock();
         float time = Timer::elapsedSeconds();
 
-        // Find a single job eligible for parsing
-        bool foundAJob = false;
-        for (auto& data : _incoming_job_queue) {
+        // Find the job eligible for parsing with the highest priority
+        // and, among these, with the smallest input
+        auto bestIt = _incoming_job_queue.end();
+        for (auto it = _incoming_job_queue.begin(); it != _incoming_job_queue.end(); ++it) {
+            auto& data = *it;
             
             // Jobs are sorted by arrival:
             // If this job has not arrived yet, then none have arrived yet
@@ -78,54 +93,93 @@ void Client::readIncomingJobs() {
             }
             if (!dependenciesSatisfied) continue;
 
-            // Job can be read: Enqueue reader task into thread pool
-            LOGGER(log, V4_VVER, "ENQUEUE #%i\n", data.description->getId());
-            auto node = _incoming_job_queue.extract(data);
-            auto future = ProcessWideThreadPool::get().addTask(
-                [this, &log, foundJobPtr = new JobMetadata(std::move(node.value()))]() mutable {
-                
-                auto& foundJob = *foundJobPtr;
-                if (!_instance_reader.continueRunning()) return;
-                
-                // Read job
-                int id = foundJob.description->getId();
-                float time = Timer::elapsedSeconds();
-                bool success = true;
-                auto filesList = foundJob.getFilesList();
-                if (foundJob.hasFiles()) {
-                    LOGGER(log, V3_VERB, "[T] Reading job #%i rev. %i %s ...\n", id, foundJob.description->getRevision(), filesList.c_str());
-                    success = JobReader::read(foundJob.files, foundJob.contentMode, *foundJob.description);
-                } else {
-                    foundJob.description->beginInitialization(foundJob.description->getRevision());
-                    foundJob.description->endInitialization();
-                }
-                if (!success) {
-                    LOGGER(log, V1_WARN, "[T] [WARN] Unsuccessful read - skipping #%i\n", id);
-                } else {
-                    time = Timer::elapsedSeconds() - time;
-                    LOGGER(log, V3_VERB, "[T] Initialized job #%i %s in %.3fs: %ld lits w/ separators, %ld assumptions\n", 
-                            id, filesList.c_str(), time, foundJob.description->getNumFormulaLiterals(), 
-                            foundJob.description->getNumAssumptionLiterals());
-                    foundJob.description->getStatistics().parseTime = time;
-                    
-                    // Enqueue in ready jobs
-                    auto lock = _ready_job_lock.getLock();
-                    _ready_job_queue.push_back(std::move(foundJob.description));
-                    atomics::incrementRelaxed(_num_ready_jobs);
-                    atomics::incrementRelaxed(_num_loaded_jobs);
-                    _sys_state.addLocal(SYSSTATE_PARSED_JOBS, 1);
-                }
-
-                delete foundJobPtr;
-            });
-            taskFutures.push_back(std::move(future));
-            foundAJob = true;
-            break;
+            if (bestIt == _incoming_job_queue.end()) {
+                bestIt = it;
+                continue;
+            }
+            float prio = data.description->getPriority();
+            float bestPrio = bestIt->description->getPriority();
+            if (prio > bestPrio || (prio == bestPrio && data.inputSize < bestIt->inputSize))
+                bestIt = it;
         }
-
-        if (foundAJob) {
-            _num_incoming_jobs--;
+        if (bestIt == _incoming_job_queue.end()) continue;
+
+        // Job must fit into the memory budget - unless no other job is loaded
+        // (otherwise, a job exceeding the budget on its own would never be parsed)
+        size_t estimatedSize = bestIt->inputSize;
+        budgetExceeded = memoryBudget > 0 && _loaded_job_bytes > 0 
+            && _loaded_job_bytes + estimatedSize > memoryBudget;
+        if (budgetExceeded) {
+            budgetExceededLoadedBytes = _loaded_job_bytes;
+            budgetExceededNumIncoming = _num_incoming_jobs;
+            continue;
         }
+
+        // Job can be read: Enqueue reader task into thread pool
+        LOGGER(log, V4_VVER, "ENQUEUE #%i (input size %lu, %lu bytes loaded)\n", 
+            bestIt->description->getId(), estimatedSize, _loaded_job_bytes);
+        _loaded_job_bytes += estimatedSize;
+        _num_parsing_jobs++;
+        auto node = _incoming_job_queue.extract(bestIt);
+        auto future = ProcessWideThreadPool::get().addTask(
+            [this, &log, enqueueTime = time, estimatedSize, 
+                foundJobPtr = new JobMetadata(std::move(node.value()))]() mutable {
+            
+            auto& foundJob = *foundJobPtr;
+            if (!_instance_reader.continueRunning()) return;
+            
+            // Read job
+            int id = foundJob.description->getId();
+            float time = Timer::elapsedSeconds();
+            bool success = true;
+            auto filesList = foundJob.getFilesList();
+            if (foundJob.hasFiles()) {
+                LOGGER(log, V3_VERB, "[T] Reading job #%i rev. %i %s ...\n", id, foundJob.description->getRevision(), filesList.c_str());
+                // In mono mode, all cores are idle until the job is parsed
+                int numThreads = _params.monoFilename.isSet() ? _params.numThreadsPerProcess() : 1;
+                success = JobReader::read(foundJob.files, foundJob.contentMode, *foundJob.description, 
+                    numThreads, _params.formulaCacheDirectory());
+            } else {
+                foundJob.description->beginInitialization(foundJob.description->getRevision());
+                foundJob.description->endInitialization();
+            }
+
+            // Replace the estimated size of the description with its actual size
+            size_t loadedSize = success ? 
+                foundJob.description->getTransferSize(foundJob.description->getRevision()) : 0;
+            {
+                auto lock = _incoming_job_lock.getLock();
+                _loaded_job_bytes += loadedSize;
+                _loaded_job_bytes -= std::min(_loaded_job_bytes, estimatedSize);
+                _num_parsing_jobs--;
+            }
+            _incoming_job_cond_var.notify();
+
+            if (!success) {
+                LOGGER(log, V1_WARN, "[T] [WARN] Unsuccessful read - skipping #%i\n", id);
+            } else {
+                float now = Timer::elapsedSeconds();
+                time = now - time;
+                // Parse latency includes the time spent waiting for a thread
+                float latency = now - enqueueTime;
+                auto& stats = foundJob.description->getStatistics();
+                LOGGER(log, V3_VERB, "[T] Initialized job #%i %s in %.3fs (latency %.3fs, decompression %.3fs, tokenization %.3fs): %ld lits w/ separators, %ld assumptions\n", 
+                        id, filesList.c_str(), time, latency, stats.decompressionTime, stats.tokenizationTime, 
+                        foundJob.description->getNumFormulaLiterals(), foundJob.description->getNumAssumptionLiterals());
+                stats.parseTime = latency;
+                
+                // Enqueue in ready jobs
+                auto lock = _ready_job_lock.getLock();
+                _ready_job_queue.push_back(std::move(foundJob.description));
+                atomics::incrementRelaxed(_num_ready_jobs);
+                atomics::incrementRelaxed(_num_loaded_jobs);
+                _sys_state.addLocal(SYSSTATE_PARSED_JOBS, 1);
+            }
+
+            delete foundJobPtr;
+        });
+        taskFutures.push_back(std::move(future));
+        _num_incoming_jobs--;
     }
 
     LOGGER(log, V3_VERB, "Stopping\n");
@@ -154,6 +208,7 @@ void Client::handleNewJob(JobMetadata&& data) {
 
     // Introduce new job into "incoming" queue
     data.description->setClientRank(_world_rank);
+    for (auto& file : data.files) data.inputSize += FileUtils::getFileSize(file);
     {
         auto lock = _arrival_times_lock.getLock();
         _arrival_times.insert(data.description->getArrival());
@@ -411,6 +466,7 @@ void Client::handleOfferAdoption(MessageHandle& handle) {
     {
         auto lock = _incoming_job_lock.getLock();
         _num_loaded_jobs--;
+        _loaded_job_bytes -= std::min(_loaded_job_bytes, data->size());
     }
     _incoming_job_cond_var.notify(); 
 }
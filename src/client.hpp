@@ -88,6 +88,11 @@ private:
 
     // Number of jobs with a loaded description (taking memory!)
     std::atomic_int _num_loaded_jobs = 0;
+    // Number of jobs whose description is being parsed right now
+    std::atomic_int _num_parsing_jobs = 0;
+    // Size of loaded descriptions plus estimated size of descriptions being parsed.
+    // Safeguarded by _incoming_job_lock.
+    size_t _loaded_job_bytes = 0;
     Mutex _finished_msg_ids_mutex;
     std::vector<int> _finished_msg_ids;
 
@@ -0,0 +1,94 @@
+
+#include "comm/buffer_pool.hpp"
+
+#include <algorithm>
+
+bool BufferPool::_enabled = true;
+
+namespace {
+    struct LocalPool {
+        std::vector<std::vector<uint8_t>> buffers[BufferPool::NUM_CLASSES];
+        BufferPool::Stats stats;
+        bool drawing = false; // whether the thread has drawn any buffer from the pool
+    };
+    thread_local LocalPool localPool;
+
+    // Smallest size class whose buffers can hold the given number of bytes
+    inline int getClassForSize(size_t size) {
+        int log = size <= 1 ? 0 : 64 - __builtin_clzll(size-1);
+        return std::max(log, BufferPool::MIN_CLASS_LOG) - BufferPool::MIN_CLASS_LOG;
+    }
+    // Largest size class which a buffer of the given capacity can serve
+    inline int getClassForCapacity(size_t capacity) {
+        int log = 63 - __builtin_clzll(capacity);
+        return std::min(log, BufferPool::MAX_CLASS_LOG) - BufferPool::MIN_CLASS_LOG;
+    }
+}
+
+std::vector<uint8_t> BufferPool::get(size_t size) {
+    auto buffer = draw(size);
+    buffer.clear();
+    buffer.resize(size);
+    return buffer;
+}
+
+std::vector<uint8_t> BufferPool::getUninitialized(size_t size) {
+    auto buffer = draw(size);
+    // Only bytes beyond the recycled buffer's former size are initialized
+    buffer.resize(size);
+    return buffer;
+}
+
+std::vector<uint8_t> BufferPool::draw(size_t size) {
+    auto& pool = localPool;
+    pool.drawing = true;
+    int cls = getClassForSize(size);
+    if (!_enabled || cls >= NUM_CLASSES) {
+        pool.stats.misses++;
+        return std::vector<uint8_t>();
+    }
+    auto& buffers = pool.buffers[cls];
+    std::vector<uint8_t> buffer;
+    if (!buffers.empty()) {
+        buffer = std::move(buffers.back());
+        buffers.pop_back();
+        pool.stats.cachedBytes -= buffer.capacity();
+        pool.stats.hits++;
+    } else {
+        buffer.reserve((size_t)1 << (cls + MIN_CLASS_LOG));
+        pool.stats.misses++;
+    }
+    return buffer;
+}
+
+void BufferPool::recycle(std::vector<uint8_t>&& buffer) {
+    if (buffer.capacity() == 0) return;
+    auto& pool = localPool;
+    // A thread which never draws from its pool would only accumulate buffers
+    if (!pool.drawing || !accepts(buffer.capacity())) {
+        pool.stats.discarded++;
+        std::vector<uint8_t>().swap(buffer);
+        return;
+    }
+    int cls = getClassForCapacity(buffer.capacity());
+    auto& buffers = pool.buffers[cls];
+    size_t maxBuffers = std::max(1UL, std::min(MAX_BUFFERS_PER_CLASS, 
+        MAX_CACHED_BYTES_PER_CLASS >> (cls + MIN_CLASS_LOG)));
+    if (buffers.size() >= maxBuffers) {
+        pool.stats.discarded++;
+        std::vector<uint8_t>().swap(buffer);
+        return;
+    }
+    // The contents are kept such that getUninitialized need not touch them
+    pool.stats.cachedBytes += buffer.capacity();
+    buffers.push_back(std::move(buffer));
+    pool.stats.recycled++;
+}
+
+BufferPool::Stats BufferPool::getAndResetStats() {
+    auto& stats = localPool.stats;
+    Stats result = stats;
+    stats = Stats();
+    stats.cachedBytes = result.cachedBytes;
+    return result;
+}
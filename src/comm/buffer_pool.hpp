@@ -0,0 +1,64 @@
+
+#ifndef DOMPASCH_MALLOB_BUFFER_POOL_HPP
+#define DOMPASCH_MALLOB_BUFFER_POOL_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Pool of byte buffers for serialized messages, organized in size classes of
+powers of two. A buffer drawn from the pool has the capacity of its size class,
+so that it can be recycled for any other message of the same class.
+Buffers are recycled when a message has been sent or a received message has
+been processed, instead of being deallocated. Each thread has a pool of its own,
+so no synchronization is required; a buffer can be recycled by a different
+thread than the one which drew it. The cached buffers of a thread are limited
+in number and in their total size per size class. A thread only caches recycled
+buffers once it has drawn from its pool itself; otherwise they are deallocated.
+*/
+class BufferPool {
+
+public:
+    static constexpr int MIN_CLASS_LOG = 6; // 64 bytes
+    static constexpr int MAX_CLASS_LOG = 22; // 4 MiB
+    static constexpr int NUM_CLASSES = MAX_CLASS_LOG - MIN_CLASS_LOG + 1;
+    static constexpr size_t MAX_BUFFERS_PER_CLASS = 64;
+    static constexpr size_t MAX_CACHED_BYTES_PER_CLASS = 2 * 1024 * 1024; // but at least one buffer
+
+    struct Stats {
+        unsigned long hits = 0;
+        unsigned long misses = 0;
+        unsigned long recycled = 0;
+        unsigned long discarded = 0;
+        size_t cachedBytes = 0;
+    };
+
+    // Returns a buffer of the given size, zero-initialized as a std::vector(size) would be.
+    static std::vector<uint8_t> get(size_t size);
+    // Returns a buffer of the given size whose contents are unspecified, e.g.,
+    // to be overwritten entirely by a receive. A recycled buffer is handed out 
+    // without clearing it. (A buffer beyond the size classes is still allocated 
+    // as a zero-initialized std::vector, which cannot hold uninitialized bytes.)
+    static std::vector<uint8_t> getUninitialized(size_t size);
+    // Hands a buffer back to the calling thread's pool. The buffer is deallocated
+    // if it does not fit into a size class, if the pool is full, or if the calling
+    // thread has never drawn from its pool.
+    static void recycle(std::vector<uint8_t>&& buffer);
+    // Whether a buffer of the given capacity can be taken by the pool.
+    static bool accepts(size_t capacity) {
+        return _enabled && capacity >= ((size_t)1 << MIN_CLASS_LOG) && capacity < ((size_t)1 << (MAX_CLASS_LOG+1));
+    }
+    // Statistics of the calling thread's pool since the last call
+    static Stats getAndResetStats();
+
+    static void setEnabled(bool enabled) {_enabled = enabled;}
+
+private:
+    static bool _enabled;
+
+    // Pops a buffer of the size's class (or returns an empty one)
+    static std::vector<uint8_t> draw(size_t size);
+};
+
+#endif
@@ -0,0 +1,178 @@
+
+#include "description_streamer.hpp"
+
+#include <cstring>
+
+#include "comm/mympi.hpp"
+#include "comm/msgtags.h"
+#include "util/logger.hpp"
+
+void DescriptionStreamer::send(int jobId, int revision, int dest, int tag, const DataPtr& message) {
+    auto buffer = std::make_shared<Buffer>();
+    buffer->data = message;
+    buffer->available = message->size();
+    OutgoingStream stream;
+    stream.jobId = jobId;
+    stream.revision = revision;
+    stream.dest = dest;
+    stream.tag = tag;
+    stream.buffer = std::move(buffer);
+    _outgoing.push_back(std::move(stream));
+    advance(std::prev(_outgoing.end()));
+}
+
+bool DescriptionStreamer::relay(int jobId, int revision, int dest) {
+    auto it = _incoming.find(std::pair<int, int>(jobId, revision));
+    if (it == _incoming.end()) return false;
+    OutgoingStream stream;
+    stream.jobId = jobId;
+    stream.revision = revision;
+    stream.dest = dest;
+    stream.tag = it->second.tag;
+    stream.buffer = it->second.buffer;
+    stream.relayed = true;
+    _outgoing.push_back(std::move(stream));
+    LOG_ADD_DEST(V4_VVER, "Relay desc. stream of #%i rev. %i (%lu/%lu bytes present)", dest,
+        jobId, revision, it->second.buffer->available, it->second.buffer->data->size());
+    advance(std::prev(_outgoing.end()));
+    return true;
+}
+
+DescriptionStreamer::CompletedMessage DescriptionStreamer::handleChunk(int source, const std::vector<uint8_t>& chunk) {
+
+    CompletedMessage result;
+    if (chunk.size() < sizeof(ChunkHeader)) return result;
+    ChunkHeader header = readHeader(chunk);
+    size_t chunkSize = chunk.size() - sizeof(ChunkHeader);
+    if (chunkSize == 0 || header.offset + chunkSize > header.totalSize) return result;
+    auto key = std::pair<int, int>(header.jobId, header.revision);
+
+    auto it = _incoming.find(key);
+    if (header.offset == 0) {
+        // New stream: (re-)initialize the message to receive
+        if (it != _incoming.end()) discard(it);
+        IncomingStream stream;
+        stream.source = source;
+        stream.tag = header.tag;
+        stream.buffer = std::make_shared<Buffer>();
+        stream.buffer->data.reset(new std::vector<uint8_t>(header.totalSize));
+        it = _incoming.emplace(key, std::move(stream)).first;
+    }
+    if (it == _incoming.end() || it->second.source != source
+            || header.offset != it->second.buffer->available
+            || header.offset + chunkSize > it->second.buffer->data->size()) {
+        // Stale or unexpected chunk
+        LOG_ADD_SRC(V4_VVER, "Drop unexpected chunk %i of desc. stream #%i rev. %i", source,
+            header.sentChunk, header.jobId, header.revision);
+        return result;
+    }
+
+    auto& buffer = *it->second.buffer;
+    memcpy(buffer.data->data() + buffer.available, chunk.data() + sizeof(ChunkHeader), chunkSize);
+    buffer.available += chunkSize;
+    LOG_ADD_SRC(V5_DEBG, "Got chunk %i of desc. stream #%i rev. %i (%lu/%lu bytes)", source,
+        header.sentChunk, header.jobId, header.revision, buffer.available, buffer.data->size());
+
+    // Forward the new data along each relay of this stream
+    auto relayIt = _outgoing.begin();
+    while (relayIt != _outgoing.end()) {
+        auto next = std::next(relayIt);
+        if (relayIt->buffer == it->second.buffer) advance(relayIt);
+        relayIt = next;
+    }
+
+    if (buffer.available == buffer.data->size()) {
+        // Stream completed
+        result.jobId = header.jobId;
+        result.revision = header.revision;
+        result.tag = it->second.tag;
+        result.data = buffer.data;
+        _incoming.erase(it);
+    }
+    return result;
+}
+
+void DescriptionStreamer::handleSent(int sendId) {
+    auto it = _send_id_to_stream.find(sendId);
+    if (it == _send_id_to_stream.end()) return;
+    auto streamIt = it->second;
+    _send_id_to_stream.erase(it);
+    streamIt->numChunksInFlight--;
+    advance(streamIt);
+}
+
+void DescriptionStreamer::discardIncoming(const std::function<bool(int)>& isObsolete) {
+    auto it = _incoming.begin();
+    while (it != _incoming.end()) {
+        if (isObsolete(it->first.first)) it = discard(it);
+        else ++it;
+    }
+}
+
+DescriptionStreamer::IncomingMap::iterator DescriptionStreamer::discard(IncomingMap::iterator it) {
+    LOG(V4_VVER, "Discard desc. stream #%i rev. %i (%lu/%lu bytes received)\n", it->first.first,
+        it->first.second, it->second.buffer->available, it->second.buffer->data->size());
+    // Cancel all relays which wait for further data of this stream
+    auto relayIt = _outgoing.begin();
+    while (relayIt != _outgoing.end()) {
+        auto next = std::next(relayIt);
+        if (relayIt->buffer == it->second.buffer) {
+            bool dropped = !relayIt->cancelled;
+            int jobId = relayIt->jobId, revision = relayIt->revision, dest = relayIt->dest;
+            relayIt->cancelled = true;
+            advance(relayIt);
+            // The destination still waits for this revision: let the caller serve it otherwise
+            if (dropped && _on_relay_dropped) _on_relay_dropped(jobId, revision, dest);
+        }
+        relayIt = next;
+    }
+    return _incoming.erase(it);
+}
+
+DescriptionStreamer::ChunkHeader DescriptionStreamer::readHeader(const std::vector<uint8_t>& chunk) {
+    ChunkHeader header;
+    memcpy(&header, chunk.data(), sizeof(ChunkHeader));
+    return header;
+}
+
+void DescriptionStreamer::advance(std::list<OutgoingStream>::iterator it) {
+
+    auto& stream = *it;
+    if (!stream.cancelled && !_check_destination(stream.jobId, stream.dest)) {
+        LOG_ADD_DEST(V4_VVER, "Cancel desc. stream #%i rev. %i after %lu/%lu bytes", stream.dest,
+            stream.jobId, stream.revision, stream.offset, stream.buffer->data->size());
+        stream.cancelled = true;
+    }
+
+    // Send further chunks of the data available so far
+    const size_t totalSize = stream.buffer->data->size();
+    while (!stream.cancelled && stream.numChunksInFlight < _max_chunks_in_flight
+            && stream.offset < stream.buffer->available) {
+
+        size_t size = std::min(_chunk_size, stream.buffer->available - stream.offset);
+        ChunkHeader header;
+        header.jobId = stream.jobId;
+        header.revision = stream.revision;
+        header.tag = stream.tag;
+        header.sentChunk = stream.numSentChunks;
+        header.totalSize = totalSize;
+        header.offset = stream.offset;
+        std::vector<uint8_t> chunk(sizeof(ChunkHeader) + size);
+        memcpy(chunk.data(), &header, sizeof(ChunkHeader));
+        memcpy(chunk.data() + sizeof(ChunkHeader), stream.buffer->data->data() + stream.offset, size);
+
+        int sendId = MyMpi::isend(stream.dest, MSG_SEND_JOB_DESCRIPTION_CHUNK, std::move(chunk));
+        _send_id_to_stream[sendId] = it;
+        if (stream.relayed) _num_relayed_bytes += size;
+        stream.offset += size;
+        stream.numSentChunks++;
+        stream.numChunksInFlight++;
+    }
+
+    // Stream done?
+    if (stream.numChunksInFlight == 0 && (stream.cancelled || stream.offset == totalSize)) {
+        if (!stream.cancelled) LOG_ADD_DEST(V4_VVER, "Streamed desc. of #%i rev. %i, size %lu, %i chunks",
+            stream.dest, stream.jobId, stream.revision, totalSize, stream.numSentChunks);
+        _outgoing.erase(it);
+    }
+}
@@ -0,0 +1,129 @@
+
+#ifndef DOMPASCH_MALLOB_DESCRIPTION_STREAMER_HPP
+#define DOMPASCH_MALLOB_DESCRIPTION_STREAMER_HPP
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include "util/hashing.hpp"
+
+typedef std::shared_ptr<std::vector<uint8_t>> DataPtr;
+
+/*
+Chunked transfer of job description messages (raw or encoded revisions)
+along a job tree. A message is sent as a sequence of chunks, each of which
+is an MPI message of its own. A worker which receives such a stream can relay
+each chunk to further workers (its existing children waiting for the same 
+revision) as soon as the chunk arrives.
+As the chunks of a stream are sent in order by a single sender (and MPI
+messages do not overtake each other), the received part of a stream is
+always a prefix of the message.
+This only pipelines a transfer along children which are already present,
+e.g., for later revisions of an incremental job. It does not speed up the 
+initial growth of a job: a newly adopted worker only adopts children of its
+own after it has received the job's full initial revision.
+*/
+class DescriptionStreamer {
+
+public:
+    struct ChunkHeader {
+        int jobId; // first, like in every job description message
+        int revision;
+        int tag; // tag of the full (reassembled) message
+        int sentChunk;
+        uint64_t totalSize;
+        uint64_t offset;
+    };
+
+    struct CompletedMessage {
+        int jobId = -1;
+        int revision = -1;
+        int tag = -1;
+        DataPtr data;
+    };
+
+    // Returns whether the specified destination still wants to receive the job's description.
+    typedef std::function<bool(int, int)> DestinationCheck;
+    // Called with (jobId, revision, dest) for each relay which was dropped because
+    // its incoming stream was discarded or restarted. The destination did not get
+    // the full revision and needs to be served again.
+    typedef std::function<void(int, int, int)> RelayDropCallback;
+
+private:
+    // Message which is (being) received, shared among all streams sending it
+    struct Buffer {
+        DataPtr data;
+        size_t available = 0;
+    };
+    struct IncomingStream {
+        int source;
+        int tag;
+        std::shared_ptr<Buffer> buffer;
+    };
+    struct OutgoingStream {
+        int jobId;
+        int revision;
+        int dest;
+        int tag;
+        std::shared_ptr<Buffer> buffer;
+        size_t offset = 0;
+        int numSentChunks = 0;
+        int numChunksInFlight = 0;
+        bool relayed = false;
+        bool cancelled = false;
+    };
+
+    const size_t _chunk_size;
+    const int _max_chunks_in_flight;
+    DestinationCheck _check_destination;
+    RelayDropCallback _on_relay_dropped;
+
+    typedef robin_hood::unordered_node_map<std::pair<int, int>, IncomingStream, IntPairHasher> IncomingMap;
+    IncomingMap _incoming;
+    std::list<OutgoingStream> _outgoing;
+    robin_hood::unordered_map<int, std::list<OutgoingStream>::iterator> _send_id_to_stream;
+
+    size_t _num_relayed_bytes = 0;
+
+public:
+    DescriptionStreamer(size_t chunkSize, int maxChunksInFlight, DestinationCheck checkDestination,
+            RelayDropCallback onRelayDropped) :
+        _chunk_size(chunkSize), _max_chunks_in_flight(maxChunksInFlight),
+        _check_destination(checkDestination), _on_relay_dropped(onRelayDropped) {}
+
+    // Whether a message of the given size should be streamed at all
+    bool isStreamed(size_t messageSize) const {return messageSize > _chunk_size;}
+
+    // Begins to stream the given message (sent with the given tag otherwise) to dest.
+    void send(int jobId, int revision, int dest, int tag, const DataPtr& message);
+    // If the specified revision is being received right now, begins to relay
+    // it to dest (beginning with all chunks received so far) and returns true.
+    bool relay(int jobId, int revision, int dest);
+    bool isReceiving(int jobId, int revision) const {
+        return _incoming.count(std::pair<int, int>(jobId, revision));
+    }
+
+    // Digests a received chunk and forwards it along all according relays.
+    // Returns the full message as soon as its last chunk was received.
+    CompletedMessage handleChunk(int source, const std::vector<uint8_t>& chunk);
+    // To be called whenever a chunk message (identified by its send ID) has been sent.
+    void handleSent(int sendId);
+
+    // Drops all incomplete incoming streams (and relays thereof) of jobs
+    // for which the provided function returns true. The relay drop callback
+    // is called for each affected relay.
+    void discardIncoming(const std::function<bool(int)>& isObsolete);
+
+    static ChunkHeader readHeader(const std::vector<uint8_t>& chunk);
+
+    size_t getNumRelayedBytes() const {return _num_relayed_bytes;}
+
+private:
+    void advance(std::list<OutgoingStream>::iterator it);
+    IncomingMap::iterator discard(IncomingMap::iterator it);
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "data/serializable.hpp"
 #include "data/job_transfer.hpp"
 #include "comm/mympi.hpp"
+#include "comm/buffer_pool.hpp"
 #include "util/logger.hpp"
 #include "util/hashing.hpp"
 
@@ -18,7 +19,7 @@ struct BFSMessage : public Serializable {
     JobRequest request;
 
     std::vector<uint8_t> serialize() const override {
-        std::vector<uint8_t> packed(3*sizeof(int));
+        std::vector<uint8_t> packed = BufferPool::get(3*sizeof(int));
         int i = 0, n;
         n = sizeof(int); memcpy(packed.data()+i, &depth, n); i += n;
         n = sizeof(int); memcpy(packed.data()+i, &maxDepth, n); i += n;
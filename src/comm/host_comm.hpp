@@ -23,6 +23,7 @@ private:
     MPI_Comm _comm;
 
     std::string _base_filename;
+    int _host_leader_pid;
 
     SysState<4>* _sysstate = nullptr;
     const int SYSSTATE_PROCESS_USED_MEMORY = 0;
@@ -37,7 +38,8 @@ private:
     float _last_contributed_criticality = 0;
 
 public:
-    HostComm(MPI_Comm parentComm, const Parameters& params) : _params(params), _parent_comm(parentComm) {}
+    HostComm(MPI_Comm parentComm, const Parameters& params) : _params(params), _parent_comm(parentComm), 
+        _host_leader_pid(Proc::getPid()) {}
     ~HostComm() {
         if (_sysstate != nullptr) delete _sysstate;
     }
@@ -88,10 +90,18 @@ public:
 
         LOG(V2_INFO, "Machine color %i with %i total workers (my rank: %i)\n", 
             color, MyMpi::size(_comm), MyMpi::rank(_comm));
+
+        // The PID of the first process on this machine identifies it
+        // (e.g., for naming host-wide shared memory) during this run
+        MPI_Bcast(&_host_leader_pid, 1, MPI_INT, 0, _comm);
         
         _sysstate = new SysState<4>(_comm, /*periodSeconds=*/1, SysState<4>::ALLGATHER);
     }
 
+    int getHostLeaderPid() const {
+        return _host_leader_pid;
+    }
+
     void setRamUsageThisWorkerGbs(float ramGbs) {
         _ram_usage_this_worker_gb = ramGbs;
     }
@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "comm/mpi_base.hpp"
+#include "comm/buffer_pool.hpp"
 
 /*
 Represents a single message that is being sent or received.
@@ -31,7 +32,10 @@ public:
         creationTime = moved.creationTime;
         data = std::move(moved.data);
     }
-    ~MessageHandle() = default;
+    ~MessageHandle() {
+        // Recycle the data unless it was moved out
+        BufferPool::recycle(std::move(data));
+    }
 
     MessageHandle& operator=(MessageHandle&& moved) {
         tag = moved.tag;
@@ -2,6 +2,7 @@
 #include "comm/message_queue.hpp"
 
 #include "comm/message_handle.hpp"
+#include "comm/buffer_pool.hpp"
 
 #include <list>
 #include <cmath>
@@ -14,15 +15,27 @@
 #include "comm/msgtags.h"
 #include "util/ringbuffer.hpp"
 
-MessageQueue::MessageQueue(int maxMsgSize) : _max_msg_size(maxMsgSize) {
+MessageQueue::MessageQueue(int maxMsgSize, int maxNumPostedReceives, bool zeroCopyFragments) : _max_msg_size(maxMsgSize), 
+        _recv_buffer_size(maxMsgSize+20), _min_num_posted_receives(1), 
+        _max_num_posted_receives(std::max(1, maxNumPostedReceives)),
+        _target_num_posted_receives(std::min(4, _max_num_posted_receives)) {
     
     MPI_Comm_rank(MPI_COMM_WORLD, &_my_rank);
-    _recv_data = (uint8_t*) malloc(maxMsgSize+20);
 
     _current_recv_tag = &_default_tag_var;
     _current_send_tag = &_default_tag_var;
 
-    resetReceiveHandle();
+    if (zeroCopyFragments) {
+        // Fragments travel on a communicator of their own, so that they cannot be 
+        // matched by the receives for arbitrary messages posted in MPI_COMM_WORLD
+        MPI_Comm_dup(MPI_COMM_WORLD, &_direct_comm);
+        int* tagUpperBound;
+        int flag;
+        MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &tagUpperBound, &flag);
+        _max_transfer_tag = flag ? *tagUpperBound : 32767;
+    }
+
+    postReceives();
 
     _batch_assembler.run([&]() {
         Proc::nameThisThread("MsgAssembler");
@@ -37,7 +50,9 @@ MessageQueue::MessageQueue(int maxMsgSize) : _max_msg_size(maxMsgSize) {
 MessageQueue::~MessageQueue() {
     _batch_assembler.stop();
     _gc.stop();
-    free(_recv_data);
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized && _direct_comm != MPI_COMM_NULL) MPI_Comm_free(&_direct_comm);
 }
 
 void MessageQueue::registerCallback(int tag, const MsgCallback& cb) {
@@ -64,10 +79,46 @@ void MessageQueue::clearCallbacks() {
 int MessageQueue::send(DataPtr data, int dest, int tag) {
 
     *_current_send_tag = tag;
+    int id = _running_send_id++;
+
+    if (isCoalesced(data->size(), dest)) {
+        // Small message: append to the destination's envelope
+        coalesce(data->data(), data->size(), dest, tag, id);
+    } else {
+        // Do not overtake the messages coalesced for this destination so far: 
+        // the envelope is enqueued first, and the message is enqueued behind it
+        // (see enqueueSend) unless it is fragmented
+        if (_envelopes.count(dest)) flushEnvelope(dest);
+        enqueueSend(data, dest, tag, id);
+    }
+
+    *_current_send_tag = 0;
+    return id;
+}
+
+int MessageQueue::send(std::vector<uint8_t>&& data, int dest, int tag) {
+    if (!isCoalesced(data.size(), dest)) 
+        return send(std::make_shared<std::vector<uint8_t>>(std::move(data)), dest, tag);
+
+    // Small message: append to the destination's envelope and recycle the data right away
+    *_current_send_tag = tag;
+    int id = _running_send_id++;
+    coalesce(data.data(), data.size(), dest, tag, id);
+    BufferPool::recycle(std::move(data));
+    *_current_send_tag = 0;
+    return id;
+}
+
+int MessageQueue::enqueueSend(DataPtr data, int dest, int tag, int id, int sendClass) {
 
     // Initialize send handle
     {
-        SendHandle handle(_running_send_id++, dest, tag, data, _max_msg_size);
+        SendHandle handle(id, dest, tag, data, _max_msg_size, _direct_comm);
+        if (handle.isDirect()) {
+            // Tags are only reused after this many further transfers
+            handle.transferTag = _running_transfer_tag;
+            _running_transfer_tag = _running_transfer_tag == _max_transfer_tag ? 0 : _running_transfer_tag+1;
+        }
 
         int msglen = handle.data->size();
         LOG(V5_DEBG, "MQ SEND n=%i d=[%i] t=%i c=(%i,...,%i,%i,%i)\n", handle.data->size(), dest, tag, 
@@ -82,27 +133,159 @@ int MessageQueue::send(DataPtr data, int dest, int tag) {
             return _self_recv_queue.back().id;
         }
 
-        _send_queue.push_back(std::move(handle));
+        handle.sendClass = sendClass >= 0 ? sendClass : getSendClass(tag, handle.isBatched());
+        if (!handle.isBatched()) {
+            // Do not overtake a pending unfragmented message to the same destination
+            // of a lower priority class: enqueue behind it instead
+            for (int cls = NUM_SEND_CLASSES-1; cls > handle.sendClass; cls--) {
+                if (_pending_sends[cls].numUnbatchedByDest.count(dest)) {
+                    handle.sendClass = cls;
+                    break;
+                }
+            }
+        }
+        handle.enqueueTime = MPI_Wtime();
+        if (handle.sendClass == SEND_CONTROL) {
+            // Control messages bypass all other pending messages
+            initiateSend(std::move(handle));
+        } else {
+            // Enqueue behind pending messages of the same class to the same destination
+            auto& pending = _pending_sends[handle.sendClass];
+            auto& destQueue = pending.byDest[dest];
+            if (destQueue.empty()) pending.destOrder.push_back(dest);
+            if (!handle.isBatched()) pending.numUnbatchedByDest[dest]++;
+            destQueue.push_back(std::move(handle));
+            pending.size++;
+            initiatePendingSends();
+        }
+    }
+    return id;
+}
+
+MessageQueue::SendClass MessageQueue::getSendClass(int tag, bool batched) {
+    // Fragmented messages occupy a send slot for a long time
+    if (batched) return SEND_BULK;
+    switch (tag) {
+    case MSG_QUERY_VOLUME:
+    case MSG_REQUEST_NODE:
+    case MSG_REQUEST_NODE_ONESHOT:
+    case MSG_REJECT_ONESHOT:
+    case MSG_OFFER_ADOPTION:
+    case MSG_OFFER_ADOPTION_OF_ROOT:
+    case MSG_ANSWER_ADOPTION_OFFER:
+    case MSG_NOTIFY_VOLUME_UPDATE:
+    case MSG_NOTIFY_NODE_LEAVING_JOB:
+    case MSG_NOTIFY_JOB_ABORTING:
+    case MSG_NOTIFY_CLIENT_JOB_ABORTING:
+    case MSG_NOTIFY_JOB_TERMINATING:
+    case MSG_NOTIFY_RESULT_FOUND:
+    case MSG_NOTIFY_RESULT_OBSOLETE:
+    case MSG_INCREMENTAL_JOB_FINISHED:
+    case MSG_INTERRUPT:
+    case MSG_DO_EXIT:
+    case MSG_COLLECTIVE_OPERATION:
+    case MSG_REDUCE_DATA:
+    case MSG_BROADCAST_DATA:
+    case MSG_NOTIFY_NEIGHBOR_STATUS:
+    case MSG_NOTIFY_NEIGHBOR_IDLE_DISTANCE:
+    case MSG_REQUEST_WORK:
+    case MSG_REQUEST_IDLE_NODE_BFS:
+    case MSG_ANSWER_IDLE_NODE_BFS:
+    case MSG_NOTIFY_ASSIGNMENT_UPDATE:
+    case MSG_SCHED_INITIALIZE_CHILD_WITH_NODES:
+    case MSG_SCHED_RETURN_NODES:
+    case MSG_SCHED_RELEASE_FROM_WAITING:
+    case MSG_SCHED_NODE_FREED:
+        return SEND_CONTROL;
+    case MSG_SEND_JOB_DESCRIPTION:
+    case MSG_SEND_ENCODED_JOB_DESCRIPTION:
+    case MSG_SEND_JOB_DESCRIPTION_CHUNK:
+    case MSG_SEND_JOB_REVISION_RANGE:
+    case MSG_SEND_JOB_RESULT:
+        return SEND_BULK;
+    default:
+        return SEND_DEFAULT;
     }
+}
 
+void MessageQueue::initiateSend(SendHandle&& handle) {
+    _send_queue.push_back(std::move(handle));
     SendHandle& h = _send_queue.back();
-    if (_num_concurrent_sends < _max_concurrent_sends) {
-        h.sendNext();
-        _num_concurrent_sends++;
-    }
+    _send_queue_delays[h.sendClass].add(MPI_Wtime() - h.enqueueTime);
+    if (h.sendClass != SEND_CONTROL) _num_concurrent_sends++;
+    if (h.sendClass == SEND_BULK) _num_concurrent_bulk_sends++;
+    h.sendNext();
+}
 
-    *_current_send_tag = 0;
-    return h.id;
+void MessageQueue::initiatePendingSends() {
+    // Initiate pending messages by priority class as long as there is a 
+    // "send slot" available to do so. Within a class, the destinations 
+    // take turns, and messages to the same destination are sent in order.
+    for (int cls = SEND_DEFAULT; cls < NUM_SEND_CLASSES; cls++) {
+        auto& pending = _pending_sends[cls];
+        while (pending.size > 0 && _num_concurrent_sends < _max_concurrent_sends
+                && (cls != SEND_BULK || _num_concurrent_bulk_sends < _max_concurrent_bulk_sends)) {
+            int dest = pending.destOrder.front();
+            pending.destOrder.pop_front();
+            auto it = pending.byDest.find(dest);
+            auto& destQueue = it->second;
+            SendHandle h(std::move(destQueue.front()));
+            destQueue.pop_front();
+            pending.size--;
+            if (destQueue.empty()) pending.byDest.erase(it);
+            else pending.destOrder.push_back(dest);
+            if (!h.isBatched()) {
+                auto itNum = pending.numUnbatchedByDest.find(dest);
+                if (--itNum->second == 0) pending.numUnbatchedByDest.erase(itNum);
+            }
+            initiateSend(std::move(h));
+        }
+    }
 }
 
 void MessageQueue::cancelSend(int sendId) {
 
+    // A coalesced message is removed from its envelope as long as the envelope 
+    // has not been flushed. (A flushed envelope is sent as a whole.)
+    for (auto it = _envelopes.begin(); it != _envelopes.end(); ++it) {
+        auto& envelope = it->second;
+        size_t pos = 0;
+        for (size_t i = 0; i < envelope.sendIds.size(); i++) {
+            int header[2];
+            memcpy(header, envelope.data.data()+pos, sizeof(header));
+            size_t len = sizeof(header) + header[1];
+            if (envelope.sendIds[i].second != sendId) {
+                pos += len;
+                continue;
+            }
+            int tag = envelope.sendIds[i].first;
+            envelope.data.erase(envelope.data.begin()+pos, envelope.data.begin()+pos+len);
+            envelope.sendIds.erase(envelope.sendIds.begin()+i);
+            if (envelope.sendIds.empty()) {
+                BufferPool::recycle(std::move(envelope.data));
+                _envelopes.erase(it);
+            }
+            // Like a cancelled send, the message counts as completed. Its completion
+            // is signaled in processSent() since the caller may be iterating over 
+            // send IDs which the send-done callback modifies.
+            _cancelled_coalesced_sends.emplace_back(tag, sendId);
+            return;
+        }
+    }
+
     for (auto& h : _send_queue) {
         if (h.id != sendId) continue;
 
         // Found fitting handle
         h.cancel();
-        break;
+        return;
+    }
+    for (auto& pending : _pending_sends) for (auto& [dest, destQueue] : pending.byDest) {
+        for (auto& h : destQueue) {
+            if (h.id != sendId) continue;
+            h.cancel();
+            return;
+        }
     }
 }
 
@@ -112,6 +295,8 @@ void MessageQueue::advance() {
     processReceived();
     processSelfReceived();
     processAssembledReceived();
+    processDirectReceived();
+    flushEnvelopes();
     processSent();
     //log(V5_DEBG, "ENDADV\n");
 }
@@ -198,91 +383,425 @@ void MessageQueue::runGarbageCollector() {
 
 void MessageQueue::processReceived() {
 
-    int k = 0;
-    while (k < _num_receives_per_loop) {
-        k++;
-
-        // Test receive
-        //log(V5_DEBG, "MQ TEST\n");
-        int flag = false;
-        MPI_Status status;
-        MPI_Test(&_recv_request, &flag, &status);
-        if (!flag) {
-            // Handle is not finished:
-            // reset #receives per loop
+    int numProcessed = 0;
+    int maxDepth = 0;
+    bool drained = false;
+    while (!drained && numProcessed < _num_receives_per_loop) {
+
+        // Test all posted receives at once
+        int numCompleted = 0;
+        MPI_Testsome(_recv_requests.size(), _recv_requests.data(), &numCompleted, 
+            _completed_indices.data(), _completed_statuses.data());
+        if (numCompleted == MPI_UNDEFINED) numCompleted = 0;
+        double time = MPI_Wtime();
+        for (int i = 0; i < numCompleted; i++) {
+            auto& slot = _recv_slots[_completed_indices[i]];
+            slot.status = _completed_statuses[i];
+            slot.completed = true;
+            slot.completionTime = time;
+        }
+        _num_completed_unprocessed += numCompleted;
+        if (numCompleted > 0) {
+            // Number of received messages waiting to be processed
+            maxDepth = std::max(maxDepth, _num_completed_unprocessed);
+            _max_recv_queue_depth = std::max(_max_recv_queue_depth, _num_completed_unprocessed);
+            _sum_recv_queue_depths += _num_completed_unprocessed;
+            _num_recv_queue_samples++;
+        }
+
+        // Process completed receives in the order of posting: receives are matched 
+        // in this order, so a message must not overtake an earlier message 
+        // (possibly from the same source) which is still being transferred.
+        int numProcessedBefore = numProcessed;
+        while (numProcessed < _num_receives_per_loop && !_recv_order.empty() 
+                && _recv_slots[_recv_order.front()].completed) {
+            int slotIdx = _recv_order.front();
+            _recv_order.pop_front();
+            processReceivedSlot(slotIdx);
+            numProcessed++;
+        }
+        if (numProcessed == numProcessedBefore) {
+            // No message ready: reset #receives per loop
             _num_receives_per_loop = _base_num_receives_per_loop;
-            return;
+            drained = true;
         }
+    }
 
-        // Message finished
-        const int source = status.MPI_SOURCE;
-        int tag = status.MPI_TAG;
-        int msglen;
-        MPI_Get_count(&status, MPI_BYTE, &msglen);
-        LOG(V5_DEBG, "MQ RECV n=%i s=[%i] t=%i c=(%i,...,%i,%i,%i)\n", msglen, source, tag, 
-                msglen>=1*sizeof(int) ? *(int*)(_recv_data) : 0, 
-                msglen>=3*sizeof(int) ? *(int*)(_recv_data+msglen - 3*sizeof(int)) : 0, 
-                msglen>=2*sizeof(int) ? *(int*)(_recv_data+msglen - 2*sizeof(int)) : 0, 
-                msglen>=1*sizeof(int) ? *(int*)(_recv_data+msglen - 1*sizeof(int)) : 0);
-
-        if (tag >= MSG_OFFSET_BATCHED) {
-            // Fragment of a message
-
-            tag -= MSG_OFFSET_BATCHED;
-            int id = ReceiveFragment::readId(_recv_data, msglen);
-            auto key = std::pair<int, int>(source, id);
-            
-            if (!_fragmented_messages.count(key)) {
-                _fragmented_messages.emplace(key, ReceiveFragment(source, id, tag));
-            }
-            auto& fragment = _fragmented_messages[key];
+    // Increase #receives per loop for the next time, if necessary
+    if (!drained && numProcessed == _num_receives_per_loop && _num_receives_per_loop < 1000) {
+        _num_receives_per_loop *= 2;
+    }
 
-            fragment.receiveNext(source, tag, _recv_data, msglen);
+    adaptNumPostedReceives(maxDepth);
+}
 
-            resetReceiveHandle();
+void MessageQueue::adaptNumPostedReceives(int maxDepth) {
+    // Adapt the number of posted receives to the observed queue depth
+    if (maxDepth >= _target_num_posted_receives && _target_num_posted_receives < _max_num_posted_receives) {
+        // All posted receives completed at once: further messages may be queueing up
+        _target_num_posted_receives = std::min(2*_target_num_posted_receives, _max_num_posted_receives);
+        _num_idle_recv_rounds = 0;
+        postReceives();
+    } else if (maxDepth <= _target_num_posted_receives/4 && _target_num_posted_receives > _min_num_posted_receives) {
+        // Posted receives are hardly used: retire some of them as they complete
+        if (++_num_idle_recv_rounds >= 10000) {
+            _target_num_posted_receives = std::max(_target_num_posted_receives/2, _min_num_posted_receives);
+            _num_idle_recv_rounds = 0;
+        }
+    } else _num_idle_recv_rounds = 0;
+}
 
-            if (fragment.isCancelled() || fragment.isFinished()) {
-                {
-                    auto lock = _fragmented_mutex.getLock();
-                    _fragmented_queue.push_back(std::move(fragment));
-                    _fragmented_messages.erase(key);
-                }
-                _fragmented_cond_var.notify();
+void MessageQueue::processReceivedSlot(int slotIdx) {
+
+    auto& slot = _recv_slots[slotIdx];
+    slot.completed = false;
+    _num_completed_unprocessed--;
+
+    // Message finished
+    const int source = slot.status.MPI_SOURCE;
+    int tag = slot.status.MPI_TAG;
+    int msglen;
+    MPI_Get_count(&slot.status, MPI_BYTE, &msglen);
+    const double completionTime = slot.completionTime;
+    const uint8_t* recvData = slot.data.data();
+    LOG(V5_DEBG, "MQ RECV n=%i s=[%i] t=%i c=(%i,...,%i,%i,%i)\n", msglen, source, tag, 
+            msglen>=1*sizeof(int) ? *(int*)(recvData) : 0, 
+            msglen>=3*sizeof(int) ? *(int*)(recvData+msglen - 3*sizeof(int)) : 0, 
+            msglen>=2*sizeof(int) ? *(int*)(recvData+msglen - 2*sizeof(int)) : 0, 
+            msglen>=1*sizeof(int) ? *(int*)(recvData+msglen - 1*sizeof(int)) : 0);
+
+    // Hand the receive buffer over to the message if this is cheaper than copying
+    // the message, i.e., if restoring the buffer's size for the next receive 
+    // touches fewer bytes than the message has.
+    std::vector<uint8_t> msg;
+    if (msglen > _recv_buffer_size/2) {
+        msg = std::move(slot.data);
+        msg.resize(msglen);
+        _num_handed_over_buffers++;
+    } else {
+        msg = BufferPool::get(msglen);
+        memcpy(msg.data(), recvData, msglen);
+    }
+
+    // Re-post the receive unless there are more posted receives than needed
+    if (_recv_order.size() < _target_num_posted_receives) {
+        postReceive(slotIdx);
+    } else {
+        std::vector<uint8_t>().swap(slot.data);
+        _unused_recv_slots.push_back(slotIdx);
+    }
+
+    if (tag >= MSG_OFFSET_ANNOUNCED) {
+        // Announcement of a directly transferred message
+        beginDirectReceive(source, tag - MSG_OFFSET_ANNOUNCED, msg);
+        _recv_latencies[tag].add(MPI_Wtime() - completionTime);
+        return;
+    }
+
+    if (tag >= MSG_OFFSET_BATCHED) {
+        // Fragment of a message
+
+        int batchedTag = tag;
+        tag -= MSG_OFFSET_BATCHED;
+        int id = ReceiveFragment::readId(msg.data(), msglen);
+        auto key = std::pair<int, int>(source, id);
+        
+        if (!_fragmented_messages.count(key)) {
+            _fragmented_messages.emplace(key, ReceiveFragment(source, id, tag));
+        }
+        auto& fragment = _fragmented_messages[key];
+
+        fragment.receiveNext(source, tag, std::move(msg));
+
+        if (fragment.isCancelled() || fragment.isFinished()) {
+            {
+                auto lock = _fragmented_mutex.getLock();
+                _fragmented_queue.push_back(std::move(fragment));
+                _fragmented_messages.erase(key);
             }
+            _fragmented_cond_var.notify();
+        }
+        _recv_latencies[batchedTag].add(MPI_Wtime() - completionTime);
+        return;
+    }
+
+    if (tag == MSG_COALESCED) {
+        unpackEnvelope(source, msg);
+        _recv_latencies[tag].add(MPI_Wtime() - completionTime);
+        return;
+    }
+
+    // Single message
+    //log(V5_DEBG, "MQ singlerecv\n");
+    MessageHandle h;
+    h.setReceive(std::move(msg));
+    h.tag = tag;
+    h.source = source;
+
+    // Process message according to its tag-specific callback
+    *_current_recv_tag = h.tag;
+    _callbacks.at(h.tag)(h);
+    *_current_recv_tag = 0;
+    _recv_latencies[tag].add(MPI_Wtime() - completionTime);
+
+    // Recycle a handed over buffer which the callback left in the message
+    // (other buffers are recycled by the message handle)
+    if (h.getRecvData().capacity() >= _recv_buffer_size && _spare_recv_buffers.size() < _target_num_posted_receives) {
+        _spare_recv_buffers.push_back(h.moveRecvData());
+    }
+}
 
-            // Receive next message
+void MessageQueue::beginDirectReceive(int source, int tag, const std::vector<uint8_t>& announcement) {
+
+    assert(_direct_comm != MPI_COMM_NULL);
+    assert(announcement.size() == sizeof(TransferAnnouncement));
+    TransferAnnouncement ann;
+    memcpy(&ann, announcement.data(), sizeof(TransferAnnouncement));
+    if (ann.totalNumBatches == 0) {
+        LOG(V4_VVER, "MSG id=%i cancelled (0 fragments)\n", ann.id);
+        return;
+    }
+    LOG(V4_VVER, "RECVB %i 0/%i %i direct n=%lu\n", ann.id, ann.totalNumBatches, source, ann.totalSize);
+
+    _direct_receives.emplace_back();
+    auto& recv = _direct_receives.back();
+    recv.source = source;
+    recv.id = ann.id;
+    recv.tag = tag;
+    recv.transferTag = ann.transferTag;
+    // The buffer is overwritten entirely, so it need not be cleared
+    recv.data = BufferPool::getUninitialized(ann.totalSize);
+    recv.requests.resize(ann.totalNumBatches);
+    // Fragments with the same source and tag are matched in the order of posting
+    for (int i = 0; i < ann.totalNumBatches; i++) {
+        size_t begin = i*(size_t)ann.sizePerBatch;
+        size_t end = std::min(ann.totalSize, (size_t)(i+1)*ann.sizePerBatch);
+        MPI_Irecv(recv.data.data()+begin, end-begin, MPI_BYTE, source, 
+            ann.transferTag, _direct_comm, &recv.requests[i]);
+    }
+    if (_completed_fragment_indices.size() < recv.requests.size()) {
+        _completed_fragment_indices.resize(recv.requests.size());
+        _completed_fragment_statuses.resize(recv.requests.size());
+    }
+}
+
+void MessageQueue::processDirectReceived() {
+
+    auto it = _direct_receives.begin();
+    while (it != _direct_receives.end()) {
+        auto& recv = *it;
+        int numCompleted = 0;
+        MPI_Testsome(recv.requests.size(), recv.requests.data(), &numCompleted, 
+            _completed_fragment_indices.data(), _completed_fragment_statuses.data());
+        if (numCompleted == MPI_UNDEFINED) numCompleted = 0;
+        for (int i = 0; i < numCompleted; i++) {
+            int msglen;
+            MPI_Get_count(&_completed_fragment_statuses[i], MPI_BYTE, &msglen);
+            if (msglen == 0) recv.cancelled = true; // empty message: transfer cancelled
+            else recv.receivedFragments++;
+        }
+        if (numCompleted > 0) recv.completionTime = MPI_Wtime();
+
+        if (recv.cancelled) {
+            // No more fragments will arrive: withdraw the remaining receives
+            for (auto& request : recv.requests) if (request != MPI_REQUEST_NULL) MPI_Cancel(&request);
+            MPI_Waitall(recv.requests.size(), recv.requests.data(), MPI_STATUSES_IGNORE);
+            LOG(V4_VVER, "MSG id=%i cancelled (%i fragments)\n", recv.id, recv.receivedFragments);
+            releaseBuffer(std::move(recv.data));
+            it = _direct_receives.erase(it);
+            continue;
+        }
+        if (recv.receivedFragments == recv.requests.size()) {
+            finishDirectReceive(recv);
+            it = _direct_receives.erase(it);
             continue;
         }
+        ++it;
+    }
+}
 
-        // Single message
-        //log(V5_DEBG, "MQ singlerecv\n");
-        MessageHandle h;
-        h.setReceive(std::vector<uint8_t>(_recv_data, _recv_data+msglen));
-        h.tag = tag;
-        h.source = source;
+void MessageQueue::finishDirectReceive(DirectReceive& recv) {
 
-        resetReceiveHandle();
+    LOG(V4_VVER, "RECVB %i %i/%i %i direct\n", recv.id, recv.receivedFragments, 
+        (int) recv.requests.size(), recv.source);
 
-        // Process message according to its tag-specific callback
-        *_current_recv_tag = h.tag;
-        _callbacks.at(h.tag)(h);
-        *_current_recv_tag = 0;
+    MessageHandle h;
+    h.source = recv.source;
+    h.tag = recv.tag;
+    h.setReceive(std::move(recv.data));
+
+    *_current_recv_tag = h.tag;
+    _callbacks.at(h.tag)(h);
+    *_current_recv_tag = 0;
+    _recv_latencies[recv.tag+MSG_OFFSET_BATCHED].add(MPI_Wtime() - recv.completionTime);
+    releaseBuffer(h.moveRecvData());
+}
+
+void MessageQueue::releaseBuffer(std::vector<uint8_t>&& data) {
+    if (BufferPool::accepts(data.capacity())) {
+        BufferPool::recycle(std::move(data));
+    } else if (data.size() > _max_msg_size) {
+        // Concurrent deallocation of large chunk of data
+        auto lock = _garbage_mutex.getLock();
+        _garbage_queue.push_back(std::make_shared<std::vector<uint8_t>>(std::move(data)));
+        atomics::incrementRelaxed(_num_garbage);
     }
+}
 
-    // Increase #receives per loop for the next time, if necessary
-    if (k == _num_receives_per_loop && _num_receives_per_loop < 1000) {
-        _num_receives_per_loop *= 2;
+void MessageQueue::postReceives() {
+    while (_recv_order.size() < _target_num_posted_receives) {
+        int slotIdx;
+        if (!_unused_recv_slots.empty()) {
+            slotIdx = _unused_recv_slots.back();
+            _unused_recv_slots.pop_back();
+        } else {
+            slotIdx = _recv_slots.size();
+            _recv_slots.emplace_back();
+            _recv_requests.push_back(MPI_REQUEST_NULL);
+            _completed_indices.resize(_recv_slots.size());
+            _completed_statuses.resize(_recv_slots.size());
+        }
+        postReceive(slotIdx);
+    }
+}
+
+void MessageQueue::postReceive(int slotIdx) {
+    auto& slot = _recv_slots[slotIdx];
+    if (slot.data.size() != _recv_buffer_size) {
+        if (!_spare_recv_buffers.empty()) {
+            slot.data = std::move(_spare_recv_buffers.back());
+            _spare_recv_buffers.pop_back();
+        }
+        slot.data.resize(_recv_buffer_size);
+    }
+    MPI_Irecv(slot.data.data(), _recv_buffer_size, MPI_BYTE, MPI_ANY_SOURCE, 
+        MPI_ANY_TAG, MPI_COMM_WORLD, &_recv_requests[slotIdx]);
+    _recv_order.push_back(slotIdx);
+}
+
+void MessageQueue::logStatistics() {
+    LOG(V4_VVER, "MQ recv posted=%i/%i depth_avg=%.3f depth_max=%i handovers=%lu\n", 
+        (int) _recv_order.size(), _max_num_posted_receives, 
+        _num_recv_queue_samples == 0 ? 0.0 : _sum_recv_queue_depths / (double) _num_recv_queue_samples, 
+        _max_recv_queue_depth, _num_handed_over_buffers);
+    for (auto& [tag, hist] : _recv_latencies) {
+        LOG(V4_VVER, "MQ recv t=%i n=%lu lat_avg=%.6f lat_max=%.6f hist_log2us=[%s]\n", tag, hist.num, 
+            hist.sum / hist.num, hist.max, hist.bucketsToStr().c_str());
+    }
+    const char* classNames[NUM_SEND_CLASSES] = {"control", "default", "bulk"};
+    for (int cls = 0; cls < NUM_SEND_CLASSES; cls++) {
+        auto& hist = _send_queue_delays[cls];
+        if (hist.num == 0 && _pending_sends[cls].size == 0) continue;
+        LOG(V4_VVER, "MQ send c=%s n=%lu pending=%lu qdelay_avg=%.6f qdelay_max=%.6f hist_log2us=[%s]\n", 
+            classNames[cls], hist.num, _pending_sends[cls].size, hist.num == 0 ? 0.0 : hist.sum / hist.num, 
+            hist.max, hist.bucketsToStr().c_str());
+        hist = LatencyHistogram();
+    }
+    auto pool = BufferPool::getAndResetStats();
+    if (pool.hits + pool.misses > 0) {
+        LOG(V4_VVER, "MQ pool hits=%lu misses=%lu hitrate=%.4f recycled=%lu discarded=%lu cached=%lu\n", 
+            pool.hits, pool.misses, pool.hits / (double) (pool.hits + pool.misses), 
+            pool.recycled, pool.discarded, pool.cachedBytes);
+    }
+    if (_num_coalesced_msgs > 0) {
+        LOG(V4_VVER, "MQ send coalesced=%lu envelopes=%lu\n", _num_coalesced_msgs, _num_envelopes);
+    }
+    // Reset statistics
+    _num_coalesced_msgs = 0;
+    _num_envelopes = 0;
+    _recv_latencies.clear();
+    _max_recv_queue_depth = 0;
+    _sum_recv_queue_depths = 0;
+    _num_recv_queue_samples = 0;
+    _num_handed_over_buffers = 0;
+}
+
+void MessageQueue::coalesce(const uint8_t* data, size_t size, int dest, int tag, int id) {
+
+    auto& envelope = _envelopes[dest];
+    if (envelope.sendIds.empty()) {
+        envelope.data = BufferPool::get(0);
+        envelope.firstTime = MPI_Wtime();
+    }
+    int header[2] = {tag, (int) size};
+    size_t pos = envelope.data.size();
+    envelope.data.resize(pos + sizeof(header) + size);
+    memcpy(envelope.data.data()+pos, header, sizeof(header));
+    memcpy(envelope.data.data()+pos+sizeof(header), data, size);
+    envelope.sendIds.emplace_back(tag, id);
+    envelope.sendClass = std::min(envelope.sendClass, (int) getSendClass(tag, false));
+    _num_coalesced_msgs++;
+
+    // Envelopes are never fragmented
+    if (envelope.data.size() + sizeof(header) + _coalescing_threshold > _max_msg_size) 
+        flushEnvelope(dest);
+}
+
+void MessageQueue::flushEnvelopes() {
+    if (_envelopes.empty()) return;
+    double time = _coalescing_delay > 0 ? MPI_Wtime() : 0;
+    for (auto& [dest, envelope] : _envelopes) {
+        if (_coalescing_delay == 0 || time - envelope.firstTime >= _coalescing_delay)
+            _envelope_dests_to_flush.push_back(dest);
+    }
+    for (int dest : _envelope_dests_to_flush) flushEnvelope(dest);
+    _envelope_dests_to_flush.clear();
+}
+
+void MessageQueue::flushEnvelope(int dest) {
+
+    auto it = _envelopes.find(dest);
+    if (it == _envelopes.end()) return;
+    Envelope envelope = std::move(it->second);
+    _envelopes.erase(it);
+
+    if (envelope.sendIds.size() == 1) {
+        // Single message: send it as is
+        auto [tag, id] = envelope.sendIds.front();
+        constexpr size_t headerSize = 2*sizeof(int);
+        auto data = BufferPool::get(envelope.data.size() - headerSize);
+        memcpy(data.data(), envelope.data.data()+headerSize, data.size());
+        BufferPool::recycle(std::move(envelope.data));
+        enqueueSend(std::make_shared<std::vector<uint8_t>>(std::move(data)), dest, tag, id, envelope.sendClass);
+        return;
     }
+
+    int id = _running_send_id++;
+    _enveloped_send_ids[id] = std::move(envelope.sendIds);
+    enqueueSend(std::make_shared<std::vector<uint8_t>>(std::move(envelope.data)), dest, MSG_COALESCED, 
+        id, envelope.sendClass);
+    _num_envelopes++;
 }
 
-void MessageQueue::resetReceiveHandle() {
-    // Reset recv handle
-    //log(V5_DEBG, "MQ MPI_Irecv\n");
-    MPI_Irecv(_recv_data, _max_msg_size+20, MPI_BYTE, MPI_ANY_SOURCE, 
-        MPI_ANY_TAG, MPI_COMM_WORLD, &_recv_request);
+void MessageQueue::unpackEnvelope(int source, const std::vector<uint8_t>& envelope) {
+    size_t pos = 0;
+    while (pos < envelope.size()) {
+        int header[2];
+        memcpy(header, envelope.data()+pos, sizeof(header));
+        pos += sizeof(header);
+        MessageHandle h;
+        h.tag = header[0];
+        h.source = source;
+        auto data = BufferPool::get(header[1]);
+        memcpy(data.data(), envelope.data()+pos, header[1]);
+        h.setReceive(std::move(data));
+        pos += header[1];
+        *_current_recv_tag = h.tag;
+        _callbacks.at(h.tag)(h);
+        *_current_recv_tag = 0;
+    }
 }
 
 void MessageQueue::signalCompletion(int tag, int id) {
+    if (tag == MSG_COALESCED) {
+        // Signal completion of each message in the envelope
+        auto it = _enveloped_send_ids.find(id);
+        if (it == _enveloped_send_ids.end()) return;
+        auto sendIds = std::move(it->second);
+        _enveloped_send_ids.erase(it);
+        for (auto [msgTag, msgId] : sendIds) signalCompletion(msgTag, msgId);
+        return;
+    }
     auto it = _send_done_callbacks.find(tag);
     if (it != _send_done_callbacks.end()) {
         auto& callback = it->second;
@@ -326,18 +845,7 @@ void MessageQueue::processAssembledReceived() {
             _callbacks.at(h.tag)(h);
             *_current_recv_tag = 0;
             
-            if (h.getRecvData().size() > _max_msg_size) {
-                // Concurrent deallocation of large chunk of data
-                auto lock = _garbage_mutex.getLock();
-                _garbage_queue.push_back(
-                    DataPtr(
-                        new std::vector<uint8_t>(
-                            h.moveRecvData()
-                        )
-                    )
-                );
-                atomics::incrementRelaxed(_num_garbage);
-            }
+            releaseBuffer(h.moveRecvData());
             _fused_queue.pop_front();
             atomics::decrementRelaxed(_num_fused);
 
@@ -351,21 +859,20 @@ void MessageQueue::processAssembledReceived() {
 
 void MessageQueue::processSent() {
 
+    // Signal completion of coalesced messages cancelled before being sent
+    if (!_cancelled_coalesced_sends.empty()) {
+        auto cancelled = std::move(_cancelled_coalesced_sends);
+        _cancelled_coalesced_sends.clear();
+        for (auto [tag, id] : cancelled) signalCompletion(tag, id);
+    }
+
     auto it = _send_queue.begin();
-    bool uninitiatedHandlesPresent = false;
 
     // Test each send handle
     while (it != _send_queue.end()) {
         
         SendHandle& h = *it;
 
-        if (!h.isInitiated()) {
-            // Message has not been sent yet
-            uninitiatedHandlesPresent = true;
-            ++it; // go to next handle
-            continue;
-        }
-
         if (!h.test()) {
             ++it; // go to next handle
             continue;
@@ -376,7 +883,15 @@ void MessageQueue::processSent() {
         bool completed = true;
 
         // Batched?
-        if (h.isBatched()) {
+        if (h.isDirect()) {
+            LOG(V5_DEBG, "MQ SENT id=%i %i/%i n=%i d=[%i] t=%i direct\n", h.id, h.sentBatches, 
+                h.totalNumBatches, h.data->size(), h.dest, h.tag);
+            // More fragments yet to send?
+            if (!h.isFinished()) {
+                h.sendNext();
+                completed = false;
+            }
+        } else if (h.isBatched()) {
             // Batch of a large message sent
             LOG(V5_DEBG, "MQ SENT id=%i %i/%i n=%i d=[%i] t=%i c=(%i,...,%i,%i,%i)\n", h.id, h.sentBatches, 
                 h.totalNumBatches, h.data->size(), h.dest, h.tag, 
@@ -396,9 +911,14 @@ void MessageQueue::processSent() {
         if (completed) {
             // Notify completion
             signalCompletion(h.tag, h.id);
-            _num_concurrent_sends--;
+            if (h.sendClass != SEND_CONTROL) _num_concurrent_sends--;
+            if (h.sendClass == SEND_BULK) _num_concurrent_bulk_sends--;
 
-            if (h.data->size() > _max_msg_size) {
+            if (h.data.use_count() == 1) {
+                // Sole owner of the data: recycle it
+                releaseBuffer(std::move(*h.data));
+                h.data.reset();
+            } else if (h.data->size() > _max_msg_size) {
                 // Concurrent deallocation of SendHandle's large chunk of data
                 auto lock = _garbage_mutex.getLock();
                 _garbage_queue.push_back(std::move(h.data));
@@ -415,17 +935,5 @@ void MessageQueue::processSent() {
         }
     }
 
-    if (!uninitiatedHandlesPresent) return;
-
-    // Initiate sending messages which have not been initiated yet
-    // as long as there is a "send slot" available to do so
-    it = _send_queue.begin();
-    while (_num_concurrent_sends < _max_concurrent_sends && it != _send_queue.end()) {
-        SendHandle& h = *it;
-        if (!h.isInitiated()) {
-            h.sendNext();
-            _num_concurrent_sends++;
-        }
-        ++it;
-    }
+    initiatePendingSends();
 }
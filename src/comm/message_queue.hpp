@@ -5,6 +5,8 @@
 #include "comm/message_handle.hpp"
 
 #include <list>
+#include <deque>
+#include <string>
 #include <cmath>
 #include "util/assert.hpp"
 #include <unistd.h>
@@ -61,10 +63,13 @@ private:
             return * (int*) (data+msglen - 3*sizeof(int));
         }
 
-        void receiveNext(int source, int tag, uint8_t* data, int msglen) {
+        // Takes ownership of the received message, including its meta data.
+        void receiveNext(int source, int tag, std::vector<uint8_t>&& msg) {
             assert(this->source >= 0);
             assert(valid());
 
+            uint8_t* data = msg.data();
+            int msglen = msg.size();
             int id, sentBatch, totalNumBatches;
             // Read meta data from end of message
             memcpy(&id,              data+msglen - 3*sizeof(int), sizeof(int));
@@ -97,7 +102,8 @@ private:
 
             //log(V5_DEBG, "MQ STORE alloc\n");
             assert(dataFragments[sentBatch] == nullptr || LOG_RETURN_FALSE("Batch %i/%i already present!\n", sentBatch, totalNumBatches));
-            dataFragments[sentBatch].reset(new std::vector<uint8_t>(data, data+msglen));
+            msg.resize(msglen); // cut off meta data
+            dataFragments[sentBatch].reset(new std::vector<uint8_t>(std::move(msg)));
             
             //log(V5_DEBG, "MQ STORE produce\n");
             // All fragments of the message received?
@@ -112,6 +118,27 @@ private:
         }
     };
 
+    struct TransferAnnouncement {
+        int id;
+        int transferTag;
+        int totalNumBatches;
+        int sizePerBatch;
+        size_t totalSize;
+    };
+
+    // Large message whose fragments are received directly into the final buffer
+    struct DirectReceive {
+        int source;
+        int id;
+        int tag;
+        int transferTag;
+        std::vector<uint8_t> data;
+        std::vector<MPI_Request> requests; // one per fragment
+        int receivedFragments = 0;
+        bool cancelled = false;
+        double completionTime = 0;
+    };
+
     struct SendHandle {
 
         int id = -1;
@@ -123,9 +150,16 @@ private:
         int totalNumBatches;
         int sizePerBatch;
         std::vector<uint8_t> tempStorage;
+        // Direct transfer of fragments: after an announcement, each fragment is sent 
+        // right out of the data on a dedicated communicator with a per-transfer tag.
+        MPI_Comm directComm = MPI_COMM_NULL;
+        int transferTag = -1;
+        bool announced = false;
+        int sendClass = 0;
+        double enqueueTime = 0;
         
-        SendHandle(int id, int dest, int tag, DataPtr data, int maxMsgSize) 
-            : id(id), dest(dest), tag(tag), data(data) {
+        SendHandle(int id, int dest, int tag, DataPtr data, int maxMsgSize, MPI_Comm directComm = MPI_COMM_NULL) 
+            : id(id), dest(dest), tag(tag), data(data), directComm(directComm) {
 
             sizePerBatch = maxMsgSize;
             sentBatches = 0;
@@ -146,6 +180,11 @@ private:
             totalNumBatches = moved.totalNumBatches;
             sizePerBatch = moved.sizePerBatch;
             tempStorage = std::move(moved.tempStorage);
+            directComm = moved.directComm;
+            transferTag = moved.transferTag;
+            announced = moved.announced;
+            sendClass = moved.sendClass;
+            enqueueTime = moved.enqueueTime;
             
             moved.id = -1;
             moved.data = DataPtr();
@@ -162,6 +201,11 @@ private:
             totalNumBatches = moved.totalNumBatches;
             sizePerBatch = moved.sizePerBatch;
             tempStorage = std::move(moved.tempStorage);
+            directComm = moved.directComm;
+            transferTag = moved.transferTag;
+            announced = moved.announced;
+            sendClass = moved.sendClass;
+            enqueueTime = moved.enqueueTime;
             
             moved.id = -1;
             moved.data = DataPtr();
@@ -195,6 +239,11 @@ private:
                 return;
             }
 
+            if (isDirect()) {
+                sendNextDirect();
+                return;
+            }
+
             if (isCancelled()) {
                 int zero = 0;
                 if (tempStorage.size() < 3*sizeof(int)) tempStorage.resize(3*sizeof(int));
@@ -232,11 +281,49 @@ private:
             //log(V5_DEBG, "MQ SEND BATCHED id=%i %i/%i\n", id, sentBatches, totalNumBatches);
         }
 
+        void sendNextDirect() {
+
+            if (!announced) {
+                // Announce the transfer: the receiver allocates the final buffer and 
+                // posts a receive for each fragment right into it. A message cancelled
+                // before its announcement is announced with zero fragments.
+                TransferAnnouncement ann {id, transferTag, isCancelled() ? 0 : totalNumBatches, 
+                    isCancelled() ? 0 : sizePerBatch, data->size()};
+                tempStorage.resize(sizeof(TransferAnnouncement));
+                memcpy(tempStorage.data(), &ann, sizeof(TransferAnnouncement));
+                MPI_Isend(tempStorage.data(), tempStorage.size(), MPI_BYTE, dest, 
+                    tag+MSG_OFFSET_ANNOUNCED, MPI_COMM_WORLD, &request);
+                announced = true;
+                if (isCancelled()) sentBatches = totalNumBatches; // mark as finished
+                return;
+            }
+
+            if (isCancelled()) {
+                // An empty message matches the receiver's next pending fragment receive
+                MPI_Isend(nullptr, 0, MPI_BYTE, dest, transferTag, directComm, &request);
+                sentBatches = totalNumBatches; // mark as finished
+                return;
+            }
+
+            size_t begin = sentBatches*(size_t)sizePerBatch;
+            size_t end = std::min(data->size(), (size_t)(sentBatches+1)*sizePerBatch);
+            assert(end>begin || LOG_RETURN_FALSE("%ld <= %ld\n", end, begin));
+            MPI_Isend(data->data()+begin, end-begin, MPI_BYTE, dest, transferTag, directComm, &request);
+
+            sentBatches++;
+            if (sentBatches == 1 || sentBatches == totalNumBatches) {
+                LOG(V4_VVER, "SENDB %i %i/%i %i direct\n", id, sentBatches, totalNumBatches, dest);
+            } else {
+                LOG(V5_DEBG, "SENDB %i %i/%i %i direct\n", id, sentBatches, totalNumBatches, dest);
+            }
+        }
+
         void cancel() {
             sizePerBatch = -1;
         }
 
         bool isBatched() const {return totalNumBatches > 1;}
+        bool isDirect() const {return isBatched() && directComm != MPI_COMM_NULL;}
         bool isCancelled() const {return sizePerBatch == -1;}
         size_t getTotalNumBatches() const {assert(isBatched()); return totalNumBatches;}
     };
@@ -245,9 +332,57 @@ private:
     int _my_rank;
     unsigned long long _iteration = 0;
 
-    // Basic receive stuff
-    MPI_Request _recv_request;
-    uint8_t* _recv_data;
+    // Histogram of latencies with logarithmic buckets: [0,1)µs, [1,2)µs, [2,4)µs, ...
+    struct LatencyHistogram {
+        static constexpr int NUM_BUCKETS = 20;
+        unsigned long counts[NUM_BUCKETS] = {0};
+        unsigned long num = 0;
+        double sum = 0;
+        double max = 0;
+        void add(double seconds) {
+            int bucket = 0;
+            for (double limit = 1e-6; bucket+1 < NUM_BUCKETS && seconds >= limit; limit *= 2) bucket++;
+            counts[bucket]++;
+            num++;
+            sum += seconds;
+            max = std::max(max, seconds);
+        }
+        std::string bucketsToStr() const {
+            int lastBucket = NUM_BUCKETS-1;
+            while (lastBucket > 0 && counts[lastBucket] == 0) lastBucket--;
+            std::string out;
+            for (int b = 0; b <= lastBucket; b++) out += (b == 0 ? "" : " ") + std::to_string(counts[b]);
+            return out;
+        }
+    };
+
+    // Pre-posted receives, tested all at once via MPI_Testsome
+    struct ReceiveSlot {
+        std::vector<uint8_t> data;
+        MPI_Status status;
+        bool completed = false;
+        double completionTime = 0;
+    };
+    size_t _recv_buffer_size;
+    std::vector<ReceiveSlot> _recv_slots;
+    std::vector<MPI_Request> _recv_requests; // one per slot, MPI_REQUEST_NULL if unused
+    std::deque<int> _recv_order; // indices of posted slots in the order of posting
+    std::vector<int> _unused_recv_slots;
+    std::vector<std::vector<uint8_t>> _spare_recv_buffers; // recycled from handed over messages
+    std::vector<int> _completed_indices;
+    std::vector<MPI_Status> _completed_statuses;
+    int _min_num_posted_receives;
+    int _max_num_posted_receives;
+    int _target_num_posted_receives;
+    int _num_idle_recv_rounds = 0;
+    // Statistics since the last report
+    int _num_completed_unprocessed = 0;
+    int _max_recv_queue_depth = 0;
+    unsigned long _sum_recv_queue_depths = 0;
+    unsigned long _num_recv_queue_samples = 0;
+    unsigned long _num_handed_over_buffers = 0;
+    robin_hood::unordered_map<int, LatencyHistogram> _recv_latencies;
+
     std::list<SendHandle> _self_recv_queue;
     int _base_num_receives_per_loop = 10;
     int _num_receives_per_loop = _base_num_receives_per_loop;
@@ -261,11 +396,53 @@ private:
     Mutex _fused_mutex;
     std::list<MessageHandle> _fused_queue;
 
+    // Direct transfers of fragments (MPI_COMM_NULL if disabled)
+    MPI_Comm _direct_comm = MPI_COMM_NULL;
+    int _max_transfer_tag;
+    int _running_transfer_tag = 0;
+    std::list<DirectReceive> _direct_receives;
+    std::vector<int> _completed_fragment_indices;
+    std::vector<MPI_Status> _completed_fragment_statuses;
+
     // Send stuff
-    std::list<SendHandle> _send_queue;
+    // Priority classes of outgoing messages, chosen by tag (and size). Control messages 
+    // are initiated right away; other messages wait for a free "send slot", and pending 
+    // default messages are initiated before pending bulk messages.
+    // Unfragmented messages to the same destination are initiated (and hence received) 
+    // in the order of their send() calls across all classes: a message only bypasses 
+    // pending messages to other destinations. As before, a fragmented message may be 
+    // completed after unfragmented messages which were sent after it.
+    enum SendClass {SEND_CONTROL, SEND_DEFAULT, SEND_BULK, NUM_SEND_CLASSES};
+    struct PendingSends {
+        robin_hood::unordered_map<int, std::list<SendHandle>> byDest;
+        std::deque<int> destOrder; // destinations with pending sends in round-robin order
+        robin_hood::unordered_map<int, int> numUnbatchedByDest; // pending unfragmented messages
+        size_t size = 0;
+    };
+    std::list<SendHandle> _send_queue; // initiated sends
+    PendingSends _pending_sends[NUM_SEND_CLASSES];
     int _running_send_id = 1;
-    int _num_concurrent_sends = 0;
+    int _num_concurrent_sends = 0; // excluding control messages
     int _max_concurrent_sends = 16;
+    int _num_concurrent_bulk_sends = 0;
+    int _max_concurrent_bulk_sends = 8;
+    LatencyHistogram _send_queue_delays[NUM_SEND_CLASSES]; // from send() to initiation
+
+    // Coalescing of small messages to the same destination
+    struct Envelope {
+        std::vector<uint8_t> data; // sequence of (tag, size, payload)
+        std::vector<std::pair<int, int>> sendIds; // (tag, id) of each contained message
+        double firstTime = 0;
+        int sendClass = NUM_SEND_CLASSES;
+    };
+    size_t _coalescing_threshold = 0;
+    double _coalescing_delay = 0;
+    robin_hood::unordered_map<int, Envelope> _envelopes; // by destination
+    robin_hood::unordered_map<int, std::vector<std::pair<int, int>>> _enveloped_send_ids; // by envelope's id
+    std::vector<int> _envelope_dests_to_flush;
+    std::vector<std::pair<int, int>> _cancelled_coalesced_sends; // (tag, id) yet to be signaled as completed
+    unsigned long _num_coalesced_msgs = 0;
+    unsigned long _num_envelopes = 0;
 
     // Garbage collection
     std::atomic_int _num_garbage = 0;
@@ -285,7 +462,7 @@ private:
     BackgroundWorker _gc;
 
 public:
-    MessageQueue(int maxMsgSize);
+    MessageQueue(int maxMsgSize, int maxNumPostedReceives = 16, bool zeroCopyFragments = false);
     ~MessageQueue();
 
     void registerCallback(int tag, const MsgCallback& cb);
@@ -295,10 +472,18 @@ public:
         _current_recv_tag = recvTag;
         _current_send_tag = sendTag;
     }
+    // Messages of up to maxSize bytes are coalesced per destination and sent at the end 
+    // of the advance() call where the oldest of them has waited for delayMicros µs.
+    void setMessageCoalescing(int maxSize, int delayMicros) {
+        _coalescing_threshold = maxSize;
+        _coalescing_delay = 0.000001 * delayMicros;
+    }
 
     int send(DataPtr data, int dest, int tag);
+    int send(std::vector<uint8_t>&& data, int dest, int tag);
     void cancelSend(int sendId);
     void advance();
+    void logStatistics();
 
 private:
     void runFragmentedMessageAssembler();
@@ -307,10 +492,30 @@ private:
     void processReceived();
     void processSelfReceived();
     void processAssembledReceived();
+    void processDirectReceived();
     void processSent();
 
-    void resetReceiveHandle();
+    static SendClass getSendClass(int tag, bool batched);
+    int enqueueSend(DataPtr data, int dest, int tag, int id, int sendClass = -1);
+    void initiateSend(SendHandle&& handle);
+    void initiatePendingSends();
+
+    void postReceive(int slotIdx);
+    void postReceives();
+    void processReceivedSlot(int slotIdx);
+    void beginDirectReceive(int source, int tag, const std::vector<uint8_t>& announcement);
+    void finishDirectReceive(DirectReceive& recv);
+    void adaptNumPostedReceives(int maxDepth);
     void signalCompletion(int tag, int id);
+    void releaseBuffer(std::vector<uint8_t>&& data);
+
+    bool isCoalesced(size_t size, int dest) const {
+        return _coalescing_threshold > 0 && dest != _my_rank && size <= _coalescing_threshold;
+    }
+    void coalesce(const uint8_t* data, size_t size, int dest, int tag, int id);
+    void flushEnvelopes();
+    void flushEnvelope(int dest);
+    void unpackEnvelope(int source, const std::vector<uint8_t>& envelope);
 };
 
 #endif
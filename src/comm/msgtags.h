@@ -143,6 +143,32 @@ const int MSG_NOTIFY_ASSIGNMENT_UPDATE = 40;
 
 const int MSG_NOTIFY_CLIENT_JOB_ABORTING = 41;
 const int MSG_OFFER_ADOPTION_OF_ROOT = 42;
+/*
+The sender transfers a job description revision to the receiver
+in a compact wire encoding.
+Data type: DescriptionCodec::Header, metadata, encoded payload
+Warning: Length may exceed the default maximum message length.
+*/
+const int MSG_SEND_ENCODED_JOB_DESCRIPTION = 43;
+/*
+The sender transfers the next chunk of a (raw or encoded) job description
+message to the receiver, which may relay it to its own children right away.
+Data type: DescriptionStreamer::ChunkHeader, chunk of the message
+*/
+const int MSG_SEND_JOB_DESCRIPTION_CHUNK = 44;
+/*
+The sender requests all revisions of a job description within a range
+(the receiver transfers as many of them as it has, but at least the first).
+Data type: IntVec {jobId, firstRevision, lastRevision}
+*/
+const int MSG_QUERY_JOB_REVISION_RANGE = 45;
+/*
+The sender transfers a contiguous range of revisions of a job description
+to the receiver in a single message with one shared header.
+Data type: see JobDescription::serializeRevisionRange
+Warning: Length may exceed the default maximum message length.
+*/
+const int MSG_SEND_JOB_REVISION_RANGE = 46;
 
 const int MSG_SCHED_INITIALIZE_CHILD_WITH_NODES = 51; // downwards
 const int MSG_SCHED_RETURN_NODES = 52; // upwards
@@ -152,7 +178,12 @@ const int MSG_SCHED_NODE_FREED = 54;
 const int MSG_JOB_TREE_REDUCTION = 61;
 const int MSG_JOB_TREE_BROADCAST = 62;
 
+// Envelope of several small messages to the same destination
+const int MSG_COALESCED = 9999;
+
 const int MSG_OFFSET_BATCHED = 10000;
+// Announcement of a large message whose fragments are transferred directly
+const int MSG_OFFSET_ANNOUNCED = 20000;
 
 // Application message tags
 const int MSG_INITIATE_CLAUSE_SHARING = 416;
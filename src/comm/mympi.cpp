@@ -2,11 +2,13 @@
 #include <chrono>
 #include <unistd.h>
 #include <ctime>
+#include <cstring>
 #include <algorithm>
 #include <iostream>
 #include "util/assert.hpp"
 
 #include "mympi.hpp"
+#include "comm/buffer_pool.hpp"
 
 #include "util/params.hpp"
 #include "util/random.hpp"
@@ -37,17 +39,21 @@ size_t MyMpi::getBinaryTreeBufferLimit(int numWorkers, int baseSize, float disco
 
 void MyMpi::setOptions(const Parameters& params) {
     int verb = MyMpi::rank(MPI_COMM_WORLD) == 0 ? V2_INFO : V4_VVER;
-    _msg_queue = new MessageQueue(params.messageBatchingThreshold());
+    _msg_queue = new MessageQueue(params.messageBatchingThreshold(), params.maxPostedReceives(), 
+        params.zeroCopyFragments());
+    _msg_queue->setMessageCoalescing(params.messageCoalescingThreshold(), params.messageCoalescingDelay());
 }
 
 int MyMpi::isend(int recvRank, int tag, const Serializable& object) {
     return isend(recvRank, tag, object.serialize());
 }
 int MyMpi::isend(int recvRank, int tag, std::vector<uint8_t>&& object) {
-    return isend(recvRank, tag, DataPtr(new std::vector<uint8_t>(std::move(object))));
+    return _msg_queue->send(std::move(object), recvRank, tag);
 }
 int MyMpi::isendCopy(int recvRank, int tag, const std::vector<uint8_t>& object) {
-    return isend(recvRank, tag, std::vector<uint8_t>(std::move(object)));
+    auto copy = BufferPool::get(object.size());
+    memcpy(copy.data(), object.data(), object.size());
+    return isend(recvRank, tag, std::move(copy));
 }
 int MyMpi::isend(int recvRank, int tag, const DataPtr& object) {
     return _msg_queue->send(object, recvRank, tag);
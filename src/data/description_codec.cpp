@@ -0,0 +1,198 @@
+
+#include "description_codec.hpp"
+
+#include <cstring>
+#ifdef MALLOB_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "util/logger.hpp"
+#include "util/varint.hpp"
+
+#define DESCRIPTION_CODEC_ZSTD_LEVEL 1
+#define DESCRIPTION_CODEC_BLOCK_SIZE (1 << 16)
+
+namespace {
+
+    inline uint64_t toUnsigned(int lit) {
+        return lit < 0 ? 2*(uint64_t)(-(int64_t)lit)+1 : 2*(uint64_t)lit;
+    }
+    inline int toLiteral(uint64_t u) {
+        // Negate in 64 bits, since the magnitude of INT_MIN does not fit into an int
+        int64_t magnitude = (int64_t) (u >> 1);
+        return (int) ((u & 1) ? -magnitude : magnitude);
+    }
+
+    // Decodes the varint payload stream piece by piece into the output literals.
+    class PayloadDecoder {
+
+    private:
+        int* _out;
+        const size_t _f_size;
+        const size_t _a_size;
+        size_t _pos = 0;
+
+        uint64_t _value = 0;
+        int _shift = 0;
+        bool _expect_length = true;
+        size_t _remaining_clause_lits = 0;
+        uint64_t _prev = 0;
+
+    public:
+        PayloadDecoder(int* out, size_t fSize, size_t aSize) : _out(out), _f_size(fSize), _a_size(aSize) {}
+
+        bool process(const uint8_t* data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                _value |= (uint64_t) (data[i] & 0x7f) << _shift;
+                if (data[i] & 0x80) {
+                    _shift += 7;
+                    if (_shift >= 64) return false;
+                    continue;
+                }
+                if (!digest(_value)) return false;
+                _value = 0;
+                _shift = 0;
+            }
+            return true;
+        }
+
+        bool done() const {
+            return _pos == _f_size+_a_size && _shift == 0;
+        }
+
+    private:
+        inline bool digest(uint64_t x) {
+            if (_pos >= _f_size) {
+                // Assumptions
+                if (_pos == _f_size+_a_size) return false;
+                _out[_pos++] = (int) Varint::unzigzag(x);
+                return true;
+            }
+            if (_expect_length) {
+                if (x > _f_size - _pos) return false;
+                _remaining_clause_lits = x;
+                _prev = 0;
+                _expect_length = false;
+            } else {
+                _prev += Varint::unzigzag(x);
+                _out[_pos++] = toLiteral(_prev);
+                _remaining_clause_lits--;
+            }
+            if (!_expect_length && _remaining_clause_lits == 0) {
+                // Clause complete: terminate it unless the formula
+                // ended in an unterminated sequence of literals
+                if (_pos < _f_size) _out[_pos++] = 0;
+                _expect_length = true;
+            }
+            return true;
+        }
+    };
+}
+
+bool DescriptionCodec::isSupported(Encoding encoding) {
+#ifndef MALLOB_USE_ZSTD
+    if (encoding == VARINT_ZSTD) return false;
+#endif
+    return true;
+}
+
+std::vector<uint8_t> DescriptionCodec::encode(const uint8_t* serialization, size_t metadataSize,
+        size_t fSize, size_t aSize, Encoding encoding) {
+
+    if (!isSupported(encoding)) encoding = VARINT;
+
+    Header header;
+    header.encoding = encoding;
+    header.rawSize = metadataSize + sizeof(int) * (fSize+aSize);
+    header.metadataSize = metadataSize;
+    header.fSize = fSize;
+    header.aSize = aSize;
+    memcpy(&header.jobId, serialization, sizeof(int));
+
+    std::vector<uint8_t> out(sizeof(Header) + metadataSize);
+    out.reserve(sizeof(Header) + metadataSize + fSize + aSize);
+    memcpy(out.data() + sizeof(Header), serialization, metadataSize);
+
+    // Formula: length-prefixed clauses with delta-coded literals
+    const int* lits = (const int*) (serialization + metadataSize);
+    size_t begin = 0;
+    while (begin < fSize) {
+        size_t end = begin;
+        while (end < fSize && lits[end] != 0) end++;
+        Varint::append(out, end-begin);
+        uint64_t prev = 0;
+        for (size_t i = begin; i < end; i++) {
+            uint64_t u = toUnsigned(lits[i]);
+            Varint::append(out, Varint::zigzag((int64_t) (u - prev)));
+            prev = u;
+        }
+        begin = end+1; // skip terminating zero
+    }
+    // Assumptions
+    for (size_t i = 0; i < aSize; i++) Varint::append(out, Varint::zigzag(lits[fSize+i]));
+
+#ifdef MALLOB_USE_ZSTD
+    if (encoding == VARINT_ZSTD) {
+        size_t varintSize = out.size() - sizeof(Header) - metadataSize;
+        std::vector<uint8_t> compressed(sizeof(Header) + metadataSize + ZSTD_compressBound(varintSize));
+        memcpy(compressed.data() + sizeof(Header), out.data() + sizeof(Header), metadataSize);
+        size_t res = ZSTD_compress(compressed.data() + sizeof(Header) + metadataSize, ZSTD_compressBound(varintSize),
+            out.data() + sizeof(Header) + metadataSize, varintSize, DESCRIPTION_CODEC_ZSTD_LEVEL);
+        if (ZSTD_isError(res)) {
+            LOG(V1_WARN, "[WARN] zstd compression of job description failed: %s\n", ZSTD_getErrorName(res));
+            header.encoding = VARINT;
+        } else {
+            compressed.resize(sizeof(Header) + metadataSize + res);
+            out = std::move(compressed);
+        }
+    }
+#endif
+
+    header.encodedPayloadSize = out.size() - sizeof(Header) - metadataSize;
+    memcpy(out.data(), &header, sizeof(Header));
+    return out;
+}
+
+std::shared_ptr<std::vector<uint8_t>> DescriptionCodec::decode(const std::vector<uint8_t>& message) {
+
+    if (message.size() < sizeof(Header)) return std::shared_ptr<std::vector<uint8_t>>();
+    Header header;
+    memcpy(&header, message.data(), sizeof(Header));
+    if (message.size() != sizeof(Header) + header.metadataSize + header.encodedPayloadSize
+            || header.rawSize != header.metadataSize + sizeof(int) * (header.fSize+header.aSize)
+            || !isSupported((Encoding) header.encoding)) {
+        return std::shared_ptr<std::vector<uint8_t>>();
+    }
+
+    auto result = std::shared_ptr<std::vector<uint8_t>>(new std::vector<uint8_t>(header.rawSize));
+    const uint8_t* in = message.data() + sizeof(Header);
+    memcpy(result->data(), in, header.metadataSize);
+    in += header.metadataSize;
+
+    PayloadDecoder decoder((int*) (result->data() + header.metadataSize), header.fSize, header.aSize);
+    bool success = true;
+    if (header.encoding == VARINT) {
+        success = decoder.process(in, header.encodedPayloadSize);
+    }
+#ifdef MALLOB_USE_ZSTD
+    if (header.encoding == VARINT_ZSTD) {
+        // Decompress block-wise and decode each block right away
+        ZSTD_DStream* strm = ZSTD_createDStream();
+        ZSTD_initDStream(strm);
+        std::vector<uint8_t> block(DESCRIPTION_CODEC_BLOCK_SIZE);
+        ZSTD_inBuffer inBuf {in, header.encodedPayloadSize, 0};
+        size_t ret = 1;
+        while (success && (inBuf.pos < inBuf.size || ret != 0)) {
+            ZSTD_outBuffer outBuf {block.data(), block.size(), 0};
+            ret = ZSTD_decompressStream(strm, &outBuf, &inBuf);
+            if (ZSTD_isError(ret)) success = false;
+            else success = decoder.process(block.data(), outBuf.pos);
+            // No progress possible any more: truncated input
+            if (success && ret != 0 && inBuf.pos == inBuf.size && outBuf.pos < outBuf.size) success = false;
+        }
+        ZSTD_freeDStream(strm);
+    }
+#endif
+    if (!success || !decoder.done()) return std::shared_ptr<std::vector<uint8_t>>();
+    return result;
+}
@@ -0,0 +1,49 @@
+
+#ifndef DOMPASCH_MALLOB_DESCRIPTION_CODEC_HPP
+#define DOMPASCH_MALLOB_DESCRIPTION_CODEC_HPP
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Wire encoding of a job description revision for its transfer among workers.
+The metadata of the serialization is kept as is; the payload is encoded as
+follows: Each clause (a sequence of formula literals terminated by zero) is
+written as its length followed by the delta-coded literals, where each literal
+is mapped to 2*|lit| + (lit < 0) and the difference to the previous literal of
+the clause is written as a zigzag varint. Assumptions are written as zigzag
+varints. With ZSTD, the varint stream is additionally compressed with zstd
+(if compiled with MALLOB_USE_ZSTD). Decoding is lossless, i.e., it results
+in a serialization which is byte-identical to the encoded one.
+*/
+class DescriptionCodec {
+
+public:
+    enum Encoding {RAW = 0, VARINT = 1, VARINT_ZSTD = 2};
+
+    struct Header {
+        int jobId; // first, like in every job description message
+        int encoding;
+        uint64_t rawSize;
+        uint64_t metadataSize;
+        uint64_t fSize;
+        uint64_t aSize;
+        uint64_t encodedPayloadSize;
+    };
+
+    // Encodes the serialization of a revision (metadata of the given size, then fSize
+    // formula literals and aSize assumption literals).
+    static std::vector<uint8_t> encode(const uint8_t* serialization, size_t metadataSize,
+        size_t fSize, size_t aSize, Encoding encoding);
+
+    // Decodes an encoded message into a full serialization of the revision,
+    // streaming the payload directly into its final place.
+    // Returns nullptr if the message is malformed.
+    static std::shared_ptr<std::vector<uint8_t>> decode(const std::vector<uint8_t>& message);
+
+    static bool isSupported(Encoding encoding);
+};
+
+#endif
@@ -0,0 +1,133 @@
+
+#include "host_description_store.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include "util/logger.hpp"
+
+#define HOST_DESCRIPTION_STORE_MAGIC "MLBDESC\0"
+
+namespace {
+    // The payload of a segment begins at the second page
+    // such that it can be mapped read-only by itself
+    size_t getPageSize() {
+        static size_t pageSize = sysconf(_SC_PAGESIZE);
+        return pageSize;
+    }
+}
+
+HostDescriptionSegment::~HostDescriptionSegment() {
+    if (_data != nullptr) munmap((void*) _data, _size);
+    if (_counted && _header->numReferences.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Last reference on this host: remove segment
+        shm_unlink(_id.c_str());
+    }
+    munmap((void*) _header, getPageSize());
+}
+
+HostDescriptionStore::HostDescriptionStore(int hostKey) :
+    _prefix("/edu.kit.iti.mallob.hostdesc." + std::to_string(hostKey)) {}
+
+std::string HostDescriptionStore::getSegmentId(int jobId, int revision) const {
+    return _prefix + ".#" + std::to_string(jobId) + ".rev" + std::to_string(revision);
+}
+
+std::shared_ptr<HostDescriptionSegment> HostDescriptionStore::publish(int jobId, int revision,
+        const uint8_t* data, size_t size, const Checksum& checksum) {
+
+    auto id = getSegmentId(jobId, revision);
+    int fd = shm_open(id.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        // Another process on this host (is about to have) published this revision
+        if (errno == EEXIST) return attach(jobId, revision);
+        return std::shared_ptr<HostDescriptionSegment>();
+    }
+
+    // Reserve all space at once: a segment exceeding the capacity of /dev/shm
+    // would otherwise only fail (with SIGBUS) while being written
+    size_t pageSize = getPageSize();
+    int res = size == 0 ? -1 : posix_fallocate(fd, 0, pageSize + size);
+    void* headerAddr = res != 0 ? MAP_FAILED : mmap(NULL, pageSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void* dataAddr = headerAddr == MAP_FAILED ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, pageSize);
+    close(fd);
+    if (dataAddr == MAP_FAILED) {
+        LOG(V1_WARN, "[WARN] Could not create host-wide segment %s of size %lu\n", id.c_str(), size);
+        if (headerAddr != MAP_FAILED) munmap(headerAddr, pageSize);
+        shm_unlink(id.c_str());
+        return std::shared_ptr<HostDescriptionSegment>();
+    }
+
+    memcpy(dataAddr, data, size);
+    mprotect(dataAddr, size, PROT_READ);
+
+    auto header = new (headerAddr) HostDescriptionSegment::Header();
+    memcpy(header->magic, HOST_DESCRIPTION_STORE_MAGIC, sizeof(header->magic));
+    header->numReferences.store(1, std::memory_order_relaxed);
+    header->size = size;
+    header->checksum = checksum;
+    // Make segment visible to other processes
+    header->state.store(1, std::memory_order_release);
+
+    return std::shared_ptr<HostDescriptionSegment>(
+        new HostDescriptionSegment(id, header, (const uint8_t*) dataAddr, size, /*counted=*/true)
+    );
+}
+
+std::shared_ptr<HostDescriptionSegment> HostDescriptionStore::attach(int jobId, int revision) {
+    return open(getSegmentId(jobId, revision), /*counted=*/true);
+}
+
+std::shared_ptr<HostDescriptionSegment> HostDescriptionStore::map(const std::string& segmentId) {
+    return open(segmentId, /*counted=*/false);
+}
+
+std::shared_ptr<HostDescriptionSegment> HostDescriptionStore::open(const std::string& segmentId, bool counted) {
+
+    // Counted mappings need to write the header's reference counter
+    int fd = shm_open(segmentId.c_str(), counted ? O_RDWR : O_RDONLY, 0);
+    if (fd == -1) return std::shared_ptr<HostDescriptionSegment>();
+    size_t pageSize = getPageSize();
+    struct stat s;
+    if (fstat(fd, &s) != 0 || s.st_size < (off_t) pageSize) {
+        close(fd);
+        return std::shared_ptr<HostDescriptionSegment>();
+    }
+    void* headerAddr = mmap(NULL, pageSize, counted ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (headerAddr == MAP_FAILED) {
+        close(fd);
+        return std::shared_ptr<HostDescriptionSegment>();
+    }
+    auto header = (HostDescriptionSegment::Header*) headerAddr;
+
+    // Segment must be completely written
+    bool ready = header->state.load(std::memory_order_acquire) == 1
+        && memcmp(header->magic, HOST_DESCRIPTION_STORE_MAGIC, sizeof(header->magic)) == 0
+        && s.st_size == (off_t) (pageSize + header->size);
+    if (ready && counted) {
+        // Only acquire a reference if the segment is not being removed
+        int numRefs = header->numReferences.load(std::memory_order_relaxed);
+        while (numRefs > 0 && !header->numReferences.compare_exchange_weak(numRefs, numRefs+1,
+                std::memory_order_acq_rel, std::memory_order_relaxed)) {}
+        ready = numRefs > 0;
+    }
+    if (!ready) {
+        munmap(headerAddr, pageSize);
+        close(fd);
+        return std::shared_ptr<HostDescriptionSegment>();
+    }
+
+    void* dataAddr = mmap(NULL, header->size, PROT_READ, MAP_SHARED, fd, pageSize);
+    close(fd);
+    // Create the mapping object in any case such that an acquired reference is released
+    auto segment = std::shared_ptr<HostDescriptionSegment>(new HostDescriptionSegment(
+        segmentId, header, dataAddr == MAP_FAILED ? nullptr : (const uint8_t*) dataAddr, header->size, counted
+    ));
+    if (dataAddr == MAP_FAILED) return std::shared_ptr<HostDescriptionSegment>();
+    return segment;
+}
@@ -0,0 +1,84 @@
+
+#ifndef DOMPASCH_MALLOB_HOST_DESCRIPTION_STORE_HPP
+#define DOMPASCH_MALLOB_HOST_DESCRIPTION_STORE_HPP
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "data/checksum.hpp"
+
+/*
+Read-only mapping of one job description revision (its full serialization)
+which resides in POSIX shared memory. Counted mappings hold a reference to
+the segment; the segment is unlinked as soon as the last counted mapping
+on the host is destroyed.
+*/
+class HostDescriptionSegment {
+
+public:
+    struct Header {
+        char magic[8];
+        std::atomic_int state; // 0: being written, 1: ready
+        std::atomic_int numReferences;
+        uint64_t size;
+        Checksum checksum;
+    };
+
+private:
+    std::string _id;
+    Header* _header = nullptr;
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    bool _counted = false;
+
+public:
+    HostDescriptionSegment(const std::string& id, Header* header, const uint8_t* data, size_t size, bool counted) :
+        _id(id), _header(header), _data(data), _size(size), _counted(counted) {}
+    ~HostDescriptionSegment();
+
+    const std::string& getId() const {return _id;}
+    const uint8_t* data() const {return _data;}
+    size_t size() const {return _size;}
+    const Checksum& getChecksum() const {return _header->checksum;}
+};
+
+/*
+Per-host store of job descriptions in POSIX shared memory, keyed by job ID
+and revision. The first worker on a host which receives a revision publishes
+it; co-located workers (and their SAT subprocesses) map it read-only instead
+of receiving their own copy over the network.
+*/
+class HostDescriptionStore {
+
+private:
+    std::string _prefix;
+
+public:
+    // All workers on a host must use the same host key, e.g., the PID of
+    // a designated process on this host.
+    HostDescriptionStore(int hostKey);
+
+    // Writes the provided serialization of the given job revision (together with
+    // the checksum of its payload) to shared memory and returns a counted mapping
+    // of it. If the revision was already published by another process, the
+    // existing segment is attached instead.
+    // Returns nullptr if the segment cannot be created (e.g., out of space).
+    std::shared_ptr<HostDescriptionSegment> publish(int jobId, int revision, const uint8_t* data, size_t size, 
+        const Checksum& checksum);
+    // Returns a counted mapping of the given job revision if it has been fully
+    // published on this host, and nullptr otherwise.
+    std::shared_ptr<HostDescriptionSegment> attach(int jobId, int revision);
+
+    // Returns an uncounted mapping of the segment with the provided ID, or nullptr
+    // if it is not present. The mapping remains valid even if the segment is unlinked.
+    static std::shared_ptr<HostDescriptionSegment> map(const std::string& segmentId);
+
+    std::string getSegmentId(int jobId, int revision) const;
+
+private:
+    static std::shared_ptr<HostDescriptionSegment> open(const std::string& segmentId, bool counted);
+};
+
+#endif
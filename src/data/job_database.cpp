@@ -17,6 +17,7 @@
 #include "util/sys/watchdog.hpp"
 #include "util/sys/proc.hpp"
 #include "util/data_statistics.hpp"
+#include "data/host_description_store.hpp"
 
 JobDatabase::JobDatabase(Parameters& params, MPI_Comm& comm, WorkerSysState& sysstate):
         _params(params), _comm(comm), _sys_state(sysstate) {
@@ -57,27 +58,41 @@ Job& JobDatabase::createJob(int commSize, int worldRank, int jobId, JobDescripti
 }
 
 bool JobDatabase::appendRevision(int jobId, const std::shared_ptr<std::vector<uint8_t>>& description, int source) {
+    int rev = JobDescription::readRevisionIndex(*description);
+    if (!isRevisionAppendable(jobId, rev, description->size())) return false;
+
+    // Push revision description
+    get(jobId).pushRevision(description);
+    return true;
+}
+
+bool JobDatabase::appendRevision(int jobId, const std::shared_ptr<HostDescriptionSegment>& segment, int source) {
+    int rev = JobDescription::readRevisionIndex(segment->data(), segment->size());
+    if (!isRevisionAppendable(jobId, rev, segment->size())) return false;
+
+    // Push revision description
+    get(jobId).pushRevision(segment);
+    return true;
+}
+
+bool JobDatabase::isRevisionAppendable(int jobId, int rev, size_t size) {
 
     if (!has(jobId)) {
-        LOG(V1_WARN, "[WARN] Unknown job #%i : discard desc. of size %i\n", jobId, description->size());
+        LOG(V1_WARN, "[WARN] Unknown job #%i : discard desc. of size %i\n", jobId, size);
         return false;
     }
     auto& job = get(jobId);
-    int rev = JobDescription::readRevisionIndex(*description);
     if (job.hasDescription()) {
         if (rev != job.getMaxConsecutiveRevision()+1) {
             // Revision data would cause a "hole" in the list of job revision data
             LOG(V1_WARN, "[WARN] #%i rev. %i inconsistent w/ max. consecutive rev. %i : discard desc. of size %i\n", 
-                jobId, rev, job.getMaxConsecutiveRevision(), description->size());
+                jobId, rev, job.getMaxConsecutiveRevision(), size);
             return false;
         }
     } else if (rev != 0) {
-        LOG(V1_WARN, "[WARN] #%i invalid \"first\" rev. %i : discard desc. of size %i\n", jobId, rev, description->size());
+        LOG(V1_WARN, "[WARN] #%i invalid \"first\" rev. %i : discard desc. of size %i\n", jobId, rev, size);
             return false;
     }
-
-    // Push revision description
-    job.pushRevision(description);
     return true;
 }
 
@@ -73,6 +73,7 @@ public:
 
     Job& createJob(int commSize, int worldRank, int jobId, JobDescription::Application application);
     bool appendRevision(int jobId, const std::shared_ptr<std::vector<uint8_t>>& description, int source);
+    bool appendRevision(int jobId, const std::shared_ptr<HostDescriptionSegment>& segment, int source);
     void execute(int jobId, int source);
 
     bool checkComputationLimits(int jobId);
@@ -146,6 +147,7 @@ public:
     std::string toStr(int j, int idx) const;
 
 private:
+    bool isRevisionAppendable(int jobId, int revision, size_t size);
     void runJanitor();
     
 };
@@ -2,15 +2,18 @@
 #include "util/assert.hpp"
 
 #include "job_description.hpp"
+#include "data/host_description_store.hpp"
 #include "util/logger.hpp"
 
 
 void JobDescription::beginInitialization(int revision) {
     _revision = revision;
-    while (_revision >= _data_per_revision.size()) _data_per_revision.emplace_back();
+    prepareRevisionSlot(_revision);
+    _shared_data_per_revision[_revision].reset();
     _data_per_revision[_revision].reset(new std::vector<uint8_t>(
         getMetadataSize()
     ));
+    _write_pos = _data_per_revision[_revision]->size();
     _f_size = 0;
     _a_size = 0;
 }
@@ -21,11 +24,16 @@ void JobDescription::reserveSize(size_t size) {
 
 void JobDescription::endInitialization() {
     // Add preloaded literals and assumptions (if any)
-    for (int l : _preloaded_literals) addLiteral(l);
-    for (int a : _preloaded_assumptions) addAssumption(a);
+    addLiterals(_preloaded_literals.data(), _preloaded_literals.size());
+    addAssumptions(_preloaded_assumptions.data(), _preloaded_assumptions.size());
     _preloaded_literals.clear();
     _preloaded_assumptions.clear();
 
+    // Cut off the unwritten excess of the geometrically grown data, so that the 
+    // serialization has its exact size. The vector's capacity is kept (shrinking 
+    // it would copy the entire description).
+    getRevisionData(_revision)->resize(_write_pos);
+
     writeMetadata();
 }
 
@@ -65,29 +73,39 @@ std::shared_ptr<std::vector<uint8_t>>& JobDescription::getRevisionData(int revis
     return _data_per_revision.at(revision);
 }
 
+const uint8_t* JobDescription::getRevisionBytes(int revision) const {
+    assert(revision >= 0 && revision < _shared_data_per_revision.size());
+    const auto& segment = _shared_data_per_revision[revision];
+    if (segment) return segment->data();
+    return getRevisionData(revision)->data();
+}
+
 size_t JobDescription::getFormulaPayloadSize(int revision) const {
     size_t fSize;
-    memcpy(&fSize, getRevisionData(revision)->data()+3*sizeof(int), sizeof(size_t));
+    memcpy(&fSize, getRevisionBytes(revision)+3*sizeof(int), sizeof(size_t));
     return fSize;
 }
 
 size_t JobDescription::getAssumptionsSize(int revision) const {
     size_t aSize;
-    memcpy(&aSize, getRevisionData(revision)->data()+3*sizeof(int)+sizeof(size_t), sizeof(size_t));
+    memcpy(&aSize, getRevisionBytes(revision)+3*sizeof(int)+sizeof(size_t), sizeof(size_t));
     return aSize;
 }
 
 const int* JobDescription::getFormulaPayload(int revision) const {
     size_t pos = getMetadataSize();
-    return (const int*) (getRevisionData(revision)->data()+pos);
+    return (const int*) (getRevisionBytes(revision)+pos);
 }
 
 const int* JobDescription::getAssumptionsPayload(int revision) const {
     size_t pos = getMetadataSize() + sizeof(int)*getFormulaPayloadSize(revision);
-    return (const int*) (getRevisionData(revision)->data()+pos);
+    return (const int*) (getRevisionBytes(revision)+pos);
 }
 
 size_t JobDescription::getTransferSize(int revision) const {
+    assert(revision >= 0 && revision < _shared_data_per_revision.size());
+    const auto& segment = _shared_data_per_revision[revision];
+    if (segment) return segment->size();
     return getRevisionData(revision)->size();
 }
 
@@ -105,16 +123,150 @@ int JobDescription::getMetadataSize() const {
 
 
 int JobDescription::readRevisionIndex(const std::vector<uint8_t>& serialized) {
-    assert(serialized.size() >= 3*sizeof(int)+2*sizeof(size_t));
+    return readRevisionIndex(serialized.data(), serialized.size());
+}
+
+int JobDescription::readRevisionIndex(const uint8_t* serialized, size_t size) {
+    assert(size >= 3*sizeof(int)+2*sizeof(size_t));
     int revision;
-    memcpy(&revision, serialized.data()+sizeof(int), sizeof(int));
+    memcpy(&revision, serialized+sizeof(int), sizeof(int));
     assert(revision >= 0);
     return revision;
 }
 
+Checksum JobDescription::readChecksum(const uint8_t* serialized) {
+    Checksum checksum;
+    size_t pos = 6*sizeof(int) + 3*sizeof(float) + 2*sizeof(size_t) + sizeof(Application);
+    memcpy(&checksum, serialized+pos, sizeof(Checksum));
+    return checksum;
+}
+
+Checksum JobDescription::computeChecksum(const uint8_t* serialized, const Checksum& base) {
+    size_t fSize, aSize;
+    memcpy(&fSize, serialized+3*sizeof(int), sizeof(size_t));
+    memcpy(&aSize, serialized+3*sizeof(int)+sizeof(size_t), sizeof(size_t));
+    size_t pos = 6*sizeof(int) + 3*sizeof(float) + 2*sizeof(size_t) + sizeof(Application) + sizeof(Checksum);
+    int configSize;
+    memcpy(&configSize, serialized+pos, sizeof(int));
+    pos += sizeof(int) + configSize;
+
+    // Same order and signs as when the description was written
+    Checksum checksum = base;
+    const int* lits = (const int*) (serialized+pos);
+    for (size_t i = 0; i < fSize; i++) checksum.combine(lits[i]);
+    for (size_t i = 0; i < aSize; i++) checksum.combine(-lits[fSize+i]);
+    return checksum;
+}
+
+namespace {
+    struct RevisionRangeHeader {
+        int jobId;
+        int firstRevision;
+        int numRevisions;
+        int metadataSize;
+    };
+    struct RevisionRangeEntry {
+        uint64_t fSize;
+        uint64_t aSize;
+        Checksum checksum;
+    };
+    const size_t REVISION_POS = sizeof(int);
+    const size_t F_SIZE_POS = 3*sizeof(int);
+    const size_t A_SIZE_POS = 3*sizeof(int)+sizeof(size_t);
+    const size_t CHECKSUM_POS = 6*sizeof(int) + 3*sizeof(float) + 2*sizeof(size_t) + sizeof(JobDescription::Application);
+}
+
+std::shared_ptr<std::vector<uint8_t>> JobDescription::serializeRevisionRange(int firstRevision, int lastRevision, 
+        bool dropPastAssumptions) const {
+
+    assert(firstRevision >= 0 && firstRevision <= lastRevision);
+    RevisionRangeHeader header {_id, firstRevision, lastRevision-firstRevision+1, getMetadataSize()};
+    std::vector<RevisionRangeEntry> entries;
+    size_t size = sizeof(RevisionRangeHeader) + header.metadataSize;
+    // Checksums are cumulative: once assumptions were dropped, the checksums
+    // of this and all following revisions are recomputed over the sent payload
+    Checksum checksum = firstRevision == 0 ? Checksum() : readChecksum(getRevisionBytes(firstRevision-1));
+    bool recompute = false;
+    for (int rev = firstRevision; rev <= lastRevision; rev++) {
+        RevisionRangeEntry entry {getFormulaPayloadSize(rev), getAssumptionsSize(rev), readChecksum(getRevisionBytes(rev))};
+        if (dropPastAssumptions && rev < lastRevision && entry.aSize > 0) {
+            entry.aSize = 0;
+            recompute = _use_checksums;
+        }
+        if (recompute) {
+            const int* lits = getFormulaPayload(rev);
+            for (size_t i = 0; i < entry.fSize; i++) checksum.combine(lits[i]);
+            for (size_t i = 0; i < entry.aSize; i++) checksum.combine(-lits[entry.fSize+i]);
+            entry.checksum = checksum;
+        } else checksum = entry.checksum;
+        size += sizeof(RevisionRangeEntry) + sizeof(int) * (entry.fSize+entry.aSize);
+        entries.push_back(entry);
+    }
+
+    auto packed = std::shared_ptr<std::vector<uint8_t>>(new std::vector<uint8_t>(size));
+    uint8_t* out = packed->data();
+    memcpy(out, &header, sizeof(RevisionRangeHeader)); out += sizeof(RevisionRangeHeader);
+    memcpy(out, getRevisionBytes(lastRevision), header.metadataSize); out += header.metadataSize;
+    memcpy(out, entries.data(), sizeof(RevisionRangeEntry) * entries.size()); out += sizeof(RevisionRangeEntry) * entries.size();
+    for (int rev = firstRevision; rev <= lastRevision; rev++) {
+        const auto& entry = entries[rev-firstRevision];
+        // Formula literals and assumptions are contiguous in each revision
+        size_t n = sizeof(int) * (entry.fSize+entry.aSize);
+        memcpy(out, getFormulaPayload(rev), n); out += n;
+    }
+    assert(out == packed->data()+packed->size());
+    return packed;
+}
+
+std::vector<std::shared_ptr<std::vector<uint8_t>>> JobDescription::deserializeRevisionRange(const std::vector<uint8_t>& packed) {
+
+    std::vector<std::shared_ptr<std::vector<uint8_t>>> revisions;
+    if (packed.size() < sizeof(RevisionRangeHeader)) return revisions;
+    RevisionRangeHeader header;
+    memcpy(&header, packed.data(), sizeof(RevisionRangeHeader));
+    if (header.numRevisions <= 0 || header.metadataSize < CHECKSUM_POS + sizeof(Checksum)
+            || packed.size() < sizeof(RevisionRangeHeader) + header.metadataSize 
+                + header.numRevisions * sizeof(RevisionRangeEntry)) {
+        return revisions;
+    }
+    const uint8_t* metadata = packed.data() + sizeof(RevisionRangeHeader);
+    std::vector<RevisionRangeEntry> entries(header.numRevisions);
+    memcpy(entries.data(), metadata + header.metadataSize, sizeof(RevisionRangeEntry) * entries.size());
+    size_t pos = sizeof(RevisionRangeHeader) + header.metadataSize + sizeof(RevisionRangeEntry) * entries.size();
+
+    for (int i = 0; i < header.numRevisions; i++) {
+        const auto& entry = entries[i];
+        size_t payloadSize = sizeof(int) * (entry.fSize+entry.aSize);
+        if (pos + payloadSize > packed.size()) {
+            revisions.clear();
+            return revisions;
+        }
+        // Shared header, patched with the revision's own index, sizes, and checksum
+        auto data = std::shared_ptr<std::vector<uint8_t>>(new std::vector<uint8_t>(header.metadataSize + payloadSize));
+        int revision = header.firstRevision + i;
+        size_t fSize = entry.fSize, aSize = entry.aSize;
+        memcpy(data->data(), metadata, header.metadataSize);
+        memcpy(data->data()+REVISION_POS, &revision, sizeof(int));
+        memcpy(data->data()+F_SIZE_POS, &fSize, sizeof(size_t));
+        memcpy(data->data()+A_SIZE_POS, &aSize, sizeof(size_t));
+        memcpy(data->data()+CHECKSUM_POS, &entry.checksum, sizeof(Checksum));
+        memcpy(data->data()+header.metadataSize, packed.data()+pos, payloadSize);
+        pos += payloadSize;
+        revisions.push_back(std::move(data));
+    }
+    if (pos != packed.size()) revisions.clear();
+    return revisions;
+}
+
+void JobDescription::prepareRevisionSlot(int revision) {
+    while (revision >= _data_per_revision.size()) _data_per_revision.emplace_back();
+    while (revision >= _shared_data_per_revision.size()) _shared_data_per_revision.emplace_back();
+}
+
 int JobDescription::prepareRevision(const std::vector<uint8_t>& packed) {
     int revision = JobDescription::readRevisionIndex(packed);
-    while (revision >= _data_per_revision.size()) _data_per_revision.emplace_back();
+    prepareRevisionSlot(revision);
+    _shared_data_per_revision[revision].reset();
     return revision;
 }
 
@@ -139,47 +291,67 @@ JobDescription& JobDescription::deserialize(const std::shared_ptr<std::vector<ui
     return *this;
 }
 
+JobDescription& JobDescription::deserialize(const std::shared_ptr<HostDescriptionSegment>& segment) {
+    int revision = readRevisionIndex(segment->data(), segment->size());
+    prepareRevisionSlot(revision);
+    _data_per_revision[revision].reset();
+    _shared_data_per_revision[revision] = segment;
+    deserialize();
+    return *this;
+}
+
 void JobDescription::deserialize() {
     size_t i = 0, n;
 
     // Basic data
     // TODO gracefully handle "holes" in data: go to max. revision r such that [0, r] is valid range.
-    auto& latestData = _data_per_revision.back();
-    n = sizeof(int);         memcpy(&_id, latestData->data()+i, n);              i += n;
-    n = sizeof(int);         memcpy(&_revision, latestData->data()+i, n);        i += n;
-    n = sizeof(int);         memcpy(&_client_rank, latestData->data()+i, n);     i += n;
-    n = sizeof(size_t);      memcpy(&_f_size, latestData->data()+i, n);          i += n;
-    n = sizeof(size_t);      memcpy(&_a_size, latestData->data()+i, n);          i += n;
-    n = sizeof(int);         memcpy(&_root_rank, latestData->data()+i, n);       i += n;
-    n = sizeof(float);       memcpy(&_priority, latestData->data()+i, n);        i += n;
-    n = sizeof(int);         memcpy(&_num_vars, latestData->data()+i, n);        i += n;
-    n = sizeof(float);       memcpy(&_wallclock_limit, latestData->data()+i, n); i += n;
-    n = sizeof(float);       memcpy(&_cpu_limit, latestData->data()+i, n);       i += n;
-    n = sizeof(int);         memcpy(&_max_demand, latestData->data()+i, n);      i += n;
-    n = sizeof(Application); memcpy(&_application, latestData->data()+i, n);     i += n;
-    n = sizeof(Checksum);    memcpy(&_checksum, latestData->data()+i, n);        i += n;
+    const uint8_t* latestData = getRevisionBytes(_data_per_revision.size()-1);
+    n = sizeof(int);         memcpy(&_id, latestData+i, n);              i += n;
+    n = sizeof(int);         memcpy(&_revision, latestData+i, n);        i += n;
+    n = sizeof(int);         memcpy(&_client_rank, latestData+i, n);     i += n;
+    n = sizeof(size_t);      memcpy(&_f_size, latestData+i, n);          i += n;
+    n = sizeof(size_t);      memcpy(&_a_size, latestData+i, n);          i += n;
+    n = sizeof(int);         memcpy(&_root_rank, latestData+i, n);       i += n;
+    n = sizeof(float);       memcpy(&_priority, latestData+i, n);        i += n;
+    n = sizeof(int);         memcpy(&_num_vars, latestData+i, n);        i += n;
+    n = sizeof(float);       memcpy(&_wallclock_limit, latestData+i, n); i += n;
+    n = sizeof(float);       memcpy(&_cpu_limit, latestData+i, n);       i += n;
+    n = sizeof(int);         memcpy(&_max_demand, latestData+i, n);      i += n;
+    n = sizeof(Application); memcpy(&_application, latestData+i, n);     i += n;
+    n = sizeof(Checksum);    memcpy(&_checksum, latestData+i, n);        i += n;
     // size of config
-    memcpy(&n, latestData->data()+i, sizeof(int)); i += sizeof(int);
+    memcpy(&n, latestData+i, sizeof(int)); i += sizeof(int);
     // bytes of config
-    std::string configSerialized = std::string((const char*) (latestData->data()+i), n);
+    std::string configSerialized = std::string((const char*) (latestData+i), n);
     _app_config.deserialize(configSerialized);
 }
 
 std::vector<uint8_t> JobDescription::serialize() const {
-    return *_data_per_revision[0];
+    const uint8_t* data = getRevisionBytes(0);
+    return std::vector<uint8_t>(data, data+getTransferSize(0));
 }
 
-const std::shared_ptr<std::vector<uint8_t>>& JobDescription::getSerialization(int revision) const {
+std::shared_ptr<std::vector<uint8_t>> JobDescription::getSerialization(int revision) const {
+    const auto& segment = getHostSegment(revision);
+    if (segment) return std::shared_ptr<std::vector<uint8_t>>(
+        new std::vector<uint8_t>(segment->data(), segment->data()+segment->size())
+    );
     return getRevisionData(revision);
 }
 
+std::shared_ptr<HostDescriptionSegment> JobDescription::getHostSegment(int revision) const {
+    assert(revision >= 0 && revision < _shared_data_per_revision.size());
+    return _shared_data_per_revision[revision];
+}
+
 void JobDescription::clearPayload(int revision) {
     getRevisionData(revision).reset();
+    _shared_data_per_revision[revision].reset();
 }
 
 int JobDescription::getMaxConsecutiveRevision() const {
     for (int r = 0; r < _data_per_revision.size(); r++) {
-        if (!_data_per_revision[r]) return r-1;
+        if (!_data_per_revision[r] && !_shared_data_per_revision[r]) return r-1;
     }
     return _data_per_revision.size()-1;
 }
@@ -5,6 +5,7 @@
 #include <vector>
 #include <cstring>
 #include <memory>
+#include <algorithm>
 
 #include "data/serializable.hpp"
 #include "data/checksum.hpp"
@@ -12,6 +13,8 @@
 
 typedef std::shared_ptr<std::vector<int>> VecPtr;
 
+class HostDescriptionSegment; // fwd
+
 /**
  * The actual job structure, containing the full description.
  */
@@ -26,6 +29,8 @@ public:
     struct Statistics {
         float timeOfScheduling;
         float parseTime;
+        float decompressionTime;
+        float tokenizationTime;
         float schedulingTime;
         float processingTime;
         float usedWallclockSeconds;
@@ -63,6 +68,9 @@ private:
     // For each revision, the shared_ptr contains the full serialization
     // of this revision including all meta data of this object.
     std::vector<std::shared_ptr<std::vector<uint8_t>>> _data_per_revision;
+    // Alternatively, a revision's serialization can reside in a host-wide
+    // shared memory segment which is mapped read-only.
+    std::vector<std::shared_ptr<HostDescriptionSegment>> _shared_data_per_revision;
     
     // Stores the position (in bytes) and size (in integers) of each revision's payload.
     struct RevisionInfo {
@@ -73,6 +81,7 @@ private:
     };
 
     // just for parsing
+    size_t _write_pos = 0;
     std::vector<int> _preloaded_literals;
     std::vector<int> _preloaded_assumptions;
 
@@ -80,10 +89,17 @@ private:
     Statistics* _stats = nullptr;
 
 private:
-    template <typename T>
-    inline static void push_obj(std::shared_ptr<std::vector<uint8_t>>& vec, T x) {
-        vec->resize(vec->size()+sizeof(T));
-        memcpy(vec->data()+vec->size()-sizeof(T), &x, sizeof(T));
+    // Returns a pointer to the writing cursor in the current revision's data
+    // and advances the cursor by the given number of bytes. During initialization, 
+    // the data vector is grown geometrically and may be larger than the cursor position.
+    inline uint8_t* prepareWrite(size_t numBytes) {
+        auto& data = _data_per_revision[_revision];
+        if (_write_pos + numBytes > data->size()) {
+            data->resize(std::max(_write_pos + numBytes, std::max(2*data->size(), data->capacity())));
+        }
+        uint8_t* out = data->data() + _write_pos;
+        _write_pos += numBytes;
+        return out;
     }
 
 public:
@@ -96,6 +112,8 @@ public:
         if (_stats != nullptr) delete _stats;
         for (auto& data : _data_per_revision)
             data.reset();
+        for (auto& segment : _shared_data_per_revision)
+            segment.reset();
     }
 
     // Moving job descriptions is okay
@@ -116,11 +134,14 @@ public:
         _f_size = std::move(other._f_size);
         _a_size = std::move(other._a_size);
         _data_per_revision = std::move(other._data_per_revision);
+        _shared_data_per_revision = std::move(other._shared_data_per_revision);
+        _write_pos = other._write_pos;
         _preloaded_literals = std::move(other._preloaded_literals);
         _preloaded_assumptions = std::move(other._preloaded_assumptions);
         _stats = std::move(other._stats);
         other._id = -1;
         other._data_per_revision.clear();
+        other._shared_data_per_revision.clear();
         other._stats = nullptr;
         return *this;
     }
@@ -138,24 +159,50 @@ public:
     void beginInitialization(int revision);
     void reserveSize(size_t size);
     inline void addLiteral(int lit) {
-        // Push literal to raw data, update counter
-        push_obj<int>(_data_per_revision[_revision], lit);
+        // Write literal to raw data at cursor, update counter
+        memcpy(prepareWrite(sizeof(int)), &lit, sizeof(int));
         _f_size++;
         if (_use_checksums) _checksum.combine(lit);
     }
+    inline void addLiterals(const int* lits, size_t numLits) {
+        // Write a batch of literals to raw data at once
+        memcpy(prepareWrite(numLits*sizeof(int)), lits, numLits*sizeof(int));
+        _f_size += numLits;
+        if (_use_checksums) for (size_t i = 0; i < numLits; i++) _checksum.combine(lits[i]);
+    }
+    // Makes room for a number of formula literals followed by a number of assumption
+    // literals at the end of the current revision's payload, e.g., to be filled by
+    // several threads concurrently. Returns a pointer to the beginning of the new space.
+    // Checksums are not updated; call addToChecksum after filling the space.
+    int* appendPayload(size_t numFormulaLits, size_t numAssumptionLits) {
+        uint8_t* out = prepareWrite((numFormulaLits+numAssumptionLits)*sizeof(int));
+        _f_size += numFormulaLits;
+        _a_size += numAssumptionLits;
+        return (int*) out;
+    }
+    void addToChecksum(const int* lits, size_t numFormulaLits, size_t numAssumptionLits) {
+        if (!_use_checksums) return;
+        for (size_t i = 0; i < numFormulaLits; i++) _checksum.combine(lits[i]);
+        for (size_t i = 0; i < numAssumptionLits; i++) _checksum.combine(-lits[numFormulaLits+i]);
+    }
     inline void addFloatData(float data) {
         static_assert(sizeof(float) == sizeof(int));
-        push_obj<float>(_data_per_revision[_revision], data);
+        memcpy(prepareWrite(sizeof(float)), &data, sizeof(float));
         _f_size++;
         if (_use_checksums) _checksum.combine(data);
     }
 
     inline void addAssumption(int lit) {
-        // Push literal to raw data, update counter
-        push_obj<int>(_data_per_revision[_revision], lit);
+        // Write literal to raw data at cursor, update counter
+        memcpy(prepareWrite(sizeof(int)), &lit, sizeof(int));
         _a_size++;
         if (_use_checksums) _checksum.combine(-lit);
     }
+    inline void addAssumptions(const int* lits, size_t numLits) {
+        memcpy(prepareWrite(numLits*sizeof(int)), lits, numLits*sizeof(int));
+        _a_size += numLits;
+        if (_use_checksums) for (size_t i = 0; i < numLits; i++) _checksum.combine(-lits[i]);
+    }
     void endInitialization();
     void writeMetadata();
 
@@ -165,6 +212,7 @@ public:
     JobDescription& deserialize(const std::vector<uint8_t>& packed) override;
     JobDescription& deserialize(std::vector<uint8_t>&& packed);
     JobDescription& deserialize(const std::shared_ptr<std::vector<uint8_t>>& packed);
+    JobDescription& deserialize(const std::shared_ptr<HostDescriptionSegment>& segment);
     void deserialize();
 
     int getId() const {return _id;}
@@ -182,7 +230,7 @@ public:
     bool isIncremental() const {return isApplicationIncremental(_application);}
     int getMetadataSize() const;
     
-    size_t getFullNonincrementalTransferSize() const {return _data_per_revision[0]->size();}
+    size_t getFullNonincrementalTransferSize() const {return getTransferSize(0);}
     int getNumVars() {return _num_vars;}
 
     void setRootRank(int rootRank) {_root_rank = rootRank;}
@@ -199,11 +247,15 @@ public:
     void setPreloadedAssumptions(std::vector<int>&& asmpt) {_preloaded_assumptions = std::move(asmpt);}
     void setAppConfigurationEntry(const std::string& key, const std::string& val) {_app_config.map[key] = val;}
 
+    bool computesChecksums() const {return _use_checksums;}
     Checksum getChecksum() const {return _checksum;}
     void setChecksum(const Checksum& checksum) {_checksum = checksum;}
 
     std::vector<uint8_t> serialize() const override;
-    const std::shared_ptr<std::vector<uint8_t>>& getSerialization(int revision) const;
+    // For a revision residing in host-wide shared memory, a (temporary) copy is returned.
+    std::shared_ptr<std::vector<uint8_t>> getSerialization(int revision) const;
+    // Returns the host-wide shared memory segment of the revision, if present.
+    std::shared_ptr<HostDescriptionSegment> getHostSegment(int revision) const;
     void clearPayload(int revision);
 
     int getMaxConsecutiveRevision() const;
@@ -217,8 +269,26 @@ public:
     const int* getAssumptionsPayload(int revision) const;
     
     size_t getTransferSize(int revision) const;
+    // Raw serialization (metadata and payload) of the given revision
+    const uint8_t* getRevisionBytes(int revision) const;
     
     static int readRevisionIndex(const std::vector<uint8_t>& serialized);
+    static int readRevisionIndex(const uint8_t* serialized, size_t size);
+    static Checksum readChecksum(const uint8_t* serialized);
+    // Checksums are cumulative over all revisions: provide the checksum
+    // of the preceding revision as the base for a revision > 0.
+    static Checksum computeChecksum(const uint8_t* serialized, const Checksum& base = Checksum());
+
+    // Packs the revisions [firstRevision, lastRevision] into a single "catch-up" message:
+    // one shared header (the metadata of the last revision), the sizes and checksums
+    // of each revision, and all payloads back to back. If dropPastAssumptions is set,
+    // only the last revision of the range keeps its assumptions, and the checksums
+    // of the sent revisions are recomputed to match the sent payloads.
+    std::shared_ptr<std::vector<uint8_t>> serializeRevisionRange(int firstRevision, int lastRevision, 
+        bool dropPastAssumptions) const;
+    // Reconstructs the individual revision serializations from a catch-up message.
+    // Returns an empty vector if the message is malformed.
+    static std::vector<std::shared_ptr<std::vector<uint8_t>>> deserializeRevisionRange(const std::vector<uint8_t>& packed);
 
     Statistics& getStatistics() {
         if (_stats == nullptr) _stats = new Statistics();
@@ -227,12 +297,14 @@ public:
 
     void transferRevisionData(JobDescription& other, int revision) {
         getRevisionData(revision) = other.getRevisionData(revision);
+        _shared_data_per_revision[revision] = other._shared_data_per_revision[revision];
         setRevision(std::max(getRevision(), revision));
     }
 
 private:
     std::shared_ptr<std::vector<uint8_t>>& getRevisionData(int revision);
     const std::shared_ptr<std::vector<uint8_t>>& getRevisionData(int revision) const;
+    void prepareRevisionSlot(int revision);
     int prepareRevision(const std::vector<uint8_t>& packed);
     
 };
@@ -17,6 +17,8 @@ struct JobMetadata {
     std::vector<int> dependencies;
     bool done = false;
     bool interrupt = false;
+    // Total size of the input files in bytes (estimate of the parsing effort)
+    size_t inputSize = 0;
 
     JobMetadata() {}
     JobMetadata(JobMetadata&& other) : 
@@ -24,7 +26,7 @@ struct JobMetadata {
         files(std::move(other.files)), 
         contentMode(other.contentMode), 
         dependencies(std::move(other.dependencies)),
-        done(other.done), interrupt(other.interrupt) {}
+        done(other.done), interrupt(other.interrupt), inputSize(other.inputSize) {}
     
     JobMetadata& operator=(JobMetadata&& other) {
         *this = JobMetadata(std::move(other));
@@ -3,13 +3,18 @@
 
 #include "app/dummy/dummy_reader.hpp"
 
-bool JobReader::read(const std::vector<std::string>& files, SatReader::ContentMode contentMode, JobDescription& desc) {
+bool JobReader::read(const std::vector<std::string>& files, SatReader::ContentMode contentMode, JobDescription& desc, 
+        int numThreads, const std::string& cacheDirectory) {
     switch (desc.getApplication()) {
     case JobDescription::DUMMY:
         return DummyReader::read(files, desc);
     case JobDescription::ONESHOT_SAT:
-    case JobDescription::INCREMENTAL_SAT:
-        return SatReader(files.front(), contentMode).read(desc);
+    case JobDescription::INCREMENTAL_SAT: {
+        SatReader reader(files.front(), contentMode);
+        reader.setNumThreads(numThreads);
+        reader.setCacheDirectory(cacheDirectory);
+        return reader.read(desc);
+    }
     default:
         return false;
     }
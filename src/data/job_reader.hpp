@@ -6,7 +6,8 @@
 #include "util/sat_reader.hpp"
 
 namespace JobReader {
-    bool read(const std::vector<std::string>& files, SatReader::ContentMode contentMode, JobDescription& desc);
+    bool read(const std::vector<std::string>& files, SatReader::ContentMode contentMode, JobDescription& desc, 
+        int numThreads = 1, const std::string& cacheDirectory = "");
 };
 
 #endif
@@ -5,6 +5,7 @@
 #include <sstream>
 
 #include "data/job_description.hpp"
+#include "comm/buffer_pool.hpp"
 
 size_t JobRequest::getTransferSize() {
     return 7*sizeof(int)+sizeof(float)+sizeof(JobDescription::Application);
@@ -12,7 +13,7 @@ size_t JobRequest::getTransferSize() {
 
 std::vector<uint8_t> JobRequest::serialize() const {
     int size = getTransferSize();
-    std::vector<uint8_t> packed(size);
+    std::vector<uint8_t> packed = BufferPool::get(size);
     int i = 0, n;
     n = sizeof(int); memcpy(packed.data()+i, &jobId, n); i += n;
     n = sizeof(JobDescription::Application); memcpy(packed.data()+i, &application, n); i += n;
@@ -85,7 +86,7 @@ OneshotJobRequestRejection& OneshotJobRequestRejection::deserialize(const std::v
 }
 
 std::vector<uint8_t> WorkRequest::serialize() const {
-    std::vector<uint8_t> packed(3*sizeof(int));
+    std::vector<uint8_t> packed = BufferPool::get(3*sizeof(int));
     int i = 0, n;
     n = sizeof(int); memcpy(packed.data()+i, &requestingRank, n); i += n;
     n = sizeof(int); memcpy(packed.data()+i, &numHops, n); i += n;
@@ -113,7 +114,7 @@ int JobSignature::getTransferSize() const {
 
 std::vector<uint8_t> JobSignature::serialize() const {
     int size = (3*sizeof(int) + sizeof(size_t));
-    std::vector<uint8_t> packed(size);
+    std::vector<uint8_t> packed = BufferPool::get(size);
 
     int i = 0, n;
     n = sizeof(int);    memcpy(packed.data()+i, &jobId, n); i += n;
@@ -134,7 +135,7 @@ JobSignature& JobSignature::deserialize(const std::vector<uint8_t>& packed) {
 
 std::vector<uint8_t> JobMessage::serialize() const {
     int size = 4*sizeof(int) + sizeof(bool) + payload.size()*sizeof(int) + sizeof(Checksum);
-    std::vector<uint8_t> packed(size);
+    std::vector<uint8_t> packed = BufferPool::get(size);
 
     int i = 0, n;
     n = sizeof(int); memcpy(packed.data()+i, &jobId, n); i += n;
@@ -162,7 +163,7 @@ JobMessage& JobMessage::deserialize(const std::vector<uint8_t>& packed) {
 
 std::vector<uint8_t> IntPair::serialize() const {
     int size = (2*sizeof(int));
-    std::vector<uint8_t> packed(size);
+    std::vector<uint8_t> packed = BufferPool::get(size);
     int i = 0, n;
     n = sizeof(int); memcpy(packed.data()+i, &first, n); i += n;
     n = sizeof(int); memcpy(packed.data()+i, &second, n); i += n;
@@ -178,7 +179,7 @@ IntPair& IntPair::deserialize(const std::vector<uint8_t>& packed) {
 
 std::vector<uint8_t> IntVec::serialize() const {
     int size = (data.size()*sizeof(int));
-    std::vector<uint8_t> packed(size);
+    std::vector<uint8_t> packed = BufferPool::get(size);
     memcpy(packed.data(), data.data(), size);
     return packed;
 }
@@ -194,7 +195,7 @@ int& IntVec::operator[](const int pos) {
 }
 
 std::vector<uint8_t> JobStatistics::serialize() const {
-    std::vector<uint8_t> packed(3*sizeof(int) + 3*sizeof(float));
+    std::vector<uint8_t> packed = BufferPool::get(3*sizeof(int) + 3*sizeof(float));
     int i = 0, n;
     n = sizeof(int);   memcpy(packed.data()+i, &jobId, sizeof(int));                      i += n;
     n = sizeof(int);   memcpy(packed.data()+i, &revision, sizeof(int));                   i += n;
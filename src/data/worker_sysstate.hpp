@@ -12,5 +12,8 @@
 #define SYSSTATE_NUMDESIRES 6
 #define SYSSTATE_NUMFULFILLEDDESIRES 7
 #define SYSSTATE_SUMDESIRELATENCIES 8
+#define SYSSTATE_DESCRAWBYTES 9
+#define SYSSTATE_DESCSENTBYTES 10
+#define SYSSTATE_DESCCODINGTIME 11
 
-typedef SysState<9> WorkerSysState;
+typedef SysState<12> WorkerSysState;
@@ -258,6 +258,8 @@ void JsonInterface::handleJobDone(JobResult&& result, const JobDescription::Stat
     j["stats"] = {
         { "time", {
             { "parsing", stats.parseTime },
+            { "parsing_decompression", stats.decompressionTime },
+            { "parsing_tokenization", stats.tokenizationTime },
             { "scheduling", stats.schedulingTime },
             { "first_balancing_latency", stats.latencyOf1stVolumeUpdate },
             { "processing", stats.processingTime },
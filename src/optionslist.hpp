@@ -14,16 +14,20 @@ OptMap _map;
 //  TYPE  member name                    option ID (short, long)                      default (, min, max)     description
 
 OPT_BOOL(abortNonincrementalSubprocess,  "ans", "abort-noninc-subproc",               false,                   "Abort (hence restart) each sub-process which works (partially) non-incrementally upon the arrival of a new revision")
+OPT_BOOL(catchUpRevisions,               "cur", "catch-up-revisions",                 false,                   "Transfer all revisions of an incremental job a worker is missing in a single message with one shared header")
 OPT_BOOL(certifiedUnsat,                 "cu", "certified-unsat",                     false,                   "Generate UNSAT proof (only supports mono mode + CaDiCaL solver)")
 OPT_BOOL(collectClauseHistory,           "ch", "collect-clause-history",              false,                   "Employ clause history collection mechanism")
 OPT_BOOL(coloredOutput,                  "colors", "",                                false,                   "Colored terminal output based on messages' verbosity")
+OPT_BOOL(compactClauseBuffers,           "ccb", "compact-clause-buffers",             false,                   "Exchange clause buffers during clause sharing in a compact delta/varint encoding whose size limit is given in bytes")
 OPT_BOOL(continuousGrowth,               "cg", "continuous-growth",                   true,                    "Continuous growth of job demands")
-OPT_BOOL(distributedDuplicateDetection,  "ddd", "",                                   false,                   "Distributed duplicate detection for clauses")
+OPT_BOOL(distributedDuplicateDetection,  "ddd", "",                                   false,                   "Distributed duplicate detection for clauses: partition clause fingerprints across the job tree and filter clauses shared recently by anyone")
 OPT_BOOL(delayMonkey,                    "delaymonkey", "",                           false,                   "Small chance for each MPI call to block for some random amount of time")
 OPT_BOOL(derandomize,                    "derandomize", "",                           true,                    "Derandomize job bouncing and build a <bounce-alternatives>-regular message graph instead")
+OPT_BOOL(dropPastAssumptions,            "dpa", "drop-past-assumptions",              false,                   "Drop the assumptions of all but the latest revision in catch-up transfers such that no worker stores them (the checksums of the transferred revisions are recomputed accordingly)")
 OPT_BOOL(useDormantChildren,             "dc", "dormant-children",                    false,                   "Simple strategy of maintaining local set of dormant child job contexts which the parent tries to reactivate")
 OPT_BOOL(explicitVolumeUpdates,          "evu", "explicit-volume-updates",            false,                   "Broadcast volume updates through job tree instead of letting each PE compute it itself")
 OPT_BOOL(groupClausesByLengthLbdSum,     "gclls", "group-by-length-lbd-sum",          false,                   "Group and prioritize clauses in buffers by the sum of clause length and LBD score")
+OPT_BOOL(hostSharedDescriptions,         "hsd", "host-shared-descriptions",           false,                   "Keep one copy of each job description per host in shared memory which co-located workers and their sub-processes map read-only")
 OPT_BOOL(help,                           "h", "help",                                 false,                   "Print help and exit")
 OPT_BOOL(useFilesystemInterface,         "interface-fs", "",                          true,                    "Use filesystem interface (.api/{in,out}/*.json)")
 OPT_BOOL(useIPCSocketInterface,          "interface-ipc", "",                         false,                   "Use IPC socket interface (.mallob.<pid>.sk)")
@@ -34,6 +38,7 @@ OPT_BOOL(monitorMpi,                     "mmpi", "monitor-mpi",
 OPT_BOOL(omitSolution,                   "os", "omit-solution",                       false,                   "Do not output solution in mono mode of operation")
 OPT_BOOL(phaseDiversification,           "phasediv", "",                              true,                    "Diversify solvers based on phase in addition to native diversification")
 OPT_BOOL(pipeLargeSolutions,             "pls", "pipe-large-solutions",               true,                    "Provide large solutions over a named pipe instead of directly writing them into the response JSON")
+OPT_BOOL(pipelineSharingEpochs,          "pse", "pipeline-sharing-epochs",            false,                   "Pipeline clause sharing epochs: begin the next epoch as soon as the clauses of the current epoch are all-reduced (at most two epochs in flight)")
 OPT_BOOL(quiet,                          "q", "quiet",                                false,                   "Do not log to stdout besides critical information")
 OPT_BOOL(reactivationScheduling,         "rs", "use-reactivation-scheduling",         true,                    "Perform reactivation-based scheduling")
 OPT_BOOL(regularProcessDistribution,     "rpa", "regular-process-allocation",         false,                   "Signal that processes have been allocated regularly, i.e., the i-th machine hosts ranks c*i through c*i + c-1")
@@ -44,6 +49,7 @@ OPT_BOOL(watchdog,                       "watchdog", "",
 OPT_BOOL(warmup,                         "warmup", "",                                false,                   "Do one explicit All-To-All warmup among all nodes in the beginning")
 OPT_BOOL(workRequests,                   "wr", "use-work-requests",                   false,                   "Send around work requests similarly to job requests")
 OPT_BOOL(yield,                          "yield", "",                                 false,                   "Yield manager thread whenever there are no new messages")
+OPT_BOOL(zeroCopyFragments,              "zcf", "zero-copy-fragments",                true,                    "Transfer fragments of large messages directly from the sender's buffer into the receiver's final buffer")
 OPT_BOOL(zeroOnlyLogging,                "0o", "zero-only-logging",                   false,                   "Only PE of rank zero does logging")
 
 OPT_INT(activeJobsPerClient,             "ajpc", "active-jobs-per-client",            0,         0, LARGE_INT, "Make each client have up to this many active jobs at any given time")
@@ -51,26 +57,35 @@ OPT_INT(bufferedImportedClsGenerations,  "bicg", "buffered-imported-cls-generati
 OPT_INT(clauseBufferBaseSize,            "cbbs", "clause-buffer-base-size",           1500,      0, MAX_INT,   "Clause buffer base size in integers")
 OPT_INT(clauseHistoryAggregationFactor,  "chaf", "clause-history-aggregation",        5,         1, LARGE_INT, "Aggregate historic clause batches by this factor")
 OPT_INT(clauseHistoryShortTermMemSize,   "chstms", "clause-history-shortterm-size",   10,        1, LARGE_INT, "Save this many \"full\" aggregated epochs until reducing them")
+OPT_INT(descriptionChunkSize,            "dcs", "desc-chunk-size",                    0,    0, MAX_INT,        "Send large job descriptions among workers in chunks of this many bytes; a worker relays each chunk upon arrival to those of its existing children which wait for the same revision (0: transfer descriptions as a whole). Does not pipeline initial job growth: a new worker adopts children only after receiving its full initial revision")
+OPT_INT(descriptionTransferEncoding,     "dte", "desc-transfer-encoding",             0,    0, 2,              "Wire encoding of job descriptions sent among workers: 0=raw, 1=varint with per-clause delta coding, 2=varint compressed with zstd")
+OPT_INT(duplicateDetectionBudget,        "dddb", "duplicate-detection-budget",        64,   0, LARGE_INT,      "Memory budget (in MB) per process for remembering the recently shared clauses of its fingerprint range with -ddd")
 OPT_INT(firstApiIndex,                   "fapii", "first-api-index",                  0,    0, LARGE_INT,      "1st API index: with c clients, uses .api/jobs.{<index>..<index>+c-1}/ as directories")
 OPT_INT(hopsBetweenBfs,                  "hbbfs", "hops-between-bfs",                 10,   0, MAX_INT,        "After a job request hopped this many times after unsuccessful \"hill climbing\" BFS, perform another BFS")
 OPT_INT(hopsUntilBfs,                    "hubfs", "hops-until-bfs",                   LARGE_INT, 0, MAX_INT,   "After a job request hopped this many times, perform a \"hill climbing\" BFS")
 OPT_INT(hopsUntilCollectiveAssignment,   "huca", "hops-until-collective-assignment",  0,    -1, LARGE_INT,     "After a job request hopped this many times, add it to collective negotiation of requests and idle nodes (0: immediately, -1: never");
 OPT_INT(jobCacheSize,                    "jc", "job-cache-size",                      4,    0, LARGE_INT,      "Size of job cache per PE for suspended yet unfinished job nodes")
+OPT_INT(loadedJobMemoryBudget,           "ljmb", "loaded-job-memory-budget",          0,    0, LARGE_INT,      "Limit (in MB) for the job descriptions each client is allowed to have loaded or in parsing at the same time, estimated from input file sizes until parsed, which underestimates compressed inputs (0: no limit)")
 OPT_INT(loadedJobsPerClient,             "ljpc", "loaded-jobs-per-client",            32,   0, LARGE_INT,      "Limit for how many job descriptions each client is allowed to have loaded at the same time")
 OPT_INT(maxBfsDepth,                     "mbfsd", "max-bfs-depth",                    4,    0, LARGE_INT,      "Max. depth to explore with hill climbing BFS for job requests")
 OPT_INT(maxDemand,                       "md", "max-demand",                          0,    0, LARGE_INT,      "Limit any job's demand to this value")
 OPT_INT(maxIdleDistance,                 "mid", "max-idle-distance",                  0,    0, LARGE_INT,      "Propagate idle distance of workers up to this limit through worker graph to weight randomness in request bouncing")
 OPT_INT(maxJobsPerStreamer,              "mjps", "max-jobs-per-streamer",             0,    0, LARGE_INT,      "Maximum number of jobs to introduce per streamer")
 OPT_INT(maxLbdPartitioningSize,          "mlbdps", "max-lbd-partition-size",          8,    1, LARGE_INT,      "Store clauses with up to this LBD in separate buckets")
+OPT_INT(maxPostedReceives,               "mpr", "max-posted-receives",                16,   1, 1024,           "Maximum number of message receives posted at once, each with a buffer of -mbt bytes; the actual number adapts to the rate of incoming messages")
 OPT_INT(messageBatchingThreshold,        "mbt", "message-batching-threshold",         1000000, 1000, MAX_INT,  "Employ batching of messages in batches of provided size")
+OPT_INT(messageCoalescingDelay,          "mcd", "message-coalescing-delay",           0,    0, LARGE_INT,      "Send coalesced small messages to a destination only once this many microseconds have passed since the first of them (0: at the end of each message queue cycle)")
+OPT_INT(messageCoalescingThreshold,      "mct", "message-coalescing-threshold",       0,    0, 10000,          "Coalesce messages of up to this many bytes to the same destination into a single message (0: no coalescing)")
 OPT_INT(minNumChunksForImportPerSolver,  "mcips", "min-import-chunks-per-solver",     10,   1, LARGE_INT,      "Min. number of cbbs-sized chunks for buffering produced clauses for export")
 OPT_INT(numBounceAlternatives,           "ba", "bounce-alternatives",                 4,    1, LARGE_INT,      "Number of bounce alternatives per PE (only relevant if -derandomize)")
 OPT_INT(numChunksForExport,              "nce", "export-chunks",                      20,   1, LARGE_INT,      "Number of cbbs-sized chunks for buffering produced clauses for export")
 OPT_INT(numClients,                      "c", "clients",                              1,    -1, LARGE_INT,     "Number of client PEs to initialize (counting backwards from last rank), -1: all PEs are clients")
 OPT_INT(numJobs,                         "J", "jobs",                                 0,    0, LARGE_INT,      "Exit as soon as this number of jobs has been processed")
+OPT_INT(numReaderThreads,                "rt", "reader-threads",                      0,    0, LARGE_INT,      "Number of job descriptions each client may parse in parallel; smaller jobs are parsed first within the same priority (0: up to size of thread pool)")
 OPT_INT(numThreadsPerProcess,            "t", "threads-per-process",                  1,    0, LARGE_INT,      "Number of worker threads per node")
 OPT_INT(maxLiteralsPerThread,            "mlpt", "max-lits-per-thread",               50000000, 0, MAX_INT,    "If formula is larger than threshold, reduce #threads per PE until #threads=1 or until limit is met \"on average\"")
 OPT_INT(processesPerHost,                "pph", "processes-per-host",                 0,    0, LARGE_INT,      "Tells Mallob how many MPI processes are executed on each physical host")
+OPT_INT(producedClauseFilterBudget,      "pcfb", "produced-clause-filter-budget",     0,    0, LARGE_INT,      "Memory budget (in MB) per process for remembering exported clauses as 64-bit fingerprints, forgetting the least recently used clauses first (0: remember clauses exactly and without limit, as required for certified UNSAT)")
 OPT_INT(qualityClauseLengthLimit,        "qcll", "quality-clause-length-limit",       8,    0, LARGE_INT,      "Clauses up to this length are considered \"high quality\"")
 OPT_INT(qualityLbdLimit,                 "qlbdl", "quality-lbd-limit",                2,    0, LARGE_INT,      "Clauses with an LBD score up to this value are considered \"high quality\"")
 OPT_INT(seed,                            "seed", "",                                  0,    0, MAX_INT,        "Random seed")
@@ -100,6 +115,7 @@ OPT_STRING(applicationConfiguration,     "app-config", "",
 OPT_STRING(applicationSpawnMode,         "appmode", "app-spawn-mode",                 "fork",                  "Application mode: \"fork\" (spawn child process for each job on each MPI process) or \"thread\" (execute jobs in separate threads but within the same process)")
 OPT_STRING(clientTemplate,               "client-template", "",                       "",                      "JSON template file which each client uses to decide on job parameters (with -job-template option)")
 OPT_STRING(satEngineConfig,              "sec", "sat-engine-config",                  "",                      "Supply config for SAT engine subprocess [internal option, do not use]")
+OPT_STRING(formulaCacheDirectory,        "fcd", "formula-cache-dir",                  "",                      "Directory to cache parsed formulae in (binary format, keyed by file path, mtime and size) for fast re-reading (empty: no caching)")
 OPT_STRING(jobDescriptionTemplate,       "job-desc-template", "",                     "",                      "Plain text file, one file path per line, to use as job descriptions (with -job-template option)")
 OPT_STRING(jobTemplate,                  "job-template", "",                          "",                      "JSON template file which each client uses to instantiate jobs indeterminately")
 OPT_STRING(logDirectory,                 "log", "log-directory",                      "",                      "Directory to save logs in")
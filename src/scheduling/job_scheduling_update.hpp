@@ -8,6 +8,7 @@
 
 #include "util/hashing.hpp"
 #include "data/serializable.hpp"
+#include "comm/buffer_pool.hpp"
 #include "util/assert.hpp"
 
 struct InactiveJobNode : public Serializable {
@@ -34,7 +35,7 @@ struct InactiveJobNode : public Serializable {
     }
 
     std::vector<uint8_t> serialize() const override {
-        std::vector<uint8_t> packed(sizeof(InactiveJobNode));    
+        std::vector<uint8_t> packed = BufferPool::get(sizeof(InactiveJobNode));
         memcpy(packed.data(), this, sizeof(InactiveJobNode));
         return packed;
     }
@@ -148,7 +149,7 @@ struct InactiveJobNodeList : public Serializable {
     }
 
     std::vector<uint8_t> serialize() const override {
-        std::vector<uint8_t> packed(sizeof(int)+getTransferSize());
+        std::vector<uint8_t> packed = BufferPool::get(sizeof(int)+getTransferSize());
         int size = set.size();
         memcpy(packed.data(), &size, sizeof(int));
         int n = sizeof(InactiveJobNode), i = sizeof(int);
@@ -197,7 +198,7 @@ struct JobSchedulingUpdate : public Serializable {
         : jobId(jobId), epoch(epoch), volume(volume), inactiveJobNodes(std::move(inactiveJobNodes)) {}
 
     std::vector<uint8_t> serialize() const override {
-        std::vector<uint8_t> packed(4*sizeof(int) + inactiveJobNodes.set.size()*sizeof(InactiveJobNode));
+        std::vector<uint8_t> packed = BufferPool::get(4*sizeof(int) + inactiveJobNodes.set.size()*sizeof(InactiveJobNode));
         int i = 0, n = sizeof(int);
         memcpy(packed.data()+i, &jobId, n); i += n;
         memcpy(packed.data()+i, &destinationIndex, n); i += n;
@@ -7,6 +7,7 @@
 #include <set>
 #include <random>
 #include <unistd.h>
+#include <forward_list>
 
 
 #include "util/sys/process.hpp"
@@ -261,6 +262,288 @@ void testReduce() {
     //LOG(V2_INFO, "BUF: %s\n", out.c_str());
 }
 
+void testArenaPerformance() {
+
+    LOG(V2_INFO, "Benchmarking insertion, export, and budget stealing ...\n");
+
+    // Generate random large clauses
+    const int nbClauses = 200'000;
+    const int maxClauseLength = 30;
+    std::vector<std::vector<int>> clauses(nbClauses);
+    std::vector<int> lbds(nbClauses);
+    for (int i = 0; i < nbClauses; i++) {
+        int len = 3 + (int) (Random::rand() * (maxClauseLength-2));
+        len = std::min(len, maxClauseLength);
+        lbds[i] = std::min(len, 2 + (int) (Random::rand() * (len-1)));
+        for (int l = 0; l < len; l++) 
+            clauses[i].push_back((Random::rand() < 0.5 ? -1 : 1) * (1 + (int) (Random::rand()*1000000)));
+    }
+
+    // Reference: one separately allocated vector per clause in a linked list
+    {
+        float time = Timer::elapsedSeconds();
+        std::forward_list<std::vector<int>> list;
+        for (int i = 0; i < nbClauses; i++) {
+            std::vector<int> vec(1+clauses[i].size());
+            vec[0] = lbds[i];
+            for (size_t j = 0; j < clauses[i].size(); j++) vec[1+j] = clauses[i][j];
+            list.push_front(std::move(vec));
+        }
+        float timeInsert = Timer::elapsedSeconds() - time;
+        time = Timer::elapsedSeconds();
+        size_t sum = 0;
+        for (auto& vec : list) sum += vec.size();
+        float timeScan = Timer::elapsedSeconds() - time;
+        LOG(V2_INFO, "forward_list<vector<int>> reference: insert %.4fs, scan %.4fs (%lu ints)\n", 
+            timeInsert, timeScan, sum);
+    }
+
+    for (bool sumMode : {false, true}) {
+
+        AdaptiveClauseDatabase::Setup setup;
+        setup.maxClauseLength = maxClauseLength;
+        setup.maxLbdPartitionedSize = 5;
+        setup.numLiterals = 10'000'000;
+        setup.slotsForSumOfLengthAndLbd = sumMode;
+
+        // Insert all clauses
+        AdaptiveClauseDatabase cdb(setup);
+        float time = Timer::elapsedSeconds();
+        int nbAdded = 0;
+        for (int i = 0; i < nbClauses; i++) {
+            if (cdb.addClause(clauses[i].data(), clauses[i].size(), lbds[i])) nbAdded++;
+        }
+        float timeInsert = Timer::elapsedSeconds() - time;
+        assert(nbAdded == nbClauses);
+        cdb.checkTotalLiterals();
+
+        // Export all clauses in rounds of limited size
+        time = Timer::elapsedSeconds();
+        int nbExported = 0;
+        std::vector<std::vector<int>> buffers;
+        while (cdb.getCurrentlyUsedLiterals() > 0) {
+            int numExported;
+            buffers.push_back(cdb.exportBuffer(500'000, numExported));
+            assert(numExported > 0);
+            nbExported += numExported;
+        }
+        float timeExport = Timer::elapsedSeconds() - time;
+        assert(nbExported == nbClauses);
+        cdb.checkTotalLiterals();
+
+        // Each clause must have been exported exactly once
+        std::vector<int> lengthCounts(maxClauseLength+1, 0);
+        for (auto& c : clauses) lengthCounts[c.size()]++;
+        for (auto& buf : buffers) {
+            auto reader = cdb.getBufferReader(buf.data(), buf.size());
+            auto cls = reader.getNextIncomingClause();
+            while (cls.begin != nullptr) {
+                lengthCounts[cls.size]--;
+                cls = reader.getNextIncomingClause();
+            }
+        }
+        for (int count : lengthCounts) assert(count == 0);
+
+        // Fill a small database with long clauses of low priority, 
+        // then insert short clauses which must steal their budget
+        setup.numLiterals = 100'000;
+        AdaptiveClauseDatabase smallCdb(setup);
+        int nbLong = 0;
+        for (auto& c : clauses) {
+            if (c.size() != maxClauseLength) continue;
+            if (!smallCdb.addClause(c.data(), c.size(), c.size())) break;
+            nbLong++;
+        }
+        time = Timer::elapsedSeconds();
+        int nbShort = 0;
+        for (int i = 0; i < nbClauses; i++) {
+            if (clauses[i].size() != 3) continue;
+            if (smallCdb.addClause(clauses[i].data(), 3, 2)) nbShort++;
+        }
+        float timeSteal = Timer::elapsedSeconds() - time;
+        smallCdb.checkTotalLiterals();
+        assert(smallCdb.getNumLiterals(3, 2) == 3*nbShort);
+
+        LOG(V2_INFO, "sum-mode=%i : insert %.4fs (%.1f ns/cls), export %.4fs in %lu rounds, "
+            "%i short cls stealing from %i long cls %.4fs\n", sumMode?1:0, timeInsert, 
+            1e9 * timeInsert / nbClauses, timeExport, buffers.size(), nbShort, nbLong, timeSteal);
+    }
+}
+
+void testMergePerformance() {
+
+    LOG(V2_INFO, "Benchmarking k-way merge of clause buffers ...\n");
+
+    const int maxClauseLength = 30;
+    const int nbClausesPerBuffer = 10'000;
+
+    for (bool sumMode : {false, true}) {
+
+        AdaptiveClauseDatabase::Setup setup;
+        setup.maxClauseLength = maxClauseLength;
+        setup.maxLbdPartitionedSize = 5;
+        setup.numLiterals = 1'000'000;
+        setup.slotsForSumOfLengthAndLbd = sumMode;
+
+        // Pool of distinct clauses from which all buffers draw, causing duplicates among buffers
+        std::vector<std::vector<int>> pool(4*nbClausesPerBuffer);
+        std::vector<int> poolLbds(pool.size());
+        std::set<std::vector<int>> poolClauses;
+        for (size_t i = 0; i < pool.size(); i++) {
+            int len = 1 + (int) (Random::rand() * maxClauseLength);
+            len = std::min(len, maxClauseLength);
+            poolLbds[i] = len == 1 ? 1 : std::min(len, 2 + (int) (Random::rand() * (len-1)));
+            do {
+                pool[i].clear();
+                for (int l = 0; l < len; l++) 
+                    pool[i].push_back((Random::rand() < 0.5 ? -1 : 1) * (1 + (int) (Random::rand()*1000000)));
+                std::sort(pool[i].begin(), pool[i].end());
+            } while (!poolClauses.insert(pool[i]).second);
+        }
+
+        for (int k = 2; k <= 64; k *= 2) {
+
+            std::vector<std::vector<int>> buffers;
+            std::set<int> drawnClauses;
+            int nbInputClauses = 0;
+            for (int b = 0; b < k; b++) {
+                AdaptiveClauseDatabase cdb(setup);
+                std::set<int> drawnHere;
+                for (int j = 0; j < nbClausesPerBuffer; j++) {
+                    int idx = (int) (Random::rand() * pool.size());
+                    idx = std::min(idx, (int) pool.size()-1);
+                    if (!drawnHere.insert(idx).second) continue;
+                    assert(cdb.addClause(pool[idx].data(), pool[idx].size(), poolLbds[idx]));
+                    drawnClauses.insert(idx);
+                }
+                int numExported;
+                buffers.push_back(cdb.exportBuffer(100'000'000, numExported));
+                assert(numExported == drawnHere.size());
+                nbInputClauses += numExported;
+            }
+
+            AdaptiveClauseDatabase cdb(setup);
+            auto merger = cdb.getBufferMerger(100'000'000);
+            for (auto& buffer : buffers) merger.add(cdb.getBufferReader(buffer.data(), buffer.size()));
+            float time = Timer::elapsedSeconds();
+            auto merged = merger.merge();
+            time = Timer::elapsedSeconds() - time;
+
+            // Merged buffer must contain each drawn clause exactly once
+            auto reader = cdb.getBufferReader(merged.data(), merged.size());
+            int nbMerged = 0;
+            while (reader.getNextIncomingClause().begin != nullptr) nbMerged++;
+            assert(nbMerged == drawnClauses.size() || 
+                log_return_false("%i merged, %lu distinct\n", nbMerged, drawnClauses.size()));
+
+            LOG(V2_INFO, "sum-mode=%i k=%i : merged %i into %i clauses in %.4fs (%.1f ns/input cls)\n", 
+                sumMode?1:0, k, nbInputClauses, nbMerged, time, 1e9 * time / nbInputClauses);
+        }
+    }
+}
+
+void testCompactBuffers() {
+
+    LOG(V2_INFO, "Testing compact clause buffers ...\n");
+
+    const int maxClauseLength = 30;
+    const int nbClausesPerBuffer = 10'000;
+    const int numBuffers = 4;
+
+    for (bool sumMode : {false, true}) {
+
+        AdaptiveClauseDatabase::Setup setup;
+        setup.maxClauseLength = maxClauseLength;
+        setup.maxLbdPartitionedSize = 5;
+        setup.numLiterals = 1'000'000;
+        setup.slotsForSumOfLengthAndLbd = sumMode;
+        AdaptiveClauseDatabase cdb(setup);
+
+        // Export buffers with overlapping clauses
+        std::vector<std::vector<int>> pool(2*nbClausesPerBuffer);
+        std::vector<int> poolLbds(pool.size());
+        for (size_t i = 0; i < pool.size(); i++) {
+            int len = std::min(maxClauseLength, 1 + (int) (Random::rand() * maxClauseLength));
+            poolLbds[i] = len == 1 ? 1 : std::min(len, 2 + (int) (Random::rand() * (len-1)));
+            std::set<int> vars;
+            while (vars.size() < len) vars.insert(1 + (int) (Random::rand() * 100'000));
+            for (int var : vars) pool[i].push_back((Random::rand() < 0.5 ? -1 : 1) * var);
+            std::sort(pool[i].begin(), pool[i].end());
+        }
+        std::vector<std::vector<int>> buffers;
+        std::vector<std::vector<int>> compactBuffers;
+        for (int b = 0; b < numBuffers; b++) {
+            AdaptiveClauseDatabase exportCdb(setup);
+            for (int j = 0; j < nbClausesPerBuffer; j++) {
+                int idx = std::min((int) pool.size()-1, (int) (Random::rand() * pool.size()));
+                exportCdb.addClause(pool[idx].data(), pool[idx].size(), poolLbds[idx]);
+            }
+            int numExported;
+            buffers.push_back(exportCdb.exportBuffer(-1, numExported));
+            auto& buf = buffers.back();
+
+            // Round trip
+            auto compact = cdb.encodeCompactBuffer(buf.data(), buf.size(), -1);
+            auto decoded = cdb.decodeCompactBuffer(compact.data(), compact.size());
+            assert(decoded == buf);
+
+            // Reading the compact buffer yields the same clauses
+            auto reader = cdb.getBufferReader(buf.data(), buf.size());
+            auto compactReader = cdb.getCompactBufferReader(compact.data(), compact.size());
+            int nbClauses = 0;
+            while (true) {
+                auto& c = reader.getNextIncomingClause();
+                auto& cc = compactReader.getNextIncomingClause();
+                assert((c.begin == nullptr) == (cc.begin == nullptr));
+                if (c.begin == nullptr) break;
+                assert(c.size == cc.size && c.lbd == cc.lbd);
+                for (int i = 0; i < c.size; i++) assert(c.begin[i] == cc.begin[i]);
+                nbClauses++;
+            }
+            assert(nbClauses == numExported);
+            LOG(V2_INFO, "sum-mode=%i : %i clauses, %lu plain bytes, %lu compact bytes (ratio %.2f)\n", 
+                sumMode?1:0, nbClauses, sizeof(int)*buf.size(), sizeof(int)*compact.size(), 
+                buf.size() / (float) compact.size());
+            compactBuffers.push_back(std::move(compact));
+        }
+
+        // Merging compact buffers yields the same clauses as merging plain buffers
+        auto merger = cdb.getBufferMerger(-1);
+        for (auto& buffer : buffers) merger.add(cdb.getBufferReader(buffer.data(), buffer.size()));
+        auto merged = merger.merge();
+        auto compactMerger = cdb.getCompactBufferMerger(-1);
+        for (auto& buffer : compactBuffers) compactMerger.add(cdb.getCompactBufferReader(buffer.data(), buffer.size()));
+        auto compactMerged = compactMerger.merge();
+        assert(cdb.decodeCompactBuffer(compactMerged.data(), compactMerged.size()) == merged);
+
+        // Merging with limits: the compact buffer respects its byte limit
+        // and carries more clauses within the same bandwidth
+        const int literalLimit = 50'000;
+        merger = cdb.getBufferMerger(literalLimit);
+        for (auto& buffer : buffers) merger.add(cdb.getBufferReader(buffer.data(), buffer.size()));
+        std::vector<int> excess;
+        merged = merger.merge(&excess);
+        compactMerger = cdb.getCompactBufferMerger(sizeof(int) * literalLimit);
+        for (auto& buffer : compactBuffers) compactMerger.add(cdb.getCompactBufferReader(buffer.data(), buffer.size()));
+        std::vector<int> compactExcess;
+        compactMerged = compactMerger.merge(&compactExcess);
+        assert(compactMerged[sizeof(size_t)/sizeof(int)] <= sizeof(int) * literalLimit);
+        auto countClauses = [&](BufferReader&& reader) {
+            int nb = 0;
+            while (reader.getNextIncomingClause().begin != nullptr) nb++;
+            return nb;
+        };
+        int nbPlain = countClauses(cdb.getBufferReader(merged.data(), merged.size()));
+        int nbPlainExcess = countClauses(cdb.getBufferReader(excess.data(), excess.size()));
+        int nbCompact = countClauses(cdb.getCompactBufferReader(compactMerged.data(), compactMerged.size()));
+        int nbCompactExcess = countClauses(cdb.getCompactBufferReader(compactExcess.data(), compactExcess.size()));
+        assert(nbCompact > nbPlain);
+        assert(nbCompact + nbCompactExcess >= nbPlain + nbPlainExcess);
+        LOG(V2_INFO, "sum-mode=%i : merged %i plain clauses vs. %i compact clauses within %i bytes\n", 
+            sumMode?1:0, nbPlain, nbCompact, sizeof(int) * literalLimit);
+    }
+}
+
 int main() {
     Timer::init();
     Random::init(rand(), rand());
@@ -272,6 +555,9 @@ int main() {
     testMinimal();
     testMerge();
     testReduce();
+    testArenaPerformance();
+    testMergePerformance();
+    testCompactBuffers();
 }
 
 
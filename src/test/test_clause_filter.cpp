@@ -1,5 +1,8 @@
 
 #include <bitset>
+#include <thread>
+#include <set>
+#include <algorithm>
 
 #include "util/sys/timer.hpp"
 #include "util/logger.hpp"
@@ -8,6 +11,9 @@
 #include "util/sys/process.hpp"
 
 #include "app/sat/sharing/filter/clause_filter.hpp"
+#include "app/sat/sharing/filter/produced_clause_filter.hpp"
+#include "app/sat/sharing/buffer/adaptive_clause_database.hpp"
+#include "app/sat/sharing/export_buffer.hpp"
 #include "util/atomic_bitset/atomic_wide_bitset.hpp"
 #include "util/atomic_bitset/atomic_bitset.hpp"
 
@@ -80,6 +86,150 @@ void test() {
     }
 }
 
+void testProducedClauseFilter(size_t fingerprintBudget) {
+
+    const int numThreads = 4;
+    const int numClauses = 20000;
+    const int maxClauseLength = 6;
+
+    // Pool of distinct clauses
+    std::set<std::vector<int>> seen;
+    std::vector<std::vector<int>> pool;
+    while (pool.size() < numClauses) {
+        int size = 1 + (int) (Random::rand() * maxClauseLength);
+        std::set<int> vars;
+        while (vars.size() < size) vars.insert(1 + (int) (Random::rand() * 1000));
+        std::vector<int> cls;
+        for (int var : vars) cls.push_back(Random::rand() < 0.5 ? -var : var);
+        if (seen.insert(cls).second) pool.push_back(cls);
+    }
+
+    AdaptiveClauseDatabase::Setup setup;
+    setup.maxClauseLength = maxClauseLength;
+    setup.maxLbdPartitionedSize = 2;
+    setup.numLiterals = 1'000'000;
+    AdaptiveClauseDatabase cdb(setup);
+    ProducedClauseFilter filter(/*epochHorizon=*/10, /*reshareImprovedLbd=*/false, fingerprintBudget);
+
+    // Each thread registers all clauses of the pool in its own order
+    std::atomic_int numAdmitted {0};
+    std::atomic_int numFiltered {0};
+    std::vector<std::thread> threads;
+    float time = Timer::elapsedSeconds();
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<int> order(pool.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = i;
+            std::shuffle(order.begin(), order.end(), std::mt19937(t));
+            for (int i : order) {
+                auto cls = pool[i];
+                int lbd = std::min(2, (int) cls.size());
+                auto result = filter.tryRegisterAndInsert(
+                    ProducedClauseCandidate(cls.data(), cls.size(), lbd, t, 0), cdb);
+                assert(result != ProducedClauseFilter::DROPPED);
+                if (result == ProducedClauseFilter::ADMITTED) numAdmitted++;
+                else numFiltered++;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    time = Timer::elapsedSeconds() - time;
+
+    // Each clause was admitted exactly once, and all threads are known as its producers
+    LOG(V2_INFO, "ProducedClauseFilter fp=%i: %i threads, %i adm, %i flt, %lu/%lu contended locks, %.4fs\n",
+        filter.usesFingerprints(), numThreads, numAdmitted.load(), numFiltered.load(), filter.getNumContendedLockAcquisitions(),
+        filter.getNumLockAcquisitions(), time);
+    assert(numAdmitted == numClauses);
+    assert(numFiltered == (numThreads-1) * numClauses);
+    assert(filter.getNumLockAcquisitions() == numThreads * numClauses);
+    for (auto& cls : pool) {
+        Mallob::Clause c(cls.data(), cls.size(), std::min(2, (int) cls.size()));
+        assert(filter.getProducers(c, 0) == (1 << numThreads)-1);
+    }
+}
+void testFingerprintEviction() {
+
+    const size_t budget = 1<<16;
+    AdaptiveClauseDatabase::Setup setup;
+    setup.maxClauseLength = 3;
+    setup.maxLbdPartitionedSize = 2;
+    setup.numLiterals = 1'000'000;
+    AdaptiveClauseDatabase cdb(setup);
+    ProducedClauseFilter filter(/*epochHorizon=*/10, /*reshareImprovedLbd=*/false, budget);
+    assert(filter.usesFingerprints());
+
+    // Register many more distinct clauses than fit into the budget, one epoch at a time
+    const int clausesPerEpoch = 1000;
+    int epoch = 0;
+    for (int var = 1; var <= 100*clausesPerEpoch; var++) {
+        if (var % clausesPerEpoch == 0) epoch++;
+        int lits[2] = {var, -var-1};
+        auto result = filter.tryRegisterAndInsert(ProducedClauseCandidate(lits, 2, 2, 0, epoch), cdb);
+        assert(result != ProducedClauseFilter::FILTERED);
+        if (result == ProducedClauseFilter::DROPPED) {
+            // Database full: flush it
+            int numExported;
+            cdb.exportBuffer(setup.numLiterals, numExported);
+        }
+    }
+    LOG(V2_INFO, "ProducedClauseFilter fingerprint eviction: %lu evictions, %lu/%lu bytes, FP prob. %.3e\n",
+        filter.getNumEvictions(), filter.getMemoryBytes(), budget, filter.getFalsePositiveProbability());
+    assert(filter.getNumEvictions() > 0);
+    assert(filter.getMemoryBytes() <= budget);
+
+    // The most recent clauses are still remembered, the oldest ones are forgotten
+    int lits[2] = {100*clausesPerEpoch, -100*clausesPerEpoch-1};
+    Mallob::Clause recent(lits, 2, 2);
+    assert(filter.getProducers(recent, epoch) == 1);
+    lits[0] = 1; lits[1] = -2;
+    Mallob::Clause old(lits, 2, 2);
+    assert(filter.getProducers(old, epoch) == 0);
+}
+
+void testExportBufferDraining() {
+
+    const int maxClauseLength = 6;
+    const size_t ringCapacity = 1000; // integers
+    const int numClauses = 2000; // clearly more than a ring holds
+    const int numClausesPerCycle = 50;
+
+    // Distinct binary clauses
+    std::vector<std::vector<int>> pool;
+    for (int var = 1; var <= numClauses; var++) pool.push_back({var, -var-1});
+
+    AdaptiveClauseDatabase::Setup setup;
+    setup.maxClauseLength = maxClauseLength;
+    setup.maxLbdPartitionedSize = 2;
+    setup.numLiterals = 1'000'000;
+
+    for (bool drainPeriodically : {true, false}) {
+        AdaptiveClauseDatabase cdb(setup);
+        ProducedClauseFilter filter(/*epochHorizon=*/10, /*reshareImprovedLbd=*/false);
+        SolverStatistics stats;
+        std::vector<SolverStatistics*> solverStats {&stats};
+        ExportBuffer exportBuffer(filter, cdb, solverStats, 1, ringCapacity, maxClauseLength);
+
+        // Produce all clauses between two exports, optionally draining the ring
+        // in between like the job's communication routine does
+        for (int i = 0; i < numClauses; i++) {
+            exportBuffer.produce(pool[i].data(), pool[i].size(), 2, 0, 0);
+            if (drainPeriodically && (i+1) % numClausesPerCycle == 0) exportBuffer.collect();
+        }
+        exportBuffer.collect();
+        int numExported;
+        cdb.exportBuffer(setup.numLiterals, numExported);
+
+        LOG(V2_INFO, "ExportBuffer drain=%i: %lu adm, %lu dropped, %i exported\n", drainPeriodically,
+            stats.producedClausesAdmitted, stats.producedClausesDropped, numExported);
+        if (drainPeriodically) {
+            assert(stats.producedClausesDropped == 0);
+            assert(stats.producedClausesAdmitted == numClauses);
+            assert(numExported == numClauses);
+        } else {
+            assert(stats.producedClausesDropped > 0);
+        }
+    }
+}
 
 int main() {
     Timer::init();
@@ -88,4 +238,8 @@ int main() {
     Process::init(0);
 
     test();
+    testProducedClauseFilter(0);
+    testProducedClauseFilter(1<<24);
+    testFingerprintEviction();
+    testExportBufferDraining();
 }
@@ -3,81 +3,255 @@
 #include "util/assert.hpp"
 #include <vector>
 #include <string>
-#include <thread>
+#include <list>
 #include <set>
 #include <random>
 #include <unistd.h>
 #include <algorithm>
-
+#include <memory>
 
 #include "util/sys/process.hpp"
 #include "util/sys/thread_pool.hpp"
 #include "util/random.hpp"
 #include "util/logger.hpp"
 #include "util/sys/timer.hpp"
-#include "util/sys/terminator.hpp"
+#include "util/robin_hood.hpp"
 #include "app/sat/job/distributed_clause_filter.hpp"
 
+void testInorderRanks() {
+    for (int volume = 1; volume <= 64; volume++) {
+        std::set<int> ranks;
+        for (int index = 0; index < volume; index++) {
+            int rank = DistributedClauseFilter::getInorderRank(index, volume);
+            ranks.insert(rank);
+            // All nodes of the left (right) subtree precede (succeed) the node
+            for (int child = 1; child <= 2; child++) {
+                std::vector<int> subtree {2*index+child};
+                while (!subtree.empty()) {
+                    int node = subtree.back(); subtree.pop_back();
+                    if (node >= volume) continue;
+                    int nodeRank = DistributedClauseFilter::getInorderRank(node, volume);
+                    assert(child == 1 ? nodeRank < rank : nodeRank > rank);
+                    subtree.push_back(2*node+1);
+                    subtree.push_back(2*node+2);
+                }
+            }
+        }
+        assert(ranks.size() == volume);
+        assert(*ranks.begin() == 0 && *ranks.rbegin() == volume-1);
+    }
+}
 
-int main() {
-    
-    int seed = 1;
+// Simulation of clause sharing in a job tree over a number of epochs. Each node
+// produces clauses drawn from a skewed distribution, so clauses are re-derived
+// frequently. All produced clauses (up to a limit) are broadcast and then filtered
+// (a) by the current scheme, where each node reports the clauses it produced itself
+// and shared recently, OR-ing full bitvectors up the tree, and (b) by distributed
+// duplicate detection.
+struct Simulation {
 
-    Timer::init();
-    Random::init(seed, seed);
-    Logger::init(0, V5_DEBG, false, false, false, nullptr);
-    Process::init(0);
-    ProcessWideThreadPool::init(1);
+    struct Result {
+        unsigned long nbBroadcast = 0;
+        unsigned long nbDuplicates = 0;
+        unsigned long nbMissedDuplicates = 0;
+        unsigned long nbFalselyFiltered = 0;
+        unsigned long trafficUp = 0; // integers sent to parents
+        unsigned long trafficDown = 0; // integers sent to children
+        unsigned long memoryEntries = 0; // remembered clauses in all nodes
+    };
+
+    const int volume;
+    const int horizon;
+    const int churnPeriod;
+    int maxBufferSize;
 
-    int numClauses = 100'000;
+    std::vector<std::vector<int>> pool;
+    std::vector<int> lastSharedEpoch; // ground truth
 
-    std::vector<std::vector<int>*> clauseData;
-    for (int c = 0; c < numClauses; c++) {
-        std::vector<int>* data = new std::vector<int>();
-        for (int i = 0; i < 1+Random::rand()*29; i++) 
-            data->push_back((int) (10000 + 90000*Random::rand()));
-        clauseData.push_back(data);
+    // State of the current scheme: last shared epoch of each produced clause
+    std::vector<robin_hood::unordered_map<int, int>> produced;
+    std::vector<std::unique_ptr<DistributedClauseFilter>> filters;
+
+    Result current;
+    Result distributed;
+
+    Simulation(int volume, int horizon, int churnPeriod) : volume(volume), horizon(horizon), churnPeriod(churnPeriod) {
+        maxBufferSize = std::min(20'000, 300*volume);
+        int poolSize = 50*maxBufferSize;
+        std::set<std::vector<int>> distinctClauses;
+        while (pool.size() < poolSize) {
+            std::vector<int> lits;
+            int size = 1 + (int) (Random::rand()*10);
+            while (lits.size() < size) {
+                int lit = (1 + (int) (Random::rand()*100'000)) * (Random::rand() < 0.5 ? -1 : 1);
+                if (std::find(lits.begin(), lits.end(), lit) == lits.end()) lits.push_back(lit);
+            }
+            std::sort(lits.begin(), lits.end());
+            if (!distinctClauses.insert(lits).second) continue;
+            pool.push_back(std::move(lits));
+        }
+        lastSharedEpoch.resize(poolSize, -1);
+        for (int i = 0; i < volume; i++) resetNode(i);
     }
-    std::vector<Clause> clauses;
-    for (auto data : clauseData) {
-        clauses.push_back(Clause(data->data(), data->size(), 2+Random::rand()*(data->size()-2)));
+
+    void resetNode(int index) {
+        if (produced.size() <= index) produced.resize(index+1);
+        produced[index].clear();
+        if (filters.size() <= index) filters.resize(index+1);
+        filters[index].reset(new DistributedClauseFilter(horizon, /*reshareImprovedLbd=*/false,
+            /*memoryBudget=*/64*1024*1024));
+        filters[index]->update(index, volume);
+    }
+
+    bool isRecent(int epoch, int lastEpoch) {
+        return lastEpoch >= 0 && epoch - lastEpoch <= horizon;
     }
-    sort(clauses.begin(), clauses.end(), 
-    [](const Clause& a, const Clause& b) -> bool
-    { 
-        return ClauseHasher::hash(a, /*which=*/3) < ClauseHasher::hash(b, /*which=*/3); 
-    });
-
-    for (int volume = 1; volume <= 32; volume++) {
-
-        std::vector<std::vector<bool>> passedMatrix;
-
-        int allNumFiltered = 0;
-        for (int rank = 0; rank < volume; rank++) {
-            DistributedClauseFilter filter(/*filterMemory=*/60);
-            filter.update(rank, volume);
-            std::vector<bool> r;
-            int numFiltered = 0;
-            for (auto& c : clauses) {
-                filter.passClause(c, /*epoch=*/1);
-                r.push_back(filter.passClause(c, /*epoch=*/2));
-                if (!r.back()) numFiltered++;
+
+    void run(int nbEpochs) {
+        for (int epoch = 1; epoch <= nbEpochs; epoch++) {
+
+            // Nodes in the right half of the tree are replaced by fresh nodes periodically
+            if (churnPeriod > 0 && epoch % churnPeriod == 0) {
+                for (int i = volume/2; i < volume; i++) resetNode(i);
+            }
+
+            // Production and (deduplicating) merge of clauses
+            std::vector<int> buffer;
+            std::vector<bool> inBuffer(pool.size(), false);
+            for (int i = 0; i < volume; i++) {
+                for (int k = 0; k < maxBufferSize / volume; k++) {
+                    double r = Random::rand();
+                    int id = (int) (r*r*r * pool.size());
+                    if (!produced[i].count(id)) produced[i][id] = -1;
+                    if (!inBuffer[id]) {
+                        inBuffer[id] = true;
+                        buffer.push_back(id);
+                    }
+                }
+            }
+            std::vector<DistributedClauseFilter::Key> keys;
+            for (int id : buffer) {
+                keys.emplace_back(Mallob::Clause(pool[id].data(), pool[id].size(), std::min(2, (int) pool[id].size())));
+            }
+            const int filterSize = (buffer.size()+31) / 32;
+
+            // (a) Current scheme: each node reports the clauses it produced and shared recently
+            std::vector<int> plainCurrent(filterSize, 0);
+            for (int i = 0; i < volume; i++) {
+                for (size_t c = 0; c < buffer.size(); c++) {
+                    auto it = produced[i].find(buffer[c]);
+                    if (it == produced[i].end()) continue;
+                    if (isRecent(epoch, it->second)) plainCurrent[c/32] |= (1u << (c%32));
+                    else it->second = epoch;
+                }
+            }
+            current.trafficUp += (volume-1) * filterSize;
+            current.trafficDown += (volume-1) * filterSize;
+
+            // (b) Distributed duplicate detection, aggregated bottom-up along the tree
+            std::vector<std::vector<int>> aggregated(volume);
+            for (int i = volume-1; i >= 0; i--) {
+                std::list<std::vector<int>> elems;
+                elems.push_back(filters[i]->getLocalFilter(keys, epoch));
+                for (int child : {2*i+1, 2*i+2}) if (child < volume) {
+                    elems.push_back(std::move(aggregated[child]));
+                }
+                aggregated[i] = DistributedClauseFilter::merge(elems, keys, volume);
+                if (i > 0) distributed.trafficUp += aggregated[i].size();
             }
-            passedMatrix.push_back(std::move(r));
-            auto indices = filter.getSlotIndices();
-            LOG(V2_INFO, "[v=%i] Rank %i : indices [%i,%i,%i], %i filtered\n", volume, rank, indices[0], indices[1], indices[2], numFiltered);
-            allNumFiltered += numFiltered;
+            distributed.trafficDown += (volume-1) * aggregated[0].size();
+            auto plainDistributed = DistributedClauseFilter::toPlainFilter(aggregated[0], keys);
+            assert(plainDistributed.size() == filterSize);
+
+            // Evaluate against ground truth
+            for (auto [result, filter] : {std::pair<Result*, std::vector<int>*>(&current, &plainCurrent),
+                    std::pair<Result*, std::vector<int>*>(&distributed, &plainDistributed)}) {
+                for (size_t c = 0; c < buffer.size(); c++) {
+                    bool duplicate = isRecent(epoch, lastSharedEpoch[buffer[c]]);
+                    bool filtered = ((*filter)[c/32] & (1u << (c%32))) != 0;
+                    result->nbBroadcast++;
+                    if (duplicate) result->nbDuplicates++;
+                    if (duplicate && !filtered) result->nbMissedDuplicates++;
+                    if (!duplicate && filtered) result->nbFalselyFiltered++;
+                }
+            }
+            // The ground truth follows the distributed scheme's sharing decisions
+            for (size_t c = 0; c < buffer.size(); c++) {
+                if ((plainDistributed[c/32] & (1u << (c%32))) == 0) lastSharedEpoch[buffer[c]] = epoch;
+            }
+        }
+        for (int i = 0; i < volume; i++) {
+            current.memoryEntries += produced[i].size();
+            distributed.memoryEntries += filters[i]->size();
         }
-        LOG(V2_INFO, "[v=%i] Total filtered: %i\n\n", volume, allNumFiltered);
     }
 
+    void report(const char* label) {
+        for (auto [name, res] : {std::pair<const char*, Result*>("current", &current),
+                std::pair<const char*, Result*>("distributed", &distributed)}) {
+            LOG(V2_INFO, "[%s v=%i] %-11s bcast=%lu dup=%.4f missed=%.4f falsepos=%.4f up=%lu down=%lu mem=%lu\n",
+                label, volume, name, res->nbBroadcast, res->nbDuplicates / (double) res->nbBroadcast,
+                res->nbMissedDuplicates / (double) std::max(1UL, res->nbDuplicates),
+                res->nbFalselyFiltered / (double) res->nbBroadcast,
+                res->trafficUp, res->trafficDown, res->memoryEntries);
+        }
+    }
+};
+
+void testMergeOfDifferentVolumes() {
+    std::vector<std::vector<int>> clauses;
+    std::vector<DistributedClauseFilter::Key> keys;
+    for (int i = 0; i < 1000; i++) clauses.push_back({i+1, -(i+2), i+3});
+    for (auto& c : clauses) keys.emplace_back(Mallob::Clause(c.data(), c.size(), 2));
 
-    
-    //for (auto& c : clauses) LOG(V2_INFO, "%s ~> %lu\n", c.toStr().c_str(), ClauseHasher::hash(c, /*which=*/3));
-    //for (auto& v : passedMatrix) {
-    //    std::string out;
-    //    for (bool passed : v) out += (passed ? " " : "X");
-    //    LOG(V2_INFO, "%s\n", out.c_str());
-    //}
+    // Nodes of two different job tree volumes report all clauses in their range
+    std::list<std::vector<int>> elems;
+    std::vector<int> oldVolumeFilter, newVolumeFilter;
+    for (int volume : {3, 4}) {
+        DistributedClauseFilter filter(10, false, 1<<20);
+        filter.update(/*index=*/1, volume);
+        filter.getLocalFilter(keys, 1);
+        elems.push_back(filter.getLocalFilter(keys, 2));
+        auto plain = DistributedClauseFilter::toPlainFilter(elems.back(), keys);
+        (volume == 3 ? oldVolumeFilter : newVolumeFilter) = plain;
+    }
+    auto merged = DistributedClauseFilter::merge(elems, keys, 4);
+    assert(merged[0] == 4 && merged[1] == 0 && merged[2] == 3);
+    auto plain = DistributedClauseFilter::toPlainFilter(merged, keys);
+    for (size_t i = 0; i < plain.size(); i++) {
+        assert(plain[i] == (oldVolumeFilter[i] | newVolumeFilter[i]));
+    }
+    int nbFiltered = 0;
+    for (int x : plain) nbFiltered += __builtin_popcount(x);
+    assert(nbFiltered > 0);
 }
 
+int main() {
+
+    int seed = 1;
+
+    Timer::init();
+    Random::init(seed, seed);
+    Logger::init(0, V5_DEBG, false, false, false, nullptr);
+    Process::init(0);
+    ProcessWideThreadPool::init(1);
+
+    testInorderRanks();
+    testMergeOfDifferentVolumes();
+
+    for (int volume : {1, 4, 16, 64}) {
+        // Stable job tree: the distributed scheme detects duplicates exactly
+        Simulation stable(volume, /*horizon=*/10, /*churnPeriod=*/0);
+        stable.run(/*nbEpochs=*/30);
+        stable.report("stable");
+        assert(stable.distributed.nbMissedDuplicates == 0);
+        assert(stable.distributed.nbFalselyFiltered == 0);
+        if (volume > 1) assert(stable.distributed.trafficUp < stable.current.trafficUp);
+
+        // Half of the job tree is replaced every few epochs
+        Simulation churn(volume, /*horizon=*/10, /*churnPeriod=*/5);
+        churn.run(/*nbEpochs=*/30);
+        churn.report("churn");
+        assert(churn.distributed.nbFalselyFiltered == 0);
+    }
+}
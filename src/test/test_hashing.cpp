@@ -4,6 +4,11 @@
 
 #include <unordered_set>
 #include <iostream>
+#include <algorithm>
+#include <random>
+
+#include "util/assert.hpp"
+#include "app/sat/data/clause_kernels.hpp"
 
 size_t commutativeHash(const int* begin, int size, int which = 3) {
     static unsigned const int primes [] = 
@@ -28,8 +33,61 @@ size_t nonCommutativeHash(const int* begin, int size, int which = 3) {
     return res;
 }
 
+std::vector<int> randomLiterals(std::mt19937& rng, int size, int maxVar) {
+    std::uniform_int_distribution<int> varDist(1, maxVar);
+    std::vector<int> lits;
+    for (int i = 0; i < size; i++) lits.push_back(varDist(rng) * (rng() % 2 ? 1 : -1));
+    return lits;
+}
+
+template <int N>
+void testSortNetwork(std::mt19937& rng) {
+    for (int rep = 0; rep < 1000; rep++) {
+        auto lits = randomLiterals(rng, N, rep % 2 ? 10 : 1000000);
+        auto expected = lits;
+        std::sort(expected.begin(), expected.end());
+        clause_kernels::sortNetwork<N>(lits.data());
+        assert(lits == expected);
+    }
+    if constexpr (N > 0) testSortNetwork<N-1>(rng);
+}
+
+void testClauseKernels() {
+    std::mt19937 rng(1);
+
+    // Scalar sorting networks of each fixed size
+    testSortNetwork<32>(rng);
+
+    for (int size = 0; size <= 80; size++) {
+        for (int rep = 0; rep < 1000; rep++) {
+            auto lits = randomLiterals(rng, size, rep % 2 ? 10 : 1000000);
+
+            // Sorting (vectorized if available) must be identical to std::sort
+            auto sorted = lits;
+            auto expected = lits;
+            clause_kernels::sortLiterals(sorted.data(), size);
+            std::sort(expected.begin(), expected.end());
+            assert(sorted == expected);
+
+            // Hash must be bit-identical to the reference implementation
+            for (int which : {0, 3, 7, 15, 16, -5}) {
+                size_t hash = clause_kernels::commutativeHash(lits.data(), size, which);
+                assert(hash == commutativeHash(lits.data(), size, which));
+                assert(hash == clause_kernels::commutativeHash(sorted.data(), size, which));
+            }
+        }
+    }
+#ifdef __AVX2__
+    std::cout << "Clause kernels (AVX2) are equivalent" << std::endl;
+#else
+    std::cout << "Clause kernels (scalar) are equivalent" << std::endl;
+#endif
+}
+
 int main() {
 
+    testClauseKernels();
+
     for (int shift = 0; shift < 64; shift += 4) {
         std::cout << "shift=" << shift << std::endl;
 
@@ -51,49 +51,34 @@ void testConcurrentImport() {
     int nbTotalAdded = 0;
     int nbTotalDigested = 0;
 
-    // Producer
+    // Producer: collects clauses in a database of its own and periodically
+    // hands them over as a shared buffer, as much as the import budget allows
     auto futureProd = ProcessWideThreadPool::get().addTask([&]() {
-        std::forward_list<int> units;
-        std::forward_list<std::pair<int, int>> binaries;
-        std::map<std::pair<int, int>, std::forward_list<std::vector<int>>> lenLbdToList;
+        AdaptiveClauseDatabase::Setup cdbSetup;
+        cdbSetup.maxClauseLength = setup.strictClauseLengthLimit;
+        cdbSetup.maxLbdPartitionedSize = 2;
+        cdbSetup.numLiterals = 100'000;
+        AdaptiveClauseDatabase produced(cdbSetup);
 
         float startTime = Timer::elapsedSeconds();
         float lastImport = startTime;
 
         auto pushClauses = [&]() {
             LOG(V2_INFO, "Adding clauses to import buffer\n");
-            int budget, remaining, nbAdded = 0;
-            
-            budget = importBuffer.getLiteralBudget(1, 1); remaining = budget;
-            units.remove_if([&](int i) {
-                if (remaining == 0) return true;
-                remaining--;
-                nbAdded++;
-                return false;
-            });
-            importBuffer.performImport(1, 1, units, budget-remaining);
-
-            budget = importBuffer.getLiteralBudget(2, 2); remaining = budget;
-            binaries.remove_if([&](const auto& pair) {
-                if (remaining < 2) return true;
-                remaining -= 2;
-                nbAdded++;
-                return false;
-            });
-            importBuffer.performImport(2, 2, binaries, budget-remaining);
-
-            for (auto& entry : lenLbdToList) {
-                auto [len, lbd] = entry.first;
-                auto& list = entry.second;
-                budget = importBuffer.getLiteralBudget(len, lbd); remaining = budget;
-                list.remove_if([&](const auto& pair) {
-                    if (remaining < len) return true;
-                    remaining -= len;
-                    nbAdded++;
-                    return false;
-                });
-                importBuffer.performImport(len, lbd, list, budget-remaining);
+            int nbAdded = 0;
+            auto buf = produced.exportBuffer(importBuffer.getFreeLiteralBudget(), nbAdded);
+            auto shared = std::make_shared<const SharedClauseBuffer>(buf.data(), buf.size(), 
+                cdbSetup.maxClauseLength, cdbSetup.slotsForSumOfLengthAndLbd);
+            SkipMask skipMask;
+            int nbLiterals = 0;
+            auto reader = shared->getReader();
+            size_t clauseIdx = 0;
+            for (auto c = reader.getNextIncomingClause(); c.begin != nullptr; c = reader.getNextIncomingClause()) {
+                skipMask.append(clauseIdx++, false);
+                nbLiterals += c.size;
             }
+            assert(clauseIdx == nbAdded);
+            importBuffer.addSharedBuffer(std::move(shared), std::move(skipMask), nbLiterals);
 
             lastImport = Timer::elapsedSeconds();
             LOG(V2_INFO, "Added %i clauses to import buffer\n", nbAdded);
@@ -102,17 +87,8 @@ void testConcurrentImport() {
         while (Timer::elapsedSeconds() - startTime <= 60 && !Terminator::isTerminating()) {
 
             auto cls = generateClause(1, setup.strictClauseLengthLimit);
-            if (cls.size == 1) {
-                units.push_front(cls.begin[0]);
-            } else if (cls.size == 2) {
-                binaries.emplace_front(cls.begin[0], cls.begin[1]);
-            } else {
-                std::vector<int> clauseVec(1+cls.size);
-                clauseVec[0] = cls.lbd;
-                for (size_t k = 0; k < cls.size; k++) clauseVec[k+1] = cls.begin[k];
-                lenLbdToList[std::pair<int, int>(cls.size, cls.lbd)].emplace_front(std::move(clauseVec));
-            }
-            nbTotalAdded++;
+            if (produced.addClause(cls)) nbTotalAdded++;
+            free(cls.begin);
             usleep(1000 * 1); // 1 millis
 
             if (Timer::elapsedSeconds() - lastImport >= 1) {
@@ -144,6 +120,90 @@ void testConcurrentImport() {
     LOG(V2_INFO, "%i produced, %i digested\n", nbTotalAdded, nbTotalDigested);
 }
 
+void testSharedBufferImport() {
+
+    SolverSetup setup;
+    setup.strictClauseLengthLimit = 20;
+	setup.strictLbdLimit = 20;
+	setup.clauseBaseBufferSize = 1500;
+	setup.anticipatedLitsToImportPerCycle = 20000;
+	setup.solverRevision = 0;
+	setup.minNumChunksPerSolver = 100;
+	setup.numBufferedClsGenerations = 4;
+
+    // Create a flat buffer of random clauses
+    AdaptiveClauseDatabase::Setup cdbSetup;
+    cdbSetup.maxClauseLength = setup.strictClauseLengthLimit;
+    cdbSetup.maxLbdPartitionedSize = 2;
+    cdbSetup.numLiterals = 100'000;
+    AdaptiveClauseDatabase cdb(cdbSetup);
+    for (int i = 0; i < 10'000; i++) {
+        auto c = generateClause(1, setup.strictClauseLengthLimit);
+        cdb.addClause(c);
+        free(c.begin);
+    }
+    int numExported;
+    auto buf = cdb.exportBuffer(-1, numExported);
+    auto shared = std::make_shared<const SharedClauseBuffer>(buf.data(), buf.size(), 
+        cdbSetup.maxClauseLength, cdbSetup.slotsForSumOfLengthAndLbd);
+
+    // Two solvers, each skipping a random subset of the clauses
+    SolverStatistics stats[2];
+    std::vector<std::unique_ptr<ImportBuffer>> importBuffers;
+    std::vector<std::vector<std::vector<int>>> expected(2);
+    std::vector<SkipMask> skipMasks(2);
+    std::vector<int> nbLiterals(2, 0);
+    for (int s = 0; s < 2; s++) {
+        stats[s].histProduced = new ClauseHistogram(20);
+        stats[s].histDigested = new ClauseHistogram(20);
+        importBuffers.emplace_back(new ImportBuffer(setup, stats[s]));
+    }
+    auto reader = shared->getReader();
+    size_t clauseIdx = 0;
+    for (auto c = reader.getNextIncomingClause(); c.begin != nullptr; c = reader.getNextIncomingClause()) {
+        for (int s = 0; s < 2; s++) {
+            bool skip = Random::rand() < 0.3;
+            skipMasks[s].append(clauseIdx, skip);
+            if (skip) continue;
+            nbLiterals[s] += c.size;
+            std::vector<int> lits(c.begin, c.begin+c.size);
+            lits.push_back(-c.lbd);
+            expected[s].push_back(std::move(lits));
+        }
+        clauseIdx++;
+    }
+    assert(clauseIdx == numExported);
+    int budgetBefore = importBuffers[0]->getFreeLiteralBudget();
+    for (int s = 0; s < 2; s++) {
+        importBuffers[s]->addSharedBuffer(shared, std::move(skipMasks[s]), nbLiterals[s]);
+        assert(!importBuffers[s]->empty());
+    }
+    assert(importBuffers[0]->getFreeLiteralBudget() == budgetBefore - nbLiterals[0]);
+
+    // Solver 0 fetches all clauses at once, solver 1 fetches non-units first
+    std::vector<std::vector<std::vector<int>>> received(2);
+    for (int s = 0; s < 2; s++) {
+        auto& importBuffer = *importBuffers[s];
+        auto mode = s == 0 ? AdaptiveClauseDatabase::ANY : AdaptiveClauseDatabase::NONUNITS;
+        auto cls = importBuffer.get(mode);
+        while (cls.begin != nullptr) {
+            std::vector<int> lits(cls.begin, cls.begin+cls.size);
+            lits.push_back(-cls.lbd);
+            received[s].push_back(std::move(lits));
+            cls = importBuffer.get(mode);
+        }
+        for (int unit : importBuffer.getUnitsBuffer()) received[s].push_back({unit, -1});
+        assert(importBuffer.empty());
+        assert(importBuffer.getFreeLiteralBudget() == budgetBefore);
+        assert(stats[s].receivedClausesDigested == expected[s].size());
+
+        std::sort(expected[s].begin(), expected[s].end());
+        std::sort(received[s].begin(), received[s].end());
+        assert(received[s] == expected[s]);
+        LOG(V2_INFO, "Solver %i imported %lu/%i clauses from shared buffer\n", s, received[s].size(), numExported);
+    }
+}
+
 int main() {
     Timer::init();
     Random::init(rand(), rand());
@@ -151,5 +211,6 @@ int main() {
     Process::init(0);
     ProcessWideThreadPool::init(4);
     
+    testSharedBufferImport();
     testConcurrentImport();
 }
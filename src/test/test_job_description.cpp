@@ -3,11 +3,15 @@
 #include "util/assert.hpp"
 #include <vector>
 #include <string>
+#include <cstring>
 
 #include "util/random.hpp"
 #include "util/sat_reader.hpp"
 #include "util/logger.hpp"
 #include "util/sys/timer.hpp"
+#include "util/sys/proc.hpp"
+#include "data/host_description_store.hpp"
+#include "data/description_codec.hpp"
 
 void testSatInstances() {
 
@@ -83,12 +87,250 @@ void testIncrementalExample() {
     }
 }
 
+void testWritingEquivalence() {
+
+    // Random payload
+    std::vector<int> lits, asmpt;
+    for (int c = 0; c < 100000; c++) {
+        int len = 1 + (int) (Random::rand() * 10);
+        for (int i = 0; i < len; i++) lits.push_back((Random::rand() < 0.5 ? -1 : 1) * (1 + (int) (Random::rand() * 1000)));
+        lits.push_back(0);
+    }
+    for (int i = 0; i < 100; i++) asmpt.push_back(1 + (int) (Random::rand() * 1000));
+
+    auto setup = [&](JobDescription& desc) {
+        desc.setNumVars(1000);
+        desc.beginInitialization(0);
+    };
+
+    // Per-literal writing
+    JobDescription d1(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+    setup(d1);
+    float time = Timer::elapsedSeconds();
+    for (int lit : lits) d1.addLiteral(lit);
+    for (int lit : asmpt) d1.addAssumption(lit);
+    d1.endInitialization();
+    time = Timer::elapsedSeconds() - time;
+    LOG(V2_INFO, "Per-literal writing of %lu lits: %.4fs\n", lits.size()+asmpt.size(), time);
+
+    // Bulk writing
+    JobDescription d2(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+    setup(d2);
+    d2.addLiterals(lits.data(), lits.size()/2);
+    int* out = d2.appendPayload(lits.size() - lits.size()/2, 0);
+    memcpy(out, lits.data() + lits.size()/2, (lits.size() - lits.size()/2) * sizeof(int));
+    d2.addToChecksum(out, lits.size() - lits.size()/2, 0);
+    d2.addAssumptions(asmpt.data(), asmpt.size());
+    d2.endInitialization();
+
+    // Preloaded literals (as from the JSON API)
+    JobDescription d3(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+    d3.setPreloadedLiterals(std::vector<int>(lits));
+    d3.setPreloadedAssumptions(std::vector<int>(asmpt));
+    setup(d3);
+    d3.endInitialization();
+
+    // All serializations must be identical and without excess space
+    auto s1 = d1.getSerialization(0);
+    auto s2 = d2.getSerialization(0);
+    auto s3 = d3.getSerialization(0);
+    assert(s1->size() == d1.getMetadataSize() + sizeof(int) * (lits.size() + asmpt.size()));
+    assert(*s1 == *s2);
+    assert(*s1 == *s3);
+    assert(d1.getChecksum().get() == d2.getChecksum().get());
+    assert(d1.getChecksum().get() == d3.getChecksum().get());
+
+    // Deserialized description must contain the original payload
+    JobDescription imported(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+    imported.deserialize(d1.getSerialization(0));
+    assert(imported.getFormulaPayloadSize(0) == lits.size());
+    assert(imported.getAssumptionsSize(0) == asmpt.size());
+    assert(memcmp(imported.getFormulaPayload(0), lits.data(), lits.size()*sizeof(int)) == 0);
+    assert(memcmp(imported.getAssumptionsPayload(0), asmpt.data(), asmpt.size()*sizeof(int)) == 0);
+}
+
+void testHostSharedRevision() {
+
+    JobDescription desc(7, 1, JobDescription::Application::ONESHOT_SAT, true);
+    desc.setNumVars(3);
+    desc.beginInitialization(0);
+    std::vector<int> lits {1, -2, 0, 2, 3, 0, -1, -3, 0};
+    desc.addLiterals(lits.data(), lits.size());
+    desc.addAssumption(3);
+    desc.endInitialization();
+    auto serialization = desc.getSerialization(0);
+
+    // Publish revision for this host
+    HostDescriptionStore store(Proc::getPid());
+    auto published = store.publish(7, 0, serialization->data(), serialization->size(), desc.getChecksum());
+    assert(published);
+    assert(JobDescription::computeChecksum(published->data()).get() == desc.getChecksum().get());
+    {
+        // Map revision as a co-located worker
+        HostDescriptionStore colocatedStore(Proc::getPid());
+        auto attached = colocatedStore.attach(7, 0);
+        assert(attached);
+        assert(attached->getChecksum().get() == desc.getChecksum().get());
+        assert(colocatedStore.attach(7, 1) == nullptr);
+
+        JobDescription mapped;
+        mapped.deserialize(attached);
+        assert(mapped.getId() == 7);
+        assert(mapped.getFormulaPayloadSize(0) == lits.size());
+        assert(mapped.getAssumptionsSize(0) == 1);
+        assert(mapped.getAssumptionsPayload(0)[0] == 3);
+        assert(memcmp(mapped.getFormulaPayload(0), lits.data(), lits.size()*sizeof(int)) == 0);
+        assert(mapped.getHostSegment(0) == attached);
+        // Serialization for the network is an identical copy
+        assert(*mapped.getSerialization(0) == *serialization);
+
+        // Publishing the same revision again attaches the existing segment
+        auto republished = colocatedStore.publish(7, 0, serialization->data(), serialization->size(), desc.getChecksum());
+        assert(republished);
+        assert(republished->data() != published->data());
+        assert(memcmp(republished->data(), published->data(), published->size()) == 0);
+    }
+
+    // Segment is removed with the last reference
+    auto id = published->getId();
+    assert(HostDescriptionStore::map(id));
+    published.reset();
+    assert(store.attach(7, 0) == nullptr);
+    assert(HostDescriptionStore::map(id) == nullptr);
+}
+
+void testDescriptionCodec() {
+
+    auto roundTrip = [&](JobDescription& desc, DescriptionCodec::Encoding encoding) {
+        auto raw = desc.getSerialization(0);
+        float time = Timer::elapsedSeconds();
+        auto encoded = DescriptionCodec::encode(raw->data(), desc.getMetadataSize(),
+            desc.getFormulaPayloadSize(0), desc.getAssumptionsSize(0), encoding);
+        float encodeTime = Timer::elapsedSeconds() - time;
+        time = Timer::elapsedSeconds();
+        auto decoded = DescriptionCodec::decode(encoded);
+        float decodeTime = Timer::elapsedSeconds() - time;
+        assert(decoded);
+        assert(*decoded == *raw);
+        LOG(V2_INFO, "Encoding %i: %lu -> %lu bytes (ratio %.3f), encoded in %.4fs, decoded in %.4fs\n", 
+            encoding, raw->size(), encoded.size(), (float)encoded.size() / raw->size(), encodeTime, decodeTime);
+
+        // Truncated messages must be rejected
+        encoded.resize(encoded.size()-1);
+        assert(!DescriptionCodec::decode(encoded));
+    };
+
+    // Random CNF with large variable indices and an unterminated trailing clause
+    {
+        JobDescription desc(1, 1, JobDescription::Application::ONESHOT_SAT);
+        desc.setNumVars(INT32_MAX);
+        desc.beginInitialization(0);
+        for (int c = 0; c < 10000; c++) {
+            int len = (int) (Random::rand() * 8);
+            for (int i = 0; i < len; i++) desc.addLiteral((Random::rand() < 0.5 ? -1 : 1) * (1 + (int) (Random::rand() * (INT32_MAX-1))));
+            desc.addLiteral(0);
+        }
+        desc.addLiteral(INT32_MIN); desc.addLiteral(0); // extreme value must survive as well
+        desc.addLiteral(-5); desc.addLiteral(INT32_MAX);
+        for (int i = 0; i < 10; i++) desc.addAssumption(-1 - (int) (Random::rand() * 1000));
+        desc.endInitialization();
+        roundTrip(desc, DescriptionCodec::VARINT);
+        if (DescriptionCodec::isSupported(DescriptionCodec::VARINT_ZSTD))
+            roundTrip(desc, DescriptionCodec::VARINT_ZSTD);
+    }
+
+    // CNF with local structure (as in most application instances)
+    {
+        JobDescription desc(1, 1, JobDescription::Application::ONESHOT_SAT);
+        desc.setNumVars(1000000);
+        desc.beginInitialization(0);
+        for (int c = 0; c < 1000000; c++) {
+            int var = 1 + (int) (Random::rand() * 999990);
+            int len = 2 + (int) (Random::rand() * 3);
+            for (int i = 0; i < len; i++) desc.addLiteral((Random::rand() < 0.5 ? -1 : 1) * (var + i));
+            desc.addLiteral(0);
+        }
+        desc.endInitialization();
+        roundTrip(desc, DescriptionCodec::VARINT);
+        if (DescriptionCodec::isSupported(DescriptionCodec::VARINT_ZSTD))
+            roundTrip(desc, DescriptionCodec::VARINT_ZSTD);
+    }
+}
+
+void testRevisionRange() {
+
+    // Incremental job with several revisions, each with new clauses and assumptions
+    JobDescription desc(1, 1, JobDescription::Application::INCREMENTAL_SAT, true);
+    desc.setNumVars(100);
+    const int numRevisions = 5;
+    for (int rev = 0; rev < numRevisions; rev++) {
+        desc.beginInitialization(rev);
+        for (int c = 0; c < 50*(rev+1); c++) {
+            for (int i = 0; i < 3; i++) desc.addLiteral((Random::rand() < 0.5 ? -1 : 1) * (1 + (int) (Random::rand() * 100)));
+            desc.addLiteral(0);
+        }
+        for (int i = 0; i < rev+1; i++) desc.addAssumption(-1-i);
+        desc.endInitialization();
+    }
+
+    // Checksums are cumulative over the revisions
+    for (int rev = 1; rev < numRevisions; rev++) {
+        auto base = JobDescription::readChecksum(desc.getRevisionBytes(rev-1));
+        assert(JobDescription::computeChecksum(desc.getRevisionBytes(rev), base).get() 
+            == JobDescription::readChecksum(desc.getRevisionBytes(rev)).get());
+    }
+
+    // Catch-up transfer of a range of revisions is lossless
+    size_t rawSize = 0;
+    for (int rev = 1; rev < numRevisions; rev++) rawSize += desc.getTransferSize(rev);
+    auto packed = desc.serializeRevisionRange(1, numRevisions-1, /*dropPastAssumptions=*/false);
+    LOG(V2_INFO, "Revisions [1,%i]: %lu bytes as single revisions, %lu bytes as range\n", 
+        numRevisions-1, rawSize, packed->size());
+    auto revisions = JobDescription::deserializeRevisionRange(*packed);
+    assert(revisions.size() == numRevisions-1);
+    for (int rev = 1; rev < numRevisions; rev++) {
+        assert(*revisions[rev-1] == *desc.getSerialization(rev));
+    }
+
+    // Past assumptions can be dropped
+    packed = desc.serializeRevisionRange(0, numRevisions-1, /*dropPastAssumptions=*/true);
+    revisions = JobDescription::deserializeRevisionRange(*packed);
+    assert(revisions.size() == numRevisions);
+    JobDescription imported;
+    for (auto& revData : revisions) imported.deserialize(revData);
+    assert(imported.getRevision() == numRevisions-1);
+    assert(imported.getMaxConsecutiveRevision() == numRevisions-1);
+    for (int rev = 0; rev < numRevisions; rev++) {
+        assert(imported.getFormulaPayloadSize(rev) == desc.getFormulaPayloadSize(rev));
+        assert(memcmp(imported.getFormulaPayload(rev), desc.getFormulaPayload(rev), 
+            sizeof(int) * desc.getFormulaPayloadSize(rev)) == 0);
+        assert(imported.getAssumptionsSize(rev) == (rev+1 == numRevisions ? desc.getAssumptionsSize(rev) : 0));
+    }
+    assert(memcmp(imported.getAssumptionsPayload(numRevisions-1), desc.getAssumptionsPayload(numRevisions-1), 
+        sizeof(int) * desc.getAssumptionsSize(numRevisions-1)) == 0);
+    // ... in which case the checksums match the dropped payloads
+    for (int rev = 0; rev < numRevisions; rev++) {
+        auto base = rev == 0 ? Checksum() : JobDescription::readChecksum(imported.getRevisionBytes(rev-1));
+        assert(JobDescription::computeChecksum(imported.getRevisionBytes(rev), base).get() 
+            == JobDescription::readChecksum(imported.getRevisionBytes(rev)).get());
+    }
+    assert(imported.getChecksum().get() != desc.getChecksum().get());
+
+    // Malformed messages are rejected
+    packed->resize(packed->size()-1);
+    assert(JobDescription::deserializeRevisionRange(*packed).empty());
+}
+
 int main() {
 
     Timer::init();
     Random::init(rand(), rand());
     Logger::init(0, V5_DEBG, false, false, false, nullptr);
 
+    testWritingEquivalence();
+    testHostSharedRevision();
+    testDescriptionCodec();
+    testRevisionRange();
     testSatInstances();
     testIncrementalExample();
 }
\ No newline at end of file
@@ -3,14 +3,19 @@
 #include "util/assert.hpp"
 #include <vector>
 #include <string>
+#include <cstring>
+#include <thread>
+#include <list>
 
 #include "util/random.hpp"
 #include "util/sat_reader.hpp"
 #include "util/logger.hpp"
 #include "util/sys/timer.hpp"
 #include "comm/mympi.hpp"
+#include "comm/buffer_pool.hpp"
 #include "util/params.hpp"
 #include "data/job_transfer.hpp"
+#include "comm/description_streamer.hpp"
 
 const int TAG_INT_VEC = 111;
 const int TAG_ACK = 112;
@@ -86,6 +91,368 @@ void testSimpleP2P() {
     while (!Terminator::isTerminating()) q.advance();
 }
 
+void testReceiveBurst() {
+
+    Terminator::reset();
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    if (size < 2) return;
+    auto& q = MyMpi::getMessageQueue();
+    q.clearCallbacks();
+
+    // Both ranks send a burst of numbered messages to each other. Every 100th 
+    // message is large enough for its receive buffer to be handed over.
+    const int numMessages = 5000;
+    int numReceived = 0;
+    bool exitReceived = false;
+    q.registerCallback(TAG_INT_VEC, [&](MessageHandle& h) {
+        auto vec = Serializable::get<IntVec>(h.getRecvData()).data;
+        assert(vec[0] == numReceived || LOG_RETURN_FALSE("Message %i overtaken by %i\n", numReceived, vec[0]));
+        assert(vec.size() == (vec[0] % 100 == 0 ? 150000 : 4));
+        numReceived++;
+    });
+    q.registerCallback(TAG_EXIT, [&](MessageHandle& h) {
+        exitReceived = true;
+    });
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank < 2) {
+        for (int i = 0; i < numMessages; i++) {
+            IntVec vec;
+            vec.data.resize(i % 100 == 0 ? 150000 : 4, i);
+            MyMpi::isend(1-rank, TAG_INT_VEC, vec);
+        }
+    }
+
+    bool exitSent = false;
+    while (rank < 2 && !exitReceived) {
+        q.advance();
+        if (numReceived == numMessages && !exitSent) {
+            MyMpi::isend(1-rank, TAG_EXIT, IntVec());
+            exitSent = true;
+        }
+    }
+    q.logStatistics();
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void testCancelledTransfer() {
+
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    if (size < 2) return;
+    auto& q = MyMpi::getMessageQueue();
+    q.clearCallbacks();
+
+    // Rank 0 cancels a large message right after sending it and then sends 
+    // another large message, which must arrive intact.
+    const int cancelledSize = 5000000;
+    const int deliveredSize = 3000001;
+    bool done = false;
+    q.registerCallback(TAG_PINGPONG, [&](MessageHandle& h) {
+        assert(false || LOG_RETURN_FALSE("Cancelled message was received\n"));
+    });
+    q.registerCallback(TAG_INT_VEC, [&](MessageHandle& h) {
+        auto vec = Serializable::get<IntVec>(h.getRecvData()).data;
+        assert(vec.size() == deliveredSize);
+        for (size_t i = 0; i < vec.size(); i++) assert(vec[i] == i);
+        MyMpi::isend(h.source, TAG_ACK, IntVec());
+        done = true;
+    });
+    q.registerCallback(TAG_ACK, [&](MessageHandle& h) {
+        done = true;
+    });
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) {
+        IntVec cancelled;
+        cancelled.data.resize(cancelledSize, 1);
+        int id = MyMpi::isend(1, TAG_PINGPONG, cancelled);
+        q.cancelSend(id);
+        IntVec delivered;
+        for (int i = 0; i < deliveredSize; i++) delivered.data.push_back(i);
+        MyMpi::isend(1, TAG_INT_VEC, delivered);
+    }
+    while (rank < 2 && !done) q.advance();
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void testSendPriorities() {
+
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    if (size < 2) return;
+    auto& q = MyMpi::getMessageQueue();
+    q.clearCallbacks();
+
+    // Rank 0 enqueues many large messages and then a control message, 
+    // which must not wait for the large messages.
+    const int numBulk = 40;
+    const int bulkSize = 1000000;
+    int numBulkReceived = 0;
+    int numBulkReceivedBeforeControl = -1;
+    q.registerCallback(TAG_INT_VEC, [&](MessageHandle& h) {
+        numBulkReceived++;
+        if (numBulkReceived == numBulk) MyMpi::isend(h.source, TAG_ACK, IntVec());
+    });
+    q.registerCallback(MSG_REQUEST_NODE, [&](MessageHandle& h) {
+        numBulkReceivedBeforeControl = numBulkReceived;
+    });
+    bool done = false;
+    q.registerCallback(TAG_ACK, [&](MessageHandle& h) {
+        done = true;
+    });
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) {
+        IntVec bulk;
+        bulk.data.resize(bulkSize, 1);
+        for (int i = 0; i < numBulk; i++) MyMpi::isend(1, TAG_INT_VEC, bulk);
+        MyMpi::isend(1, MSG_REQUEST_NODE, IntVec());
+    }
+    while (rank < 2 && !done && numBulkReceived < numBulk) q.advance();
+    if (rank == 1) {
+        LOG(V2_INFO, "Control message overtook %i/%i large messages\n", 
+            numBulk-numBulkReceivedBeforeControl, numBulk);
+        assert(numBulkReceivedBeforeControl >= 0 && numBulkReceivedBeforeControl < numBulk/2);
+    }
+    q.logStatistics();
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void testSendOrderAcrossClasses() {
+
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    if (size < 2) return;
+    auto& q = MyMpi::getMessageQueue();
+    q.clearCallbacks();
+
+    // Rank 0 enqueues more unfragmented default messages than there are 
+    // send slots and then a control message to the same destination, 
+    // which must not overtake them.
+    const int numDefault = 64;
+    const int defaultSize = 100000;
+    int numDefaultReceived = 0;
+    bool done = false;
+    q.registerCallback(TAG_INT_VEC, [&](MessageHandle& h) {
+        auto vec = Serializable::get<IntVec>(h.getRecvData()).data;
+        assert(vec[0] == numDefaultReceived);
+        numDefaultReceived++;
+    });
+    q.registerCallback(MSG_REQUEST_NODE, [&](MessageHandle& h) {
+        assert(numDefaultReceived == numDefault || LOG_RETURN_FALSE("Control message overtook %i/%i messages\n", 
+            numDefault-numDefaultReceived, numDefault));
+        MyMpi::isend(h.source, TAG_ACK, IntVec());
+        done = true;
+    });
+    q.registerCallback(TAG_ACK, [&](MessageHandle& h) {
+        done = true;
+    });
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) {
+        IntVec vec;
+        for (int i = 0; i < numDefault; i++) {
+            vec.data.assign(defaultSize, i);
+            MyMpi::isend(1, TAG_INT_VEC, vec);
+        }
+        MyMpi::isend(1, MSG_REQUEST_NODE, IntVec());
+    }
+    while (rank < 2 && !done) q.advance();
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void testCoalescing() {
+
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    if (size < 2) return;
+    auto& q = MyMpi::getMessageQueue();
+    q.clearCallbacks();
+    q.setMessageCoalescing(64, 0);
+
+    // Both ranks send numbered messages to each other, most of which are small 
+    // enough to be coalesced. Messages must arrive in order.
+    const int numMessages = 2000;
+    int numReceived = 0;
+    int numSent = 0;
+    bool exitReceived = false;
+    q.registerCallback(TAG_INT_VEC, [&](MessageHandle& h) {
+        auto vec = Serializable::get<IntVec>(h.getRecvData()).data;
+        assert(vec[0] == numReceived || LOG_RETURN_FALSE("Message %i overtaken by %i\n", numReceived, vec[0]));
+        assert(vec.size() == (vec[0] % 50 == 0 ? 100 : 2));
+        numReceived++;
+    });
+    q.registerSentCallback(TAG_INT_VEC, [&](int id) {
+        numSent++;
+    });
+    q.registerCallback(TAG_EXIT, [&](MessageHandle& h) {
+        exitReceived = true;
+    });
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    bool exitSent = false;
+    int numIssued = 0;
+    while (rank < 2 && !(exitReceived && exitSent)) {
+        // Issue messages over several cycles
+        for (int i = 0; i < 10 && numIssued < numMessages; i++) {
+            IntVec vec;
+            vec.data.resize(numIssued % 50 == 0 ? 100 : 2, numIssued);
+            MyMpi::isend(1-rank, TAG_INT_VEC, vec);
+            numIssued++;
+        }
+        q.advance();
+        if (numReceived == numMessages && numSent == numMessages && !exitSent) {
+            MyMpi::isend(1-rank, TAG_EXIT, IntVec());
+            exitSent = true;
+        }
+    }
+    q.logStatistics();
+    q.setMessageCoalescing(0, 0);
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void testCoalescingOrderAndCancel() {
+
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    if (size < 2) return;
+    auto& q = MyMpi::getMessageQueue();
+    q.clearCallbacks();
+    q.setMessageCoalescing(64, 1000000);
+
+    // Rank 0 occupies all send slots, coalesces small messages, cancels the 
+    // last of them, and then sends a control message too large to be coalesced.
+    // The control message must not overtake the flushed envelope.
+    const int numDefault = 32;
+    const int numSmall = 5;
+    const int numKept = 2;
+    int numDefaultReceived = 0;
+    std::vector<int> smallReceived;
+    bool done = false;
+    // Like a job tree, rank 0 cancels its sends by iterating over their IDs,
+    // which the send-done callback removes
+    std::list<int> sendIdsToCancel;
+    bool cancelling = false;
+    int numSmallCompleted = 0;
+    q.registerSentCallback(TAG_PINGPONG, [&](int id) {
+        assert(!cancelling);
+        sendIdsToCancel.remove(id);
+        numSmallCompleted++;
+    });
+    q.registerCallback(TAG_INT_VEC, [&](MessageHandle& h) {
+        numDefaultReceived++;
+    });
+    q.registerCallback(TAG_PINGPONG, [&](MessageHandle& h) {
+        smallReceived.push_back(Serializable::get<IntVec>(h.getRecvData()).data[0]);
+    });
+    q.registerCallback(MSG_REQUEST_NODE, [&](MessageHandle& h) {
+        assert(numDefaultReceived == numDefault);
+        assert(smallReceived.size() == numKept || LOG_RETURN_FALSE("%i/%i small messages before control message\n", 
+            smallReceived.size(), numKept));
+        for (int i = 0; i < numKept; i++) assert(smallReceived[i] == i);
+        // (too large to be coalesced)
+        MyMpi::isend(h.source, TAG_ACK, Serializable::get<IntVec>(h.getRecvData()));
+        done = true;
+    });
+    q.registerCallback(TAG_ACK, [&](MessageHandle& h) {
+        done = true;
+    });
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) {
+        IntVec vec;
+        vec.data.resize(100000, 1);
+        for (int i = 0; i < numDefault; i++) MyMpi::isend(1, TAG_INT_VEC, vec);
+        for (int i = 0; i < numSmall; i++) {
+            int id = MyMpi::isend(1, TAG_PINGPONG, IntVec({i}));
+            if (i >= numKept) sendIdsToCancel.push_back(id);
+        }
+        cancelling = true;
+        for (int id : sendIdsToCancel) q.cancelSend(id);
+        cancelling = false;
+        vec.data.resize(100);
+        MyMpi::isend(1, MSG_REQUEST_NODE, vec);
+    }
+    while (rank < 2 && !done) q.advance();
+    if (rank == 0) assert(numSmallCompleted == numSmall && sendIdsToCancel.empty());
+    q.setMessageCoalescing(0, 0);
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void testBufferPool() {
+
+    // A recycled buffer is zero-filled again by get(), but not by getUninitialized()
+    auto buffer = BufferPool::get(1000);
+    memset(buffer.data(), 0xff, buffer.size());
+    BufferPool::recycle(std::move(buffer));
+    buffer = BufferPool::get(1000);
+    for (uint8_t byte : buffer) assert(byte == 0);
+    memset(buffer.data(), 0xff, buffer.size());
+    BufferPool::recycle(std::move(buffer));
+    buffer = BufferPool::getUninitialized(600);
+    assert(buffer.size() == 600 && buffer.capacity() >= 1000 && buffer[0] == 0xff);
+    BufferPool::recycle(std::move(buffer));
+
+    // A thread which never draws from its pool does not cache buffers recycled by it
+    buffer = BufferPool::get(1000);
+    std::thread([&]() {
+        BufferPool::recycle(std::move(buffer));
+        auto stats = BufferPool::getAndResetStats();
+        assert(stats.cachedBytes == 0 && stats.recycled == 0 && stats.discarded == 1);
+    }).join();
+
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    if (size < 2) return;
+    auto& q = MyMpi::getMessageQueue();
+
+    // Both ranks exchange many messages of various small sizes, 
+    // once with and once without pooled message buffers.
+    const int numMessages = 50000;
+    for (bool pooled : {false, true}) {
+        q.clearCallbacks();
+        BufferPool::setEnabled(pooled);
+        BufferPool::getAndResetStats();
+        int numReceived = 0;
+        bool exitReceived = false;
+        q.registerCallback(TAG_INT_VEC, [&](MessageHandle& h) {
+            auto vec = Serializable::get<IntVec>(h.getRecvData()).data;
+            assert(vec.size() == 1 + vec[0] % 300);
+            numReceived++;
+        });
+        q.registerCallback(TAG_EXIT, [&](MessageHandle& h) {
+            exitReceived = true;
+        });
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        float time = Timer::elapsedSeconds();
+        bool exitSent = false;
+        int numIssued = 0;
+        while (rank < 2 && !(exitReceived && exitSent)) {
+            for (int i = 0; i < 10 && numIssued < numMessages; i++) {
+                IntVec vec;
+                vec.data.resize(1 + numIssued % 300, numIssued);
+                MyMpi::isend(1-rank, TAG_INT_VEC, vec);
+                numIssued++;
+            }
+            q.advance();
+            if (numReceived == numMessages && !exitSent) {
+                MyMpi::isend(1-rank, TAG_EXIT, IntVec());
+                exitSent = true;
+            }
+        }
+        time = Timer::elapsedSeconds() - time;
+        auto stats = BufferPool::getAndResetStats();
+        double hitRate = stats.hits / (double) std::max(1UL, stats.hits + stats.misses);
+        LOG(V2_INFO, "pooled=%i: %i messages in %.4fs (%.1f msgs/s), pool hit rate %.4f\n", 
+            pooled, numMessages, time, numMessages / time, hitRate);
+        if (pooled && rank < 2) assert(hitRate > 0.9);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+}
+
 void testBigP2P() {
 
     Terminator::reset();
@@ -175,6 +542,67 @@ void testBigP2P() {
     LOG(V2_INFO, "Max delay: %.4f s\n", maxDelay);
 }
 
+void testDescriptionStreaming() {
+
+    Terminator::reset();
+    int rank = MyMpi::rank(MPI_COMM_WORLD);
+    int size = MyMpi::size(MPI_COMM_WORLD);
+    auto& q = MyMpi::getMessageQueue();
+    q.clearCallbacks();
+
+    // Stream a message along the chain of ranks 0 -> 1 -> ... -> size-1
+    // (or from rank 0 to itself if there is only one rank)
+    const int jobId = 1;
+    const int revision = 0;
+    const size_t msgSize = 10000000;
+    const int lastRank = size == 1 ? 0 : size-1;
+    DescriptionStreamer streamer(1 << 16, 4, [](int jobId, int dest) {return true;},
+        [](int jobId, int revision, int dest) {abort();});
+    bool relaying = false;
+    float startTime = 0;
+
+    q.registerSentCallback(MSG_SEND_JOB_DESCRIPTION_CHUNK, [&](int sendId) {
+        streamer.handleSent(sendId);
+    });
+    q.registerCallback(MSG_SEND_JOB_DESCRIPTION_CHUNK, [&](MessageHandle& h) {
+        auto completed = streamer.handleChunk(h.source, h.getRecvData());
+        if (!completed.data) {
+            // Relay the stream as soon as its first chunk arrives
+            if (!relaying && rank < lastRank) {
+                assert(streamer.isReceiving(jobId, revision));
+                relaying = streamer.relay(jobId, revision, rank+1);
+                assert(relaying);
+            }
+            return;
+        }
+        assert(completed.jobId == jobId);
+        assert(completed.revision == revision);
+        assert(completed.tag == TAG_INT_VEC);
+        assert(completed.data->size() == msgSize);
+        for (size_t i = 0; i < msgSize; i++) assert((*completed.data)[i] == (uint8_t) (i % 251));
+        LOG(V2_INFO, "Stream complete and verified, relayed %lu bytes\n", streamer.getNumRelayedBytes());
+        if (rank == lastRank) {
+            LOG(V2_INFO, "Streamed %lu bytes across %i hops in %.4fs\n", msgSize, 
+                std::max(1, size-1), Timer::elapsedSeconds() - startTime);
+            for (int r = 0; r < size; r++) MyMpi::isend(r, TAG_EXIT, IntVec());
+        }
+    });
+    q.registerCallback(TAG_EXIT, [&](MessageHandle& h) {
+        Terminator::setTerminating();
+    });
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    startTime = Timer::elapsedSeconds();
+    if (rank == 0) {
+        DataPtr msg(new std::vector<uint8_t>(msgSize));
+        for (size_t i = 0; i < msgSize; i++) (*msg)[i] = (uint8_t) (i % 251);
+        assert(streamer.isStreamed(msg->size()));
+        streamer.send(jobId, revision, size == 1 ? 0 : 1, TAG_INT_VEC, msg);
+    }
+
+    while (!Terminator::isTerminating()) q.advance();
+}
+
 int main(int argc, char *argv[]) {
 
     MyMpi::init();
@@ -192,6 +620,14 @@ int main(int argc, char *argv[]) {
 
     //testSelfMessages();
     //testSimpleP2P();
+    testDescriptionStreaming();
+    testReceiveBurst();
+    testCancelledTransfer();
+    testSendPriorities();
+    testSendOrderAcrossClasses();
+    testCoalescing();
+    testCoalescingOrderAndCancel();
+    testBufferPool();
     testBigP2P();
 
     MPI_Finalize();
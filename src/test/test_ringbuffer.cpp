@@ -295,6 +295,41 @@ void testRingBufferV2() {
         }
         for (int lit : out) LOG(V2_INFO, "%i\n", lit);
     }
+
+    {
+        // Concurrent producer and consumer; elements with a prefix of two integers
+        RingBufferV2 rb(/*size=*/100);
+        const int numElems = 100000;
+        std::thread producer([&]() {
+            std::vector<int> lits;
+            for (int i = 0; i < numElems; i++) {
+                int size = 1 + i % 10;
+                lits.resize(size);
+                for (int j = 0; j < size; j++) lits[j] = i+j;
+                const int prefix[2] = {size, i};
+                while (!rb.produceWithPrefix(prefix, 2, lits.data(), /*prodId=*/0, size+2, size))
+                    std::this_thread::yield();
+            }
+        });
+        std::vector<int> out;
+        int numConsumed = 0;
+        while (numConsumed < numElems) {
+            uint8_t size;
+            if (!rb.getNextHeaderByte(size)) {
+                std::this_thread::yield();
+                continue;
+            }
+            out.clear();
+            bool success = rb.consume(size+2, out);
+            assert(success);
+            assert(out.size() == 3+size);
+            assert(out[0] == size && out[1] == size && out[2] == numConsumed);
+            for (int j = 0; j < size; j++) assert(out[3+j] == numConsumed+j);
+            numConsumed++;
+        }
+        producer.join();
+        LOG(V2_INFO, "Transferred %i elements with prefix\n", numConsumed);
+    }
 }
 
 int main() {
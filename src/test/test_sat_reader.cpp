@@ -3,17 +3,197 @@
 #include "util/assert.hpp"
 #include <vector>
 #include <string>
+#include <thread>
 
 #include "util/random.hpp"
 #include "util/sat_reader.hpp"
 #include "util/logger.hpp"
 #include "util/sys/timer.hpp"
 
-int main() {
+void writeRandomCnf(const std::string& filename, int numVars, int numClauses) {
+    FILE* f = fopen(filename.c_str(), "w");
+    assert(f != nullptr);
+    fprintf(f, "c randomly generated test formula\np cnf %i %i\n", numVars, numClauses);
+    for (int c = 0; c < numClauses; c++) {
+        // Sprinkle in some unusual (yet valid) formatting
+        if (c % 1000 == 17) fprintf(f, "c comment line within the clauses, 1 2 3 0\n");
+        if (c % 5000 == 42) fprintf(f, "\n");
+        int len = 1 + (int) (Random::rand() * 12);
+        for (int i = 0; i < len; i++) {
+            int lit = 1 + (int) (Random::rand() * numVars);
+            if (Random::rand() < 0.5) lit = -lit;
+            fprintf(f, c % 3000 == 7 ? "%i  " : "%i ", lit);
+        }
+        fprintf(f, c % 2000 == 99 ? "0\r\n" : "0\n");
+    }
+    fprintf(f, "a 1 -2 3 0\n");
+    fclose(f);
+}
 
-    Timer::init();
-    Random::init(rand(), rand());
-    Logger::init(0, V5_DEBG, false, false, false, nullptr);
+int readFormula(const std::string& file, bool bulkParsing, JobDescription& desc, int numThreads = 1) {
+    SatReader r(file, SatReader::ContentMode::ASCII);
+    r.setBulkParsing(bulkParsing);
+    r.setNumThreads(numThreads);
+    bool success = r.read(desc);
+    assert(success);
+    return r.getMaxVar();
+}
+
+void testBulkParsingEquivalence() {
+
+    std::string generated = "/tmp/mallob_test_sat_reader_random.cnf";
+    writeRandomCnf(generated, 5000, 100000);
+
+    auto files = {"instances/r3sat_200.cnf", "instances/r3unsat_300.cnf", 
+        "instances/incremental/entertainment08-0.cnf", "instances/incremental/entertainment08-1.cnf",
+        generated.c_str()};
+    for (const auto& file : files) {
+        LOG(V2_INFO, "Checking equivalence of bulk parsing for %s ...\n", file);
+        JobDescription bulk(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+        readFormula(file, true, bulk);
+        JobDescription scalar(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+        readFormula(file, false, scalar);
+
+        assert(bulk.getNumFormulaLiterals() > 0);
+        assert(bulk.getNumFormulaLiterals() == scalar.getNumFormulaLiterals());
+        assert(bulk.getNumAssumptionLiterals() == scalar.getNumAssumptionLiterals());
+        assert(bulk.getAppConfiguration().map.at("__NC") == scalar.getAppConfiguration().map.at("__NC"));
+        assert(bulk.getChecksum().get() == scalar.getChecksum().get());
+        assert(*bulk.getSerialization(0) == *scalar.getSerialization(0));
+    }
+    remove(generated.c_str());
+}
+
+void testParallelParsingEquivalence() {
+
+    std::string generated = "/tmp/mallob_test_sat_reader_random.cnf";
+    writeRandomCnf(generated, 20000, 200000);
+
+    for (int numThreads : {2, 3, 4, 7}) {
+        LOG(V2_INFO, "Checking equivalence of parallel parsing with %i threads ...\n", numThreads);
+        JobDescription parallel(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+        int maxVarParallel = readFormula(generated, true, parallel, numThreads);
+        JobDescription sequential(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+        int maxVarSequential = readFormula(generated, true, sequential);
+
+        assert(maxVarParallel == maxVarSequential);
+        assert(parallel.getNumFormulaLiterals() == sequential.getNumFormulaLiterals());
+        assert(parallel.getNumAssumptionLiterals() == sequential.getNumAssumptionLiterals());
+        assert(parallel.getAppConfiguration().map.at("__NC") == sequential.getAppConfiguration().map.at("__NC"));
+        assert(parallel.getChecksum().get() == sequential.getChecksum().get());
+        assert(*parallel.getSerialization(0) == *sequential.getSerialization(0));
+    }
+    remove(generated.c_str());
+}
+
+void testInProcessDecompression() {
+
+    std::string generated = "/tmp/mallob_test_sat_reader_compressed.cnf";
+    writeRandomCnf(generated, 20000, 200000);
+    JobDescription plain(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+    readFormula(generated, true, plain);
+
+    std::vector<std::pair<std::string, std::string>> compressors {
+        {"xz -k -f ", ".xz"}, {"gzip -k -f ", ".gz"}, {"zstd -q -k -f ", ".zst"}
+    };
+    for (const auto& [command, ending] : compressors) {
+        auto file = generated + ending;
+        if (system((command + generated).c_str()) != 0) {
+            LOG(V2_INFO, "Cannot create %s - skipping\n", file.c_str());
+            continue;
+        }
+        auto format = StreamDecompressor::getFormat(file);
+        LOG(V2_INFO, "Reading %s %s ...\n", file.c_str(), StreamDecompressor::isSupported(format) ? 
+            "in-process" : "via external program");
+        JobDescription desc(1, 1, JobDescription::Application::ONESHOT_SAT, true);
+        float time = Timer::elapsedSeconds();
+        readFormula(file, true, desc);
+        time = Timer::elapsedSeconds() - time;
+        LOG(V2_INFO, " - done, took %.3fs (decompression %.3fs, tokenization %.3fs)\n", time, 
+            desc.getStatistics().decompressionTime, desc.getStatistics().tokenizationTime);
+
+        assert(desc.getAppConfiguration().map.at("__NC") == plain.getAppConfiguration().map.at("__NC"));
+        assert(desc.getChecksum().get() == plain.getChecksum().get());
+        assert(*desc.getSerialization(0) == *plain.getSerialization(0));
+        remove(file.c_str());
+    }
+    remove(generated.c_str());
+}
+
+void testFormulaCache() {
+
+    std::string cacheDir = "/tmp/mallob_test_formula_cache";
+    std::string generated = "/tmp/mallob_test_sat_reader_cached.cnf";
+    writeRandomCnf(generated, 20000, 200000);
+
+    for (auto file : {generated, std::string("instances/incremental/entertainment08-0.cnf")}) {
+        SatReader r0(file, SatReader::ContentMode::ASCII);
+        JobDescription plain(1, 1, JobDescription::Application::INCREMENTAL_SAT, true);
+        r0.read(plain);
+
+        for (int i = 0; i < 2; i++) {
+            LOG(V2_INFO, "Reading %s with formula cache (%s) ...\n", file.c_str(), i == 0 ? "cold" : "warm");
+            SatReader r(file, SatReader::ContentMode::ASCII);
+            r.setCacheDirectory(cacheDir);
+            JobDescription desc(1, 1, JobDescription::Application::INCREMENTAL_SAT, true);
+            float time = Timer::elapsedSeconds();
+            bool success = r.read(desc);
+            time = Timer::elapsedSeconds() - time;
+            LOG(V2_INFO, " - done, took %.3fs\n", time);
+            assert(success);
+            assert(r.getMaxVar() == r0.getMaxVar());
+            assert(desc.getNumAssumptionLiterals() == plain.getNumAssumptionLiterals());
+            assert(desc.getAppConfiguration().map.at("__NC") == plain.getAppConfiguration().map.at("__NC"));
+            assert(desc.getChecksum().get() == plain.getChecksum().get());
+            assert(*desc.getSerialization(0) == *plain.getSerialization(0));
+        }
+    }
+
+    // A modified file must not be served from the cache
+    writeRandomCnf(generated, 100, 1000);
+    SatReader r0(generated, SatReader::ContentMode::ASCII);
+    JobDescription plain(1, 1, JobDescription::Application::ONESHOT_SAT);
+    r0.read(plain);
+    SatReader r(generated, SatReader::ContentMode::ASCII);
+    r.setCacheDirectory(cacheDir);
+    JobDescription desc(1, 1, JobDescription::Application::ONESHOT_SAT);
+    r.read(desc);
+    assert(*desc.getSerialization(0) == *plain.getSerialization(0));
+
+    remove(generated.c_str());
+    auto cmd = "rm -rf " + cacheDir;
+    int retval = system(cmd.c_str());
+    assert(retval == 0);
+}
+
+void benchmarkBulkParsing() {
+
+    std::string generated = "/tmp/mallob_test_sat_reader_bench.cnf";
+    writeRandomCnf(generated, 1000000, 4000000);
+    FILE* f = fopen(generated.c_str(), "r");
+    fseek(f, 0, SEEK_END);
+    double gigabytes = ftell(f) / 1e9;
+    fclose(f);
+
+    for (bool bulkParsing : {false, true}) {
+        float time = Timer::elapsedSeconds();
+        JobDescription desc(1, 1, JobDescription::Application::ONESHOT_SAT);
+        readFormula(generated, bulkParsing, desc);
+        time = Timer::elapsedSeconds() - time;
+        LOG(V2_INFO, "%s parsing: %.3f GB in %.3fs (%.3f GB/s)\n", bulkParsing ? "bulk" : "per-char",
+            gigabytes, time, gigabytes / time);
+    }
+    int numThreads = std::max(2U, std::thread::hardware_concurrency());
+    float time = Timer::elapsedSeconds();
+    JobDescription desc(1, 1, JobDescription::Application::ONESHOT_SAT);
+    readFormula(generated, true, desc, numThreads);
+    time = Timer::elapsedSeconds() - time;
+    LOG(V2_INFO, "bulk parsing with %i threads: %.3f GB in %.3fs (%.3f GB/s)\n", numThreads,
+        gigabytes, time, gigabytes / time);
+    remove(generated.c_str());
+}
+
+void testCompressedInstances() {
 
     auto files = {"Steiner-9-5-bce.cnf.xz", "uum12.smt2.cnf.xz", 
         "LED_round_29-32_faultAt_29_fault_injections_5_seed_1579630418.cnf.xz", "SAT_dat.k80.cnf.xz", "Timetable_C_497_E_62_Cl_33_S_30.cnf.xz", 
@@ -41,4 +221,18 @@ int main() {
 
         LOG(V2_INFO, " -- difference: %.3fs\n", time - time2);
     }
-}
\ No newline at end of file
+}
+
+int main() {
+
+    Timer::init();
+    Random::init(rand(), rand());
+    Logger::init(0, V5_DEBG, false, false, false, nullptr);
+
+    testBulkParsingEquivalence();
+    testParallelParsingEquivalence();
+    testInProcessDecompression();
+    testFormulaCache();
+    benchmarkBulkParsing();
+    testCompressedInstances();
+}
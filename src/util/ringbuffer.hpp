@@ -9,6 +9,7 @@
 #include "util/assert.hpp"
 #include <list>
 #include <atomic>
+#include <optional> // for SPSCRingBuffer::consume()
 
 #include "util/sys/threading.hpp"
 #include "util/logger.hpp"
@@ -136,6 +137,13 @@ public:
     // Otherwise, numIntegers must indicate the size of the provided data, and headerByte
     // can be any kind of data from which the user is able to decode back the element's size.
     bool produce(const int* data, int producerId, int numIntegers = -1, uint8_t headerByte = 0) {
+        return produceWithPrefix(nullptr, 0, data, producerId, numIntegers, headerByte);
+    }
+    // Like produce, but the element consists of prefixSize integers from prefix
+    // followed by numIntegers integers from data (numIntegers includes prefixSize).
+    // This allows to insert an element without assembling it in a separate buffer first.
+    bool produceWithPrefix(const int* prefix, int prefixSize, const int* data, int producerId, 
+            int numIntegers = -1, uint8_t headerByte = 0) {
         
         if (numIntegers == -1) {
             assert(_mode == OperationMode::UNIFORM_SIZE);
@@ -156,7 +164,11 @@ public:
             _data[offset] = headerByte;
             offset++;
         }
-        memcpy(_data+offset, data, numBytes);
+        if (prefixSize > 0) {
+            memcpy(_data+offset, prefix, sizeof(int)*prefixSize);
+            offset += sizeof(int)*prefixSize;
+        }
+        memcpy(_data+offset, data, numBytes - sizeof(int)*prefixSize);
         ringbuf_produce(_ringbuf, _producers[producerId]);
         return true;
     }
@@ -0,0 +1,135 @@
+
+#include "sat_formula_cache.hpp"
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdio>
+#include <functional>
+
+#include "data/checksum.hpp"
+#include "util/sys/fileutils.hpp"
+#include "util/sys/proc.hpp"
+#include "util/logger.hpp"
+
+#define SAT_FORMULA_CACHE_MAGIC "MLBCNF\0\0"
+#define SAT_FORMULA_CACHE_VERSION 1
+
+SatFormulaCache::SatFormulaCache(const std::string& directory, const std::string& sourceFile, int contentMode) :
+        _directory(directory), _content_mode(contentMode) {
+
+    // Identify the source file
+    char resolved[PATH_MAX];
+    if (realpath(sourceFile.c_str(), resolved) == nullptr) return;
+    _source_path = resolved;
+    struct stat s;
+    if (stat(resolved, &s) != 0 || !S_ISREG(s.st_mode)) return;
+
+    memset(&_source_info, 0, sizeof(Header));
+    memcpy(_source_info.magic, SAT_FORMULA_CACHE_MAGIC, sizeof(_source_info.magic));
+    _source_info.version = SAT_FORMULA_CACHE_VERSION;
+    _source_info.contentMode = _content_mode;
+    _source_info.sourceSize = s.st_size;
+    _source_info.sourceMtimeSec = s.st_mtim.tv_sec;
+    _source_info.sourceMtimeNsec = s.st_mtim.tv_nsec;
+    _source_info.pathLength = _source_path.size();
+    _valid_source = true;
+}
+
+std::string SatFormulaCache::getCacheFile() const {
+    std::string key = _source_path + ":" + std::to_string(_source_info.sourceMtimeSec)
+        + "." + std::to_string(_source_info.sourceMtimeNsec) + ":" + std::to_string(_source_info.sourceSize)
+        + ":" + std::to_string(_content_mode);
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016lx", (unsigned long) std::hash<std::string>()(key));
+    return _directory + "/" + std::string(hex) + ".mcnf";
+}
+
+bool SatFormulaCache::load(JobDescription& desc, Result& result) {
+    if (!_valid_source) return false;
+
+    auto cacheFile = getCacheFile();
+    int fd = open(cacheFile.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    struct stat s;
+    if (fstat(fd, &s) != 0 || s.st_size < (off_t) sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    size_t size = s.st_size;
+    void* mmapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mmapped == MAP_FAILED) return false;
+
+    // Check that the entry belongs to the very same source file
+    Header header;
+    memcpy(&header, mmapped, sizeof(Header));
+    const char* path = ((const char*) mmapped) + sizeof(Header);
+    bool valid = memcmp(header.magic, _source_info.magic, sizeof(header.magic)) == 0
+        && header.version == _source_info.version
+        && header.contentMode == _source_info.contentMode
+        && header.sourceSize == _source_info.sourceSize
+        && header.sourceMtimeSec == _source_info.sourceMtimeSec
+        && header.sourceMtimeNsec == _source_info.sourceMtimeNsec
+        && header.pathLength == _source_info.pathLength
+        && size == sizeof(Header) + header.pathLength + (header.fSize+header.aSize)*sizeof(int)
+        && std::string(path, header.pathLength) == _source_path;
+    const int* payload = (const int*) (path + header.pathLength);
+    if (valid && desc.computesChecksums()) {
+        // Descriptions with checksums visit each literal anyway
+        valid = computeChecksum(payload, header.fSize, header.aSize) == header.checksum;
+    }
+    if (!valid) {
+        LOG(V1_WARN, "[WARN] Invalid formula cache entry %s for %s\n", cacheFile.c_str(), _source_path.c_str());
+        munmap(mmapped, size);
+        return false;
+    }
+
+    // Copy the entire payload into the description at once
+    int* out = desc.appendPayload(header.fSize, header.aSize);
+    memcpy(out, payload, (header.fSize+header.aSize)*sizeof(int));
+    desc.addToChecksum(out, header.fSize, header.aSize);
+    munmap(mmapped, size);
+
+    result.maxVar = header.maxVar;
+    result.numClauses = header.numClauses;
+    return true;
+}
+
+bool SatFormulaCache::store(const int* payload, size_t fSize, size_t aSize, const Result& result) {
+    if (!_valid_source) return false;
+    if (FileUtils::mkdir(_directory) != 0) return false;
+
+    Header header = _source_info;
+    header.maxVar = result.maxVar;
+    header.numClauses = result.numClauses;
+    header.fSize = fSize;
+    header.aSize = aSize;
+    header.checksum = computeChecksum(payload, fSize, aSize);
+
+    // Write to a temporary file first which is then renamed
+    // such that concurrent readers never see a partial entry
+    auto cacheFile = getCacheFile();
+    auto tmpFile = cacheFile + ".tmp." + std::to_string(Proc::getPid()) + "." + std::to_string(Proc::getTid());
+    FILE* f = fopen(tmpFile.c_str(), "wb");
+    if (f == nullptr) return false;
+    bool success = fwrite(&header, sizeof(Header), 1, f) == 1
+        && fwrite(_source_path.c_str(), 1, _source_path.size(), f) == _source_path.size()
+        && fwrite(payload, sizeof(int), fSize+aSize, f) == fSize+aSize;
+    success = (fclose(f) == 0) && success;
+    if (success) success = rename(tmpFile.c_str(), cacheFile.c_str()) == 0;
+    if (!success) {
+        LOG(V1_WARN, "[WARN] Could not write formula cache entry %s\n", cacheFile.c_str());
+        remove(tmpFile.c_str());
+    }
+    return success;
+}
+
+uint64_t SatFormulaCache::computeChecksum(const int* payload, size_t fSize, size_t aSize) {
+    Checksum checksum;
+    for (size_t i = 0; i < fSize; i++) checksum.combine(payload[i]);
+    for (size_t i = 0; i < aSize; i++) checksum.combine(-payload[fSize+i]);
+    return checksum.get();
+}
@@ -0,0 +1,65 @@
+
+#ifndef DOMPASCH_MALLOB_SAT_FORMULA_CACHE_HPP
+#define DOMPASCH_MALLOB_SAT_FORMULA_CACHE_HPP
+
+#include <string>
+#include <cstdint>
+
+#include "data/job_description.hpp"
+
+/*
+On-disk cache of parsed formulae in a binary format. Each entry is keyed by
+the source file's path, modification time and size (and the content mode
+it was parsed with) and contains the parsed payload (formula literals and
+assumptions, in the order they were parsed), the max. variable, the number
+of clauses, and a checksum of the payload.
+*/
+class SatFormulaCache {
+
+public:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        int32_t contentMode;
+        uint64_t sourceSize;
+        int64_t sourceMtimeSec;
+        int64_t sourceMtimeNsec;
+        int32_t maxVar;
+        int32_t numClauses;
+        uint64_t fSize;
+        uint64_t aSize;
+        uint64_t checksum;
+        uint64_t pathLength;
+    };
+
+    struct Result {
+        int maxVar = 0;
+        int numClauses = 0;
+    };
+
+private:
+    std::string _directory;
+    std::string _source_path;
+    int _content_mode;
+
+    bool _valid_source = false;
+    Header _source_info;
+
+public:
+    SatFormulaCache(const std::string& directory, const std::string& sourceFile, int contentMode);
+
+    // Appends the cached payload for the source file to the current revision
+    // of the description. Returns false (leaving the description untouched)
+    // if no valid cache entry exists.
+    bool load(JobDescription& desc, Result& result);
+
+    // Writes a cache entry for the source file from the provided payload.
+    bool store(const int* payload, size_t fSize, size_t aSize, const Result& result);
+
+    std::string getCacheFile() const;
+
+private:
+    static uint64_t computeChecksum(const int* payload, size_t fSize, size_t aSize);
+};
+
+#endif
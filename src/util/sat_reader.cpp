@@ -7,18 +7,441 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <thread>
+#include <algorithm>
 
 #include "sat_reader.hpp"
 #include "util/sys/terminator.hpp"
+#include "util/logger.hpp"
+#include "util/sys/threading.hpp"
+#include "util/sys/timer.hpp"
+#include "util/sys/proc.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MALLOB_SAT_READER_X86 1
+#endif
+
+// Classification of a 64-byte block of ASCII DIMACS content.
+// "plain" has a bit set for each digit, ' ', '-', and '\n' character.
+// "separators" has a bit set for each ' ', '-', and '\n' character.
+// All other characters (comments, assumptions, '\r', ...) are left
+// to the scalar state machine.
+struct BlockClassification {
+	uint64_t plain;
+	uint64_t separators;
+};
+typedef BlockClassification (*BlockClassifier)(const char*);
+
+static BlockClassification classifyBlockScalar(const char* data) {
+	BlockClassification cls {0, 0};
+	for (int i = 0; i < 64; i++) {
+		char c = data[i];
+		bool sep = c == ' ' || c == '-' || c == '\n';
+		bool digit = c >= '0' && c <= '9';
+		cls.separators |= ((uint64_t) sep) << i;
+		cls.plain |= ((uint64_t) (sep || digit)) << i;
+	}
+	return cls;
+}
+
+#ifdef MALLOB_SAT_READER_X86
+
+__attribute__((target("sse2")))
+static BlockClassification classifyBlockSse(const char* data) {
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i minus = _mm_set1_epi8('-');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i belowZero = _mm_set1_epi8('0'-1);
+	const __m128i aboveNine = _mm_set1_epi8('9'+1);
+	BlockClassification cls {0, 0};
+	for (int i = 0; i < 4; i++) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (data + 16*i));
+		__m128i sep = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), 
+			_mm_cmpeq_epi8(v, minus)), _mm_cmpeq_epi8(v, newline));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, belowZero), _mm_cmplt_epi8(v, aboveNine));
+		cls.separators |= ((uint64_t) (uint16_t) _mm_movemask_epi8(sep)) << (16*i);
+		cls.plain |= ((uint64_t) (uint16_t) _mm_movemask_epi8(_mm_or_si128(sep, digit))) << (16*i);
+	}
+	return cls;
+}
+
+__attribute__((target("avx2")))
+static BlockClassification classifyBlockAvx2(const char* data) {
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i minus = _mm256_set1_epi8('-');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i belowZero = _mm256_set1_epi8('0'-1);
+	const __m256i aboveNine = _mm256_set1_epi8('9'+1);
+	BlockClassification cls {0, 0};
+	for (int i = 0; i < 2; i++) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (data + 32*i));
+		__m256i sep = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), 
+			_mm256_cmpeq_epi8(v, minus)), _mm256_cmpeq_epi8(v, newline));
+		__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, belowZero), _mm256_cmpgt_epi8(aboveNine, v));
+		cls.separators |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(sep)) << (32*i);
+		cls.plain |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(sep, digit))) << (32*i);
+	}
+	return cls;
+}
+
+#endif
+
+static BlockClassifier getBlockClassifier() {
+#ifdef MALLOB_SAT_READER_X86
+	if (__builtin_cpu_supports("avx2")) return &classifyBlockAvx2;
+	if (__builtin_cpu_supports("sse2")) return &classifyBlockSse;
+#endif
+	return &classifyBlockScalar;
+}
+
+void SatReader::processBlock(const char* data, size_t size, JobDescription& desc) {
+
+	if (!_bulk_parsing) {
+		for (size_t i = 0; i < size; i++) process(data[i], desc);
+		return;
+	}
+
+	static const BlockClassifier classify = getBlockClassifier();
+
+	size_t pos = 0;
+	while (pos < size) {
+
+		if (_comment) {
+			// Skip to the end of the line
+			const char* newline = (const char*) memchr(data+pos, '\n', size-pos);
+			if (newline == nullptr) break;
+			pos = newline - data;
+			flushLiterals(desc);
+			process(data[pos], desc);
+			pos++;
+			continue;
+		}
+
+		if (size - pos < 64) {
+			// Remaining tail: scalar processing
+			flushLiterals(desc);
+			for (; pos < size; pos++) process(data[pos], desc);
+			break;
+		}
+
+		auto cls = classify(data+pos);
+		if (cls.plain != ~0ULL) {
+			// Process all plain characters up to the first special character,
+			// then hand the special character to the scalar state machine
+			int numPlain = __builtin_ctzll(~cls.plain);
+			processPlainBlock(data+pos, numPlain, cls.separators & ((1ULL << numPlain) - 1), desc);
+			flushLiterals(desc);
+			process(data[pos+numPlain], desc);
+			pos += numPlain+1;
+			continue;
+		}
+		processPlainBlock(data+pos, 64, cls.separators, desc);
+		pos += 64;
+	}
+
+	flushLiterals(desc);
+}
+
+void SatReader::processPlainBlock(const char* data, int size, uint64_t separators, JobDescription& desc) {
+
+	// Work on local copies of the parser state so that the compiler
+	// can keep them in registers (the literal batch may alias members)
+	int num = _num;
+	int sign = _sign;
+	int maxVar = _max_var;
+	int numReadClauses = _num_read_clauses;
+	int batchSize = _lit_batch_size;
+	bool beganNum = _began_num;
+	bool assumption = _assumption;
+	int* batch = _lit_batch;
+
+	int i = 0;
+	while (true) {
+		// Position of the next separator (or end of block)
+		int end = separators == 0 ? size : __builtin_ctzll(separators);
+
+		// Accumulate digits
+		if (i < end) beganNum = true;
+		for (; i < end; i++) num = num*10 + (data[i]-'0');
+		if (end == size) break;
+		separators &= separators-1;
+
+		int lit = 0;
+		bool emit = false;
+		switch (data[end]) {
+		case ' ':
+			if (beganNum) {
+				maxVar = std::max(maxVar, num);
+				if (!assumption) {
+					lit = sign * num;
+					emit = true;
+				} else if (num != 0) {
+					_lit_batch_size = batchSize;
+					flushLiterals(desc);
+					batchSize = 0;
+					desc.addAssumption(sign * num);
+				}
+				num = 0;
+				beganNum = false;
+			}
+			sign = 1;
+			break;
+		case '-':
+			sign = -1;
+			beganNum = true;
+			break;
+		default: // '\n' (no comment can be active here)
+			if (beganNum) {
+				assert(num == 0);
+				emit = !assumption;
+				beganNum = false;
+			}
+			assumption = false;
+			break;
+		}
+		if (emit) {
+			batch[batchSize++] = lit;
+			if (lit == 0) numReadClauses++;
+			if (batchSize == LITERAL_BATCH_SIZE) {
+				_lit_batch_size = batchSize;
+				flushLiterals(desc);
+				batchSize = 0;
+			}
+		}
+		i = end+1;
+	}
+
+	_num = num;
+	_sign = sign;
+	_max_var = maxVar;
+	_num_read_clauses = numReadClauses;
+	_lit_batch_size = batchSize;
+	_began_num = beganNum;
+	_assumption = assumption;
+}
+
+bool SatReader::processInParallel(const char* data, size_t size, JobDescription& desc) {
+
+	// Split the content into chunks, each beginning right after a line break
+	std::vector<size_t> bounds {0};
+	size_t numChunks = std::min((size_t) _num_threads, size / MIN_BYTES_PER_PARSER_THREAD);
+	for (size_t i = 1; i < numChunks; i++) {
+		size_t pos = std::max(bounds.back(), i * (size / numChunks));
+		const char* newline = (const char*) memchr(data+pos, '\n', size-pos);
+		if (newline == nullptr) break;
+		pos = newline - data + 1;
+		if (pos > bounds.back() && pos < size) bounds.push_back(pos);
+	}
+	bounds.push_back(size);
+	numChunks = bounds.size()-1;
+	if (numChunks < 2) return false;
+
+	// Parse each chunk into a thread-local description
+	std::vector<SatReader> readers(numChunks, SatReader(_filename, _content_mode));
+	std::vector<JobDescription> descs;
+	descs.reserve(numChunks);
+	for (size_t i = 0; i < numChunks; i++) {
+		descs.emplace_back(desc.getId(), desc.getPriority(), desc.getApplication());
+	}
+	std::vector<std::thread> threads(numChunks);
+	for (size_t i = 0; i < numChunks; i++) {
+		threads[i] = std::thread([&, i]() {
+			readers[i].setBulkParsing(_bulk_parsing);
+			descs[i].beginInitialization(0);
+			descs[i].reserveSize((bounds[i+1]-bounds[i]) / sizeof(int));
+			readers[i].processBlock(data+bounds[i], bounds[i+1]-bounds[i], descs[i]);
+		});
+	}
+	for (auto& thread : threads) thread.join();
+
+	// Each chunk was parsed from a fresh state. This is only equivalent
+	// to sequential parsing if each chunk also ended in such a state.
+	for (size_t i = 0; i+1 < numChunks; i++) {
+		if (!readers[i].hasCleanLineState()) {
+			LOG(V4_VVER, "Parallel parsing of %s failed at chunk %lu - falling back to sequential parsing\n", 
+				_filename.c_str(), i);
+			return false;
+		}
+	}
+
+	// Reduce statistics, adopt the final parser state of the last chunk
+	size_t numLits = 0, numAssumptions = 0;
+	std::vector<size_t> offsets(numChunks+1, 0);
+	for (size_t i = 0; i < numChunks; i++) {
+		_max_var = std::max(_max_var, readers[i]._max_var);
+		_num_read_clauses += readers[i]._num_read_clauses;
+		numLits += descs[i].getNumFormulaLiterals();
+		numAssumptions += descs[i].getNumAssumptionLiterals();
+		offsets[i+1] = offsets[i] + descs[i].getNumFormulaLiterals() + descs[i].getNumAssumptionLiterals();
+	}
+	_sign = readers.back()._sign;
+	_comment = readers.back()._comment;
+	_began_num = readers.back()._began_num;
+	_assumption = readers.back()._assumption;
+	_num = readers.back()._num;
+
+	// Copy the chunks' payloads into the description at their prefix sum offsets
+	int* out = desc.appendPayload(numLits, numAssumptions);
+	for (size_t i = 0; i < numChunks; i++) {
+		threads[i] = std::thread([&, i]() {
+			memcpy(out + offsets[i], descs[i].getFormulaPayload(0), (offsets[i+1]-offsets[i]) * sizeof(int));
+			descs[i].clearPayload(0);
+		});
+	}
+	for (auto& thread : threads) thread.join();
+	desc.addToChecksum(out, numLits, numAssumptions);
+	return true;
+}
+
+void SatReader::processRawBlock(const char* data, size_t size, JobDescription& desc) {
+
+	size_t pos = 0;
+	// Complete an integer which was split across the previous and this block
+	if (_num_raw_carry_bytes > 0) {
+		size_t numBytes = std::min(size, sizeof(int) - _num_raw_carry_bytes);
+		memcpy(_raw_carry + _num_raw_carry_bytes, data, numBytes);
+		_num_raw_carry_bytes += numBytes;
+		pos = numBytes;
+		if (_num_raw_carry_bytes == sizeof(int)) {
+			int x;
+			memcpy(&x, _raw_carry, sizeof(int));
+			processInt(x, desc);
+			_num_raw_carry_bytes = 0;
+		}
+	}
+	for (; pos + sizeof(int) <= size; pos += sizeof(int)) {
+		int x;
+		memcpy(&x, data+pos, sizeof(int));
+		processInt(x, desc);
+	}
+	// Keep the remaining bytes (fewer than sizeof(int)) for the next block
+	memcpy(_raw_carry, data+pos, size-pos);
+	_num_raw_carry_bytes += size-pos;
+}
+
+void SatReader::processChars(const char* data, size_t size, JobDescription& desc) {
+	if (_content_mode == RAW) processRawBlock(data, size, desc);
+	else processBlock(data, size, desc);
+}
+
+bool SatReader::processDecompressed(StreamDecompressor& decompressor, JobDescription& desc) {
+
+	// Decompress in a separate thread while parsing in this thread.
+	// The decompressed data is handed over in a ring of large blocks.
+	struct Block {
+		std::vector<char> data;
+		ssize_t size = 0;
+		bool full = false;
+	};
+	const size_t blockSize = 1 << 22;
+	std::vector<Block> blocks(4);
+	Mutex mutex;
+	ConditionVariable condVar;
+	bool stop = false;
+
+	std::thread decompressorThread([&]() {
+		Proc::nameThisThread("Decompressor");
+		for (size_t i = 0; ; i = (i+1) % blocks.size()) {
+			auto& block = blocks[i];
+			{
+				auto lock = mutex.getLock();
+				condVar.waitWithLockedMutex(lock, [&]() {return !block.full || stop;});
+				if (stop) break;
+			}
+			float time = Timer::elapsedSeconds();
+			block.data.resize(blockSize);
+			ssize_t size = decompressor.read(block.data.data(), blockSize);
+			_decompression_time += Timer::elapsedSeconds() - time;
+			{
+				auto lock = mutex.getLock();
+				block.size = size;
+				block.full = true;
+			}
+			condVar.notify();
+			if (size <= 0) break;
+		}
+	});
+
+	bool success = true;
+	for (size_t i = 0; ; i = (i+1) % blocks.size()) {
+		auto& block = blocks[i];
+		{
+			auto lock = mutex.getLock();
+			condVar.waitWithLockedMutex(lock, [&]() {return block.full;});
+		}
+		if (block.size <= 0) {
+			success = block.size == 0;
+			break;
+		}
+		float time = Timer::elapsedSeconds();
+		processChars(block.data.data(), block.size, desc);
+		_tokenization_time += Timer::elapsedSeconds() - time;
+		bool terminate = Terminator::isTerminating();
+		{
+			auto lock = mutex.getLock();
+			block.full = false;
+			if (terminate) stop = true;
+		}
+		condVar.notify();
+		if (terminate) break;
+	}
+	decompressorThread.join();
+	return success;
+}
+
+void SatReader::setNumClausesEntry(JobDescription& desc, bool final) {
+	const std::string NC_DEFAULT_VAL = "BMMMKKK111";
+	if (!final) {
+		desc.setAppConfigurationEntry("__NC", NC_DEFAULT_VAL);
+		return;
+	}
+	std::string numClausesStr = std::to_string(_num_read_clauses);
+	assert(numClausesStr.size() < NC_DEFAULT_VAL.size());
+	while (numClausesStr.size() < NC_DEFAULT_VAL.size())
+		numClausesStr += ".";
+	desc.setAppConfigurationEntry("__NC", numClausesStr);
+}
+
+bool SatReader::readFromCache(SatFormulaCache& cache, JobDescription& desc) {
+
+	setNumClausesEntry(desc, false);
+	desc.beginInitialization(desc.getRevision());
+
+	SatFormulaCache::Result result;
+	float time = Timer::elapsedSeconds();
+	if (!cache.load(desc, result)) return false;
+	time = Timer::elapsedSeconds() - time;
+	LOG(V4_VVER, "Loaded %s from formula cache %s in %.3fs\n", _filename.c_str(), cache.getCacheFile().c_str(), time);
+
+	_max_var = result.maxVar;
+	_num_read_clauses = result.numClauses;
+	_valid_input = true;
+	setNumClausesEntry(desc, true);
+	desc.endInitialization();
+	return true;
+}
 
 bool SatReader::read(JobDescription& desc) {
 
+	// Try to load a previously parsed copy of the file
+	std::unique_ptr<SatFormulaCache> cache;
+	if (!_cache_directory.empty()) {
+		cache.reset(new SatFormulaCache(_cache_directory, _filename, _content_mode));
+		if (readFromCache(*cache, desc)) return true;
+	}
+
 	FILE* pipe = nullptr;
 	int namedpipe = -1;
-	if ((_filename.size() > 3 && _filename.substr(_filename.size()-3, 3) == ".xz")
-		|| (_filename.size() > 5 && _filename.substr(_filename.size()-5, 5) == ".lzma")) {
-		// Decompress, read output
-		auto command = "xz -c -d " + _filename;
+	std::unique_ptr<StreamDecompressor> decompressor;
+	auto format = StreamDecompressor::getFormat(_filename);
+	if (format != StreamDecompressor::NONE && StreamDecompressor::isSupported(format)) {
+		// Decompress within this process
+		decompressor.reset(new StreamDecompressor(_filename));
+		if (!decompressor->open()) return false;
+	} else if (format == StreamDecompressor::XZ || format == StreamDecompressor::ZSTD) {
+		// Decompress with external program, read output
+		auto command = std::string(format == StreamDecompressor::XZ ? "xz" : "zstd -q") + " -c -d " + _filename;
 		pipe = popen(command.c_str(), "r");
 		if (pipe == nullptr) return false;
 	} else if (_filename.size() > 5 && _filename.substr(_filename.size()-5, 5) == ".pipe") {
@@ -26,11 +449,15 @@ bool SatReader::read(JobDescription& desc) {
 		namedpipe = open(_filename.c_str(), O_RDONLY);
 	}
 	
-	const std::string NC_DEFAULT_VAL = "BMMMKKK111";
-	desc.setAppConfigurationEntry("__NC", NC_DEFAULT_VAL);
+	setNumClausesEntry(desc, false);
 	desc.beginInitialization(desc.getRevision());
 	
-	if (pipe == nullptr && namedpipe == -1) {
+	if (decompressor) {
+		// Read decompressed file contents
+		if (!processDecompressed(*decompressor, desc)) return false;
+		if (_content_mode == ASCII) process(EOF, desc);
+
+	} else if (pipe == nullptr && namedpipe == -1) {
 		// Read file with mmap
 		int fd = open(_filename.c_str(), O_RDONLY);
 		if (fd == -1) return false;
@@ -43,18 +470,18 @@ bool SatReader::read(JobDescription& desc) {
 		desc.reserveSize(size / sizeof(int));
 		void* mmapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
 
+		float time = Timer::elapsedSeconds();
 		if (_content_mode == RAW) {
 			int* f = (int*) mmapped;
 			for (long i = 0; i < size; i++) {
 				processInt(f[i], desc);
 			}
 		} else {
-			char* f = (char*) mmapped;
-			for (long i = 0; i < size; i++) {
-				process(f[i], desc);
-			}
+			if (_num_threads <= 1 || !processInParallel((const char*) mmapped, size, desc))
+				processBlock((const char*) mmapped, size, desc);
 			process(EOF, desc);
 		}
+		_tokenization_time += Timer::elapsedSeconds() - time;
 		munmap(mmapped, size);
 		close(fd);
 
@@ -77,52 +504,43 @@ bool SatReader::read(JobDescription& desc) {
 			while (iteration ^ 511 != 0 || !Terminator::isTerminating()) {
 				int numRead = ::read(namedpipe, buffer, sizeof(buffer));
 				if (numRead <= 0) break;
-				for (int i = 0; i < numRead; i++) {
-					int c = buffer[i];
-					process(c, desc);
-				}
+				processBlock(buffer, numRead, desc);
 				iteration++;
 			}
 			process(EOF, desc);
 		}
 
 	} else {
-		// Read file over pipe
-		if (_content_mode == RAW) {
-			int iteration = 0;
-			int buffer[1024] = {0};
-			while (iteration ^ 511 != 0 || !Terminator::isTerminating()) {
-				int numRead = ::read(fileno(pipe), buffer, sizeof(buffer));
-				if (numRead <= 0) break;
-				for (int i = 0; i < numRead; i++) {
-					int c = buffer[i];
-					processInt(c, desc);
-				}
-				iteration++;
-			}
-		} else {
-			char buffer[4096] = {'\0'};
-			while (!Terminator::isTerminating() && fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-				size_t pos = 0;
-				while (buffer[pos] != '\0') {
-					int c = buffer[pos++];
-					process(c, desc);
-				}
-			}
-			process(EOF, desc);
+		// Read file over pipe in large chunks
+		std::vector<char> buffer(1 << 20);
+		while (!Terminator::isTerminating()) {
+			float time = Timer::elapsedSeconds();
+			ssize_t numRead = ::read(fileno(pipe), buffer.data(), buffer.size());
+			_decompression_time += Timer::elapsedSeconds() - time;
+			if (numRead <= 0) break;
+			time = Timer::elapsedSeconds();
+			processChars(buffer.data(), numRead, desc);
+			_tokenization_time += Timer::elapsedSeconds() - time;
 		}
+		if (_content_mode == ASCII) process(EOF, desc);
 	}
 
-        std::string numClausesStr = std::to_string(_num_read_clauses);
-	assert(numClausesStr.size() < NC_DEFAULT_VAL.size());
-	while (numClausesStr.size() < NC_DEFAULT_VAL.size())
-		numClausesStr += ".";
-	desc.setAppConfigurationEntry("__NC", numClausesStr);
+	setNumClausesEntry(desc, true);
+
+	if (cache && isValidInput() && !Terminator::isTerminating()) {
+		// Store parsed payload (without any preloaded literals) for later
+		cache->store(desc.getFormulaPayload(desc.getRevision()), desc.getNumFormulaLiterals(), 
+			desc.getNumAssumptionLiterals(), SatFormulaCache::Result {_max_var, _num_read_clauses});
+	}
 
 	desc.endInitialization();
 
 	if (pipe != nullptr) pclose(pipe);
 	if (namedpipe != -1) close(namedpipe);
 
+	auto& stats = desc.getStatistics();
+	stats.decompressionTime = _decompression_time;
+	stats.tokenizationTime = _tokenization_time;
+
 	return isValidInput();
 }
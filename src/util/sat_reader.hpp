@@ -9,6 +9,8 @@
 #include "util/assert.hpp"
 
 #include "data/job_description.hpp"
+#include "util/stream_decompressor.hpp"
+#include "util/sat_formula_cache.hpp"
 
 #include <iostream>
 
@@ -37,10 +39,45 @@ private:
 
     bool _valid_input = false;
 
+    // Bulk parsing of ASCII content: literals are collected in a small
+    // batch which is appended to the description at once
+    bool _bulk_parsing = true;
+    static const int LITERAL_BATCH_SIZE = 4096;
+    int _lit_batch[LITERAL_BATCH_SIZE];
+    int _lit_batch_size = 0;
+
+    // Content mode RAW over a stream: bytes of an integer split across blocks
+    char _raw_carry[sizeof(int)];
+    int _num_raw_carry_bytes = 0;
+
+    // Busy time of each stage of reading
+    float _decompression_time = 0;
+    float _tokenization_time = 0;
+
+    // Parallel parsing of a single (uncompressed) ASCII file
+    int _num_threads = 1;
+    static const size_t MIN_BYTES_PER_PARSER_THREAD = 1 << 20;
+
+    // Directory for binary copies of parsed formulae (empty: no caching)
+    std::string _cache_directory;
+
 public:
     SatReader(const std::string& filename, ContentMode contentMode) : _filename(filename), _content_mode(contentMode) {}
     bool read(JobDescription& desc);
 
+    // Use up to this many threads to parse an uncompressed ASCII file (default: 1).
+    void setNumThreads(int numThreads) {_num_threads = numThreads;}
+    // Load the formula from / store it to a binary cache in this directory.
+    void setCacheDirectory(const std::string& directory) {_cache_directory = directory;}
+
+    // Use block-wise (vectorized) parsing for ASCII content (default: true).
+    // If false, every character goes through process(char, JobDescription&).
+    void setBulkParsing(bool bulkParsing) {_bulk_parsing = bulkParsing;}
+
+    // Processes a contiguous chunk of ASCII content. The result is exactly
+    // the same as if process(c, desc) was called for each character c.
+    void processBlock(const char* data, size_t size, JobDescription& desc);
+
     inline void processInt(int x, JobDescription& desc) {
         
         //std::cout << x << std::endl;
@@ -130,6 +167,26 @@ public:
     bool isValidInput() const {
         return _content_mode != RAW || _valid_input;
     }
+    int getMaxVar() const {
+        return _max_var;
+    }
+
+private:
+    inline void flushLiterals(JobDescription& desc) {
+        if (_lit_batch_size == 0) return;
+        desc.addLiterals(_lit_batch, _lit_batch_size);
+        _lit_batch_size = 0;
+    }
+    void processPlainBlock(const char* data, int size, uint64_t separators, JobDescription& desc);
+    bool processInParallel(const char* data, size_t size, JobDescription& desc);
+    void processRawBlock(const char* data, size_t size, JobDescription& desc);
+    void processChars(const char* data, size_t size, JobDescription& desc);
+    bool processDecompressed(StreamDecompressor& decompressor, JobDescription& desc);
+    bool readFromCache(SatFormulaCache& cache, JobDescription& desc);
+    void setNumClausesEntry(JobDescription& desc, bool final);
+    bool hasCleanLineState() const {
+        return !_comment && !_began_num && !_assumption && _num == 0 && _sign == 1;
+    }
 };
 
 #endif
@@ -0,0 +1,205 @@
+
+#include "stream_decompressor.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef MALLOB_USE_LZMA
+#include <lzma.h>
+#endif
+#ifdef MALLOB_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "util/assert.hpp"
+
+#define STREAM_DECOMPRESSOR_INPUT_BUFFER_SIZE (1 << 20)
+
+StreamDecompressor::Format StreamDecompressor::getFormat(const std::string& filename) {
+    auto endsWith = [&](const std::string& ending) {
+        return filename.size() > ending.size()
+            && filename.substr(filename.size()-ending.size(), ending.size()) == ending;
+    };
+    if (endsWith(".xz") || endsWith(".lzma")) return XZ;
+    if (endsWith(".gz")) return GZIP;
+    if (endsWith(".zst")) return ZSTD;
+    return NONE;
+}
+
+bool StreamDecompressor::isSupported(Format format) {
+    switch (format) {
+    case XZ:
+#ifdef MALLOB_USE_LZMA
+        return true;
+#else
+        return false;
+#endif
+    case GZIP:
+        return true;
+    case ZSTD:
+#ifdef MALLOB_USE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+bool StreamDecompressor::open() {
+    if (!isSupported(_format)) return false;
+
+    _fd = ::open(_filename.c_str(), O_RDONLY);
+    if (_fd == -1) return false;
+    _in_buffer = (unsigned char*) malloc(STREAM_DECOMPRESSOR_INPUT_BUFFER_SIZE);
+
+    switch (_format) {
+    case XZ: {
+#ifdef MALLOB_USE_LZMA
+        lzma_stream* strm = new lzma_stream;
+        *strm = LZMA_STREAM_INIT;
+        _state = strm;
+        // The auto decoder handles both .xz and .lzma streams
+        if (lzma_auto_decoder(strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) return false;
+#endif
+        break;
+    }
+    case GZIP: {
+        z_stream* strm = new z_stream;
+        strm->zalloc = Z_NULL;
+        strm->zfree = Z_NULL;
+        strm->opaque = Z_NULL;
+        strm->next_in = Z_NULL;
+        strm->avail_in = 0;
+        _state = strm;
+        // 15+32: maximum window size, automatic detection of gzip / zlib header
+        if (inflateInit2(strm, 15+32) != Z_OK) return false;
+        break;
+    }
+    case ZSTD: {
+#ifdef MALLOB_USE_ZSTD
+        ZSTD_DStream* strm = ZSTD_createDStream();
+        _state = strm;
+        if (strm == nullptr) return false;
+        if (ZSTD_isError(ZSTD_initDStream(strm))) return false;
+#endif
+        break;
+    }
+    default:
+        return false;
+    }
+    return true;
+}
+
+bool StreamDecompressor::refillInput() {
+    if (_input_exhausted) return false;
+    ssize_t numRead = ::read(_fd, _in_buffer, STREAM_DECOMPRESSOR_INPUT_BUFFER_SIZE);
+    if (numRead <= 0) {
+        _input_exhausted = true;
+        _in_size = 0;
+    } else _in_size = numRead;
+    _in_pos = 0;
+    return numRead > 0;
+}
+
+ssize_t StreamDecompressor::read(char* out, size_t capacity) {
+
+    if (_done || _state == nullptr) return 0;
+    size_t written = 0;
+
+    while (written < capacity && !_done) {
+
+        if (_in_pos == _in_size) refillInput();
+
+        switch (_format) {
+        case XZ: {
+#ifdef MALLOB_USE_LZMA
+            lzma_stream* strm = (lzma_stream*) _state;
+            strm->next_in = _in_buffer + _in_pos;
+            strm->avail_in = _in_size - _in_pos;
+            strm->next_out = (uint8_t*) out + written;
+            strm->avail_out = capacity - written;
+            lzma_ret ret = lzma_code(strm, _input_exhausted ? LZMA_FINISH : LZMA_RUN);
+            _in_pos = _in_size - strm->avail_in;
+            written = capacity - strm->avail_out;
+            if (ret == LZMA_STREAM_END) _done = true;
+            else if (ret != LZMA_OK) return -1;
+#endif
+            break;
+        }
+        case GZIP: {
+            z_stream* strm = (z_stream*) _state;
+            strm->next_in = _in_buffer + _in_pos;
+            strm->avail_in = _in_size - _in_pos;
+            strm->next_out = (Bytef*) out + written;
+            strm->avail_out = capacity - written;
+            int ret = inflate(strm, Z_NO_FLUSH);
+            _in_pos = _in_size - strm->avail_in;
+            written = capacity - strm->avail_out;
+            if (ret == Z_STREAM_END) {
+                // Concatenated gzip members: continue with the next one
+                if (_in_pos == _in_size && !refillInput()) _done = true;
+                else inflateReset(strm);
+            } else if (ret == Z_BUF_ERROR && _input_exhausted) {
+                return -1; // truncated input
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) return -1;
+            break;
+        }
+        case ZSTD: {
+#ifdef MALLOB_USE_ZSTD
+            ZSTD_DStream* strm = (ZSTD_DStream*) _state;
+            if (_input_exhausted && _in_pos == _in_size && _frame_complete) {
+                _done = true;
+                break;
+            }
+            ZSTD_inBuffer in {_in_buffer, _in_size, _in_pos};
+            ZSTD_outBuffer outBuf {out, capacity, written};
+            size_t ret = ZSTD_decompressStream(strm, &outBuf, &in);
+            if (ZSTD_isError(ret)) return -1;
+            _in_pos = in.pos;
+            written = outBuf.pos;
+            _frame_complete = ret == 0;
+            if (_input_exhausted && _in_pos == _in_size && outBuf.pos < outBuf.size) {
+                // No more input and no more output
+                if (ret != 0) return -1; // truncated input
+                _done = true;
+            }
+#endif
+            break;
+        }
+        default:
+            return -1;
+        }
+    }
+
+    return written;
+}
+
+StreamDecompressor::~StreamDecompressor() {
+    if (_state != nullptr) {
+        switch (_format) {
+        case XZ:
+#ifdef MALLOB_USE_LZMA
+            lzma_end((lzma_stream*) _state);
+            delete (lzma_stream*) _state;
+#endif
+            break;
+        case GZIP:
+            inflateEnd((z_stream*) _state);
+            delete (z_stream*) _state;
+            break;
+        case ZSTD:
+#ifdef MALLOB_USE_ZSTD
+            ZSTD_freeDStream((ZSTD_DStream*) _state);
+#endif
+            break;
+        default:
+            break;
+        }
+    }
+    if (_in_buffer != nullptr) free(_in_buffer);
+    if (_fd != -1) ::close(_fd);
+}
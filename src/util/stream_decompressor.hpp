@@ -0,0 +1,48 @@
+
+#ifndef DOMPASCH_MALLOB_STREAM_DECOMPRESSOR_HPP
+#define DOMPASCH_MALLOB_STREAM_DECOMPRESSOR_HPP
+
+#include <string>
+#include <sys/types.h>
+
+/*
+In-process streaming decompression of a compressed file.
+The format is determined by the file ending: .xz / .lzma (liblzma,
+if compiled with MALLOB_USE_LZMA), .gz (zlib), .zst (libzstd, if
+compiled with MALLOB_USE_ZSTD).
+*/
+class StreamDecompressor {
+
+public:
+    enum Format {NONE, XZ, GZIP, ZSTD};
+
+private:
+    std::string _filename;
+    Format _format;
+
+    int _fd = -1;
+    void* _state = nullptr;
+    unsigned char* _in_buffer = nullptr;
+    size_t _in_size = 0;
+    size_t _in_pos = 0;
+    bool _input_exhausted = false;
+    bool _frame_complete = false;
+    bool _done = false;
+
+public:
+    StreamDecompressor(const std::string& filename) : _filename(filename), _format(getFormat(filename)) {}
+    ~StreamDecompressor();
+
+    static Format getFormat(const std::string& filename);
+    static bool isSupported(Format format);
+
+    bool open();
+    // Decompresses the next portion of data into the provided buffer.
+    // Returns the number of written bytes (0: end of stream, -1: error).
+    ssize_t read(char* out, size_t capacity);
+
+private:
+    bool refillInput();
+};
+
+#endif
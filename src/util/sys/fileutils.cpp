@@ -21,6 +21,12 @@ bool FileUtils::isDirectory(const std::string& dirpath) {
     return stat(dirpath.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode);
 }
 
+size_t FileUtils::getFileSize(const std::string& file) {
+    struct stat sb;
+    if (stat(file.c_str(), &sb) != 0) return 0;
+    return sb.st_size;
+}
+
 int FileUtils::mkdir(const std::string& dir) {
     for (size_t i = 0; i < dir.size(); i++) {
         if (dir[i] == '/' && i > 0 && i+1 < dir.size()) {
@@ -15,6 +15,8 @@ public:
 
     static bool isRegularFile(const std::string& file);
     static bool isDirectory(const std::string& dirpath);
+    // Size of the given file in bytes, or 0 if it cannot be accessed.
+    static size_t getFileSize(const std::string& file);
 
     static std::vector<std::string> glob(const std::string& pattern);
 };
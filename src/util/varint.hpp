@@ -0,0 +1,67 @@
+
+#ifndef DOMPASCH_MALLOB_VARINT_HPP
+#define DOMPASCH_MALLOB_VARINT_HPP
+
+#include <cstdint>
+#include <vector>
+
+/*
+Variable-length encoding of unsigned integers: seven bits per byte, least
+significant group first, with the high bit set in all bytes but the last.
+Signed values are mapped to unsigned ones via zigzag encoding beforehand
+(0, -1, 1, -2, ... -> 0, 1, 2, 3, ...) so that values of a small magnitude
+have a short encoding regardless of their sign.
+*/
+struct Varint {
+
+    // Maximum number of bytes of an encoded 64-bit value
+    static constexpr int MAX_BYTES = 10;
+
+    static inline uint64_t zigzag(int64_t x) {
+        return (((uint64_t) x) << 1) ^ (uint64_t) (x >> 63);
+    }
+    static inline int64_t unzigzag(uint64_t x) {
+        return (int64_t) (x >> 1) ^ -((int64_t) (x & 1));
+    }
+
+    static inline int getSize(uint64_t x) {
+        int size = 1;
+        while (x >= 0x80) {
+            x >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    // Writes x to out, returns the number of written bytes.
+    static inline int write(uint64_t x, uint8_t* out) {
+        int size = 0;
+        while (x >= 0x80) {
+            out[size++] = (uint8_t) (x | 0x80);
+            x >>= 7;
+        }
+        out[size++] = (uint8_t) x;
+        return size;
+    }
+    static inline void append(std::vector<uint8_t>& out, uint64_t x) {
+        while (x >= 0x80) {
+            out.push_back((uint8_t) (x | 0x80));
+            x >>= 7;
+        }
+        out.push_back((uint8_t) x);
+    }
+
+    // Reads a value of at most maxBytes bytes from [pos, end) into x and advances pos.
+    // Returns false if the input ends prematurely or the value is too long.
+    static inline bool read(const uint8_t*& pos, const uint8_t* end, uint64_t& x, int maxBytes = MAX_BYTES) {
+        x = 0;
+        for (int shift = 0; shift < 7*maxBytes && pos < end; shift += 7) {
+            uint8_t byte = *(pos++);
+            x |= ((uint64_t) (byte & 0x7f)) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+};
+
+#endif
@@ -24,7 +24,7 @@
 
 Worker::Worker(MPI_Comm comm, Parameters& params) :
     _comm(comm), _world_rank(MyMpi::rank(MPI_COMM_WORLD)), 
-    _params(params), _job_db(_params, _comm, _sys_state), _sys_state(_comm, params.sysstatePeriod(), SysState<9>::ALLREDUCE), 
+    _params(params), _job_db(_params, _comm, _sys_state), _sys_state(_comm, params.sysstatePeriod(), WorkerSysState::ALLREDUCE), 
     _watchdog(/*enabled=*/_params.watchdog(), /*checkIntervMillis=*/100, Timer::elapsedSeconds())
 {
     _watchdog.setWarningPeriod(50); // warn after 50ms without a reset
@@ -59,7 +59,7 @@ void Worker::init() {
     // Write tag of currently handled message into watchdog
     q.setCurrentTagPointers(_watchdog.activityRecvTag(), _watchdog.activitySendTag());
 
-    q.registerSentCallback(MSG_SEND_JOB_DESCRIPTION, [&](int sendId) {
+    auto descSentCb = [&](int sendId) {
         auto it = _send_id_to_job_id.find(sendId);
         if (it != _send_id_to_job_id.end()) {
             int jobId = it->second;
@@ -68,6 +68,31 @@ void Worker::init() {
             }
             _send_id_to_job_id.erase(sendId);
         }
+    };
+    q.registerSentCallback(MSG_SEND_JOB_DESCRIPTION, descSentCb);
+    q.registerSentCallback(MSG_SEND_ENCODED_JOB_DESCRIPTION, descSentCb);
+    q.registerSentCallback(MSG_SEND_JOB_REVISION_RANGE, descSentCb);
+
+    if (_params.descriptionChunkSize() > 0) {
+        // Each chunk must fit into a single (non-batched) message
+        size_t chunkSize = std::min((size_t) _params.descriptionChunkSize(), 
+            _params.messageBatchingThreshold() - sizeof(DescriptionStreamer::ChunkHeader));
+        _desc_streamer.reset(new DescriptionStreamer(chunkSize, MAX_DESCRIPTION_CHUNKS_IN_FLIGHT, 
+            [&](int jobId, int dest) {
+                // Only stream to nodes which are still children of this job
+                if (!_job_db.has(jobId)) return false;
+                auto& tree = _job_db.get(jobId).getJobTree();
+                return (tree.hasLeftChild() && tree.getLeftChildNodeRank() == dest)
+                    || (tree.hasRightChild() && tree.getRightChildNodeRank() == dest);
+            },
+            [&](int jobId, int revision, int dest) {
+                // The relayed stream broke off: serve the child once the revision is present
+                if (_job_db.has(jobId)) _job_db.get(jobId).addChildWaitingForRevision(dest, revision);
+            }
+        ));
+    }
+    q.registerSentCallback(MSG_SEND_JOB_DESCRIPTION_CHUNK, [&](int sendId) {
+        if (_desc_streamer) _desc_streamer->handleSent(sendId);
     });
 
     // Begin listening to incoming messages
@@ -93,6 +118,8 @@ void Worker::init() {
         [&](auto& h) {handleOfferAdoption(h);});
     q.registerCallback(MSG_QUERY_JOB_DESCRIPTION,
         [&](auto& h) {handleQueryJobDescription(h);});
+    q.registerCallback(MSG_QUERY_JOB_REVISION_RANGE,
+        [&](auto& h) {handleQueryJobRevisionRange(h);});
     q.registerCallback(MSG_QUERY_JOB_RESULT, 
         [&](auto& h) {handleQueryJobResult(h);});
     q.registerCallback(MSG_QUERY_VOLUME, 
@@ -111,6 +138,12 @@ void Worker::init() {
         [&](auto& h) {handleSendApplicationMessage(h);});
     q.registerCallback(MSG_SEND_JOB_DESCRIPTION, 
         [&](auto& h) {handleSendJobDescription(h);});
+    q.registerCallback(MSG_SEND_ENCODED_JOB_DESCRIPTION, 
+        [&](auto& h) {handleSendJobDescription(h);});
+    q.registerCallback(MSG_SEND_JOB_DESCRIPTION_CHUNK, 
+        [&](auto& h) {handleSendJobDescription(h);});
+    q.registerCallback(MSG_SEND_JOB_REVISION_RANGE, 
+        [&](auto& h) {handleSendJobDescription(h);});
     q.registerCallback(MSG_NOTIFY_ASSIGNMENT_UPDATE, 
         [&](auto& h) {_coll_assign.handle(h);});
     q.registerCallback(MSG_SCHED_RELEASE_FROM_WAITING, 
@@ -235,6 +268,7 @@ void Worker::advance(float time) {
         // Forget jobs that are old or wasting memory
         _watchdog.setActivity(Watchdog::FORGET_OLD_JOBS);
         _job_db.forgetOldJobs();
+        if (_desc_streamer) _desc_streamer->discardIncoming([&](int jobId) {return !_job_db.has(jobId);});
 
         // Continue to bounce requests which were deferred earlier
         _watchdog.setActivity(Watchdog::THAW_JOB_REQUESTS);
@@ -297,6 +331,9 @@ void Worker::checkStats(float time) {
     // Print further stats?
     if (_periodic_big_stats_check.ready(time)) {
 
+        // For the message queue
+        MyMpi::getMessageQueue().logStatistics();
+
         // For the current job
         if (_job_db.hasActiveJob()) {
             Job& job = _job_db.getActive();
@@ -428,10 +465,11 @@ void Worker::publishAndResetSysState() {
         float ratioFulfilled = numDesires <= 0 ? 0 : (float)numFulfilledDesires / numDesires;
         float latency = numFulfilledDesires <= 0 ? 0 : result[SYSSTATE_SUMDESIRELATENCIES] / numFulfilledDesires;
 
-        LOG(V2_INFO, "sysstate busyratio=%.3f cmtdratio=%.3f jobs=%i globmem=%.2fGB newreqs=%i hops=%i\n", 
+        LOG(V2_INFO, "sysstate busyratio=%.3f cmtdratio=%.3f jobs=%i globmem=%.2fGB newreqs=%i hops=%i descraw=%.3fMB descsent=%.3fMB desccoding=%.3fs\n", 
                     result[SYSSTATE_BUSYRATIO]/MyMpi::size(_comm), result[SYSSTATE_COMMITTEDRATIO]/MyMpi::size(_comm), 
                     (int)result[SYSSTATE_NUMJOBS], result[SYSSTATE_GLOBALMEM], (int)result[SYSSTATE_SPAWNEDREQUESTS], 
-                    (int)result[SYSSTATE_NUMHOPS]);
+                    (int)result[SYSSTATE_NUMHOPS], result[SYSSTATE_DESCRAWBYTES] / 1e6, 
+                    result[SYSSTATE_DESCSENTBYTES] / 1e6, result[SYSSTATE_DESCCODINGTIME]);
     }
     
     if (!_job_db.isBusyOrCommitted()) {
@@ -444,6 +482,9 @@ void Worker::publishAndResetSysState() {
     _sys_state.setLocal(SYSSTATE_NUMDESIRES, 0);
     _sys_state.setLocal(SYSSTATE_NUMFULFILLEDDESIRES, 0);
     _sys_state.setLocal(SYSSTATE_SUMDESIRELATENCIES, 0);
+    _sys_state.setLocal(SYSSTATE_DESCRAWBYTES, 0);
+    _sys_state.setLocal(SYSSTATE_DESCSENTBYTES, 0);
+    _sys_state.setLocal(SYSSTATE_DESCCODINGTIME, 0);
 }
 
 void Worker::handleNotifyJobAborting(MessageHandle& handle) {
@@ -502,10 +543,13 @@ void Worker::handleAnswerAdoptionOffer(MessageHandle& handle) {
         }
 
         job.setDesiredRevision(req.revision);
+        if (!job.hasDescription() || job.getRevision() < req.revision) {
+            // Revisions published by a co-located worker need not be transferred
+            fetchRevisionsFromHostStore(job, req.revision);
+        }
         if (!job.hasDescription() || job.getRevision() < req.revision) {
             // Transfer of at least one revision is required
-            int requestedRevision = job.hasDescription() ? job.getRevision()+1 : 0;
-            MyMpi::isend(handle.source, MSG_QUERY_JOB_DESCRIPTION, IntPair(jobId, requestedRevision));
+            queryMissingRevisions(job, handle.source);
         }
         if (job.hasDescription()) {
             // At least the initial description is present: Begin to execute job
@@ -536,6 +580,9 @@ void Worker::handleQueryJobDescription(MessageHandle& handle) {
 
     if (job.getRevision() >= revision) {
         sendRevisionDescription(jobId, revision, handle.source);
+    } else if (_desc_streamer && _desc_streamer->relay(jobId, revision, handle.source)) {
+        // This revision is being received right now: forward it chunk by chunk
+        return;
     } else {
         // This revision is not present yet: Defer this query
         // and send the job description upon receiving it
@@ -544,19 +591,131 @@ void Worker::handleQueryJobDescription(MessageHandle& handle) {
     }
 }
 
+void Worker::handleQueryJobRevisionRange(MessageHandle& handle) {
+    IntVec vec = Serializable::get<IntVec>(handle.getRecvData());
+    int jobId = vec[0];
+    int firstRevision = vec[1];
+    int lastRevision = vec[2];
+
+    if (!_job_db.has(jobId)) return;
+    Job& job = _job_db.get(jobId);
+
+    if (job.getRevision() < firstRevision) {
+        // Handle like a query for the first revision of the range
+        if (_desc_streamer && _desc_streamer->relay(jobId, firstRevision, handle.source)) return;
+        job.addChildWaitingForRevision(handle.source, firstRevision);
+        return;
+    }
+    lastRevision = std::min(lastRevision, job.getRevision());
+    if (firstRevision == lastRevision) {
+        sendRevisionDescription(jobId, firstRevision, handle.source);
+        return;
+    }
+
+    // Send all present revisions of the range at once
+    auto packed = job.getDescription().serializeRevisionRange(firstRevision, lastRevision, 
+        _params.dropPastAssumptions());
+    size_t rawSize = 0;
+    for (int rev = firstRevision; rev <= lastRevision; rev++) rawSize += job.getDescription().getTransferSize(rev);
+    _sys_state.addLocal(SYSSTATE_DESCRAWBYTES, rawSize);
+    _sys_state.addLocal(SYSSTATE_DESCSENTBYTES, packed->size());
+    if (_desc_streamer && _desc_streamer->isStreamed(packed->size())) {
+        LOG_ADD_DEST(V4_VVER, "Stream revisions [%i,%i] of %s, size %lu", handle.source, 
+                firstRevision, lastRevision, job.toStr(), packed->size());
+        _desc_streamer->send(jobId, firstRevision, handle.source, MSG_SEND_JOB_REVISION_RANGE, packed);
+        return;
+    }
+    int sendId = MyMpi::isend(handle.source, MSG_SEND_JOB_REVISION_RANGE, packed);
+    LOG_ADD_DEST(V4_VVER, "Sent revisions [%i,%i] of %s, size %lu->%lu, id=%i", handle.source, 
+            firstRevision, lastRevision, job.toStr(), rawSize, packed->size(), sendId);
+    job.getJobTree().addSendHandle(handle.source, sendId);
+    _send_id_to_job_id[sendId] = jobId;
+}
+
 void Worker::sendRevisionDescription(int jobId, int revision, int dest) {
     // Retrieve and send concerned job description
     auto& job = _job_db.get(jobId);
-    const auto& descPtr = job.getSerializedDescription(revision);
-    assert(descPtr->size() == job.getDescription().getTransferSize(revision) 
-        || LOG_RETURN_FALSE("%i != %i\n", descPtr->size(), job.getDescription().getTransferSize(revision)));
-    int sendId = MyMpi::isend(dest, MSG_SEND_JOB_DESCRIPTION, descPtr);
+    const auto& desc = job.getDescription();
+    size_t rawSize = desc.getTransferSize(revision);
+    _sys_state.addLocal(SYSSTATE_DESCRAWBYTES, rawSize);
+
+    int tag = MSG_SEND_JOB_DESCRIPTION;
+    DataPtr descPtr;
+    auto encoding = (DescriptionCodec::Encoding) _params.descriptionTransferEncoding();
+    if (encoding != DescriptionCodec::RAW && rawSize >= MIN_ENCODED_DESCRIPTION_SIZE) {
+        // Encode description for this transfer
+        float time = Timer::elapsedSeconds();
+        auto encoded = DescriptionCodec::encode(desc.getRevisionBytes(revision), desc.getMetadataSize(), 
+            desc.getFormulaPayloadSize(revision), desc.getAssumptionsSize(revision), encoding);
+        time = Timer::elapsedSeconds() - time;
+        _sys_state.addLocal(SYSSTATE_DESCCODINGTIME, time);
+        // Only use the encoding if it actually pays off
+        if (encoded.size() < rawSize) {
+            LOG_ADD_DEST(V4_VVER, "Encoded job desc. of %s rev. %i, size %lu->%lu, in %.4fs", dest, 
+                    job.toStr(), revision, rawSize, encoded.size(), time);
+            tag = MSG_SEND_ENCODED_JOB_DESCRIPTION;
+            descPtr.reset(new std::vector<uint8_t>(std::move(encoded)));
+        }
+    }
+    if (!descPtr) {
+        descPtr = job.getSerializedDescription(revision);
+        assert(descPtr->size() == job.getDescription().getTransferSize(revision) 
+            || LOG_RETURN_FALSE("%i != %i\n", descPtr->size(), job.getDescription().getTransferSize(revision)));
+    }
+    _sys_state.addLocal(SYSSTATE_DESCSENTBYTES, descPtr->size());
+
+    if (_desc_streamer && _desc_streamer->isStreamed(descPtr->size())) {
+        // Send description in chunks which the receiver can relay right away
+        LOG_ADD_DEST(V4_VVER, "Stream job desc. of %s rev. %i, size %lu", dest, 
+                job.toStr(), revision, descPtr->size());
+        _desc_streamer->send(jobId, revision, dest, tag, descPtr);
+        return;
+    }
+
+    int sendId = MyMpi::isend(dest, tag, descPtr);
     LOG_ADD_DEST(V4_VVER, "Sent job desc. of %s rev. %i, size %lu, id=%i", dest, 
             job.toStr(), revision, descPtr->size(), sendId);
     job.getJobTree().addSendHandle(dest, sendId);
     _send_id_to_job_id[sendId] = jobId;
 }
 
+void Worker::relayDescriptionStream(Job& job, int revision) {
+    // Forward the stream to all children which are waiting for this revision
+    auto& waitingRankRevPairs = job.getWaitingRankRevisionPairs();
+    auto it = waitingRankRevPairs.begin();
+    while (it != waitingRankRevPairs.end()) {
+        auto& [rank, rev] = *it;
+        bool isChild = (job.getJobTree().hasLeftChild() && job.getJobTree().getLeftChildNodeRank() == rank)
+            || (job.getJobTree().hasRightChild() && job.getJobTree().getRightChildNodeRank() == rank);
+        if (rev == revision && isChild && _desc_streamer->relay(job.getId(), revision, rank)) {
+            it = waitingRankRevPairs.erase(it);
+        } else ++it;
+    }
+}
+
+bool Worker::fetchRevisionsFromHostStore(Job& job, int maxRevision) {
+    if (!_desc_store) return false;
+    bool fetched = false;
+    int rev = job.hasDescription() ? job.getMaxConsecutiveRevision()+1 : 0;
+    for (; rev <= maxRevision; rev++) {
+        auto segment = _desc_store->attach(job.getId(), rev);
+        if (!segment) break;
+        if (_params.useChecksums()) {
+            // Verify the mapped payload against the published (cumulative) checksum
+            auto checksum = JobDescription::computeChecksum(segment->data(), rev == 0 ? Checksum() 
+                : JobDescription::readChecksum(job.getDescription().getRevisionBytes(rev-1)));
+            if (checksum.get() != segment->getChecksum().get()) {
+                LOG(V1_WARN, "[WARN] %s : checksum fail for host-wide rev. %i\n", job.toStr(), rev);
+                break;
+            }
+        }
+        if (!_job_db.appendRevision(job.getId(), segment, _world_rank)) break;
+        LOG(V4_VVER, "%s : mapped host-wide desc. of rev. %i, size %lu\n", job.toStr(), rev, segment->size());
+        fetched = true;
+    }
+    return fetched;
+}
+
 void Worker::handleRejectOneshot(MessageHandle& handle) {
     OneshotJobRequestRejection rej = Serializable::get<OneshotJobRequestRejection>(handle.getRecvData());
     JobRequest& req = rej.request;
@@ -856,7 +1015,8 @@ void Worker::handleNotifyResultObsolete(MessageHandle& handle) {
 void Worker::handleSendJobDescription(MessageHandle& handle) {
     const auto& data = handle.getRecvData();
     int jobId = data.size() >= sizeof(int) ? Serializable::get<int>(data) : -1;
-    LOG_ADD_SRC(V4_VVER, "Got desc. of size %i for job #%i", handle.source, data.size(), jobId);
+    if (handle.tag != MSG_SEND_JOB_DESCRIPTION_CHUNK)
+        LOG_ADD_SRC(V4_VVER, "Got desc. of size %i for job #%i", handle.source, data.size(), jobId);
     if (jobId == -1 || !_job_db.has(jobId)) {
         if (_job_db.hasCommitment(jobId)) {
             _job_db.uncommit(jobId);
@@ -868,18 +1028,62 @@ void Worker::handleSendJobDescription(MessageHandle& handle) {
 
     // Append revision description to job
     auto& job = _job_db.get(jobId);
-    auto dataPtr = std::shared_ptr<std::vector<uint8_t>>(
-        new std::vector<uint8_t>(handle.moveRecvData())
-    );
-    bool valid = _job_db.appendRevision(jobId, dataPtr, handle.source);
-    if (!valid) {
-        // Need to clean up shared pointer concurrently 
-        // because it might take too much time in the main thread
+    int tag = handle.tag;
+    std::shared_ptr<std::vector<uint8_t>> dataPtr;
+    if (tag == MSG_SEND_JOB_DESCRIPTION_CHUNK) {
+        if (!_desc_streamer) return;
+        auto completed = _desc_streamer->handleChunk(handle.source, data);
+        if (!completed.data) {
+            // Stream still in progress: let waiting children take part
+            int revision = DescriptionStreamer::readHeader(data).revision;
+            if (_desc_streamer->isReceiving(jobId, revision)) relayDescriptionStream(job, revision);
+            return;
+        }
+        LOG_ADD_SRC(V4_VVER, "Completed desc. stream of size %lu for job #%i", handle.source, 
+            completed.data->size(), jobId);
+        tag = completed.tag;
+        dataPtr = std::move(completed.data);
+    }
+    if (tag == MSG_SEND_ENCODED_JOB_DESCRIPTION) {
+        // Decode description directly into its final serialization
+        float time = Timer::elapsedSeconds();
+        size_t encodedSize = dataPtr ? dataPtr->size() : data.size();
+        dataPtr = DescriptionCodec::decode(dataPtr ? *dataPtr : data);
+        time = Timer::elapsedSeconds() - time;
+        _sys_state.addLocal(SYSSTATE_DESCCODINGTIME, time);
+        if (!dataPtr) {
+            LOG_ADD_SRC(V1_WARN, "[WARN] Malformed encoded desc. for job #%i", handle.source, jobId);
+            return;
+        }
+        LOG_ADD_SRC(V4_VVER, "Decoded desc. of size %lu->%lu for job #%i in %.4fs", handle.source, 
+            encodedSize, dataPtr->size(), jobId, time);
+    } else if (!dataPtr) {
+        dataPtr.reset(new std::vector<uint8_t>(handle.moveRecvData()));
+    }
+
+    std::vector<std::shared_ptr<std::vector<uint8_t>>> revisions;
+    if (tag == MSG_SEND_JOB_REVISION_RANGE) {
+        // Split catch-up message into the individual revisions
+        revisions = JobDescription::deserializeRevisionRange(*dataPtr);
+        if (revisions.empty()) {
+            LOG_ADD_SRC(V1_WARN, "[WARN] Malformed revision range for job #%i", handle.source, jobId);
+            return;
+        }
+        LOG_ADD_SRC(V4_VVER, "Got revisions [%i,%i] of job #%i", handle.source, 
+            JobDescription::readRevisionIndex(*revisions.front()), 
+            JobDescription::readRevisionIndex(*revisions.back()), jobId);
         ProcessWideThreadPool::get().addTask([sharedPtr = std::move(dataPtr)]() mutable {
             sharedPtr.reset();
         });
-        return;
+    } else revisions.push_back(std::move(dataPtr));
+
+    bool valid = false;
+    for (auto& revisionData : revisions) {
+        // Skip revisions which are already present
+        if (appendReceivedRevision(jobId, std::move(revisionData), handle.source)) valid = true;
+        else if (valid) break;
     }
+    if (!valid) return;
 
     // If job has not started yet, execute it now
     if (_job_db.hasCommitment(jobId)) {
@@ -896,10 +1100,45 @@ void Worker::handleSendJobDescription(MessageHandle& handle) {
     if (job.getState() != ACTIVE) return;
 
     // Arrived at final revision?
-    if (_job_db.get(jobId).getRevision() < _job_db.get(jobId).getDesiredRevision()) {
-        // No: Query next revision
-        MyMpi::isend(handle.source, MSG_QUERY_JOB_DESCRIPTION, IntPair(jobId, _job_db.get(jobId).getRevision()+1));
+    if (job.getRevision() < job.getDesiredRevision()) {
+        fetchRevisionsFromHostStore(job, job.getDesiredRevision());
+    }
+    if (job.getRevision() < job.getDesiredRevision()) {
+        // No: Query next revision(s)
+        queryMissingRevisions(job, handle.source);
+    }
+}
+
+void Worker::queryMissingRevisions(Job& job, int dest) {
+    int firstRevision = job.hasDescription() ? job.getRevision()+1 : 0;
+    int lastRevision = job.getDesiredRevision();
+    if (_params.catchUpRevisions() && lastRevision > firstRevision) {
+        // Catch up with all missing revisions at once
+        MyMpi::isend(dest, MSG_QUERY_JOB_REVISION_RANGE, IntVec({job.getId(), firstRevision, lastRevision}));
+    } else {
+        MyMpi::isend(dest, MSG_QUERY_JOB_DESCRIPTION, IntPair(job.getId(), firstRevision));
+    }
+}
+
+bool Worker::appendReceivedRevision(int jobId, std::shared_ptr<std::vector<uint8_t>>&& dataPtr, int source) {
+    bool valid;
+    std::shared_ptr<HostDescriptionSegment> segment;
+    if (_desc_store) {
+        // Publish the revision for co-located workers and keep only the host-wide copy
+        int rev = JobDescription::readRevisionIndex(*dataPtr);
+        segment = _desc_store->publish(jobId, rev, dataPtr->data(), dataPtr->size(), 
+            JobDescription::readChecksum(dataPtr->data()));
+    }
+    if (segment) valid = _job_db.appendRevision(jobId, segment, source);
+    else valid = _job_db.appendRevision(jobId, dataPtr, source);
+    if (!valid || segment) {
+        // Need to clean up shared pointer concurrently 
+        // because it might take too much time in the main thread
+        ProcessWideThreadPool::get().addTask([sharedPtr = std::move(dataPtr)]() mutable {
+            sharedPtr.reset();
+        });
     }
+    return valid;
 }
 
 void Worker::handleNotifyJobTerminating(MessageHandle& handle) {
@@ -21,6 +21,9 @@
 #include "util/periodic_event.hpp"
 #include "util/sys/watchdog.hpp"
 #include "comm/host_comm.hpp"
+#include "data/host_description_store.hpp"
+#include "data/description_codec.hpp"
+#include "comm/description_streamer.hpp"
 
 /*
 Primary actor in the system who is responsible for participating in the scheduling and execution of jobs.
@@ -57,21 +60,32 @@ private:
     robin_hood::unordered_map<std::pair<int, int>, JobResult, IntPairHasher> _pending_results;
 
     robin_hood::unordered_map<int, int> _send_id_to_job_id;
+    // Smaller descriptions are always transferred without encoding
+    static const size_t MIN_ENCODED_DESCRIPTION_SIZE = 1 << 16;
+    // Pipelined transfer of descriptions in chunks (if enabled)
+    std::unique_ptr<DescriptionStreamer> _desc_streamer;
+    static const int MAX_DESCRIPTION_CHUNKS_IN_FLIGHT = 4;
 
     HostComm* _host_comm;
+    std::unique_ptr<HostDescriptionStore> _desc_store;
 
 public:
     Worker(MPI_Comm comm, Parameters& params);
     ~Worker();
     void init();
     void advance(float time = -1);
-    void setHostComm(HostComm& hostComm) {_host_comm = &hostComm;}
+    void setHostComm(HostComm& hostComm) {
+        _host_comm = &hostComm;
+        if (_params.hostSharedDescriptions())
+            _desc_store.reset(new HostDescriptionStore(hostComm.getHostLeaderPid()));
+    }
 
 private:
     void handleRequestNode(MessageHandle& handle, JobDatabase::JobRequestMode mode);
     void handleOfferAdoption(MessageHandle& handle);
     void handleAnswerAdoptionOffer(MessageHandle& handle);
     void handleQueryJobDescription(MessageHandle& handle);
+    void handleQueryJobRevisionRange(MessageHandle& handle);
     void handleSendJobDescription(MessageHandle& handle);
 
     void handleNotifyJobAborting(MessageHandle& handle);
@@ -95,6 +109,10 @@ private:
     void handleSchedNodeFreed(MessageHandle& handle);
 
     void sendRevisionDescription(int jobId, int revision, int dest);
+    void relayDescriptionStream(Job& job, int revision);
+    void queryMissingRevisions(Job& job, int dest);
+    bool appendReceivedRevision(int jobId, std::shared_ptr<std::vector<uint8_t>>&& dataPtr, int source);
+    bool fetchRevisionsFromHostStore(Job& job, int maxRevision);
     void bounceJobRequest(JobRequest& request, int senderRank);
 
     void checkStats(float time);